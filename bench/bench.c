@@ -0,0 +1,2512 @@
+/*
+ *  Benchmark:
+ *  Measures the GPIO and I2C hot paths and prints the results as JSON or CSV
+ *  so releases can be compared. Built twice by bench/Makefile, bench.exe
+ *  against librpigpio.a for real hardware and bench_sim.exe against
+ *  librpigpiosim.a, where a register file slave is attached at the I2C
+ *  address used.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Usage:
+ *  bench.exe [-c|-j] [-d] [-n samples] [-p gpio] [-a address] [-l length]
+ *            [-s channels]
+ *
+ *  -c / -j     CSV or JSON (default) output.
+ *  -n          Samples per measurement.
+ *  -p          Output pin toggled, left as an output afterwards.
+ *  -a          I2C slave used for transactions. Omit on hardware to skip
+ *              the transaction benchmarks, the scan is always run.
+ *  -l          Bytes per I2C transaction.
+ *  -s          Software PWM channels, driven on GPIO 2 upwards. Defaults to
+ *              none on hardware as every channel pin is driven.
+ *
+ *  -d          Run the DMA capture, which toggles the output pin. Always
+ *              run by bench_sim.exe.
+ *
+ *  board_detect parses canned /proc/cpuinfo revision lines and looks up
+ *  their boards, rate is lines per second. Failures are boards with the
+ *  wrong SoC, peripheral base, header pins or BSC, bad lines and unknown
+ *  codes which are not rejected, and revisions gpioSetup() detects
+ *  differently. Only run by bench_sim.exe.
+ *  i2c_set_timing times gpioI2cSetTiming(). Beforehand 10, 100 and 400 kHz
+ *  are set on boards with 250, 400 and 500 MHz core clocks, counting a
+ *  failure for each divider, achieved frequency, byte time, data delay or
+ *  timeout read back wrongly, and if a rejected timing changes the bus.
+ *  Only run by bench_sim.exe.
+ *  wave_build builds DMA waveform chains without starting them and walks
+ *  each chain, counting a failure if its edges or timing are wrong.
+ *  debounce_update filters 32 pins which toggle at different rates with
+ *  short glitches, counting a failure for each sample where the debounced
+ *  levels are not the glitch free levels delayed by the threshold.
+ *  encoder_read_levels and encoder_read_events time gpioEncoderRead() while
+ *  simulated encoders are turned, counting a failure for each encoder whose
+ *  final count is wrong or which saw an error. Only run by bench_sim.exe.
+ *  pulse_period_error measures two software PWM outputs, reporting how far
+ *  the measured period is from the real one and counting a failure for
+ *  each reading whose period or duty is out of tolerance. Only run by
+ *  bench_sim.exe.
+ *  soft_i2c_1bus and soft_i2c_4bus write then read back a register file on
+ *  one and four bit banged buses clocked together, rate is the bytes moved
+ *  by all the buses. Failures are errors and data read back wrongly. Only
+ *  run by bench_sim.exe.
+ *  soft_spi_1lane and soft_spi_8lane time unpaced software SPI transfers,
+ *  rate is the bits moved by all the lanes. Beforehand each mode and bit
+ *  order is checked by decoding MOSI from the pin levels, with MISO held at
+ *  a fixed level, counting a failure for each wrong byte. Only run by
+ *  bench_sim.exe.
+ *  one_wire_read_1bus and one_wire_read_4bus search for the probes on one
+ *  and four 1-Wire buses driven together, then time a conversion and a read
+ *  of every probe's scratchpad, rate is probes read. A step which fails,
+ *  usually as a slot was late, is tried again. Failures are steps which
+ *  never succeeded, ROMs not found and wrong temperatures. Only run by
+ *  bench_sim.exe.
+ *  led_encode_1strip and led_encode_8strip time encoding a frame of LEDs on
+ *  one and eight strips. led_show_1strip and led_show_8strip time showing
+ *  it by spinning, rate is frames. A frame reported late is shown again.
+ *  Failures are frames never shown on time and frames whose bits, decoded
+ *  from the pin levels, are wrong. led_show_dma_8strip times frames played
+ *  by DMA until their latch ends, failures are errors. Only run by
+ *  bench_sim.exe.
+ *  shift_update_1chain and shift_update_8chain time gpioShiftUpdate() on
+ *  one and eight chains of 74HC595s and 74HC165s sharing a clock and latch,
+ *  with new outputs written before each update, rate is updates. Failures
+ *  are errors, outputs latched by the simulated 595s which differ from
+ *  those written and inputs read which differ from those set on the
+ *  simulated 165s. Only run by bench_sim.exe.
+ *  parallel_write_8bit and parallel_write_16bit time gpioParallelWrite() of
+ *  a block of words on an 8080 bus, rate is words. parallel_flush_full
+ *  times gpioParallelFlush() of a whole RGB565 frame on an 8 bit bus and
+ *  parallel_flush_dirty of two small changed regions, rate is flushes.
+ *  Words written are decoded from the pin levels at each rising WR, and for
+ *  flushes replayed into a model display. Failures are errors, words which
+ *  differ from those written and model pixels which differ from the frame.
+ *  Only run by bench_sim.exe.
+ *  keypad_event_8x8 presses and releases keys of a simulated 8x8 matrix
+ *  scanned every KEYPAD_PERIOD_NS, timing each from the switch changing to
+ *  its event being read. Failures are events for the wrong key, missing
+ *  events and keys whose state reads back wrongly. Only run by
+ *  bench_sim.exe.
+ *  shm_read_levels is the time a client takes to read the daemon's
+ *  snapshot, averaged over SHM_READ_BATCH reads. shm_write_latency is the
+ *  time from a client queueing a pin change to the snapshot showing it,
+ *  with the daemon period SHM_BENCH_PERIOD_NS. Failures are changes not
+ *  seen, and events which do not match them. Only run by bench_sim.exe.
+ *  i2c_arbiter_1client times a batch through the I2C arbiter, a register
+ *  write then a read of it back, at the fastest clock, and
+ *  i2c_arbiter_4clients the same while 3 other processes send batches as
+ *  fast as they can, so each waits its turn. Failures are batches which
+ *  fail or read back the wrong data, or are missing from the arbiter's
+ *  per client counts. Only run by bench_sim.exe.
+ *  i2c_record_write_read times a register write then a read of it back at
+ *  the fastest clock while the traffic is recorded, failures are wrong
+ *  data and a recording which could not be written. i2c_replay replays that
+ *  recording back to back RECORD_REPLAYS times and then once at its
+ *  recorded times, the time is per call, failures are calls whose status or
+ *  data differs from the recording. Only run by bench_sim.exe.
+ *  capture_half_interval is the time between capture callbacks, failures
+ *  are overruns, gaps in the sample index and missed pin transitions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "rpiGpio.h"
+#ifdef GPIO_SIM
+#include "rpiGpioSim.h"
+#endif
+
+#define DEFAULT_SAMPLES     1000
+#define DEFAULT_PIN         17
+#define DEFAULT_LENGTH      16
+#define SIM_ADDRESS         0x50
+#define BATCH               100 /* Calls timed together for the fast paths */
+#define MAX_LENGTH          256
+#define SCAN_FIRST          0x08
+#define SCAN_LAST           0x77
+#define SIM_PWM_CHANNELS    16
+#define PWM_FIRST_PIN       2
+#define PWM_PERIOD_NS       1000000 /* 1 kHz */
+#define PWM_RUN_NS          500000000
+#define PWM_OVERRUN_GROSS   10      /* Percent of periods overrun which fails */
+#define WAVE_CHANNELS       8       /* Servo pulses on GPIO 2 upwards */
+#define WAVE_TICK_NS        1000
+#define WAVE_PERIOD_NS      20000000
+#define WAVE_BLOCKS         64
+#define WAVE_BUS            0xC0000000
+#define WAVE_PERI_BUS       0x7E000000
+#define DEBOUNCE_SAMPLES    4
+#define DEBOUNCE_PERIOD     16      /* Pin n toggles every PERIOD + n samples */
+#define DEBOUNCE_GLITCH     7       /* and glitches for 2 samples at GLITCH */
+#define ENCODERS            4       /* On GPIO 4 upwards, odd ones reversed */
+#define ENCODER_FIRST_PIN   4
+#define ENCODER_STEPS       500
+#define ENCODER_STEP_NS     1000000
+#define ENCODER_SAMPLE_NS   100000
+#define PULSE_SIGNAL_NS     2000000 /* Software PWM measured, 500 Hz */
+#define PULSE_SAMPLE_NS     100000
+#define PULSE_WINDOW        64
+#define PULSE_READS         50
+#define PULSE_READ_NS       10000000
+#define PULSE_PERIOD_GROSS_NS 500000 /* 25 %, only this fails */
+#define PULSE_DUTY_GROSS    100000  /* 10 %, only this fails */
+#define SOFT_I2C_FIRST_PIN  20      /* Buses on GPIO 20 - 27, SDA even */
+#define SOFT_I2C_BUSES_MAX  4
+#define SOFT_I2C_FREQ       100000
+#define SOFT_I2C_SAMPLES    20
+#define SOFT_SPI_SCLK_PIN   20
+#define SOFT_SPI_CS_PIN     21
+#define SOFT_SPI_MOSI_PIN   4       /* Lane n on GPIO 4 + n */
+#define SOFT_SPI_LANES_MAX  8
+#define SOFT_SPI_CHECK      8       /* Bytes checked in each mode */
+#define ONE_WIRE_FIRST_PIN  22      /* Buses on GPIO 22 upwards */
+#define ONE_WIRE_BUSES_MAX  4
+#define ONE_WIRE_PROBES     3       /* Probes on each bus */
+#define ONE_WIRE_SAMPLES    5
+#define ONE_WIRE_ATTEMPTS   8       /* A late slot fails the attempt, a retry */
+#define LED_FIRST_PIN       4       /* Strip n on GPIO 4 + n */
+#define LED_STRIPS_MAX      8
+#define LED_LEDS            30      /* Short frames, so fewer are preempted */
+#define LED_SAMPLES         50
+#define LED_ATTEMPTS        64      /* A preempted cell fails the attempt */
+#define LED_DECODE_NS       675     /* Between a late 0 and a 1 */
+#define LED_TICK_NS         400
+#define SHIFT_CLOCK_PIN     20
+#define SHIFT_LATCH_PIN     21      /* Also loads the 165s */
+#define SHIFT_OUT_PIN       4       /* Chain n on GPIO 4 + n */
+#define SHIFT_IN_PIN        12      /* and GPIO 12 + n */
+#define SHIFT_CHAINS_USED   8
+#define SHIFT_REGISTERS     4
+#define PARALLEL_DATA_PIN   4       /* D0 on GPIO 4, D15 on GPIO 19 */
+#define PARALLEL_WR_PIN     20
+#define PARALLEL_RD_PIN     21
+#define PARALLEL_DC_PIN     22
+#define PARALLEL_CS_PIN     23
+#define PARALLEL_WORDS      1024
+#define PARALLEL_FRAME_W    64
+#define PARALLEL_FRAME_H    48
+#define PARALLEL_PATCH      8       /* Side of each region changed */
+#define PARALLEL_SAMPLES    50
+#define KEYPAD_COLUMN_PIN   4       /* Column n on GPIO 4 + n */
+#define KEYPAD_ROW_PIN      12      /* and row n on GPIO 12 + n */
+#define KEYPAD_PERIOD_NS    50000
+#define KEYPAD_SAMPLES      3       /* Scans a key is debounced for */
+#define KEYPAD_KEYS         64
+#define KEYPAD_TIMEOUT_NS   20000000
+#define SHM_BENCH_NAME      "/rpigpio_bench"
+#define SHM_BENCH_PIN       22
+#define SHM_BENCH_PERIOD_NS 20000
+#define SHM_READ_BATCH      100     /* Reads timed together per sample */
+#define SHM_TIMEOUT_NS      20000000
+#define ARBITER_PATH        "/tmp/rpigpio_bench_i2c"
+#define ARBITER_CLIENTS     4       /* This process and 3 forked ones */
+#define RECORD_PATH         "/tmp/rpigpio_bench.i2c"
+#define RECORD_REPLAYS      5
+#define PWM_HW_CLOCK_HZ     4800000 /* Hardware PWM clock */
+#define PWM_HW_PIN_1        18      /* Channel 1 */
+#define PWM_HW_PIN_2        13      /* Channel 2 */
+#define PWM_HW_FREQ         1000
+#define CLOCK_PIN           4       /* GPCLK0 */
+#define CLOCK_FREQ          1000000 /* Needs a fractional divisor */
+#define CAPTURE_TICK_NS     10000
+#define CAPTURE_HALF        1000
+#define CAPTURE_TOGGLE_NS   5000000
+#define CAPTURE_TOGGLES     100
+#define I2C_CLKT_BENCH      0x80        /* Clock stretch timeout set, in SCL clocks */
+#define BOARD_REV1_PINS     0x03E6CF93  /* GPIO on the rev1 P1 header */
+#define BOARD_REV2_PINS     0x0BC6CF9C  /* GPIO on the rev2 P1 header */
+#define BOARD_J8_PINS       0x0FFFFFFF  /* GPIO on the 40 pin J8 header */
+
+typedef enum {
+    formatJson,
+    formatCsv
+} eFormat;
+
+typedef struct {
+    const char * line;      /* As read from /proc/cpuinfo */
+    errStatus    status;    /* Expected from parsing and look up */
+    tSoc         soc;
+    uint32_t     peripheralBase;
+    uint32_t     validPins;
+    uint32_t     bscOffset;
+} tBoardCase;
+
+typedef struct {
+    uint64_t * intervals;   /* Time between callbacks */
+    int        count;       /* Entries available in intervals */
+    int        halves;
+    uint64_t   last;        /* Time of the previous callback */
+    uint64_t   expected;    /* Index of the next sample */
+    int        gaps;
+    uint32_t   mask;        /* Pin watched for transitions */
+    uint32_t   level;
+    int        transitions;
+} tCaptureBench;
+
+typedef struct {
+    uint32_t sclk;
+    uint32_t mosi[SOFT_SPI_LANES_MAX];
+    int      lanes;
+    int      sampleHigh;    /* SCLK level after the edge the slave samples */
+    int      lsbFirst;
+    int      bits;          /* Bits seen on each lane */
+    uint8_t  seen[SOFT_SPI_LANES_MAX][SOFT_SPI_CHECK];
+} tSpiBench;
+
+typedef struct {
+    uint32_t pins[LED_STRIPS_MAX];
+    int      strips;
+    uint64_t rise[LED_STRIPS_MAX];
+    int      bits[LED_STRIPS_MAX];  /* Bits seen on each strip */
+    uint8_t  seen[LED_STRIPS_MAX][LED_LEDS * 3];
+} tLedBench;
+
+typedef struct {
+    int      width;
+    uint32_t command;       /* Last command, 0 before any */
+    int      params;
+    uint8_t  param[4];
+    int      x0, x1, y0, y1;
+    int      x, y;
+    int      high;          /* The high byte of a pixel was seen */
+    uint32_t pixel;
+    int      count;         /* Words seen outside a command */
+    uint32_t words[PARALLEL_WORDS];
+    uint16_t model[PARALLEL_FRAME_H][PARALLEL_FRAME_W];
+} tParallelBench;
+
+typedef struct {
+    const char * name;
+    const char * unit;
+    uint64_t     p50;
+    uint64_t     p90;
+    uint64_t     p99;
+    uint64_t     max;
+    double       rate;      /* Operations or bytes per second at p50 */
+    const char * rateUnit;
+    int          failures;
+} tResult;
+
+static eFormat gFormat = formatJson;
+static int gResultCount = 0;
+
+static uint64_t nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static int compareU64(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Sorts samples and fills the percentiles of result. rateScale is the number
+ * of operations or bytes one sample represents. */
+static void summarise(tResult * result, uint64_t * samples, int count,
+                      double rateScale)
+{
+    qsort(samples, count, sizeof(uint64_t), compareU64);
+
+    result->p50 = samples[count * 50 / 100];
+    result->p90 = samples[count * 90 / 100];
+    result->p99 = samples[count * 99 / 100];
+    result->max = samples[count - 1];
+    result->rate = result->p50 ? rateScale * 1e9 / result->p50 : 0;
+}
+
+static void emit(const tResult * result)
+{
+    if (gFormat == formatCsv)
+    {
+        if (gResultCount == 0)
+        {
+            printf("name,unit,p50,p90,p99,max,rate,rate_unit,failures\n");
+        }
+
+        printf("%s,%s,%llu,%llu,%llu,%llu,%.1f,%s,%d\n",
+               result->name, result->unit,
+               (unsigned long long)result->p50, (unsigned long long)result->p90,
+               (unsigned long long)result->p99, (unsigned long long)result->max,
+               result->rate, result->rateUnit, result->failures);
+    }
+
+    else
+    {
+        printf("%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"p50\": %llu, "
+               "\"p90\": %llu, \"p99\": %llu, \"max\": %llu, \"rate\": %.1f, "
+               "\"rate_unit\": \"%s\", \"failures\": %d}",
+               gResultCount ? "," : "[",
+               result->name, result->unit,
+               (unsigned long long)result->p50, (unsigned long long)result->p90,
+               (unsigned long long)result->p99, (unsigned long long)result->max,
+               result->rate, result->rateUnit, result->failures);
+    }
+
+    gResultCount++;
+}
+
+#ifdef GPIO_SIM
+/* Parses and looks up canned revision lines, then detects each known one
+ * with gpioSetup(). Must run before the main gpioSetup(). */
+static void benchBoard(uint64_t * samples, int count)
+{
+    static const tBoardCase cases[] = {
+        {"Revision\t: 0002\n", OK, socBcm2835, BCM2835_PERI_BASE,
+         BOARD_REV1_PINS, BSC0_BASE_OFFSET},
+        {"Revision\t: 000e\n", OK, socBcm2835, BCM2835_PERI_BASE,
+         BOARD_REV2_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: 0010\n", OK, socBcm2835, BCM2835_PERI_BASE,
+         BOARD_J8_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: 0015\n", OK, socBcm2835, BCM2835_PERI_BASE,
+         BOARD_J8_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: a02082\n", OK, socBcm2837, BCM2837_PERI_BASE,
+         BOARD_J8_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: a03111\n", OK, socBcm2711, BCM2711_PERI_BASE,
+         BOARD_J8_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: c03111\n", OK, socBcm2711, BCM2711_PERI_BASE,
+         BOARD_J8_PINS, BSC1_BASE_OFFSET},
+        /* Warranty bit set on a rev2 board */
+        {"Revision\t: 1000000e\n", OK, socBcm2835, BCM2835_PERI_BASE,
+         BOARD_REV2_PINS, BSC1_BASE_OFFSET},
+        {"Revision\t: \n", ERROR_RANGE, socBcm2835, 0, 0, 0},
+        {"Hardware\t: BCM2835\n", ERROR_RANGE, socBcm2835, 0, 0, 0},
+        /* Old style codes never used, and a new style BCM2712 */
+        {"Revision\t: 0001\n", ERROR_RANGE, socBcm2835, 0, 0, 0},
+        {"Revision\t: 0016\n", ERROR_RANGE, socBcm2835, 0, 0, 0},
+        {"Revision\t: c04170\n", ERROR_RANGE, socBcm2835, 0, 0, 0},
+    };
+    static const int caseCount = sizeof(cases) / sizeof(cases[0]);
+    tResult result = {"board_detect", "ns/table", 0, 0, 0, 0, 0, "line/s", 0};
+    const tBoard * board = NULL;
+    const tBoard * detected = NULL;
+    uint32_t revision = 0;
+    errStatus status = ERROR_DEFAULT;
+    uint64_t start = 0;
+    int sample = 0;
+    int index = 0;
+
+    for (index = 0; index < caseCount; index++)
+    {
+        board = NULL;
+
+        if ((status = gpioParseRevision(cases[index].line, &revision)) == OK)
+        {
+            status = gpioLookupBoard(revision, &board);
+        }
+
+        result.failures += status != cases[index].status;
+
+        if (status == OK && cases[index].status == OK)
+        {
+            result.failures += board->soc != cases[index].soc ||
+                               board->peripheralBase != cases[index].peripheralBase ||
+                               board->validPins != cases[index].validPins ||
+                               board->bscOffset != cases[index].bscOffset;
+        }
+
+        /* The same revision through gpioSetup(), which must fail if unknown */
+        if (gpioParseRevision(cases[index].line, &revision) == OK)
+        {
+            simSetRevision(revision);
+            status = gpioSetup();
+            result.failures += (status == OK) != (board != NULL) ||
+                               (status == OK && (gpioGetBoard(&detected) != OK ||
+                                                 detected != board));
+            gpioCleanup();
+        }
+    }
+
+    simSetRevision(SIM_DEFAULT_REVISION);
+
+    for (sample = 0; sample < count; sample++)
+    {
+        start = nowNs();
+
+        for (index = 0; index < caseCount; index++)
+        {
+            if (gpioParseRevision(cases[index].line, &revision) == OK)
+            {
+                gpioLookupBoard(revision, &board);
+            }
+        }
+
+        samples[sample] = nowNs() - start;
+    }
+
+    summarise(&result, samples, count, caseCount);
+    emit(&result);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* Compares members, as the padding of tI2cClock is never written */
+static int clockDiffers(const tI2cClock * a, const tI2cClock * b)
+{
+    return a->divider != b->divider || a->frequency != b->frequency ||
+           a->byteTime_ns != b->byteTime_ns || a->fallingDelay != b->fallingDelay ||
+           a->risingDelay != b->risingDelay ||
+           a->clockStretchTimeout != b->clockStretchTimeout;
+}
+
+/* Sets each clock on a board of each core clock and checks the divider read
+ * back. Must run before the main gpioSetup(). */
+static void benchI2cClock(uint64_t * samples, int count)
+{
+    static const uint32_t revisions[] = {0x000010, 0xa02082, 0xa03111};
+    static const uint32_t coreHz[] = {250000000, 400000000, 500000000};
+    static const uint32_t frequencies[] = {10000, 100000, 400000};
+    /* The smallest even divider not above each frequency */
+    static const uint32_t dividers[][3] = {{25000, 2500, 626},
+                                           {40000, 4000, 1000},
+                                           {50000, 5000, 1250}};
+    tResult result = {"i2c_set_timing", "ns/call", 0, 0, 0, 0, 0, "call/s", 0};
+    tI2cTiming timing = {0, 0, 0, I2C_CLKT_BENCH};
+    tI2cClock achieved;
+    tI2cClock clock;
+    uint64_t start = 0;
+    int sample = 0;
+    int board = 0;
+    int index = 0;
+
+    for (board = 0; board < 3; board++)
+    {
+        simSetRevision(revisions[board]);
+
+        if (gpioSetup() != OK || gpioI2cSetup() != OK)
+        {
+            result.failures++;
+            gpioCleanup();
+            continue;
+        }
+
+        for (index = 0; index < 3; index++)
+        {
+            timing.frequency = frequencies[index];
+            result.failures += gpioI2cSetTiming(&timing, &achieved) != OK ||
+                               gpioI2cGetClock(&clock) != OK ||
+                               clockDiffers(&achieved, &clock) ||
+                               clock.divider != dividers[board][index] ||
+                               clock.frequency != coreHz[board] / dividers[board][index] ||
+                               clock.frequency > frequencies[index] ||
+                               clock.byteTime_ns != (uint32_t)(9ULL * dividers[board][index] *
+                                                               1000000000ULL / coreHz[board]) ||
+                               clock.fallingDelay != dividers[board][index] / 16 ||
+                               clock.risingDelay != dividers[board][index] / 16 ||
+                               clock.clockStretchTimeout != I2C_CLKT_BENCH;
+
+            /* gpioI2cSetClock() sets the same divider, and rescales delays
+             * set for a slower clock */
+            timing.frequency = I2C_CLOCK_FREQ_MIN;
+            timing.fallingDelay = dividers[0][0] / 2;
+            timing.risingDelay = dividers[0][0] / 2;
+            result.failures += gpioI2cSetTiming(&timing, NULL) != OK ||
+                               gpioI2cSetClock((int)frequencies[index]) != OK ||
+                               gpioI2cGetClock(&clock) != OK ||
+                               clock.divider != dividers[board][index] ||
+                               clock.fallingDelay != dividers[board][index] / 16 ||
+                               clock.risingDelay != dividers[board][index] / 16 ||
+                               clock.clockStretchTimeout != I2C_CLKT_BENCH;
+            timing.fallingDelay = 0;
+            timing.risingDelay = 0;
+        }
+
+        /* 0 is the BSC's default timeout, which is only disabled explicitly */
+        timing.clockStretchTimeout = 0;
+        result.failures += gpioI2cSetTiming(&timing, &achieved) != OK ||
+                           achieved.clockStretchTimeout != I2C_CLKT_DEFAULT;
+        timing.clockStretchTimeout = I2C_CLKT_DISABLE;
+        result.failures += gpioI2cSetTiming(&timing, &achieved) != OK ||
+                           achieved.clockStretchTimeout != 0;
+        timing.clockStretchTimeout = I2C_CLKT_BENCH;
+        result.failures += gpioI2cSetTiming(&timing, NULL) != OK ||
+                           gpioI2cGetClock(&clock) != OK;
+
+        /* A delay over half the divider leaves the timing unchanged */
+        timing.risingDelay = BSC_DEL_MAX;
+        result.failures += gpioI2cSetTiming(&timing, NULL) != ERROR_RANGE ||
+                           gpioI2cGetClock(&achieved) != OK ||
+                           clockDiffers(&achieved, &clock);
+        timing.risingDelay = 0;
+
+        /* Timed on the last board only */
+        for (sample = 0; board == 2 && sample < count; sample++)
+        {
+            timing.frequency = frequencies[sample % 3];
+            start = nowNs();
+            result.failures += gpioI2cSetTiming(&timing, NULL) != OK;
+            samples[sample] = nowNs() - start;
+        }
+
+        gpioI2cCleanup();
+        gpioCleanup();
+    }
+
+    simSetRevision(SIM_DEFAULT_REVISION);
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+#endif
+
+static void benchToggle(int pin, uint64_t * samples, int count)
+{
+    tResult result = {"gpio_toggle", "ns/op", 0, 0, 0, 0, 0, "op/s", 0};
+    uint64_t start = 0;
+    int sample = 0;
+    int call = 0;
+
+    for (sample = 0; sample < count; sample++)
+    {
+        start = nowNs();
+        for (call = 0; call < BATCH; call++)
+        {
+            result.failures += gpioSetPin(pin, call & 1 ? low : high) != OK;
+        }
+        samples[sample] = (nowNs() - start) / BATCH;
+    }
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+
+static void benchReadLevels(uint64_t * samples, int count)
+{
+    tResult result = {"gpio_read_levels", "ns/op", 0, 0, 0, 0, 0, "op/s", 0};
+    uint32_t levels = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int call = 0;
+
+    for (sample = 0; sample < count; sample++)
+    {
+        start = nowNs();
+        for (call = 0; call < BATCH; call++)
+        {
+            result.failures += gpioReadLevels(&levels) != OK;
+        }
+        samples[sample] = (nowNs() - start) / BATCH;
+    }
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+
+static void benchSetFunction(int pin, uint64_t * samples, int count)
+{
+    tResult result = {"gpio_set_function", "ns/op", 0, 0, 0, 0, 0, "op/s", 0};
+    uint64_t start = 0;
+    int sample = 0;
+    int call = 0;
+
+    for (sample = 0; sample < count; sample++)
+    {
+        start = nowNs();
+        for (call = 0; call < BATCH; call++)
+        {
+            result.failures += gpioSetFunction(pin, call & 1 ? input : output) != OK;
+        }
+        samples[sample] = (nowNs() - start) / BATCH;
+    }
+
+    gpioSetFunction(pin, output);
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+
+/* One write of length bytes then a read of length bytes per sample. */
+static void benchI2c(int frequency, int length, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/transaction", 0, 0, 0, 0, 0, "byte/s", 0};
+    uint8_t buffer[MAX_LENGTH];
+    uint64_t start = 0;
+    int sample = 0;
+
+    snprintf(name, sizeof(name), "i2c_write_read_%dhz", frequency);
+    memset(buffer, 0, sizeof(buffer));
+
+    if (gpioI2cSetClock(frequency) != OK)
+    {
+        result.failures = count;
+    }
+
+    for (sample = 0; sample < count && result.failures < count; sample++)
+    {
+        start = nowNs();
+        result.failures += gpioI2cWriteData(buffer, length) != OK;
+        result.failures += gpioI2cReadData(buffer, length) != OK;
+        samples[sample] = nowNs() - start;
+    }
+
+    summarise(&result, samples, sample ? sample : 1, 2.0 * length);
+    emit(&result);
+}
+
+static void discard(void * context, eLogLevel level, const char * text, size_t length)
+{
+}
+
+/* Addresses every 7-bit address with a zero length write. NACKs are expected
+ * so logging is discarded while scanning. */
+static void benchScan(uint64_t * samples, int count)
+{
+    tResult result = {"i2c_scan", "ns/scan", 0, 0, 0, 0, 0, "scan/s", 0};
+    uint8_t byte = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int address = 0;
+    int found = 0;
+
+    gpioI2cSetClock(I2C_CLOCK_FREQ_MAX);
+    gpioLogSetSink(discard, NULL);
+
+    for (sample = 0; sample < count; sample++)
+    {
+        found = 0;
+        start = nowNs();
+        for (address = SCAN_FIRST; address <= SCAN_LAST; address++)
+        {
+            gpioI2cSet7BitSlave(address);
+            found += gpioI2cWriteData(&byte, 0) == OK;
+        }
+        samples[sample] = nowNs() - start;
+    }
+
+    gpioLogDrain();
+    gpioLogSetSink(NULL, NULL);
+
+    summarise(&result, samples, count, 1);
+    result.failures = found == 0;
+    emit(&result);
+}
+
+/* Runs channels software PWM outputs with distinct duties, changing one
+ * duty every 10 ms, and reports how late the edges were written. */
+static void benchSoftPwm(int channels)
+{
+    tResult result = {"soft_pwm_edge_lateness", "ns", 0, 0, 0, 0, 0, "edge/s", 0};
+    tSoftPwmStats stats;
+    struct timespec wait = {0, 10000000};
+    uint64_t start = 0;
+    int channel = 0;
+    int step = 0;
+
+    if (gpioSoftPwmStart(PWM_PERIOD_NS, -1) != OK)
+    {
+        result.failures = 1;
+    }
+
+    for (channel = 0; channel < channels && result.failures == 0; channel++)
+    {
+        result.failures += gpioSoftPwmSetDuty(PWM_FIRST_PIN + channel,
+                               PWM_PERIOD_NS / (channels + 1) * (channel + 1)) != OK;
+    }
+
+    start = nowNs();
+    while (result.failures == 0 && nowNs() - start < PWM_RUN_NS)
+    {
+        nanosleep(&wait, NULL);
+        step++;
+        gpioSoftPwmSetDuty(PWM_FIRST_PIN + step % channels,
+                           PWM_PERIOD_NS / 100 * (step % 100));
+    }
+
+    gpioSoftPwmGetStats(&stats);
+    gpioSoftPwmStop();
+
+    /* Percentiles are histogram bucket upper bounds */
+    result.p50 = gpioStatsPercentile(&stats.lateness, 50);
+    result.p90 = gpioStatsPercentile(&stats.lateness, 90);
+    result.p99 = gpioStatsPercentile(&stats.lateness, 99);
+    result.max = stats.maxLateNs;
+    result.rate = stats.lateness.calls * 1e9 / PWM_RUN_NS;
+    /* Lateness is the scheduler's, only failing to keep up at all fails */
+    result.failures += stats.lateness.calls == 0 ||
+                       stats.overruns * 100 > stats.periods * PWM_OVERRUN_GROSS;
+    emit(&result);
+}
+
+#ifdef GPIO_SIM
+/* A simulated register, or all ones if its block is not mapped */
+static uint32_t peek(uint32_t offset)
+{
+    uint32_t value = 0;
+
+    return simPeekRegister(offset, &value) == OK ? value : 0xFFFFFFFF;
+}
+
+/* The PWM and clock manager values written, against the datasheet */
+static void benchPwm(uint64_t * samples, int count)
+{
+    tResult result = {"pwm_set_output", "ns/call", 0, 0, 0, 0, 0, "call/s", 0};
+    const tBoard * board = NULL;
+    uint32_t faults = 0;
+    uint32_t after = 0;
+    uint32_t divi = 0;
+    uint32_t range = 0;
+    uint64_t divisor = 0;
+    uint64_t start = 0;
+    int sample = 0;
+
+    if (gpioGetBoard(&board) != OK || simCmGetFaults(&faults) != OK ||
+        gpioPwmSetup() != OK || gpioPwmSetClock(PWM_HW_CLOCK_HZ) != OK)
+    {
+        result.failures++;
+        emit(&result);
+        return;
+    }
+
+    divi = (board->oscillatorHz + PWM_HW_CLOCK_HZ / 2) / PWM_HW_CLOCK_HZ;
+    range = board->oscillatorHz / divi / PWM_HW_FREQ;
+    result.failures += peek(CM_BASE_OFFSET + CM_PWMDIV_OFFSET) != divi << CM_DIVI_SHIFT ||
+                       peek(CM_BASE_OFFSET + CM_PWMCTL_OFFSET) !=
+                           (CM_BUSY | CM_ENAB | CM_SRC_OSC);
+
+    /* A quarter on channel 1, half on channel 2 at twice the frequency */
+    result.failures += gpioPwmSetOutput(PWM_HW_PIN_1, PWM_HW_FREQ, PWM_DUTY_MAX / 4) != OK ||
+                       gpioPwmSetOutput(PWM_HW_PIN_2, PWM_HW_FREQ * 2,
+                                        PWM_DUTY_MAX / 2) != OK ||
+                       peek(PWM_BASE_OFFSET + PWM_RNG1_OFFSET) != range ||
+                       peek(PWM_BASE_OFFSET + PWM_DAT1_OFFSET) != range / 4 ||
+                       peek(PWM_BASE_OFFSET + PWM_RNG2_OFFSET) != range / 2 ||
+                       peek(PWM_BASE_OFFSET + PWM_DAT2_OFFSET) != range / 4 ||
+                       peek(PWM_BASE_OFFSET + PWM_CTL_OFFSET) !=
+                           ((PWM_MSEN1 | PWM_PWEN1) * (1 | 1 << PWM_CTL_CHANNEL_SHIFT));
+
+    /* Restarting a running clock must stop it before the divisor changes */
+    divisor = (((uint64_t)board->oscillatorHz << CM_DIVF_BITS) + CLOCK_FREQ / 2) /
+              CLOCK_FREQ;
+    result.failures += gpioClockStart(CLOCK_PIN, CLOCK_FREQ * 2) != OK ||
+                       gpioClockStart(CLOCK_PIN, CLOCK_FREQ) != OK ||
+                       peek(CM_BASE_OFFSET + CM_GP0DIV_OFFSET) != divisor ||
+                       peek(CM_BASE_OFFSET + CM_GP0CTL_OFFSET) !=
+                           (CM_BUSY | CM_ENAB | CM_SRC_OSC |
+                            (divisor & ((0x1 << CM_DIVF_BITS) - 1) ? 1 << CM_MASH_SHIFT : 0)) ||
+                       gpioClockStop(CLOCK_PIN) != OK ||
+                       peek(CM_BASE_OFFSET + CM_GP0CTL_OFFSET) & (CM_BUSY | CM_ENAB);
+
+    for (sample = 0; sample < count; sample++)
+    {
+        start = nowNs();
+        result.failures += gpioPwmSetOutput(PWM_HW_PIN_1, PWM_HW_FREQ,
+                                            PWM_DUTY_MAX / 100 * (sample % 100)) != OK;
+        samples[sample] = nowNs() - start;
+    }
+
+    result.failures += gpioPwmStop(PWM_HW_PIN_1) != OK ||
+                       peek(PWM_BASE_OFFSET + PWM_CTL_OFFSET) & PWM_PWEN1 ||
+                       gpioPwmCleanup() != OK ||
+                       simCmGetFaults(&after) != OK || after != faults;
+
+    gpioSetFunction(PWM_HW_PIN_1, input);
+    gpioSetFunction(PWM_HW_PIN_2, input);
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+#endif
+
+/* A servo frame: every channel high, then each cleared after 1 - 2 ms */
+static void benchWaveBuild(uint64_t * samples, int count)
+{
+    tResult result = {"wave_build", "ns", 0, 0, 0, 0, 0, "build/s", 0};
+    static tDmaControlBlock blocks[WAVE_BLOCKS] __attribute__((aligned(32)));
+    tWaveStep steps[WAVE_CHANNELS + 1];
+    size_t blockCount = 0;
+    size_t index = 0;
+    uint64_t start = 0;
+    uint64_t ticks = 0;
+    uint32_t levels = 0;
+    uint32_t bus = 0;
+    uint32_t elapsed = 0;
+    int channel = 0;
+    int sample = 0;
+
+    steps[0].setMask = ((0x1u << WAVE_CHANNELS) - 1) << PWM_FIRST_PIN;
+    steps[0].clearMask = 0;
+    steps[0].delay_ns = 1000000;
+    elapsed = steps[0].delay_ns;
+
+    for (channel = 0; channel < WAVE_CHANNELS; channel++)
+    {
+        steps[channel + 1].setMask = 0;
+        steps[channel + 1].clearMask = 0x1u << (PWM_FIRST_PIN + channel);
+        steps[channel + 1].delay_ns = 1000000 / WAVE_CHANNELS;
+        elapsed += steps[channel + 1].delay_ns;
+    }
+
+    steps[WAVE_CHANNELS].delay_ns += WAVE_PERIOD_NS - elapsed;
+
+    for (sample = 0; sample < count; sample++)
+    {
+        blockCount = WAVE_BLOCKS;
+        start = nowNs();
+        result.failures += gpioWaveBuild(steps, WAVE_CHANNELS + 1, WAVE_TICK_NS,
+                                         wavePacePwm, 1, blocks, WAVE_BUS,
+                                         &blockCount) != OK;
+        samples[sample] = nowNs() - start;
+    }
+
+    /* Walk one frame of the loop, as the DMA engine would */
+    bus = WAVE_BUS;
+    channel = 0;
+    do
+    {
+        index = (bus - WAVE_BUS) / sizeof(tDmaControlBlock);
+
+        if (index >= blockCount ||
+            blocks[index].source != bus + offsetof(tDmaControlBlock, reserved))
+        {
+            result.failures++;
+            break;
+        }
+
+        else if (blocks[index].dest == WAVE_PERI_BUS + GPIO_BASE_OFFSET + GPSET0_OFFSET)
+        {
+            levels |= blocks[index].reserved[0];
+        }
+
+        else if (blocks[index].dest == WAVE_PERI_BUS + GPIO_BASE_OFFSET + GPCLR0_OFFSET)
+        {
+            /* Channel n is cleared after 1 ms + n / WAVE_CHANNELS ms */
+            result.failures += ticks * WAVE_TICK_NS !=
+                1000000 + 1000000 / WAVE_CHANNELS * channel++ ||
+                !(levels & blocks[index].reserved[0]);
+            levels &= ~blocks[index].reserved[0];
+        }
+
+        else
+        {
+            ticks += blocks[index].length / sizeof(uint32_t);
+        }
+
+        bus = blocks[index].next;
+    } while (bus != WAVE_BUS && bus != 0);
+
+    result.failures += bus != WAVE_BUS || levels != 0 || channel != WAVE_CHANNELS ||
+                       ticks * WAVE_TICK_NS != WAVE_PERIOD_NS;
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+
+/* Level of every pin at sample k, with or without glitches */
+static uint32_t debounceLevels(uint64_t k, int glitches)
+{
+    uint32_t levels = 0;
+    uint64_t period = 0;
+    int pin = 0;
+
+    for (pin = 0; pin < 32; pin++)
+    {
+        period = DEBOUNCE_PERIOD + pin;
+        levels |= (uint32_t)((k / period) & 0x1) << pin;
+
+        if (glitches && (k % period == DEBOUNCE_GLITCH || k % period == DEBOUNCE_GLITCH + 1))
+        {
+            levels ^= 0x1u << pin;
+        }
+    }
+
+    return levels;
+}
+
+/* Glitch free levels as debounced after sample k, SAMPLES - 1 late */
+static uint32_t debounceExpected(uint64_t k)
+{
+    return debounceLevels(k + 1 < DEBOUNCE_SAMPLES ? 0 : k + 1 - DEBOUNCE_SAMPLES, 0);
+}
+
+static void benchDebounce(uint64_t * samples, int count)
+{
+    tResult result = {"debounce_update", "ns/op", 0, 0, 0, 0, 0, "sample/s", 0};
+    uint32_t input[BATCH];
+    uint32_t changed[BATCH];
+    tDebounce debounce;
+    uint64_t k = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int call = 0;
+
+    result.failures += gpioDebounceInit(&debounce, 0xFFFFFFFF, DEBOUNCE_SAMPLES,
+                                        debounceLevels(0, 0)) != OK;
+
+    for (sample = 0; sample < count; sample++)
+    {
+        for (call = 0; call < BATCH; call++)
+        {
+            input[call] = debounceLevels(k + call, 1);
+        }
+
+        start = nowNs();
+        for (call = 0; call < BATCH; call++)
+        {
+            gpioDebounceUpdate(&debounce, input[call], &changed[call]);
+        }
+        samples[sample] = (nowNs() - start) / BATCH;
+
+        /* Only pins whose glitch free level changed may report an edge */
+        for (call = 0; call < BATCH; call++, k++)
+        {
+            result.failures += changed[call] !=
+                (debounceExpected(k) ^ (k ? debounceExpected(k - 1) : debounceLevels(0, 0)));
+        }
+    }
+
+    result.failures += debounce.levels != debounceExpected(k - 1);
+
+    summarise(&result, samples, count, 1);
+    emit(&result);
+}
+
+#ifdef GPIO_SIM
+/* Turns ENCODERS simulated encoders a step at a time, timing reads between */
+static void benchEncoder(eEncoderSample mode, uint64_t * samples, int count)
+{
+    static const uint32_t gray[4] = {0x0, 0x1, 0x3, 0x2}; /* B << 1 | A */
+    tResult result = {"encoder_read_levels", "ns/op", 0, 0, 0, 0, 0, "op/s", 0};
+    struct timespec wait = {0, ENCODER_STEP_NS};
+    tEncoderState state;
+    int handles[ENCODERS];
+    uint32_t mask = 0;
+    uint32_t levels = 0;
+    uint32_t phase = 0;
+    uint64_t start = 0;
+    int encoder = 0;
+    int step = 0;
+    int call = 0;
+    int timed = 0;
+
+    if (mode == encoderSampleEvents)
+    {
+        result.name = "encoder_read_events";
+    }
+
+    mask = ((0x1u << (ENCODERS * 2)) - 1) << ENCODER_FIRST_PIN;
+    simSetInputs(mask, 0);
+
+    result.failures += gpioEncoderStart(mode, ENCODER_SAMPLE_NS, -1) != OK;
+
+    for (encoder = 0; encoder < ENCODERS && result.failures == 0; encoder++)
+    {
+        result.failures += gpioEncoderAdd(ENCODER_FIRST_PIN + encoder * 2,
+                                          ENCODER_FIRST_PIN + encoder * 2 + 1,
+                                          &handles[encoder]) != OK;
+    }
+
+    /* Let the thread take the encoders before the first step */
+    nanosleep(&wait, NULL);
+
+    for (step = 1; step <= ENCODER_STEPS && result.failures == 0; step++)
+    {
+        levels = 0;
+
+        for (encoder = 0; encoder < ENCODERS; encoder++)
+        {
+            phase = gray[(encoder & 0x1 ? -step : step) & 0x3];
+            levels |= phase << (ENCODER_FIRST_PIN + encoder * 2);
+        }
+
+        simSetInputs(mask, levels);
+        nanosleep(&wait, NULL);
+
+        if (timed < count)
+        {
+            start = nowNs();
+            for (call = 0; call < BATCH; call++)
+            {
+                gpioEncoderRead(handles[call % ENCODERS], &state);
+            }
+            samples[timed++] = (nowNs() - start) / BATCH;
+        }
+    }
+
+    for (encoder = 0; encoder < ENCODERS && result.failures == 0; encoder++)
+    {
+        result.failures += gpioEncoderRead(handles[encoder], &state) != OK ||
+                           state.count != (encoder & 0x1 ? -ENCODER_STEPS : ENCODER_STEPS) ||
+                           state.errors != 0;
+    }
+
+    gpioEncoderStop();
+    simSetInputs(0, 0);
+
+    if (timed > 0)
+    {
+        summarise(&result, samples, timed, 1);
+    }
+
+    emit(&result);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* Measures software PWM outputs on two pins with different duties */
+static void benchPulse(uint64_t * samples, int count)
+{
+    static const uint32_t duties[2] = {PWM_DUTY_MAX / 4, PWM_DUTY_MAX * 3 / 5};
+    static uint64_t dutyErrors[PULSE_READS * 2];
+    tResult result = {"pulse_period_error", "ns", 0, 0, 0, 0, 0, "read/s", 0};
+    tResult duty = {"pulse_duty_error", "ppm", 0, 0, 0, 0, 0, "read/s", 0};
+    struct timespec settle = {0, PULSE_SIGNAL_NS * (PULSE_WINDOW + 4)};
+    struct timespec wait = {0, PULSE_READ_NS};
+    tPulseMeasure measure;
+    uint64_t start = 0;
+    uint64_t reads = 0;
+    uint64_t readNs = 0;
+    int64_t error = 0;
+    int64_t dutyError = 0;
+    int timed = 0;
+    int channel = 0;
+    int read = 0;
+
+    result.failures += gpioSoftPwmStart(PULSE_SIGNAL_NS, -1) != OK ||
+                       gpioPulseStart(PULSE_SAMPLE_NS, -1) != OK;
+
+    for (channel = 0; channel < 2 && result.failures == 0; channel++)
+    {
+        result.failures += gpioSoftPwmSetDuty(PWM_FIRST_PIN + channel,
+                               (uint64_t)PULSE_SIGNAL_NS * duties[channel] / PWM_DUTY_MAX) != OK ||
+                           gpioPulseAdd(PWM_FIRST_PIN + channel, PULSE_WINDOW) != OK;
+    }
+
+    nanosleep(&settle, NULL);
+
+    for (read = 0; read < PULSE_READS && result.failures == 0; read++)
+    {
+        nanosleep(&wait, NULL);
+
+        for (channel = 0; channel < 2; channel++)
+        {
+            start = nowNs();
+            gpioPulseRead(PWM_FIRST_PIN + channel, &measure);
+            readNs += nowNs() - start;
+            reads++;
+
+            error = (int64_t)measure.period_ns - PULSE_SIGNAL_NS;
+            error = error < 0 ? -error : error;
+            dutyError = (int64_t)measure.duty - duties[channel];
+            dutyError = dutyError < 0 ? -dutyError : dutyError;
+
+            /* The errors are reported, as they follow the scheduler. Only a
+             * missing or grossly wrong measurement fails */
+            result.failures += measure.cycles != PULSE_WINDOW ||
+                               error > PULSE_PERIOD_GROSS_NS ||
+                               dutyError > PULSE_DUTY_GROSS;
+
+            if (timed < count)
+            {
+                samples[timed] = error;
+                dutyErrors[timed++] = dutyError;
+            }
+        }
+    }
+
+    gpioPulseStop();
+    gpioSoftPwmStop();
+
+    if (timed > 0)
+    {
+        summarise(&result, samples, timed, 1);
+        summarise(&duty, dutyErrors, timed, 1);
+        result.rate = readNs ? reads * 1e9 / readNs : 0;
+        duty.rate = result.rate;
+    }
+
+    emit(&result);
+    emit(&duty);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* Writes a pattern to register files on several software buses at once and
+ * reads it back */
+static void benchSoftI2c(int buses, int length, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/transaction", 0, 0, 0, 0, 0, "byte/s", 0};
+    tSoftI2cTransfer transfers[SOFT_I2C_BUSES_MAX];
+    uint8_t written[SOFT_I2C_BUSES_MAX][MAX_LENGTH + 1];
+    uint8_t read[SOFT_I2C_BUSES_MAX][MAX_LENGTH];
+    uint64_t start = 0;
+    int bus[SOFT_I2C_BUSES_MAX];
+    int sample = 0;
+    int lane = 0;
+    int byte = 0;
+
+    snprintf(name, sizeof(name), "soft_i2c_%dbus", buses);
+    simSetInputs(0, 0);
+
+    for (lane = 0; lane < buses; lane++)
+    {
+        int sda = SOFT_I2C_FIRST_PIN + lane * 2;
+
+        result.failures += simI2cAttachPinsRegisterFile(sda, sda + 1, SIM_ADDRESS) != OK ||
+                           gpioSoftI2cOpen(sda, sda + 1, SOFT_I2C_FREQ, &bus[lane]) != OK;
+    }
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        start = nowNs();
+
+        for (lane = 0; lane < buses; lane++)
+        {
+            written[lane][0] = 0;
+            for (byte = 1; byte <= length; byte++)
+            {
+                written[lane][byte] = (uint8_t)(sample * 31 + lane * 7 + byte);
+            }
+
+            memset(&transfers[lane], 0, sizeof(tSoftI2cTransfer));
+            transfers[lane].bus = bus[lane];
+            transfers[lane].address = SIM_ADDRESS;
+            transfers[lane].writeData = written[lane];
+            transfers[lane].writeLength = length + 1;
+        }
+
+        result.failures += gpioSoftI2cTransfer(transfers, buses) != OK;
+
+        /* Register pointer back to 0 then a repeated start to read */
+        for (lane = 0; lane < buses; lane++)
+        {
+            transfers[lane].writeLength = 1;
+            transfers[lane].readBuffer = read[lane];
+            transfers[lane].readLength = length;
+        }
+
+        result.failures += gpioSoftI2cTransfer(transfers, buses) != OK;
+        samples[sample] = nowNs() - start;
+
+        for (lane = 0; lane < buses; lane++)
+        {
+            result.failures += memcmp(read[lane], &written[lane][1], length) != 0;
+        }
+    }
+
+    for (lane = 0; lane < buses; lane++)
+    {
+        gpioSoftI2cClose(bus[lane]);
+        simI2cDetachPins(SOFT_I2C_FIRST_PIN + lane * 2);
+    }
+
+    summarise(&result, samples, sample ? sample : 1, 2.0 * length * buses);
+    emit(&result);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* Decodes MOSI of each lane as the slave would see it */
+static void spiWatch(void * context, uint64_t time_ns, uint32_t levels, uint32_t changed)
+{
+    tSpiBench * bench = context;
+    int lane = 0;
+    int byte = bench->bits / 8;
+    int bit = bench->bits % 8;
+
+    if (!(changed & bench->sclk) || ((levels & bench->sclk) != 0) != bench->sampleHigh ||
+        byte >= SOFT_SPI_CHECK)
+    {
+        return;
+    }
+
+    for (lane = 0; lane < bench->lanes; lane++)
+    {
+        if (levels & bench->mosi[lane])
+        {
+            bench->seen[lane][byte] |= bench->lsbFirst ? 0x1 << bit : 0x80 >> bit;
+        }
+    }
+
+    bench->bits++;
+}
+
+/* Checks every mode then times transfers on all lanes in mode 0 */
+static void benchSoftSpi(int lanes, int length, uint64_t * samples, int count)
+{
+    /* MISO of each lane, clear of DEFAULT_PIN which later benchmarks toggle */
+    static const int miso[SOFT_SPI_LANES_MAX] = {22, 23, 24, 25, 26, 27, 0, 1};
+    static char name[64];
+    tResult result = {name, "ns/transfer", 0, 0, 0, 0, 0, "Mbit/s", 0};
+    static tSpiBench bench;
+    tSoftSpiConfig config;
+    uint8_t tx[SOFT_SPI_LANES_MAX][MAX_LENGTH];
+    uint8_t rx[SOFT_SPI_LANES_MAX][MAX_LENGTH];
+    const uint8_t * txData[SOFT_SPI_LANES_MAX];
+    uint8_t * rxBuffer[SOFT_SPI_LANES_MAX];
+    uint32_t misoMask = 0;
+    uint32_t misoHigh = 0;
+    uint64_t start = 0;
+    int check = 0;
+    int sample = 0;
+    int lane = 0;
+    int byte = 0;
+    int bus = -1;
+
+    snprintf(name, sizeof(name), "soft_spi_%dlane", lanes);
+    memset(&config, 0, sizeof(config));
+    memset(&bench, 0, sizeof(bench));
+    config.gpioNumberSclk = SOFT_SPI_SCLK_PIN;
+    config.lanes = lanes;
+    bench.sclk = 0x1u << SOFT_SPI_SCLK_PIN;
+    bench.lanes = lanes;
+
+    for (lane = 0; lane < lanes; lane++)
+    {
+        config.gpioNumberMosi[lane] = SOFT_SPI_MOSI_PIN + lane;
+        config.gpioNumberMiso[lane] = miso[lane];
+        config.gpioNumberCs[lane] = lane ? -1 : SOFT_SPI_CS_PIN;
+        bench.mosi[lane] = 0x1u << (SOFT_SPI_MOSI_PIN + lane);
+        misoMask |= 0x1u << miso[lane];
+        misoHigh |= lane & 0x1 ? 0x1u << miso[lane] : 0;
+        txData[lane] = tx[lane];
+        rxBuffer[lane] = rx[lane];
+
+        for (byte = 0; byte < MAX_LENGTH; byte++)
+        {
+            tx[lane][byte] = (uint8_t)(byte * 37 + lane * 11 + 1);
+        }
+    }
+
+    simSetInputs(misoMask, misoHigh);
+
+    /* Modes 0 - 3, each MSB then LSB first */
+    for (check = 0; check < 8; check++)
+    {
+        config.mode = check / 2;
+        config.order = check & 0x1 ? softSpiLsbFirst : softSpiMsbFirst;
+        memset(bench.seen, 0, sizeof(bench.seen));
+        bench.bits = 0;
+        bench.sampleHigh = !((config.mode >> 1) ^ (config.mode & 0x1));
+        bench.lsbFirst = config.order == softSpiLsbFirst;
+
+        if (gpioSoftSpiOpen(&config, &bus) != OK)
+        {
+            result.failures++;
+            continue;
+        }
+
+        simSetLevelWatch(spiWatch, &bench);
+        result.failures += gpioSoftSpiTransfer(bus, txData, rxBuffer, SOFT_SPI_CHECK) != OK;
+        simSetLevelWatch(NULL, NULL);
+        gpioSoftSpiClose(bus);
+
+        for (lane = 0; lane < lanes; lane++)
+        {
+            for (byte = 0; byte < SOFT_SPI_CHECK; byte++)
+            {
+                result.failures += bench.seen[lane][byte] != tx[lane][byte] ||
+                                   rx[lane][byte] != (lane & 0x1 ? 0xFF : 0x00);
+            }
+        }
+    }
+
+    config.mode = 0;
+    config.order = softSpiMsbFirst;
+
+    if (gpioSoftSpiOpen(&config, &bus) != OK)
+    {
+        result.failures++;
+    }
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        start = nowNs();
+        result.failures += gpioSoftSpiTransfer(bus, txData, rxBuffer, length) != OK;
+        samples[sample] = nowNs() - start;
+    }
+
+    gpioSoftSpiClose(bus);
+    simSetInputs(0, 0);
+
+    summarise(&result, samples, sample ? sample : 1, 8.0 * length * lanes / 1e6);
+    emit(&result);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* A DS18B20 ROM code with a valid CRC */
+static uint64_t oneWireRom(int bus, int probe)
+{
+    uint8_t bytes[8] = {0x28, (uint8_t)bus, (uint8_t)probe, 0x5A, 0xC3, (uint8_t)(bus * 7 + probe), 0x00, 0};
+    uint64_t rom = 0;
+    int byte = 0;
+
+    bytes[7] = gpioOneWireCrc8(bytes, 7);
+
+    for (byte = 0; byte < 8; byte++)
+    {
+        rom |= (uint64_t)bytes[byte] << (byte * 8);
+    }
+
+    return rom;
+}
+
+/* Finds the probes on each bus then converts and reads them all together */
+/* A slot preempted without being seen late can still flip a bit, which a
+ * real application would retry too */
+static int oneWireFound(const int * number, int buses)
+{
+    int lane = 0;
+
+    for (lane = 0; lane < buses && number[lane] == ONE_WIRE_PROBES; lane++)
+    {
+    }
+
+    return lane == buses;
+}
+
+static int oneWireValid(uint8_t scratchpad[][9], int buses)
+{
+    int lane = 0;
+
+    for (lane = 0; lane < buses && gpioOneWireCrc8(scratchpad[lane], 9) == 0; lane++)
+    {
+    }
+
+    return lane == buses;
+}
+
+static void benchOneWire(int buses, uint64_t * samples, int count)
+{
+    static char name[64];
+    static char retryName[64];
+    static uint64_t retries[ONE_WIRE_SAMPLES];
+    tResult result = {name, "ns/pass", 0, 0, 0, 0, 0, "probe/s", 0};
+    tResult retry = {retryName, "retries/pass", 0, 0, 0, 0, 0, "pass/s", 0};
+    uint64_t found[ONE_WIRE_BUSES_MAX][ONE_WIRE_PROBES];
+    uint64_t * roms[ONE_WIRE_BUSES_MAX];
+    uint8_t command[ONE_WIRE_BUSES_MAX][10];
+    uint8_t scratchpad[ONE_WIRE_BUSES_MAX][9];
+    const uint8_t * write[ONE_WIRE_BUSES_MAX];
+    uint8_t * read[ONE_WIRE_BUSES_MAX];
+    uint32_t present = 0;
+    uint64_t start = 0;
+    int bus[ONE_WIRE_BUSES_MAX];
+    int number[ONE_WIRE_BUSES_MAX];
+    int attempt = 0;
+    int sample = 0;
+    int lane = 0;
+    int probe = 0;
+    int byte = 0;
+
+    snprintf(name, sizeof(name), "one_wire_read_%dbus", buses);
+    snprintf(retryName, sizeof(retryName), "one_wire_retries_%dbus", buses);
+
+    for (lane = 0; lane < buses; lane++)
+    {
+        for (probe = 0; probe < ONE_WIRE_PROBES; probe++)
+        {
+            result.failures += simOneWireAttach(ONE_WIRE_FIRST_PIN + lane,
+                                                oneWireRom(lane, probe),
+                                                (int16_t)(lane * 160 + probe * 16 + 8)) != OK;
+        }
+
+        result.failures += gpioOneWireOpen(ONE_WIRE_FIRST_PIN + lane, &bus[lane]) != OK;
+        roms[lane] = found[lane];
+        write[lane] = command[lane];
+        read[lane] = scratchpad[lane];
+    }
+
+    if (result.failures == 0)
+    {
+        for (attempt = 0; attempt < ONE_WIRE_ATTEMPTS; attempt++)
+        {
+            if (gpioOneWireSearch(bus, buses, roms, ONE_WIRE_PROBES, number) == OK &&
+                oneWireFound(number, buses))
+            {
+                break;
+            }
+        }
+
+        result.failures += attempt == ONE_WIRE_ATTEMPTS;
+
+        /* Found in the order of their bits, LSB first, so match each ROM */
+        for (lane = 0; lane < buses; lane++)
+        {
+            result.failures += number[lane] != ONE_WIRE_PROBES;
+
+            for (probe = 0; probe < ONE_WIRE_PROBES; probe++)
+            {
+                for (byte = 0; byte < number[lane]; byte++)
+                {
+                    if (found[lane][byte] == oneWireRom(lane, probe))
+                    {
+                        break;
+                    }
+                }
+
+                result.failures += byte == number[lane];
+            }
+        }
+    }
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        start = nowNs();
+        retries[sample] = 0;
+
+        /* Every probe converts at once, one conversion window for the rack */
+        for (lane = 0; lane < buses; lane++)
+        {
+            command[lane][0] = ONE_WIRE_SKIP_ROM;
+            command[lane][1] = 0x44;
+        }
+
+        for (attempt = 0; attempt < ONE_WIRE_ATTEMPTS; attempt++)
+        {
+            if (gpioOneWireReset(bus, buses, &present) == OK &&
+                present == (0x1u << buses) - 1 &&
+                gpioOneWireWrite(bus, buses, write, 2) == OK)
+            {
+                break;
+            }
+        }
+
+        /* A retried attempt follows the scheduler and is reported. Only a
+         * transfer that never succeeds fails */
+        retries[sample] += attempt;
+        result.failures += attempt == ONE_WIRE_ATTEMPTS;
+
+        for (probe = 0; probe < ONE_WIRE_PROBES; probe++)
+        {
+            for (lane = 0; lane < buses; lane++)
+            {
+                command[lane][0] = ONE_WIRE_MATCH_ROM;
+                for (byte = 0; byte < 8; byte++)
+                {
+                    command[lane][1 + byte] = (uint8_t)(found[lane][probe] >> (byte * 8));
+                }
+                command[lane][9] = 0xBE;
+            }
+
+            for (attempt = 0; attempt < ONE_WIRE_ATTEMPTS; attempt++)
+            {
+                if (gpioOneWireReset(bus, buses, &present) == OK &&
+                    gpioOneWireWrite(bus, buses, write, 10) == OK &&
+                    gpioOneWireRead(bus, buses, read, 9) == OK &&
+                    oneWireValid(scratchpad, buses))
+                {
+                    break;
+                }
+            }
+
+            retries[sample] += attempt;
+            result.failures += attempt == ONE_WIRE_ATTEMPTS;
+
+            for (lane = 0; lane < buses && attempt < ONE_WIRE_ATTEMPTS; lane++)
+            {
+                result.failures += gpioOneWireCrc8(scratchpad[lane], 9) != 0 ||
+                                   (int16_t)(scratchpad[lane][0] | scratchpad[lane][1] << 8) !=
+                                   (int16_t)(found[lane][probe] >> 16 & 0xFF) * 16 + lane * 160 + 8;
+            }
+        }
+
+        samples[sample] = nowNs() - start;
+    }
+
+    for (lane = 0; lane < buses; lane++)
+    {
+        gpioOneWireClose(bus[lane]);
+        simOneWireDetach(ONE_WIRE_FIRST_PIN + lane);
+    }
+
+    summarise(&result, samples, sample ? sample : 1, buses * ONE_WIRE_PROBES);
+    summarise(&retry, retries, sample ? sample : 1, 1);
+    retry.rate = result.rate / (buses * ONE_WIRE_PROBES);
+    emit(&result);
+    emit(&retry);
+}
+#endif
+
+#ifdef GPIO_SIM
+/* Decodes each strip as an LED would, by the length of each high */
+static void ledWatch(void * context, uint64_t time_ns, uint32_t levels, uint32_t changed)
+{
+    tLedBench * bench = context;
+    int strip = 0;
+    int byte = 0;
+
+    for (strip = 0; strip < bench->strips; strip++)
+    {
+        if (!(changed & bench->pins[strip]))
+        {
+            continue;
+        }
+
+        else if (levels & bench->pins[strip])
+        {
+            bench->rise[strip] = time_ns;
+        }
+
+        else if ((byte = bench->bits[strip] / 8) < LED_LEDS * 3)
+        {
+            if (time_ns - bench->rise[strip] > LED_DECODE_NS)
+            {
+                bench->seen[strip][byte] |= 0x80 >> (bench->bits[strip] % 8);
+            }
+
+            bench->bits[strip]++;
+        }
+    }
+}
+
+/* Times encoding a frame, then showing it by spinning. A frame reported
+ * late is shown again, one which is not must decode to the pixels set. */
+static void benchLed(int strips, uint64_t * samples, int count)
+{
+    static char encodeName[64];
+    static char showName[64];
+    tResult encode = {encodeName, "ns/frame", 0, 0, 0, 0, 0, "frame/s", 0};
+    tResult show = {showName, "ns/frame", 0, 0, 0, 0, 0, "frame/s", 0};
+    static tLedBench bench;
+    uint8_t expected[LED_STRIPS_MAX][LED_LEDS * 3];
+    int pins[LED_STRIPS_MAX];
+    uint32_t rgb = 0;
+    uint64_t start = 0;
+    errStatus rtn = ERROR_DEFAULT;
+    int sample = 0;
+    int attempt = 0;
+    int strip = 0;
+    int led = 0;
+
+    snprintf(encodeName, sizeof(encodeName), "led_encode_%dstrip", strips);
+    snprintf(showName, sizeof(showName), "led_show_%dstrip", strips);
+    memset(&bench, 0, sizeof(bench));
+    bench.strips = strips;
+
+    for (strip = 0; strip < strips; strip++)
+    {
+        pins[strip] = LED_FIRST_PIN + strip;
+        bench.pins[strip] = 0x1u << pins[strip];
+    }
+
+    if (gpioLedOpen(pins, strips, LED_LEDS) != OK)
+    {
+        encode.failures++;
+        show.failures++;
+    }
+
+    for (strip = 0; strip < strips; strip++)
+    {
+        for (led = 0; led < LED_LEDS; led++)
+        {
+            rgb = (led * 0x0A0B0Cu + strip * 0x112233u + 0x010203u) & 0xFFFFFF;
+            encode.failures += gpioLedSetPixel(strip, led, rgb) != OK;
+            expected[strip][led * 3] = (uint8_t)(rgb >> 8);
+            expected[strip][led * 3 + 1] = (uint8_t)(rgb >> 16);
+            expected[strip][led * 3 + 2] = (uint8_t)rgb;
+        }
+    }
+
+    for (sample = 0; sample < count && encode.failures == 0; sample++)
+    {
+        start = nowNs();
+        encode.failures += gpioLedEncode() != OK;
+        samples[sample] = nowNs() - start;
+    }
+
+    summarise(&encode, samples, sample ? sample : 1, 1);
+    emit(&encode);
+
+    count = count < LED_SAMPLES ? count : LED_SAMPLES;
+
+    for (sample = 0; sample < count && show.failures == 0; sample++)
+    {
+        for (attempt = 0, rtn = ERROR_EXTERNAL;
+             attempt < LED_ATTEMPTS && rtn == ERROR_EXTERNAL; attempt++)
+        {
+            memset(bench.seen, 0, sizeof(bench.seen));
+            memset(bench.bits, 0, sizeof(bench.bits));
+            simSetLevelWatch(ledWatch, &bench);
+            start = nowNs();
+            rtn = gpioLedShow(ledDriveSpin);
+            samples[sample] = nowNs() - start;
+            simSetLevelWatch(NULL, NULL);
+        }
+
+        show.failures += rtn != OK;
+
+        for (strip = 0; strip < strips && rtn == OK; strip++)
+        {
+            show.failures += memcmp(bench.seen[strip], expected[strip], LED_LEDS * 3) != 0;
+        }
+    }
+
+    gpioLedClose();
+
+    summarise(&show, samples, sample ? sample : 1, 1);
+    emit(&show);
+}
+
+/* Times frames played by DMA, from the show until the latch has ended */
+static void benchLedDma(int strips, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/frame", 0, 0, 0, 0, 0, "frame/s", 0};
+    int pins[LED_STRIPS_MAX];
+    uint32_t tick_ns = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int strip = 0;
+    int busy = 1;
+
+    snprintf(name, sizeof(name), "led_show_dma_%dstrip", strips);
+
+    for (strip = 0; strip < strips; strip++)
+    {
+        pins[strip] = LED_FIRST_PIN + strip;
+    }
+
+    if (gpioWaveSetup(wavePacePwm, LED_TICK_NS, -1, &tick_ns) != OK)
+    {
+        result.failures++;
+    }
+
+    else if (gpioLedOpen(pins, strips, LED_LEDS) != OK)
+    {
+        result.failures++;
+        gpioWaveCleanup();
+    }
+
+    else
+    {
+        for (strip = 0; strip < strips; strip++)
+        {
+            gpioLedSetPixel(strip, strip, 0xFFFFFF);
+        }
+
+        count = count < LED_SAMPLES ? count : LED_SAMPLES;
+
+        for (sample = 0; sample < count && result.failures == 0; sample++)
+        {
+            start = nowNs();
+            result.failures += gpioLedShow(ledDriveDma) != OK;
+
+            while (gpioWaveBusy(&busy) == OK && busy)
+            {
+                usleep(100);
+            }
+
+            samples[sample] = nowNs() - start;
+        }
+
+        gpioLedClose();
+        gpioWaveCleanup();
+    }
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+
+/* Times updates of chains whose outputs change every update, checking what
+ * the simulated registers latched and what was read from them */
+static void benchShift(int chains, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/update", 0, 0, 0, 0, 0, "update/s", 0};
+    tShiftConfig config;
+    uint8_t data[SHIFT_REGISTERS];
+    uint8_t seen[SHIFT_REGISTERS];
+    uint64_t start = 0;
+    int group = 0;
+    int sample = 0;
+    int chain = 0;
+    int reg = 0;
+
+    snprintf(name, sizeof(name), "shift_update_%dchain", chains);
+    memset(&config, 0, sizeof(config));
+    config.gpioNumberClock = SHIFT_CLOCK_PIN;
+    config.gpioNumberLatch = SHIFT_LATCH_PIN;
+    config.gpioNumberLoad = -1;
+    config.chains = chains;
+    config.registers = SHIFT_REGISTERS;
+
+    for (chain = 0; chain < SHIFT_CHAINS; chain++)
+    {
+        config.gpioNumberOut[chain] = chain < chains ? SHIFT_OUT_PIN + chain : -1;
+        config.gpioNumberIn[chain] = chain < chains ? SHIFT_IN_PIN + chain : -1;
+    }
+
+    for (chain = 0; chain < chains; chain++)
+    {
+        for (reg = 0; reg < SHIFT_REGISTERS; reg++)
+        {
+            data[reg] = (uint8_t)(chain * 0x35 + reg * 0x5B + 0x96);
+        }
+
+        result.failures += simShiftAttachOutputs(SHIFT_CLOCK_PIN, SHIFT_LATCH_PIN,
+                                                 SHIFT_OUT_PIN + chain, SHIFT_REGISTERS) != OK;
+        result.failures += simShiftAttachInputs(SHIFT_CLOCK_PIN, SHIFT_LATCH_PIN,
+                                                SHIFT_IN_PIN + chain, SHIFT_REGISTERS) != OK;
+        result.failures += simShiftSetInputs(SHIFT_IN_PIN + chain, data) != OK;
+    }
+
+    if (result.failures == 0 && gpioShiftOpen(&config, &group) != OK)
+    {
+        result.failures++;
+    }
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        for (chain = 0; chain < chains; chain++)
+        {
+            memset(data, (uint8_t)(sample + chain), sizeof(data));
+            result.failures += gpioShiftWrite(group, chain, data) != OK;
+        }
+
+        start = nowNs();
+        result.failures += gpioShiftUpdate(group) != OK;
+        samples[sample] = nowNs() - start;
+
+        for (chain = 0; chain < chains; chain++)
+        {
+            memset(data, (uint8_t)(sample + chain), sizeof(data));
+            simShiftGetOutputs(SHIFT_OUT_PIN + chain, seen);
+            result.failures += memcmp(seen, data, sizeof(data)) != 0;
+
+            for (reg = 0; reg < SHIFT_REGISTERS; reg++)
+            {
+                data[reg] = (uint8_t)(chain * 0x35 + reg * 0x5B + 0x96);
+            }
+
+            gpioShiftRead(group, chain, seen);
+            result.failures += memcmp(seen, data, sizeof(data)) != 0;
+        }
+    }
+
+    gpioShiftClose(group);
+
+    for (chain = 0; chain < chains; chain++)
+    {
+        simShiftDetach(SHIFT_OUT_PIN + chain);
+        simShiftDetach(SHIFT_IN_PIN + chain);
+    }
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+
+/* Decodes each word at the rising WR, replaying DCS windows and memory
+ * writes into the model display */
+static void parallelWatch(void * context, uint64_t time_ns, uint32_t levels, uint32_t changed)
+{
+    tParallelBench * bench = context;
+    uint32_t word = (levels >> PARALLEL_DATA_PIN) & (bench->width > 8 ? 0xFFFF : 0xFF);
+
+    (void)time_ns;
+
+    if (!(changed & levels & (0x1u << PARALLEL_WR_PIN)))
+    {
+        return;
+    }
+
+    if (!(levels & (0x1u << PARALLEL_DC_PIN)))
+    {
+        bench->command = word;
+        bench->params = 0;
+        bench->x = bench->x0;
+        bench->y = bench->y0;
+        bench->high = 0;
+    }
+
+    else if ((bench->command == PARALLEL_DCS_COLUMN || bench->command == PARALLEL_DCS_PAGE) &&
+             bench->params < 4)
+    {
+        bench->param[bench->params++] = (uint8_t)word;
+
+        if (bench->params == 4 && bench->command == PARALLEL_DCS_COLUMN)
+        {
+            bench->x0 = bench->param[0] << 8 | bench->param[1];
+            bench->x1 = bench->param[2] << 8 | bench->param[3];
+        }
+
+        else if (bench->params == 4)
+        {
+            bench->y0 = bench->param[0] << 8 | bench->param[1];
+            bench->y1 = bench->param[2] << 8 | bench->param[3];
+        }
+    }
+
+    else if (bench->command == PARALLEL_DCS_MEMORY_WRITE)
+    {
+        bench->pixel = bench->width > 8 ? word : bench->pixel << 8 | word;
+        bench->high = bench->width > 8 ? 0 : !bench->high;
+
+        if (!bench->high && bench->x < PARALLEL_FRAME_W && bench->y < PARALLEL_FRAME_H)
+        {
+            bench->model[bench->y][bench->x] = (uint16_t)bench->pixel;
+        }
+
+        if (!bench->high && ++bench->x > bench->x1)
+        {
+            bench->x = bench->x0;
+            bench->y++;
+        }
+    }
+
+    else if (bench->count < PARALLEL_WORDS)
+    {
+        bench->words[bench->count++] = word;
+    }
+}
+
+/* Opens an 8080 bus of \p width data lines with the bench's pins */
+static errStatus parallelOpen(int width)
+{
+    tParallelConfig config;
+    int bit = 0;
+
+    memset(&config, 0, sizeof(config));
+    config.bus = parallel8080;
+    config.width = width;
+    config.gpioNumberWr = PARALLEL_WR_PIN;
+    config.gpioNumberRd = PARALLEL_RD_PIN;
+    config.gpioNumberDc = PARALLEL_DC_PIN;
+    config.gpioNumberCs = PARALLEL_CS_PIN;
+
+    for (bit = 0; bit < width; bit++)
+    {
+        config.gpioNumberData[bit] = PARALLEL_DATA_PIN + bit;
+    }
+
+    return gpioParallelOpen(&config);
+}
+
+/* Times writing a block of words, each checked against the pin levels */
+static void benchParallelWrite(int width, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/write", 0, 0, 0, 0, 0, "word/s", 0};
+    static tParallelBench bench;
+    uint16_t words[PARALLEL_WORDS];
+    uint8_t bytes[PARALLEL_WORDS];
+    uint64_t start = 0;
+    uint32_t mask = width > 8 ? 0xFFFF : 0xFF;
+    int sample = 0;
+    int index = 0;
+
+    snprintf(name, sizeof(name), "parallel_write_%dbit", width);
+    result.failures += parallelOpen(width) != OK;
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        for (index = 0; index < PARALLEL_WORDS; index++)
+        {
+            words[index] = (uint16_t)((index * 0x9E37u + sample * 0x79B9u) & mask);
+            bytes[index] = (uint8_t)words[index];
+        }
+
+        memset(&bench, 0, sizeof(bench));
+        bench.width = width;
+        simSetLevelWatch(parallelWatch, &bench);
+        start = nowNs();
+        result.failures += gpioParallelWrite(width > 8 ? (void *)words : (void *)bytes,
+                                             PARALLEL_WORDS) != OK;
+        samples[sample] = nowNs() - start;
+        simSetLevelWatch(NULL, NULL);
+
+        for (index = 0; index < PARALLEL_WORDS; index++)
+        {
+            result.failures += index >= bench.count || bench.words[index] != words[index];
+        }
+    }
+
+    gpioParallelClose();
+
+    summarise(&result, samples, sample ? sample : 1, PARALLEL_WORDS);
+    emit(&result);
+}
+
+/* Times flushing the whole frame, or only two changed regions of it, each
+ * checked by replaying the words into a model display */
+static void benchParallelFlush(int dirty, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/flush", 0, 0, 0, 0, 0, "flush/s", 0};
+    static tParallelBench bench;
+    static uint16_t frame[PARALLEL_FRAME_H][PARALLEL_FRAME_W];
+    uint64_t start = 0;
+    int sample = 0;
+    int patch = 0;
+    int x = 0;
+    int y = 0;
+
+    snprintf(name, sizeof(name), "parallel_flush_%s", dirty ? "dirty" : "full");
+    memset(&bench, 0, sizeof(bench));
+    bench.width = 8;
+
+    for (y = 0; y < PARALLEL_FRAME_H; y++)
+    {
+        for (x = 0; x < PARALLEL_FRAME_W; x++)
+        {
+            frame[y][x] = (uint16_t)(x * 0x0841u + y * 0x1003u);
+        }
+    }
+
+    if (parallelOpen(8) != OK)
+    {
+        result.failures++;
+    }
+
+    /* The first flush sends the whole frame, so the model starts equal */
+    else
+    {
+        simSetLevelWatch(parallelWatch, &bench);
+        result.failures += gpioParallelSetFrame(&frame[0][0], PARALLEL_FRAME_W,
+                                                PARALLEL_FRAME_H) != OK;
+        result.failures += gpioParallelFlush() != OK;
+        simSetLevelWatch(NULL, NULL);
+    }
+
+    count = count < PARALLEL_SAMPLES ? count : PARALLEL_SAMPLES;
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        for (patch = 0; patch < 2; patch++)
+        {
+            int x0 = (sample * 13 + patch * 29) % (PARALLEL_FRAME_W - PARALLEL_PATCH);
+            int y0 = (sample * 7 + patch * 17) % (PARALLEL_FRAME_H - PARALLEL_PATCH);
+
+            for (y = y0; y < y0 + PARALLEL_PATCH; y++)
+            {
+                for (x = x0; x < x0 + PARALLEL_PATCH; x++)
+                {
+                    frame[y][x] += (uint16_t)(sample + patch + 1);
+                }
+            }
+
+            result.failures += gpioParallelMarkDirty(dirty ? x0 : 0, dirty ? y0 : 0,
+                dirty ? PARALLEL_PATCH : PARALLEL_FRAME_W,
+                dirty ? PARALLEL_PATCH : PARALLEL_FRAME_H) != OK;
+        }
+
+        simSetLevelWatch(parallelWatch, &bench);
+        start = nowNs();
+        result.failures += gpioParallelFlush() != OK;
+        samples[sample] = nowNs() - start;
+        simSetLevelWatch(NULL, NULL);
+
+        result.failures += memcmp(bench.model, frame, sizeof(frame)) != 0;
+    }
+
+    gpioParallelClose();
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+
+/* Times from a simulated key changing to its event being read */
+static void benchKeypad(uint64_t * samples, int count)
+{
+    tResult result = {"keypad_event_8x8", "ns", 0, 0, 0, 0, 0, "event/s", 0};
+    tKeypadConfig config;
+    tKeypadEvent event;
+    uint64_t keys = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int pressed = 0;
+    int found = 0;
+    int key = 0;
+    int line = 0;
+
+    memset(&config, 0, sizeof(config));
+    config.columns = KEYPAD_LINES;
+    config.rows = KEYPAD_LINES;
+    config.period_ns = KEYPAD_PERIOD_NS;
+    config.samples = KEYPAD_SAMPLES;
+    config.cpu = -1;
+
+    for (line = 0; line < KEYPAD_LINES; line++)
+    {
+        config.gpioNumberColumn[line] = KEYPAD_COLUMN_PIN + line;
+        config.gpioNumberRow[line] = KEYPAD_ROW_PIN + line;
+    }
+
+    result.failures += gpioKeypadStart(&config) != OK;
+    count = count < KEYPAD_KEYS * 2 ? count : KEYPAD_KEYS * 2;
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        key = (sample / 2 * 37) % KEYPAD_KEYS;
+        pressed = !(sample & 0x1);
+        start = nowNs();
+        simSwitchSet(KEYPAD_COLUMN_PIN + key / KEYPAD_LINES, KEYPAD_ROW_PIN + key % KEYPAD_LINES,
+                     pressed);
+
+        do
+        {
+            gpioKeypadRead(&event, 1, &found);
+        }
+        while (!found && nowNs() - start < KEYPAD_TIMEOUT_NS);
+
+        samples[sample] = nowNs() - start;
+        gpioKeypadGetKeys(&keys);
+        result.failures += !found || event.column * KEYPAD_LINES + event.row != key ||
+                           event.pressed != pressed || keys != ((uint64_t)pressed << key);
+    }
+
+    gpioKeypadStop();
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+
+/* Runs the daemon and a client in this process, timing snapshot reads and
+ * how soon a queued change is published */
+static void benchShm(uint64_t * samples, int count)
+{
+    tResult read = {"shm_read_levels", "ns", 0, 0, 0, 0, 0, "read/s", 0};
+    tResult write = {"shm_write_latency", "ns", 0, 0, 0, 0, 0, "write/s", 0};
+    const uint32_t mask = 0x1u << SHM_BENCH_PIN;
+    tShmEvent event;
+    uint32_t levels = 0;
+    uint32_t lost = 0;
+    uint64_t start = 0;
+    int sample = 0;
+    int found = 0;
+    int batch = 0;
+    int high = 0;
+
+    read.failures += gpioShmStart(SHM_BENCH_NAME, SHM_BENCH_PERIOD_NS, 0600, -1) != OK ||
+                     gpioShmAttach(SHM_BENCH_NAME) != OK;
+    read.failures += gpioShmSetFunction(SHM_BENCH_PIN, output) != OK ||
+                     gpioShmWrite(0, mask) != OK;
+
+    for (sample = 0; sample < count && read.failures == 0; sample++)
+    {
+        start = nowNs();
+
+        for (batch = 0; batch < SHM_READ_BATCH; batch++)
+        {
+            gpioShmReadLevels(&levels, NULL);
+        }
+
+        samples[sample] = (nowNs() - start) / SHM_READ_BATCH;
+    }
+
+    summarise(&read, samples, sample ? sample : 1, 1);
+    emit(&read);
+
+    /* Discards the events of setting the pin up */
+    gpioShmReadEvents(&event, 1, &found, &lost);
+    while (found)
+    {
+        gpioShmReadEvents(&event, 1, &found, &lost);
+    }
+
+    for (sample = 0; sample < count && read.failures == 0 && write.failures == 0; sample++)
+    {
+        high = !(sample & 0x1);
+        start = nowNs();
+        write.failures += gpioShmWrite(high ? mask : 0, high ? 0 : mask) != OK;
+
+        do
+        {
+            gpioShmReadLevels(&levels, NULL);
+        }
+        while (!(levels & mask) != !high && nowNs() - start < SHM_TIMEOUT_NS);
+
+        samples[sample] = nowNs() - start;
+        gpioShmReadEvents(&event, 1, &found, &lost);
+        write.failures += !(levels & mask) != !high || !found || lost ||
+                          event.changed != mask || (event.levels & mask) != (levels & mask);
+    }
+
+    gpioShmDetach();
+    gpioShmStop();
+
+    summarise(&write, samples, sample ? sample : 1, 1);
+    emit(&write);
+}
+
+/* Writes two bytes to a register of the simulated register file then reads
+ * them back, as one arbiter batch. Returns non zero on failure. */
+static int arbiterBatch(int address, int reg, int sample)
+{
+    tI2cTransfer transfers[2];
+    uint8_t data[3] = {(uint8_t)reg, (uint8_t)sample, (uint8_t)(sample >> 8)};
+    uint8_t read[2] = {0, 0};
+
+    memset(transfers, 0, sizeof(transfers));
+    transfers[0].address = address;
+    transfers[0].writeData = data;
+    transfers[0].writeLength = sizeof(data);
+    transfers[1].address = address;
+    transfers[1].writeData = data;
+    transfers[1].writeLength = 1;
+    transfers[1].readBuffer = read;
+    transfers[1].readLength = sizeof(read);
+
+    return gpioI2cArbiterTransfer(I2C_CLOCK_FREQ_MAX, transfers, 2) != OK ||
+           memcmp(read, data + 1, sizeof(read)) != 0;
+}
+
+/* Times writes and reads while recording them, then replays the recording */
+static void benchRecord(int address, uint64_t * samples, int count)
+{
+    tResult record = {"i2c_record_write_read", "ns/transaction", 0, 0, 0, 0, 0, "byte/s", 0};
+    tResult replay = {"i2c_replay", "ns/call", 0, 0, 0, 0, 0, "call/s", 0};
+    tI2cReplayStats stats;
+    tI2cTiming timing = {I2C_CLOCK_FREQ_MAX, 0, 0, 0};
+    uint8_t data[3] = {0, 0, 0};
+    uint8_t read[2] = {0, 0};
+    uint64_t start = 0;
+    int sample = 0;
+
+    record.failures += gpioI2cRecordStart(RECORD_PATH) != OK;
+    record.failures += gpioI2cSetClock(I2C_CLOCK_FREQ_MAX) != OK ||
+                       gpioI2cSetTiming(&timing, NULL) != OK ||
+                       gpioI2cSet7BitSlave(address) != OK;
+
+    for (sample = 0; sample < count && record.failures == 0; sample++)
+    {
+        data[1] = (uint8_t)sample;
+        data[2] = (uint8_t)(sample >> 8);
+        start = nowNs();
+        record.failures += gpioI2cWriteData(data, sizeof(data)) != OK ||
+                           gpioI2cWriteData(data, 1) != OK ||
+                           gpioI2cReadData(read, sizeof(read)) != OK;
+        samples[sample] = nowNs() - start;
+        record.failures += memcmp(read, data + 1, sizeof(read)) != 0;
+    }
+
+    record.failures += gpioI2cRecordStop() != OK;
+    summarise(&record, samples, sample ? sample : 1, sizeof(data) + 1 + sizeof(read));
+    emit(&record);
+
+    for (sample = 0; sample <= RECORD_REPLAYS && record.failures == 0; sample++)
+    {
+        /* The last replay keeps the recorded timing */
+        replay.failures += gpioI2cReplay(RECORD_PATH, sample == RECORD_REPLAYS, &stats) != OK;
+        replay.failures += stats.statusMismatches + stats.dataMismatches +
+                           (stats.calls != (uint64_t)count * 3 + 3);
+        samples[sample] = stats.calls ? stats.replayed_ns / stats.calls : 0;
+    }
+
+    unlink(RECORD_PATH);
+    summarise(&replay, samples, sample ? sample : 1, 1);
+    emit(&replay);
+}
+
+/* Times batches through an arbiter in this process, with clients - 1 other
+ * processes sending the same number of batches at the same time */
+static void benchArbiter(int clients, int address, uint64_t * samples, int count)
+{
+    static char name[64];
+    tResult result = {name, "ns/batch", 0, 0, 0, 0, 0, "batch/s", 0};
+    tI2cArbiterStats stats;
+    pid_t children[ARBITER_CLIENTS];
+    uint64_t start = 0;
+    int sample = 0;
+    int child = 0;
+    int failed = 0;
+    int status = 0;
+
+    snprintf(name, sizeof(name), "i2c_arbiter_%dclient%s", clients, clients > 1 ? "s" : "");
+    result.failures += gpioI2cArbiterStart(ARBITER_PATH, 0600) != OK;
+
+    for (child = 1; child < clients && result.failures == 0; child++)
+    {
+        if ((children[child] = fork()) == 0)
+        {
+            failed = gpioI2cArbiterConnect(ARBITER_PATH) != OK;
+
+            for (sample = 0; sample < count && !failed; sample++)
+            {
+                failed = arbiterBatch(address, child * 2, sample);
+            }
+
+            _exit(failed);
+        }
+
+        result.failures += children[child] < 0;
+    }
+
+    result.failures += gpioI2cArbiterConnect(ARBITER_PATH) != OK;
+
+    for (sample = 0; sample < count && result.failures == 0; sample++)
+    {
+        start = nowNs();
+        result.failures += arbiterBatch(address, 0, sample);
+        samples[sample] = nowNs() - start;
+    }
+
+    for (child = 1; child < clients; child++)
+    {
+        result.failures += children[child] <= 0 || waitpid(children[child], &status, 0) < 0 ||
+                           !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+
+    gpioI2cArbiterGetStats(&stats);
+    result.failures += stats.batches != (uint64_t)count * clients || stats.rejected != 0;
+
+    for (child = 0; child < clients; child++)
+    {
+        result.failures += stats.client[child].batches != (uint64_t)count;
+    }
+
+    gpioI2cArbiterDisconnect();
+    gpioI2cArbiterStop();
+
+    summarise(&result, samples, sample ? sample : 1, 1);
+    emit(&result);
+}
+#endif
+
+/* Checks each half follows on from the last and counts pin transitions */
+static void captureHalf(void * context, const uint32_t * samples, size_t count,
+                        uint64_t index)
+{
+    tCaptureBench * bench = context;
+    uint64_t now = nowNs();
+    size_t sample = 0;
+
+    if (bench->halves > 0 && bench->halves <= bench->count)
+    {
+        bench->intervals[bench->halves - 1] = now - bench->last;
+    }
+
+    if (bench->halves > 0 && index != bench->expected)
+    {
+        bench->gaps++;
+    }
+
+    else if (bench->halves == 0)
+    {
+        bench->level = samples[0] & bench->mask;
+    }
+
+    for (sample = 0; sample < count; sample++)
+    {
+        if ((samples[sample] & bench->mask) != bench->level)
+        {
+            bench->level ^= bench->mask;
+            bench->transitions++;
+        }
+    }
+
+    bench->last = now;
+    bench->expected = index + count;
+    bench->halves++;
+}
+
+/* Captures while the pin is toggled every CAPTURE_TOGGLE_NS. Paced by PCM so
+ * it does not contend with the PWM used by other benchmarks. */
+static void benchCapture(int pin, uint64_t * samples, int count)
+{
+    tResult result = {"capture_half_interval", "ns", 0, 0, 0, 0, 0, "sample/s", 0};
+    tCaptureBench bench;
+    tCaptureStats stats;
+    struct timespec wait = {0, CAPTURE_TOGGLE_NS};
+    uint32_t tick = 0;
+    int toggle = 0;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.intervals = samples;
+    bench.count = count;
+    bench.mask = 0x1u << pin;
+
+    /* Earlier benchmarks may have left the pin an input, or high */
+    if (gpioSetFunction(pin, output) != OK || gpioSetPin(pin, low) != OK ||
+        gpioCaptureStart(wavePacePcm, CAPTURE_TICK_NS, -1, CAPTURE_HALF,
+                         captureHalf, &bench, &tick) != OK)
+    {
+        result.failures = 1;
+        emit(&result);
+        return;
+    }
+
+    /* Let the first half complete so every toggle is captured */
+    nanosleep(&wait, NULL);
+
+    for (toggle = 0; toggle < CAPTURE_TOGGLES; toggle++)
+    {
+        gpioSetPin(pin, toggle & 0x1 ? low : high);
+        nanosleep(&wait, NULL);
+    }
+
+    gpioSetPin(pin, low);
+    nanosleep(&wait, NULL);
+    gpioCaptureStop();
+    gpioCaptureGetStats(&stats);
+
+    result.failures = stats.overruns + bench.gaps +
+                      (bench.transitions != CAPTURE_TOGGLES);
+
+    if (bench.halves > 1)
+    {
+        summarise(&result, samples, bench.halves - 1 < count ? bench.halves - 1 : count,
+                  CAPTURE_HALF);
+    }
+
+    else
+    {
+        result.failures++;
+    }
+
+    emit(&result);
+}
+
+int main(int argc, char ** argv)
+{
+    static const int clocks[] = {I2C_CLOCK_FREQ_MIN, 20000, 50000, 100000,
+                                 200000, I2C_CLOCK_FREQ_MAX};
+    int samples = DEFAULT_SAMPLES;
+    int pin = DEFAULT_PIN;
+    int length = DEFAULT_LENGTH;
+    int address = -1;
+    int pwmChannels = 0;
+    int capture = 0;
+    int option = 0;
+    unsigned int clock = 0;
+    uint64_t * buffer = NULL;
+
+#ifdef GPIO_SIM
+    address = SIM_ADDRESS;
+    pwmChannels = SIM_PWM_CHANNELS;
+    capture = 1;
+#endif
+
+    while ((option = getopt(argc, argv, "cjdn:p:a:l:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'c': gFormat = formatCsv;                  break;
+            case 'j': gFormat = formatJson;                 break;
+            case 'd': capture = 1;                          break;
+            case 'n': samples = atoi(optarg);               break;
+            case 'p': pin = atoi(optarg);                   break;
+            case 'a': address = strtol(optarg, NULL, 0);    break;
+            case 'l': length = atoi(optarg);                break;
+            case 's': pwmChannels = atoi(optarg);           break;
+            default:
+                fprintf(stderr, "usage: %s [-c|-j] [-d] [-n samples] [-p gpio] "
+                                "[-a address] [-l length] [-s channels]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (samples <= 0 || length <= 0 || length > MAX_LENGTH ||
+        pwmChannels < 0 || PWM_FIRST_PIN + pwmChannels > 28 ||
+        (buffer = malloc(samples * sizeof(uint64_t))) == NULL)
+    {
+        fprintf(stderr, "bad samples, length or channels\n");
+        return 1;
+    }
+
+#ifdef GPIO_SIM
+    simI2cAttachRegisterFile(address);
+#endif
+
+#ifdef GPIO_SIM
+    benchBoard(buffer, samples);
+    benchI2cClock(buffer, samples);
+#endif
+
+    if (gpioSetup() != OK || gpioSetFunction(pin, output) != OK)
+    {
+        fprintf(stderr, "gpioSetup failed\n");
+        return 1;
+    }
+
+    benchToggle(pin, buffer, samples);
+    benchReadLevels(buffer, samples);
+    benchSetFunction(pin, buffer, samples);
+    benchWaveBuild(buffer, samples);
+    benchDebounce(buffer, samples);
+#ifdef GPIO_SIM
+    benchPwm(buffer, samples);
+    benchEncoder(encoderSampleLevels, buffer, samples);
+    benchEncoder(encoderSampleEvents, buffer, samples);
+#endif
+
+    if (pwmChannels > 0)
+    {
+        benchSoftPwm(pwmChannels);
+    }
+
+#ifdef GPIO_SIM
+    benchPulse(buffer, samples);
+    benchSoftI2c(1, length, buffer, samples < SOFT_I2C_SAMPLES ? samples : SOFT_I2C_SAMPLES);
+    benchSoftI2c(SOFT_I2C_BUSES_MAX, length, buffer,
+                 samples < SOFT_I2C_SAMPLES ? samples : SOFT_I2C_SAMPLES);
+    benchSoftSpi(1, length, buffer, samples);
+    benchSoftSpi(SOFT_SPI_LANES_MAX, length, buffer, samples);
+    benchOneWire(1, buffer, samples < ONE_WIRE_SAMPLES ? samples : ONE_WIRE_SAMPLES);
+    benchOneWire(ONE_WIRE_BUSES_MAX, buffer,
+                 samples < ONE_WIRE_SAMPLES ? samples : ONE_WIRE_SAMPLES);
+    benchLed(1, buffer, samples);
+    benchLed(LED_STRIPS_MAX, buffer, samples);
+    benchLedDma(LED_STRIPS_MAX, buffer, samples);
+    benchShift(1, buffer, samples);
+    benchShift(SHIFT_CHAINS_USED, buffer, samples);
+    benchParallelWrite(8, buffer, samples);
+    benchParallelWrite(16, buffer, samples);
+    benchParallelFlush(0, buffer, samples);
+    benchParallelFlush(1, buffer, samples);
+    benchKeypad(buffer, samples);
+    benchShm(buffer, samples);
+#endif
+
+    if (capture)
+    {
+        benchCapture(pin, buffer, samples);
+    }
+
+    if (gpioI2cSetup() != OK)
+    {
+        fprintf(stderr, "gpioI2cSetup failed\n");
+    }
+
+    else
+    {
+        if (address >= 0)
+        {
+            for (clock = 0; clock < sizeof(clocks) / sizeof(clocks[0]); clock++)
+            {
+                gpioI2cSet7BitSlave(address);
+                /* The slow clocks take ms per transaction */
+                benchI2c(clocks[clock], length, buffer,
+                         samples / 10 ? samples / 10 : 1);
+            }
+        }
+
+#ifdef GPIO_SIM
+        benchRecord(address, buffer, samples / 10 ? samples / 10 : 1);
+        benchArbiter(1, address, buffer, samples / 10 ? samples / 10 : 1);
+        benchArbiter(ARBITER_CLIENTS, address, buffer, samples / 10 ? samples / 10 : 1);
+#endif
+        benchScan(buffer, samples / 100 ? samples / 100 : 1);
+        gpioI2cCleanup();
+    }
+
+    printf(gFormat == formatJson ? "\n]\n" : "");
+
+    gpioCleanup();
+    free(buffer);
+
+    return 0;
+}
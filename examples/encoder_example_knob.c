@@ -0,0 +1,78 @@
+/*
+ *  Encoder Example Knob:
+ *  The following is an example of decoding a rotary encoder. The encoder's
+ *  position and speed are printed every 100 ms for 10 seconds while the
+ *  sampling thread decodes every edge in the background.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO17 -->| A
+ * Raspberry Pi GPIO27 -->| B    ROTARY ENCODER
+ * Raspberry Pi GND    -->| C
+ *
+ * The encoder's contacts switch A and B to common, the internal pullups
+ * hold them high otherwise.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "rpiGpio.h"
+
+#define PIN_A           17
+#define PIN_B           27
+
+/* Sample every 50 us, comfortably faster than a hand turned knob */
+#define SAMPLE_NS       50000
+#define PRINT_NS        100000000
+#define PRINTS          100
+
+int main(void)
+{
+    struct timespec wait = {0, PRINT_NS};
+    tEncoderState state;
+    int encoder;
+    int ctr;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting");
+        return 1;
+    }
+
+    if (gpioEncoderStart(encoderSampleLevels, SAMPLE_NS, -1) != OK ||
+        gpioEncoderAdd(PIN_A, PIN_B, &encoder) != OK)
+    {
+        dbgPrint(DBG_INFO, "Encoder setup failed. Exiting");
+        gpioCleanup();
+        return 1;
+    }
+
+    gpioSetPullResistor(PIN_A, pullup);
+    gpioSetPullResistor(PIN_B, pullup);
+
+    for (ctr = 0; ctr < PRINTS; ctr++)
+    {
+        nanosleep(&wait, NULL);
+        gpioEncoderRead(encoder, &state);
+        printf("count: %lld velocity: %lld/s errors: %llu\n",
+               (long long)state.count, (long long)state.velocity,
+               (unsigned long long)state.errors);
+    }
+
+    gpioEncoderStop();
+    gpioCleanup();
+
+    return 0;
+}
@@ -3,7 +3,8 @@
  *  
  *  The following is an example of using the GPIO library to configure a pin 
  *  with a pullup resistor and put it into input mode.
- *  The pin is then read at 1 second intervals for 10 seconds.
+ *  The pin is then sampled every 5 ms for 10 seconds and debounced, a press
+ *  or release being reported once the switch has settled for 20 ms.
  *
  *  This program is free software: you can redistribute it and/or modify
  *  it under the terms of the GNU General Public License as published by
@@ -30,15 +31,23 @@
  */
 
 #include <stdio.h>
-#include <unistd.h>
+#include <time.h>
 #include "rpiGpio.h"
 
-/* The pin to use as an output and toggle */
+/* The pin the switch is connected to */
 #define GPIO_PIN 25
 
+/* Sampling period and the samples a switch must be settled for */
+#define SAMPLE_NS       5000000
+#define SETTLE_SAMPLES  4
+#define RUN_SAMPLES     2000
+
 int main(void)
 {
-    eState state;
+    struct timespec wait = {0, SAMPLE_NS};
+    tDebounce debounce;
+    uint32_t levels;
+    uint32_t changed;
     int ctr;
 
     if (gpioSetup() != OK)
@@ -54,11 +63,20 @@ int main(void)
      * pressed at which point it will read low. */
     gpioSetPullResistor(GPIO_PIN, pullup);
 
-    for (ctr = 0; ctr < 10; ctr++)
+    /* More pins could be debounced at the same cost by adding to the mask */
+    gpioReadLevels(&levels);
+    gpioDebounceInit(&debounce, 0x1u << GPIO_PIN, SETTLE_SAMPLES, levels);
+
+    for (ctr = 0; ctr < RUN_SAMPLES; ctr++)
     {
-        gpioReadPin(GPIO_PIN, &state);
-        printf("state: %d\n", state);
-        sleep(1);
+        nanosleep(&wait, NULL);
+        gpioReadLevels(&levels);
+        gpioDebounceUpdate(&debounce, levels, &changed);
+
+        if (changed & (0x1u << GPIO_PIN))
+        {
+            printf("%s\n", debounce.levels & changed ? "released" : "pressed");
+        }
     }
 
     gpioCleanup();
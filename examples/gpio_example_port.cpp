@@ -0,0 +1,75 @@
+/*
+ *  GPIO Example Port:
+ *  The following is an example of using the C++ pin and port types to toggle
+ *  one LED and count in binary on three others. Pin numbers are checked when
+ *  compiling and each set or clear is a single register write.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO PIN -->|
+ *                          |
+ *                         LED
+ *                          |
+ *                       RESISTOR
+ *                          |
+ * Raspberry Pi GND PIN  <--|
+ *
+ * The same LED and resistor on each of GPIO 22, 23, 24 and 25.
+ * RESISTOR = 470 R
+ */
+
+#include <unistd.h>
+#include "rpiGpio.hpp"
+
+using rpiGpio::Pin;
+using rpiGpio::Port;
+
+/* The pin to toggle */
+typedef Pin<25, output> Led;
+
+/* The pins to count on, GPIO22 is the least significant bit */
+typedef Port<Pin<22>, Pin<23>, Pin<24> > Counter;
+
+int main(void)
+{
+    uint32_t count = 0;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting\n");
+        return 1;
+    }
+
+    if (Led::setup() != OK || Counter::setup() != OK)
+    {
+        dbgPrint(DBG_INFO, "pin setup failed. Exiting\n");
+        gpioCleanup();
+        return 1;
+    }
+
+    for (count = 0; count < 8; count++)
+    {
+        Led::write(count & 0x1 ? high : low);
+        Counter::write(count);
+        sleep(1);
+    }
+
+    Counter::clear();
+    Led::set();
+
+    gpioCleanup();
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ *  I2C Example Arbiter:
+ *  The following is an example of several processes sharing the I2C bus.
+ *  Started with -s it becomes the arbiter, which owns the BSC until
+ *  interrupted and then prints how each client used it. Started without,
+ *  it reads a TMP102 Temperature Sensor through the arbiter once a second
+ *  for 10 seconds. Any number of readers may run at once.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup: as i2c_example_temp_sensor.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "rpiGpio.h"
+
+#define TMP102_ADDRESS                  0x48
+#define TMP102_TEMPERATURE_REGISTER     0x00
+
+/* Temp = Temp. Register Value * TMP102_CONVERSION */
+#define TMP102_CONVERSION               0.0625
+
+#define SOCKET_MODE                     0660
+
+static int arbiter(void)
+{
+    tI2cArbiterStats stats;
+    sigset_t signals;
+    int received = 0;
+    int client;
+
+    /* Blocked before the arbiter thread starts, so only sigwait() sees them */
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    if (gpioSetup() != OK || gpioI2cSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup or gpioI2cSetup failed. Exiting");
+        return 1;
+    }
+
+    if (gpioI2cArbiterStart(I2C_ARBITER_PATH, SOCKET_MODE) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioI2cArbiterStart failed. Exiting");
+        gpioI2cCleanup();
+        gpioCleanup();
+        return 1;
+    }
+
+    sigwait(&signals, &received);
+
+    gpioI2cArbiterGetStats(&stats);
+    gpioI2cArbiterStop();
+
+    printf("%llu batches, most waiting at once %u\n",
+           (unsigned long long)stats.batches, stats.depthMax);
+
+    for (client = 0; client < I2C_ARBITER_CLIENTS; client++)
+    {
+        if (stats.client[client].batches)
+        {
+            printf("pid %d: %llu batches, longest wait %llu us\n", stats.client[client].pid,
+                   (unsigned long long)stats.client[client].batches,
+                   (unsigned long long)stats.client[client].waitMax_ns / 1000);
+        }
+    }
+
+    gpioI2cCleanup();
+    gpioCleanup();
+    return 0;
+}
+
+static int reader(void)
+{
+    uint8_t rxBuffer[2] = {0};
+    uint8_t txBuffer[1] = {TMP102_TEMPERATURE_REGISTER};
+    tI2cTransfer transfer;
+    uint32_t temperature = 0;
+    int ctr;
+
+    if (gpioI2cArbiterConnect(I2C_ARBITER_PATH) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioI2cArbiterConnect failed, is the arbiter running? Exiting");
+        return 1;
+    }
+
+    /* Selecting the register and reading it are one batch, so no other
+     * process can select another register in between */
+    memset(&transfer, 0, sizeof(transfer));
+    transfer.address = TMP102_ADDRESS;
+    transfer.writeData = txBuffer;
+    transfer.writeLength = sizeof(txBuffer);
+    transfer.readBuffer = rxBuffer;
+    transfer.readLength = sizeof(rxBuffer);
+
+    for (ctr = 0; ctr < 10; ctr++)
+    {
+        if (gpioI2cArbiterTransfer(100000, &transfer, 1) == OK)
+        {
+            temperature = rxBuffer[0] << 4;
+            temperature |= rxBuffer[1] >> 4;
+            fprintf(stdout, "Temperature: %.2f Celsius\n", temperature * TMP102_CONVERSION);
+        }
+
+        sleep(1);
+    }
+
+    gpioI2cArbiterDisconnect();
+    return 0;
+}
+
+int main(int argc, char ** argv)
+{
+    return argc > 1 && strcmp(argv[1], "-s") == 0 ? arbiter() : reader();
+}
@@ -0,0 +1,60 @@
+/*
+ *  I2C Example Replay:
+ *  The following is an example of replaying I2C traffic recorded with
+ *  gpioI2cRecordStart(), for instance by a program in the field, against
+ *  the devices on this Pi's bus. Pass -t to keep the recorded timing rather
+ *  than making the calls back to back. The devices should be in the state
+ *  they were in when recording started for reads to compare equal.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rpiGpio.h"
+
+int main(int argc, char ** argv)
+{
+    tI2cReplayStats stats;
+    int timed = argc > 2 && strcmp(argv[1], "-t") == 0;
+    errStatus rtn;
+
+    if (argc != 2 + timed)
+    {
+        fprintf(stderr, "usage: %s [-t] recording\n", argv[0]);
+        return 1;
+    }
+
+    if (gpioSetup() != OK || gpioI2cSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup or gpioI2cSetup failed. Exiting");
+        return 1;
+    }
+
+    rtn = gpioI2cReplay(argv[1 + timed], timed, &stats);
+
+    printf("%llu calls, %llu returned a different status, %llu read different data\n",
+           (unsigned long long)stats.calls, (unsigned long long)stats.statusMismatches,
+           (unsigned long long)stats.dataMismatches);
+    printf("recorded %llu us, replayed %llu us",
+           (unsigned long long)stats.recorded_ns / 1000,
+           (unsigned long long)stats.replayed_ns / 1000);
+    printf(timed ? ", started up to %llu us late\n" : "\n",
+           (unsigned long long)stats.lateMax_ns / 1000);
+
+    gpioI2cCleanup();
+    gpioCleanup();
+
+    return rtn == OK ? 0 : 1;
+}
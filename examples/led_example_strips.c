@@ -0,0 +1,116 @@
+/*
+ *  LED Example Strips:
+ *  The following is an example of a rainbow running along two strips of
+ *  60 WS2812B LEDs, one on each pin. Both strips are sent together, so a
+ *  frame takes as long as one strip. Frames are played by DMA, so no CPU
+ *  time is spent on the bit timing. Runs for 10 seconds at about 50 frames
+ *  a second. Requires root.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO22 -->| DIN     WS2812B strip (1)
+ * Raspberry Pi GPIO23 -->| DIN     WS2812B strip (2)
+ *
+ * Each data line goes through a 74AHCT125 buffer to reach 5 V levels. The
+ * strips have their own 5 V supply with its ground joined to the Pi's.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "rpiGpio.h"
+
+#define STRIPS          2
+#define FIRST_PIN       22
+#define LEDS            60
+#define TICK_NS         400
+#define FRAMES          500
+
+/* A dim colour around the colour wheel, position 0 - 255 */
+static uint32_t wheel(int position)
+{
+    uint32_t level = (uint32_t)(position % 85) * 3 / 8;
+
+    return position < 85  ? (level << 16) | ((31 - level) << 8) :
+           position < 170 ? ((31 - level) << 16) | level :
+                            (level << 8) | (31 - level);
+}
+
+int main(void)
+{
+    struct timespec wait = {0, 20000000};
+    int pins[STRIPS];
+    int strip;
+    int led;
+    int frame;
+
+    for (strip = 0; strip < STRIPS; strip++)
+    {
+        pins[strip] = FIRST_PIN + strip;
+    }
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting");
+        return 1;
+    }
+
+    else if (gpioWaveSetup(wavePacePwm, TICK_NS, -1, NULL) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioWaveSetup failed. Exiting");
+        gpioCleanup();
+        return 1;
+    }
+
+    else if (gpioLedOpen(pins, STRIPS, LEDS) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen failed. Exiting");
+        gpioWaveCleanup();
+        gpioCleanup();
+        return 1;
+    }
+
+    for (frame = 0; frame < FRAMES; frame++)
+    {
+        for (strip = 0; strip < STRIPS; strip++)
+        {
+            for (led = 0; led < LEDS; led++)
+            {
+                /* The second strip runs the other way */
+                gpioLedSetPixel(strip, led,
+                                wheel((led * 256 / LEDS + (strip ? -frame : frame) * 4) & 0xFF));
+            }
+        }
+
+        gpioLedShow(ledDriveDma);
+        nanosleep(&wait, NULL);
+    }
+
+    for (strip = 0; strip < STRIPS; strip++)
+    {
+        for (led = 0; led < LEDS; led++)
+        {
+            gpioLedSetPixel(strip, led, 0);
+        }
+    }
+
+    gpioLedShow(ledDriveDma);
+    nanosleep(&wait, NULL);
+
+    gpioLedClose();
+    gpioWaveCleanup();
+    gpioCleanup();
+
+    return 0;
+}
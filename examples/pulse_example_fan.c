@@ -0,0 +1,103 @@
+/*
+ *  Pulse Example Fan:
+ *  The following is an example of measuring a PC fan's speed from its
+ *  tachometer output, and the duty of a PWM signal on a second pin. The
+ *  measurements are printed every second for 10 seconds.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO23 -->| TACH      FAN
+ * Raspberry Pi GND    -->| GND
+ *
+ * Raspberry Pi GPIO24 -->| PWM signal, 3.3 V logic
+ *
+ * The tachometer is open collector, the internal pullup holds it high. Two
+ * pulses are output per revolution.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "rpiGpio.h"
+
+#define TACH_PIN            23
+#define PWM_PIN             24
+#define PULSES_PER_REV      2
+
+/* 20 us samples, averaging over 16 tachometer and 256 PWM cycles */
+#define SAMPLE_NS           20000
+#define TACH_WINDOW         16
+#define PWM_WINDOW          256
+
+/* No tachometer edge for this long means the fan has stopped */
+#define STOPPED_NS          1000000000ULL
+
+int main(void)
+{
+    struct timespec wait = {1, 0};
+    struct timespec now;
+    tPulseMeasure tach;
+    tPulseMeasure pwm;
+    uint64_t now_ns;
+    int ctr;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting");
+        return 1;
+    }
+
+    gpioSetFunction(TACH_PIN, input);
+    gpioSetPullResistor(TACH_PIN, pullup);
+    gpioSetFunction(PWM_PIN, input);
+
+    if (gpioPulseStart(SAMPLE_NS, -1) != OK ||
+        gpioPulseAdd(TACH_PIN, TACH_WINDOW) != OK ||
+        gpioPulseAdd(PWM_PIN, PWM_WINDOW) != OK)
+    {
+        dbgPrint(DBG_INFO, "Pulse measurement setup failed. Exiting");
+        gpioCleanup();
+        return 1;
+    }
+
+    for (ctr = 0; ctr < 10; ctr++)
+    {
+        nanosleep(&wait, NULL);
+        gpioPulseRead(TACH_PIN, &tach);
+        gpioPulseRead(PWM_PIN, &pwm);
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+        if (tach.period_ns == 0 || now_ns - tach.lastEdge_ns > STOPPED_NS)
+        {
+            printf("fan: stopped ");
+        }
+
+        else
+        {
+            printf("fan: %llu rpm ", (unsigned long long)
+                   (60000000000ULL / (tach.period_ns * PULSES_PER_REV)));
+        }
+
+        printf("pwm: %u.%03u Hz duty %u.%u %%\n",
+               pwm.frequency_mHz / 1000, pwm.frequency_mHz % 1000,
+               pwm.duty / 10000, pwm.duty / 1000 % 10);
+    }
+
+    gpioPulseStop();
+    gpioCleanup();
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ *  PWM Example LED:
+ *  The following is an example of using the PWM peripheral to fade an LED
+ *  up and down, and of outputting a 1 MHz clock on GPCLK0. Once configured
+ *  the peripherals produce the waveforms without using the CPU.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO18 -->|
+ *                        |
+ *                       LED
+ *                        |
+ *                     RESISTOR
+ *                        |
+ * Raspberry Pi GND    <--|
+ *
+ * RESISTOR = 470 R
+ * GPIO4 to an oscilloscope or frequency counter.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "rpiGpio.h"
+
+/* PWM channel 1 on ALT5 */
+#define LED_PIN         18
+/* GPCLK0 on ALT0 */
+#define CLOCK_PIN       4
+
+#define PWM_FREQ_HZ     1000
+#define CLOCK_FREQ_HZ   1000000
+#define STEPS           50
+
+int main(void)
+{
+    int step;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting\n");
+        return 1;
+    }
+
+    else if (gpioPwmSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioPwmSetup failed. Exiting\n");
+        gpioCleanup();
+        return 1;
+    }
+
+    else if (gpioClockStart(CLOCK_PIN, CLOCK_FREQ_HZ) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioClockStart failed. Exiting\n");
+        gpioPwmCleanup();
+        gpioCleanup();
+        return 1;
+    }
+
+    /* Fade up then down */
+    for (step = 0; step <= 2 * STEPS; step++)
+    {
+        int level = step <= STEPS ? step : 2 * STEPS - step;
+
+        gpioPwmSetOutput(LED_PIN, PWM_FREQ_HZ, PWM_DUTY_MAX / STEPS * level);
+        usleep(40000);
+    }
+
+    gpioPwmStop(LED_PIN);
+    gpioClockStop(CLOCK_PIN);
+
+    gpioPwmCleanup();
+    gpioCleanup();
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ *  Shm Example Client:
+ *  The following is an example of a process using the pins through
+ *  shm_example_daemon, without mapping the GPIO registers itself. An LED is
+ *  flashed and a button is watched for 10 seconds, printing each change.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO25 -->| LED |--> 330R --> GND
+ * Raspberry Pi GPIO24 -->| BUTTON |--> GND
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "rpiGpio.h"
+
+#define LED_PIN             25
+#define BUTTON_PIN          24
+#define EVENTS              16
+
+int main(void)
+{
+    struct timespec wait = {0, 100000000};
+    tShmEvent events[EVENTS];
+    uint32_t lost = 0;
+    int count = 0;
+    int ctr;
+    int index;
+
+    if (gpioShmAttach(SHM_NAME_DEFAULT) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioShmAttach failed, is the daemon running? Exiting");
+        return 1;
+    }
+
+    gpioShmSetFunction(LED_PIN, output);
+    gpioShmSetFunction(BUTTON_PIN, input);
+    gpioShmSetPullResistor(BUTTON_PIN, pullup);
+
+    for (ctr = 0; ctr < 100; ctr++)
+    {
+        if (ctr % 5 == 0)
+        {
+            gpioShmWrite(ctr % 10 ? 0 : 0x1u << LED_PIN,
+                         ctr % 10 ? 0x1u << LED_PIN : 0);
+        }
+
+        nanosleep(&wait, NULL);
+        gpioShmReadEvents(events, EVENTS, &count, &lost);
+
+        for (index = 0; index < count; index++)
+        {
+            if (events[index].changed & (0x1u << BUTTON_PIN))
+            {
+                printf("%llu: button %s\n", (unsigned long long)events[index].time_ns,
+                       events[index].levels & (0x1u << BUTTON_PIN) ? "released" : "pressed");
+            }
+        }
+
+        if (lost)
+        {
+            printf("%u events lost\n", lost);
+        }
+    }
+
+    gpioShmDetach();
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ *  Shm Example Daemon:
+ *  The following is an example of a daemon sharing the GPIO pins with other
+ *  processes. It publishes the pin levels every millisecond to the shared
+ *  memory segment /rpigpio, which any user in the daemon's group may
+ *  attach to, and applies the output changes they ask for. It runs until
+ *  interrupted. See shm_example_client.c.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+#include <pthread.h>
+#include "rpiGpio.h"
+
+#define PERIOD_NS           1000000
+#define SEGMENT_MODE        0660
+
+int main(void)
+{
+    sigset_t signals;
+    int received = 0;
+
+    /* Blocked before any thread starts, so only sigwait() sees them */
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting");
+        return 1;
+    }
+
+    if (gpioShmStart(SHM_NAME_DEFAULT, PERIOD_NS, SEGMENT_MODE, -1) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioShmStart failed. Exiting");
+        gpioCleanup();
+        return 1;
+    }
+
+    sigwait(&signals, &received);
+
+    gpioShmStop();
+    gpioCleanup();
+
+    return 0;
+}
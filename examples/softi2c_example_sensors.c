@@ -0,0 +1,106 @@
+/*
+ *  Software I2C Example Sensors:
+ *  The following is an example of reading two TMP102 temperature sensors
+ *  which share an address, each on its own bit banged bus. Both buses are
+ *  clocked together so reading both takes as long as reading one. The
+ *  temperatures are printed every second for 10 seconds.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO22 -->| SDA     TMP102 (1), ADD0 to GND
+ * Raspberry Pi GPIO23 -->| SCL
+ * Raspberry Pi GPIO24 -->| SDA     TMP102 (2), ADD0 to GND
+ * Raspberry Pi GPIO25 -->| SCL
+ *
+ * Each line has a 4.7k pull up to 3.3 V.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "rpiGpio.h"
+
+#define SENSORS             2
+#define FIRST_SDA_PIN       22
+#define TMP102_ADDRESS      0x48
+#define TMP102_TEMPERATURE  0x00
+#define CLOCK_HZ            100000
+
+int main(void)
+{
+    static const uint8_t pointer = TMP102_TEMPERATURE;
+    struct timespec wait = {1, 0};
+    tSoftI2cTransfer transfers[SENSORS];
+    uint8_t data[SENSORS][2];
+    int bus[SENSORS];
+    int sensor;
+    int ctr;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting");
+        return 1;
+    }
+
+    for (sensor = 0; sensor < SENSORS; sensor++)
+    {
+        if (gpioSoftI2cOpen(FIRST_SDA_PIN + sensor * 2, FIRST_SDA_PIN + sensor * 2 + 1,
+                            CLOCK_HZ, &bus[sensor]) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioSoftI2cOpen failed. Exiting");
+            gpioCleanup();
+            return 1;
+        }
+
+        /* Write the register pointer, repeated start, read two bytes */
+        transfers[sensor].bus = bus[sensor];
+        transfers[sensor].address = TMP102_ADDRESS;
+        transfers[sensor].writeData = &pointer;
+        transfers[sensor].writeLength = 1;
+        transfers[sensor].readBuffer = data[sensor];
+        transfers[sensor].readLength = 2;
+    }
+
+    for (ctr = 0; ctr < 10; ctr++)
+    {
+        gpioSoftI2cTransfer(transfers, SENSORS);
+
+        for (sensor = 0; sensor < SENSORS; sensor++)
+        {
+            if (transfers[sensor].status != OK)
+            {
+                printf("sensor %d: %s ", sensor, gpioErrToString(transfers[sensor].status));
+            }
+
+            else
+            {
+                /* 12 bits left aligned, 0.0625 C per bit */
+                int16_t raw = (int16_t)((data[sensor][0] << 8) | data[sensor][1]) >> 4;
+                printf("sensor %d: %.4f C ", sensor, raw * 0.0625);
+            }
+        }
+
+        printf("\n");
+        nanosleep(&wait, NULL);
+    }
+
+    for (sensor = 0; sensor < SENSORS; sensor++)
+    {
+        gpioSoftI2cClose(bus[sensor]);
+    }
+
+    gpioCleanup();
+
+    return 0;
+}
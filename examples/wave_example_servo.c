@@ -0,0 +1,96 @@
+/*
+ *  Wave Example Servo:
+ *  The following is an example of driving two hobby servos from a DMA
+ *  waveform. Each 20 ms frame drives both pins high, then clears them after
+ *  their pulse widths. The DMA engine replays the frame without using the
+ *  CPU, so the pulses do not jitter when the system is busy.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Tested Setup:
+ * Raspberry Pi GPIO22 --> Servo A signal
+ * Raspberry Pi GPIO23 --> Servo B signal
+ * Raspberry Pi GND    --> Servo ground, shared with the servo supply
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include "rpiGpio.h"
+
+#define SERVO_A         22
+#define SERVO_B         23
+
+#define FRAME_NS        20000000
+#define PULSE_MIN_NS    1000000
+#define PULSE_MAX_NS    2000000
+#define TICK_NS         1000
+
+int main(void)
+{
+    tWaveStep steps[3];
+    uint32_t tick = 0;
+    uint32_t pulseA = 0;
+    uint32_t pulseB = 0;
+    int sweep;
+
+    if (gpioSetup() != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetup failed. Exiting\n");
+        return 1;
+    }
+
+    else if (gpioWaveSetup(wavePacePwm, TICK_NS, -1, &tick) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioWaveSetup failed. Exiting\n");
+        gpioCleanup();
+        return 1;
+    }
+
+    gpioSetFunction(SERVO_A, output);
+    gpioSetFunction(SERVO_B, output);
+    printf("Tick: %u ns\n", tick);
+
+    /* Sweep servo A one way and servo B the other */
+    for (sweep = 0; sweep <= 10; sweep++)
+    {
+        pulseA = PULSE_MIN_NS + (PULSE_MAX_NS - PULSE_MIN_NS) / 10 * sweep;
+        pulseB = PULSE_MAX_NS - (PULSE_MAX_NS - PULSE_MIN_NS) / 10 * sweep;
+
+        steps[0].setMask = (0x1 << SERVO_A) | (0x1 << SERVO_B);
+        steps[0].clearMask = 0;
+        steps[0].delay_ns = pulseA < pulseB ? pulseA : pulseB;
+
+        steps[1].setMask = 0;
+        steps[1].clearMask = 0x1 << (pulseA < pulseB ? SERVO_A : SERVO_B);
+        steps[1].delay_ns = (pulseA < pulseB ? pulseB - pulseA : pulseA - pulseB);
+
+        steps[2].setMask = 0;
+        steps[2].clearMask = (0x1 << SERVO_A) | (0x1 << SERVO_B);
+        steps[2].delay_ns = FRAME_NS - (pulseA > pulseB ? pulseA : pulseB);
+
+        if (gpioWavePlay(steps, 3, 1) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioWavePlay failed.\n");
+            break;
+        }
+
+        sleep(1);
+    }
+
+    gpioWaveStop();
+    gpioWaveCleanup();
+    gpioCleanup();
+
+    return 0;
+}
@@ -32,6 +32,36 @@
 #ifndef _BCM_2835_
 #define _BCM_2835_
 
+/******************************************************************************/
+/* The following are the physical peripheral base addresses of each SoC.      */
+/* The absolute register addresses further down are those of the BCM2835; on  */
+/* other SoCs the *_OFFSET values should be added to the appropriate base.    */
+/******************************************************************************/
+#define BCM2835_PERI_BASE       0x20000000  /**<BCM2835 (Pi 1, Zero) peripheral base */
+#define BCM2836_PERI_BASE       0x3F000000  /**<BCM2836 (Pi 2) peripheral base */
+#define BCM2837_PERI_BASE       0x3F000000  /**<BCM2837 (Pi 3, Zero 2) peripheral base */
+#define BCM2711_PERI_BASE       0xFE000000  /**<BCM2711 (Pi 4, Pi 400) peripheral base */
+
+#define GPIO_BASE_OFFSET        0x00200000  /**<GPIO block offset from the peripheral base */
+#define BSC0_BASE_OFFSET        0x00205000  /**<BSC0 block offset from the peripheral base */
+#define BSC1_BASE_OFFSET        0x00804000  /**<BSC1 block offset from the peripheral base */
+#define BSC2_BASE_OFFSET        0x00805000  /**<BSC2 block offset from the peripheral base */
+#define CM_BASE_OFFSET          0x00101000  /**<Clock manager block offset from the peripheral base */
+#define PWM_BASE_OFFSET         0x0020C000  /**<PWM block offset from the peripheral base */
+#define PCM_BASE_OFFSET         0x00203000  /**<PCM block offset from the peripheral base */
+#define DMA_BASE_OFFSET         0x00007000  /**<DMA channels 0 - 14 offset from the peripheral base */
+#define ST_BASE_OFFSET          0x00003000  /**<System timer offset from the peripheral base */
+
+#define PERI_BUS_BASE           0x7E000000  /**<Peripheral base as seen by DMA (bus address) */
+
+#define BCM2835_OSC_HZ          19200000    /**<Oscillator clock source of BCM2835 - BCM2837 */
+#define BCM2711_OSC_HZ          54000000    /**<Oscillator clock source of BCM2711 */
+#define BCM2835_PLLD_HZ         500000000   /**<PLLD clock source of BCM2835 - BCM2837 */
+#define BCM2711_PLLD_HZ         750000000   /**<PLLD clock source of BCM2711 */
+#define BCM2835_CORE_HZ         250000000   /**<Default core clock of BCM2835 - BCM2836 */
+#define BCM2837_CORE_HZ         400000000   /**<Default core clock of BCM2837 */
+#define BCM2711_CORE_HZ         500000000   /**<Default core clock of BCM2711 */
+
 /******************************************************************************/
 /* The following are the physical GPIO addresses                              */
 /******************************************************************************/
@@ -57,9 +87,15 @@
 #define GPREN0                  0x2020004C  /**<GPIO Pin Rising Edge Detect Enable 0 Register Address */
 #define GPREN1                  0x20200050  /**<GPIO Pin Rising Edge Detect Enable 1 Register Address */
 
+#define GPFEN0                  0x20200058  /**<GPIO Pin Falling Edge Detect Enable 0 Register Address */
+#define GPFEN1                  0x2020005C  /**<GPIO Pin Falling Edge Detect Enable 1 Register Address */
+
 #define GPHEN0                  0x20200064  /**<GPIO Pin High Detect Enable 0 Register Address */
 #define GPHEN1                  0x20200068  /**<GPIO Pin High Detect Enable 1 Register Address */
 
+#define GPLEN0                  0x20200070  /**<GPIO Pin Low Detect Enable 0 Register Address */
+#define GPLEN1                  0x20200074  /**<GPIO Pin Low Detect Enable 1 Register Address */
+
 #define GPAREN0                 0x2020007C  /**<GPIO Pin Async. Rising Edge Detect 0 Register Address */
 #define GPAREN1                 0x20200080  /**<GPIO Pin Async. Rising Edge Detect 1 Register Address */
 
@@ -99,9 +135,15 @@
 #define GPREN0_OFFSET           0x00004C  /**< GPIO Pin Rising Edge Detect Enable 0 Offset from GPIO_BASE */
 #define GPREN1_OFFSET           0x000050  /**< GPIO Pin Rising Edge Detect Enable 1 Offset from GPIO_BASE */
 
+#define GPFEN0_OFFSET           0x000058  /**< GPIO Pin Falling Edge Detect Enable 0 Offset from GPIO_BASE */
+#define GPFEN1_OFFSET           0x00005C  /**< GPIO Pin Falling Edge Detect Enable 1 Offset from GPIO_BASE */
+
 #define GPHEN0_OFFSET           0x000064  /**< GPIO Pin High Detect Enable 0 Offset from GPIO_BASE */
 #define GPHEN1_OFFSET           0x000068  /**< GPIO Pin High Detect Enable 1 Offset from GPIO_BASE */
 
+#define GPLEN0_OFFSET           0x000070  /**< GPIO Pin Low Detect Enable 0 Offset from GPIO_BASE */
+#define GPLEN1_OFFSET           0x000074  /**< GPIO Pin Low Detect Enable 1 Offset from GPIO_BASE */
+
 #define GPAREN0_OFFSET          0x00007C  /**< GPIO Pin Async. Rising Edge Detect 0 Offset from GPIO_BASE */
 #define GPAREN1_OFFSET          0x000080  /**< GPIO Pin Async. Rising Edge Detect 1 Offset from GPIO_BASE */
 
@@ -113,6 +155,12 @@
 #define GPPUDCLK0_OFFSET        0x000098  /**< GPIO Pin Pull-up/down Enable Clock 0 Offset from GPIO_BASE */
 #define GPPUDCLK1_OFFSET        0x00009C  /**< GPIO Pin Pull-up/down Enable Clock 1 Offset from GPIO_BASE */
 
+/* BCM2711 only - these replace GPPUD and GPPUDCLKx */
+#define GPPUPPDN0_OFFSET        0x0000E4  /**< BCM2711 GPIO Pull-up/down Control 0 Offset from GPIO_BASE */
+#define GPPUPPDN1_OFFSET        0x0000E8  /**< BCM2711 GPIO Pull-up/down Control 1 Offset from GPIO_BASE */
+#define GPPUPPDN2_OFFSET        0x0000EC  /**< BCM2711 GPIO Pull-up/down Control 2 Offset from GPIO_BASE */
+#define GPPUPPDN3_OFFSET        0x0000F0  /**< BCM2711 GPIO Pull-up/down Control 3 Offset from GPIO_BASE */
+
 
 /**********************************************************************************/
 /* Function select bits for GPFSELX. In GPFSELX registers each pin has three
@@ -133,6 +181,12 @@
 #define GPPUD_PULLDOWN          0x1 /**< Enables a pulldown resistor */
 #define GPPUD_PULLUP            0x2 /**< Enables a pullup resistor */
 
+/* Function select bits for GPPUPPDNx on the BCM2711. Two bits per pin. */
+#define GPPUPPDN_DISABLE        0x0 /**< BCM2711: Disables the resistor */
+#define GPPUPPDN_PULLUP         0x1 /**< BCM2711: Enables a pullup resistor */
+#define GPPUPPDN_PULLDOWN       0x2 /**< BCM2711: Enables a pulldown resistor */
+#define GPPUPPDN_BITS           0x3 /**< BCM2711: Two bits per GPIO in GPPUPPDNx */
+
 
 /******************************************************************************/
 /* The following are the physical BSC / I2C addresses                         */
@@ -144,6 +198,7 @@
 #define BSC0_FIFO               0x20205010 /**< BSC0 Data FIFO Register Address */
 #define BSC0_DIV                0x20205014 /**< BSC0 Clock Divider Register Address */
 #define BSC0_DEL                0x20205018 /**< BSC0 Data Delay Register Address */
+#define BSC0_CLKT               0x2020501C /**< BSC0 Clock Stretch Timeout Register Address */
 
 #define BSC1_C                  0x20804000 /**< BSC1 Control Register Address */
 #define BSC1_S                  0x20804004 /**< BSC1 Status Register Address */
@@ -152,6 +207,7 @@
 #define BSC1_FIFO               0x20804010 /**< BSC1 Data FIFO Register Address */
 #define BSC1_DIV                0x20804014 /**< BSC1 Clock Divider Register Address */
 #define BSC1_DEL                0x20804018 /**< BSC1 Data Delay Register Address */
+#define BSC1_CLKT               0x2080401C /**< BSC1 Clock Stretch Timeout Register Address */
 
 #define BSC2_C                  0x20805000 /**< BSC2 Control Register Address */
 #define BSC2_S                  0x20805004 /**< BSC2 Status Register Address */
@@ -160,6 +216,7 @@
 #define BSC2_FIFO               0x20805010 /**< BSC2 Data FIFO Register Address */
 #define BSC2_DIV                0x20805014 /**< BSC2 Clock Divider Register Address */
 #define BSC2_DEL                0x20805018 /**< BSC2 Data Delay Register Address */
+#define BSC2_CLKT               0x2080501C /**< BSC2 Clock Stretch Timeout Register Address */
 
 /**********************************************************************************/
 /* The following are the base addresses for each BSC module                       */
@@ -179,6 +236,7 @@
 #define BSC_FIFO_OFFSET     0x00000010  /**< BSC Data FIFO offset from BSCx_BASE */
 #define BSC_DIV_OFFSET      0x00000014  /**< BSC Clock Divider offset from BSCx_BASE */
 #define BSC_DEL_OFFSET      0x00000018  /**< BSC Data Delay offset from BSCx_BASE */
+#define BSC_CLKT_OFFSET     0x0000001C  /**< BSC Clock Stretch Timeout offset from BSCx_BASE */
 
 
 /**********************************************************************************/
@@ -207,4 +265,145 @@
 #define BSC_TA              0x001       /**< BSC Status: Transfer Active */
 
 #define BSC_FIFO_SIZE       16          /**< BSC FIFO Size */
+
+/**********************************************************************************/
+/* The following are the BSC Clock Divider, Data Delay and Clock Stretch Timeout
+ * Register fields */
+/**********************************************************************************/
+#define BSC_DIV_MIN         0x0002      /**< BSC Clock Divider: Smallest CDIV */
+#define BSC_DIV_MAX         0xFFFE      /**< BSC Clock Divider: Largest even CDIV */
+#define BSC_DEL_FEDL_SHIFT  16          /**< BSC Data Delay: Falling Edge Delay shift */
+#define BSC_DEL_REDL_SHIFT  0           /**< BSC Data Delay: Rising Edge Delay shift */
+#define BSC_DEL_MAX         0xFFFF      /**< BSC Data Delay: Largest FEDL or REDL */
+#define BSC_CLKT_MAX        0xFFFF      /**< BSC Clock Stretch Timeout: Largest TOUT */
+
+/**********************************************************************************/
+/* The following are offset addresses which can be used with a pointer to the
+ * PWM base */
+/**********************************************************************************/
+#define PWM_CTL_OFFSET      0x00000000  /**< PWM Control offset from PWM base */
+#define PWM_STA_OFFSET      0x00000004  /**< PWM Status offset from PWM base */
+#define PWM_DMAC_OFFSET     0x00000008  /**< PWM DMA Configuration offset from PWM base */
+#define PWM_RNG1_OFFSET     0x00000010  /**< PWM Channel 1 Range offset from PWM base */
+#define PWM_DAT1_OFFSET     0x00000014  /**< PWM Channel 1 Data offset from PWM base */
+#define PWM_FIF1_OFFSET     0x00000018  /**< PWM FIFO Input offset from PWM base */
+#define PWM_RNG2_OFFSET     0x00000020  /**< PWM Channel 2 Range offset from PWM base */
+#define PWM_DAT2_OFFSET     0x00000024  /**< PWM Channel 2 Data offset from PWM base */
+
+/**********************************************************************************/
+/* The following are the PWM Control Register Bits. Channel 2 bits are the        */
+/* channel 1 bits shifted left by PWM_CTL_CHANNEL_SHIFT.                          */
+/**********************************************************************************/
+#define PWM_PWEN1           0x0001      /**< PWM Control: Channel 1 Enable */
+#define PWM_MODE1           0x0002      /**< PWM Control: Channel 1 Serialiser Mode */
+#define PWM_RPTL1           0x0004      /**< PWM Control: Channel 1 Repeat Last Data */
+#define PWM_SBIT1           0x0008      /**< PWM Control: Channel 1 Silence Bit */
+#define PWM_POLA1           0x0010      /**< PWM Control: Channel 1 Polarity Inverted */
+#define PWM_USEF1           0x0020      /**< PWM Control: Channel 1 Use FIFO */
+#define PWM_CLRF1           0x0040      /**< PWM Control: Clear FIFO */
+#define PWM_MSEN1           0x0080      /**< PWM Control: Channel 1 Mark Space Enable */
+#define PWM_CTL_CHANNEL_SHIFT 8         /**< PWM Control: Shift from channel 1 to 2 bits */
+
+#define PWM_STA_ERRORS      0x01FF      /**< PWM Status: FIFO, bus and gap error flags, write 1 to clear */
+#define PWM_STA_STA1        0x0200      /**< PWM Status: Channel 1 transmitting, channel 2 is the next bit */
+
+#define PWM_DMAC_ENAB       0x80000000  /**< PWM DMA Configuration: DMA Enable */
+#define PWM_DMAC_PANIC(x)   ((x) << 8)  /**< PWM DMA Configuration: Panic threshold */
+#define PWM_DMAC_DREQ(x)    (x)         /**< PWM DMA Configuration: DREQ threshold */
+
+#define ST_CLO_OFFSET       0x00000004  /**< System timer: 1 MHz counter, lower 32 bits */
+
+/**********************************************************************************/
+/* The following are offset addresses which can be used with a pointer to the
+ * PCM base */
+/**********************************************************************************/
+#define PCM_CS_OFFSET       0x00000000  /**< PCM Control and Status offset from PCM base */
+#define PCM_FIFO_OFFSET     0x00000004  /**< PCM FIFO Data offset from PCM base */
+#define PCM_MODE_OFFSET     0x00000008  /**< PCM Mode offset from PCM base */
+#define PCM_RXC_OFFSET      0x0000000C  /**< PCM Receive Configuration offset from PCM base */
+#define PCM_TXC_OFFSET      0x00000010  /**< PCM Transmit Configuration offset from PCM base */
+#define PCM_DREQ_OFFSET     0x00000014  /**< PCM DMA Request Level offset from PCM base */
+
+#define PCM_CS_EN           0x00000001  /**< PCM Control: Enable */
+#define PCM_CS_RXON         0x00000002  /**< PCM Control: Receive Enable */
+#define PCM_CS_TXON         0x00000004  /**< PCM Control: Transmit Enable */
+#define PCM_CS_TXCLR        0x00000008  /**< PCM Control: Clear TX FIFO */
+#define PCM_CS_RXCLR        0x00000010  /**< PCM Control: Clear RX FIFO */
+#define PCM_CS_DMAEN        0x00000200  /**< PCM Control: DMA DREQ Enable */
+#define PCM_MODE_FLEN(x)    ((x) << 10) /**< PCM Mode: Frame length - 1 */
+#define PCM_TXC_CH1WEX      0x80000000  /**< PCM TX: Channel 1 width extension */
+#define PCM_TXC_CH1EN       0x40000000  /**< PCM TX: Channel 1 enable */
+#define PCM_DREQ_TX(x)      ((x) << 8)  /**< PCM DMA Request: TX request level */
+#define PCM_DREQ_TX_PANIC(x) ((x) << 24) /**< PCM DMA Request: TX panic level */
+
+/**********************************************************************************/
+/* The following are offset addresses which can be used with a pointer to a DMA
+ * channel. Channel n is at DMA_BASE + n * DMA_CHANNEL_SIZE */
+/**********************************************************************************/
+#define DMA_CHANNEL_SIZE        0x100       /**< Register space of each channel */
+#define DMA_CHANNEL_MAX         14          /**< Highest channel in the DMA_BASE page */
+#define DMA_ENABLE_OFFSET       0x00000FF0  /**< Global enable offset from DMA base */
+#define DMA_CS_OFFSET           0x00000000  /**< DMA Control and Status offset */
+#define DMA_CONBLK_AD_OFFSET    0x00000004  /**< DMA Control Block Address offset */
+#define DMA_TI_OFFSET           0x00000008  /**< DMA Transfer Information offset */
+#define DMA_SOURCE_AD_OFFSET    0x0000000C  /**< DMA Source Address offset */
+#define DMA_DEST_AD_OFFSET      0x00000010  /**< DMA Destination Address offset */
+#define DMA_TXFR_LEN_OFFSET     0x00000014  /**< DMA Transfer Length offset */
+#define DMA_NEXTCONBK_OFFSET    0x0000001C  /**< DMA Next Control Block offset */
+#define DMA_DEBUG_OFFSET        0x00000020  /**< DMA Debug offset */
+
+#define DMA_CS_ACTIVE           0x00000001  /**< DMA Control: Active */
+#define DMA_CS_END              0x00000002  /**< DMA Control: End, write 1 to clear */
+#define DMA_CS_INT              0x00000004  /**< DMA Control: Interrupt, write 1 to clear */
+#define DMA_CS_ERROR            0x00000100  /**< DMA Control: Error */
+#define DMA_CS_PRIORITY(x)      ((x) << 16) /**< DMA Control: AXI priority */
+#define DMA_CS_PANIC_PRIORITY(x) ((x) << 20) /**< DMA Control: AXI panic priority */
+#define DMA_CS_WAIT_WRITES      0x10000000  /**< DMA Control: Wait for outstanding writes */
+#define DMA_CS_ABORT            0x40000000  /**< DMA Control: Abort the current block */
+#define DMA_CS_RESET            0x80000000  /**< DMA Control: Reset the channel */
+#define DMA_DEBUG_CLEAR         0x00000007  /**< DMA Debug: Clear every error flag */
+
+#define DMA_TI_WAIT_RESP        0x00000008  /**< DMA Transfer: Wait for write response */
+#define DMA_TI_DEST_INC         0x00000010  /**< DMA Transfer: Increment destination */
+#define DMA_TI_DEST_DREQ        0x00000040  /**< DMA Transfer: Pace writes with DREQ */
+#define DMA_TI_SRC_INC          0x00000100  /**< DMA Transfer: Increment source */
+#define DMA_TI_SRC_DREQ         0x00000400  /**< DMA Transfer: Pace reads with DREQ */
+#define DMA_TI_PERMAP(x)        ((x) << 16) /**< DMA Transfer: Peripheral providing DREQ */
+#define DMA_TI_NO_WIDE_BURSTS   0x04000000  /**< DMA Transfer: No wide writes */
+#define DMA_LENGTH_MAX          0xFFFC      /**< Longest transfer on every channel, lite included */
+
+#define DMA_DREQ_PCM_TX         2           /**< DREQ peripheral: PCM transmit */
+#define DMA_DREQ_PWM            5           /**< DREQ peripheral: PWM */
+
+/**********************************************************************************/
+/* The following are offset addresses which can be used with a pointer to the
+ * clock manager base */
+/**********************************************************************************/
+#define CM_GP0CTL_OFFSET    0x00000070  /**< General Purpose Clock 0 Control offset from CM base */
+#define CM_GP0DIV_OFFSET    0x00000074  /**< General Purpose Clock 0 Divisor offset from CM base */
+#define CM_GP1CTL_OFFSET    0x00000078  /**< General Purpose Clock 1 Control offset from CM base */
+#define CM_GP1DIV_OFFSET    0x0000007C  /**< General Purpose Clock 1 Divisor offset from CM base */
+#define CM_GP2CTL_OFFSET    0x00000080  /**< General Purpose Clock 2 Control offset from CM base */
+#define CM_GP2DIV_OFFSET    0x00000084  /**< General Purpose Clock 2 Divisor offset from CM base */
+#define CM_PCMCTL_OFFSET    0x00000098  /**< PCM Clock Control offset from CM base */
+#define CM_PCMDIV_OFFSET    0x0000009C  /**< PCM Clock Divisor offset from CM base */
+#define CM_PWMCTL_OFFSET    0x000000A0  /**< PWM Clock Control offset from CM base */
+#define CM_PWMDIV_OFFSET    0x000000A4  /**< PWM Clock Divisor offset from CM base */
+
+/**********************************************************************************/
+/* The following are the Clock Manager Control and Divisor Register Bits          */
+/**********************************************************************************/
+#define CM_PASSWD           0x5A000000  /**< CM: Password, required in every write */
+#define CM_MASH_SHIFT       9           /**< CM Control: MASH filter stages shift */
+#define CM_FLIP             0x0100      /**< CM Control: Invert the output */
+#define CM_BUSY             0x0080      /**< CM Control: Clock generator running */
+#define CM_KILL             0x0020      /**< CM Control: Stop the clock generator */
+#define CM_ENAB             0x0010      /**< CM Control: Enable the clock generator */
+#define CM_SRC_OSC          0x0001      /**< CM Control: Source is the oscillator */
+#define CM_SRC_PLLD         0x0006      /**< CM Control: Source is PLLD */
+#define CM_SRC_MASK         0x000F      /**< CM Control: Source field */
+#define CM_MASH_MASK        0x0600      /**< CM Control: MASH field */
+#define CM_DIVI_SHIFT       12          /**< CM Divisor: Integer part shift */
+#define CM_DIVI_MAX         0xFFF       /**< CM Divisor: Largest integer part */
+#define CM_DIVF_BITS        12          /**< CM Divisor: Bits of fractional part */
 #endif /* _BCM_2835_ */
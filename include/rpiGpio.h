@@ -27,8 +27,9 @@
 #include <stdio.h>
 #include <stdint.h>
 
-/**@brief Speed of the core clock core_clk */
-#define CORE_CLK_HZ                 250000000
+/**@brief Speed of the BCM2835 core clock core_clk. The board table holds
+ * each board's, see tBoard::coreClockHz. */
+#define CORE_CLK_HZ                 BCM2835_CORE_HZ
 
 /** @brief The list of errors which may be returned from gpio functions.
  *  @details Errors are defined within #ERROR(x). */
@@ -44,7 +45,8 @@
     ERROR(ERROR_I2C_NACK)               \
     ERROR(ERROR_I2C)                    \
     ERROR(ERROR_I2C_CLK_TIMEOUT)        \
-    ERROR(ERROR_INVALID_BSC)        \
+    ERROR(ERROR_INVALID_BSC)            \
+    ERROR(ERROR_UNSUPPORTED)            \
 
 
 #undef  ERROR
@@ -52,12 +54,36 @@
 #define ERROR(x) x,
 
 
+/** @brief Log level which removes every message at compile time. */
+#define GPIO_LOG_NONE              0
+/** @brief Log level of errors. dbgPrint() logs at this level. */
+#define GPIO_LOG_ERROR             1
+/** @brief Log level of warnings. */
+#define GPIO_LOG_WARNING           2
+/** @brief Log level of informational messages. */
+#define GPIO_LOG_INFO              3
+/** @brief Log level of debug messages. */
+#define GPIO_LOG_DEBUG             4
+
+#ifndef GPIO_LOG_LEVEL
+/** @brief Messages above this level are removed at compile time. */
+#define GPIO_LOG_LEVEL             GPIO_LOG_DEBUG
+#endif
+
 /** @brief Minimum I2C frequency (Hertz) */
 #define I2C_CLOCK_FREQ_MIN         10000
 
 /** @brief Maximum I2C frequency (Hertz) */
 #define I2C_CLOCK_FREQ_MAX         400000
 
+/** @brief Clock stretch timeout (SCL clocks) set for a
+ ** tI2cTiming::clockStretchTimeout of 0, the BSC's reset value */
+#define I2C_CLKT_DEFAULT           0x40
+
+/** @brief tI2cTiming::clockStretchTimeout which disables the timeout, so a
+ ** slave may stretch the clock for ever */
+#define I2C_CLKT_DISABLE           0xFFFF
+
 /** @brief The enum of possible errors returned from gpio functions.
  *  Errors themselves are defined in the macro #ERRORS. */
 typedef enum {
@@ -65,6 +91,20 @@ typedef enum {
     ERROR_MAX
 } errStatus;
 
+/** @brief Log levels. See gpioLogSetLevel(). */
+typedef enum {
+    logError   = GPIO_LOG_ERROR,   /**< Errors */
+    logWarning = GPIO_LOG_WARNING, /**< Warnings */
+    logInfo    = GPIO_LOG_INFO,    /**< Informational */
+    logDebug   = GPIO_LOG_DEBUG    /**< Debug */
+} eLogLevel;
+
+/** @brief A user supplied destination for log records.
+ *  @details Called from the log drain thread, one call per record. \p text
+ *  includes the trailing newline and is not NUL terminated. */
+typedef void (*tLogSink)(void * context, eLogLevel level,
+                         const char * text, size_t length);
+
 /** @brief The enum of possible pin states in input/output modes. */
 typedef enum {
     low  = 0x0, /**< Pin low */
@@ -92,34 +132,486 @@ typedef enum {
     alt4   = GPFSEL_ALT4,         /**< Set pin to alternative function 4 */
     alt5   = GPFSEL_ALT5,         /**< Set pin to alternative function 5 */
     eFunctionMin = GPFSEL_INPUT,  /**< Minimum valid value for enum */
-    eFunctionMax = GPFSEL_ALT3    /**< Maximum valid value for enum */
+    eFunctionMax = GPFSEL_ALT3    /**< Maximum valid value for enum. ALT3 has
+                                       the highest encoding (0x7), so alt4
+                                       (0x3) and alt5 (0x2) lie within range */
 } eFunction;
 
-/* Function Prototypes */
-errStatus gpioSetup(void);
-errStatus gpioCleanup(void);
-errStatus gpioSetFunction(int gpioNumber, eFunction function);
-errStatus gpioSetPin(int gpioNumber, eState state);
-errStatus gpioReadPin(int gpioNumber, eState * state);
-errStatus gpioSetPullResistor(int gpioNumber, eResistor resistor);
-errStatus gpioGetI2cPins(int * gpioNumberScl, int * gpioNumberSda);
+/** @brief How the peripheral blocks are mapped. See gpioSetMapMode(). */
+typedef enum {
+    mapAuto     = 0, /**< GPIO from /dev/gpiomem, falling back to /dev/mem */
+    mapDevMem   = 1, /**< Every block from /dev/mem */
+    mapGpiomem  = 2, /**< GPIO from /dev/gpiomem only. No root, no I2C */
+    mapCombined = 3, /**< One /dev/mem mapping over the blocks chosen with
+                          gpioSetMapBlocks() */
+} eMapMode;
 
-errStatus gpioI2cSetup(void);
-errStatus gpioI2cCleanup(void);
-errStatus gpioI2cSetClock(int frequency);
-errStatus gpioI2cSet7BitSlave(uint8_t slaveAddress);
-errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength);
-errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead);
+/** @brief Peripheral blocks which may share the #mapCombined mapping.
+ ** Combine with bitwise OR. See gpioSetMapBlocks(). */
+typedef enum {
+    mapBlockGpio = 0x01, /**< GPIO */
+    mapBlockBsc0 = 0x02, /**< BSC0, the I2C master on a rev 1 header */
+    mapBlockBsc1 = 0x04, /**< BSC1, the I2C master on a rev 2 / J8 header */
+    mapBlockCm   = 0x08, /**< Clock manager */
+    mapBlockPwm  = 0x10, /**< PWM */
+    mapBlockPcm  = 0x20, /**< PCM, used to pace DMA */
+    mapBlockDma  = 0x40, /**< DMA */
+    mapBlockAll  = 0x7F, /**< Every block above */
+} eMapBlock;
 
-const char * gpioErrToString(errStatus error);
-int dbgPrint(FILE * stream, const char * file, int line, const char * format, ...);
+/** @brief The APIs counted by the statistics layer. See gpioStatsSnapshot(). */
+typedef enum {
+    statsGpioSetFunction = 0,
+    statsGpioSetPin,
+    statsGpioReadPin,
+    statsGpioSetPullResistor,
+    statsI2cSetClock,
+    statsI2cSet7BitSlave,
+    statsI2cWriteData,
+    statsI2cReadData,
+    statsGpioSetMask,
+    statsGpioClearMask,
+    statsGpioReadLevels,
+    statsApiMax
+} eStatsApi;
 
-/** @brief Macro which covers the first three arguments of dbgPrint. */
-#define DBG_INFO stderr,__FILE__,__LINE__
+/** @brief Number of latency histogram buckets. Bucket b counts calls taking
+ *  [2^(b-1), 2^b) nano seconds, the last bucket counts anything longer. */
+#define STATS_HIST_BUCKETS          32
+
+/** @brief Statistics of a single API. Every member is a uint64_t. */
+typedef struct {
+    uint64_t calls;                           /**< Number of calls */
+    uint64_t status[ERROR_MAX];               /**< Calls by #errStatus returned */
+    uint64_t histogram[STATS_HIST_BUCKETS];   /**< Log2 latency histogram */
+    uint64_t totalNs;                         /**< Sum of all latencies */
+} tStatsApi;
+
+/** @brief Statistics of every API, indexed by #eStatsApi. */
+typedef struct {
+    tStatsApi api[statsApiMax];               /**< Per API statistics */
+} tStats;
+
+/** @brief Shortest software PWM period, 50 kHz. */
+#define SOFT_PWM_PERIOD_MIN_NS      20000
+/** @brief Longest software PWM period, 1 Hz. */
+#define SOFT_PWM_PERIOD_MAX_NS      1000000000
+
+/** @brief Duty passed to gpioPwmSetOutput() for always high. */
+#define PWM_DUTY_MAX                1000000
+
+/** @brief Software PWM timing. See gpioSoftPwmGetStats(). */
+typedef struct {
+    uint64_t  periods;      /**< Periods run */
+    uint64_t  overruns;     /**< Periods which started late by a whole period */
+    uint64_t  maxLateNs;    /**< Latest an edge has been written */
+    tStatsApi lateness;     /**< calls counts edges, histogram and totalNs
+                                 their lateness. Use gpioStatsPercentile() */
+} tSoftPwmStats;
+
+/** @brief Peripheral whose FIFO paces a DMA waveform or capture. */
+typedef enum {
+    wavePacePwm = 0, /**< PWM channel 1. Not usable with gpioPwmSetOutput() */
+    wavePacePcm = 1, /**< PCM transmit. Not usable for audio meanwhile */
+} eWavePacing;
+
+/** @brief Shortest DMA waveform tick. #wavePacePcm can not go below 800 ns,
+ ** 533 ns on BCM2711. */
+#define WAVE_TICK_NS_MIN            400
+/** @brief Longest DMA waveform tick. */
+#define WAVE_TICK_NS_MAX            100000
+/** @brief DMA channel used if gpioWaveSetup() is passed -1. */
+#define WAVE_DEFAULT_DMA_CHANNEL    10
+
+/** @brief One step of a DMA waveform: GPSET0, then GPCLR0, then a delay. */
+typedef struct {
+    uint32_t setMask;   /**< Written to GPSET0, skipped if 0 */
+    uint32_t clearMask; /**< Written to GPCLR0, skipped if 0 */
+    uint32_t delay_ns;  /**< Time until the next step, rounded to ticks */
+} tWaveStep;
+
+/** @brief Fewest samples in each half of the capture buffer. */
+#define CAPTURE_HALF_MIN            64
+/** @brief Most samples in each half of the capture buffer. */
+#define CAPTURE_HALF_MAX            65536
+/** @brief DMA channel used if gpioCaptureStart() is passed -1. */
+#define CAPTURE_DEFAULT_DMA_CHANNEL 11
+
+/**
+ * @brief   Receives captured GPLEV0 samples, called from the capture thread.
+ * @param   context     As passed to gpioCaptureStart().
+ * @param   samples     GPLEV0, one tick apart. Valid until the call returns.
+ * @param   count       Samples, the half buffer size.
+ * @param   index       Position of the first sample in the capture. Gaps
+ *                      follow overruns. */
+typedef void (*tCaptureCallback)(void * context, const uint32_t * samples,
+                                 size_t count, uint64_t index);
+
+/** @brief Capture counters. See gpioCaptureGetStats(). */
+typedef struct {
+    uint64_t samples;   /**< Samples passed to the callback */
+    uint64_t halves;    /**< Callbacks made */
+    uint64_t overruns;  /**< Halves overwritten before they were drained */
+} tCaptureStats;
+
+/** @brief Bits in each debounce counter. */
+#define DEBOUNCE_COUNTER_BITS       4
+/** @brief Most consecutive samples a debounced level can be required for. */
+#define DEBOUNCE_SAMPLES_MAX        ((0x1u << DEBOUNCE_COUNTER_BITS) - 1)
+
+/** @brief Debounces up to 32 pins from GPLEV0 samples. See
+ ** gpioDebounceUpdate(). */
+typedef struct {
+    uint32_t mask;                              /**< Pins filtered */
+    uint32_t samples;                           /**< Samples a level is held for */
+    uint32_t levels;                            /**< Debounced levels */
+    uint32_t counter[DEBOUNCE_COUNTER_BITS];    /**< Bit b of every pin's count
+                                                     of differing samples */
+} tDebounce;
+
+/** @brief Most quadrature encoders decoded at once. */
+#define ENCODER_MAX                 8
+/** @brief Shortest encoder sampling period. */
+#define ENCODER_PERIOD_MIN_NS       1000
+/** @brief Longest encoder sampling period. */
+#define ENCODER_PERIOD_MAX_NS       10000000
+/** @brief Window over which encoder velocity is measured. */
+#define ENCODER_VELOCITY_NS         10000000
+
+/** @brief What the encoder thread reads each period. */
+typedef enum {
+    encoderSampleLevels = 0, /**< GPLEV0 every period */
+    encoderSampleEvents = 1, /**< GPEDS0, then GPLEV0 only if an encoder pin
+                                  had an edge. Uses the pins' edge detect */
+} eEncoderSample;
+
+/** @brief A quadrature encoder's position. See gpioEncoderRead(). */
+typedef struct {
+    int64_t  count;     /**< Edges, counting up while A leads B */
+    int64_t  velocity;  /**< Edges per second over the last window */
+    uint64_t errors;    /**< Samples where both pins had changed, so edges
+                             were missed and the count may be wrong */
+} tEncoderState;
+
+/** @brief Shortest pulse measurement sampling period. */
+#define PULSE_PERIOD_MIN_NS         1000
+/** @brief Longest pulse measurement sampling period. */
+#define PULSE_PERIOD_MAX_NS         10000000
+/** @brief Most cycles a pulse measurement averages over. */
+#define PULSE_WINDOW_MAX            256
+
+/** @brief A pin's period and duty, the means over its window. See
+ ** gpioPulseRead(). */
+typedef struct {
+    uint64_t period_ns;     /**< Rising edge to rising edge, 0 until a cycle
+                                 has completed */
+    uint64_t high_ns;       /**< Rising edge to falling edge */
+    uint32_t duty;          /**< high_ns / period_ns in parts of
+                                 #PWM_DUTY_MAX */
+    uint32_t frequency_mHz; /**< 1 / period_ns in milli hertz */
+    uint32_t cycles;        /**< Cycles averaged, up to the window */
+    uint64_t edges;         /**< Edges seen since the pin was added */
+    uint64_t glitches;      /**< Pulses shorter than a sample, seen only by
+                                 edge detect. Approximate */
+    uint64_t lastEdge_ns;   /**< CLOCK_MONOTONIC time of the last edge, a
+                                 stopped signal keeps its last measurement */
+} tPulseMeasure;
+
+/** @brief Most software I2C buses open at once. */
+#define SOFT_I2C_BUSES              8
+/** @brief Slowest software I2C clock. */
+#define SOFT_I2C_FREQ_MIN           1000
+/** @brief Fastest software I2C clock. */
+#define SOFT_I2C_FREQ_MAX           400000
+/** @brief Longest a slave may stretch a clock before the transfer fails. */
+#define SOFT_I2C_STRETCH_MAX_NS     25000000
+
+/** @brief One transaction on a software I2C bus: a write, a read, or a write
+ ** then a repeated start and a read. See gpioSoftI2cTransfer(). */
+typedef struct {
+    int             bus;            /**< From gpioSoftI2cOpen() */
+    uint8_t         address;        /**< 7-bit slave address */
+    const uint8_t * writeData;      /**< Bytes written, may be NULL if none */
+    uint16_t        writeLength;    /**< Bytes to write */
+    uint8_t *       readBuffer;     /**< Bytes read, may be NULL if none */
+    uint16_t        readLength;     /**< Bytes to read */
+    errStatus       status;         /**< Set to the result of the transaction */
+    uint32_t        stretches;      /**< Set to the clocks the slave stretched */
+} tSoftI2cTransfer;
+
+/** @brief Most 1-Wire buses open at once, and driven together. */
+#define ONE_WIRE_BUSES              16
+/** @brief 1-Wire ROM command, search ROM. */
+#define ONE_WIRE_SEARCH_ROM         0xF0
+/** @brief 1-Wire ROM command, match ROM. */
+#define ONE_WIRE_MATCH_ROM          0x55
+/** @brief 1-Wire ROM command, skip ROM. */
+#define ONE_WIRE_SKIP_ROM           0xCC
+
+/** @brief Most data lanes clocked by one software SPI SCLK. */
+#define SOFT_SPI_LANES              8
+/** @brief Most software SPI buses open at once. */
+#define SOFT_SPI_BUSES              4
+/** @brief Fastest paced software SPI clock. 0 runs as fast as the register
+ ** writes allow. */
+#define SOFT_SPI_FREQ_MAX           10000000
+
+/** @brief Bit order of a software SPI bus. */
+typedef enum {
+    softSpiMsbFirst = 0,    /**< Bit 7 of each byte first */
+    softSpiLsbFirst = 1     /**< Bit 0 of each byte first */
+} eSoftSpiBitOrder;
+
+/** @brief A software SPI bus. Every lane shares SCLK, so a lane may be one
+ ** of several data lines to a device or a separate device, selected by its
+ ** own chip select. See gpioSoftSpiOpen(). */
+typedef struct {
+    int              gpioNumberSclk;                 /**< The clock */
+    int              lanes;                          /**< Lanes used, 1 - #SOFT_SPI_LANES */
+    int              gpioNumberMosi[SOFT_SPI_LANES]; /**< Data out, -1 if none */
+    int              gpioNumberMiso[SOFT_SPI_LANES]; /**< Data in, -1 if none */
+    int              gpioNumberCs[SOFT_SPI_LANES];   /**< Active low select, -1 if none */
+    int              mode;                           /**< 0 - 3, CPOL bit 1, CPHA bit 0 */
+    eSoftSpiBitOrder order;                          /**< Bit order */
+    int              frequency;                      /**< SCLK in Hz, 0 for unpaced */
+} tSoftSpiConfig;
+
+/** @brief Most LED strips driven together. */
+#define LED_STRIPS                  8
+/** @brief Most LEDs on each strip. */
+#define LED_COUNT_MAX               1024
+
+/** @brief How gpioLedShow() times the bit cells. */
+typedef enum {
+    ledDriveSpin = 0,   /**< The calling thread spins on the system timer */
+    ledDriveDma  = 1    /**< A DMA waveform, see gpioLedShow() */
+} eLedDrive;
+
+/** @brief Most chains of shift registers in a group. */
+#define SHIFT_CHAINS                8
+/** @brief Most 8 bit registers in a chain. */
+#define SHIFT_REGISTERS_MAX         32
+/** @brief Most groups open at once. */
+#define SHIFT_GROUPS                4
+/** @brief Fastest paced shift clock. 0 runs as fast as the register writes
+ ** allow. */
+#define SHIFT_FREQ_MAX              10000000
+
+/** @brief A group of shift register chains, each a chain of 74HC595 outputs,
+ ** of 74HC165 inputs or of both, on its own data lines. Every chain shares
+ ** the clock and latch and has the same number of registers. See
+ ** gpioShiftOpen(). */
+typedef struct {
+    int gpioNumberClock;                /**< SRCLK of the 595s, CLK of the 165s */
+    int gpioNumberLatch;                /**< RCLK of the 595s */
+    int gpioNumberLoad;                 /**< SH/LD of the 165s, -1 if it is the latch */
+    int chains;                         /**< Chains used, 1 - #SHIFT_CHAINS */
+    int registers;                      /**< Registers in each chain, 1 - #SHIFT_REGISTERS_MAX */
+    int gpioNumberOut[SHIFT_CHAINS];    /**< SER of the first 595, -1 if none */
+    int gpioNumberIn[SHIFT_CHAINS];     /**< QH of the first 165, -1 if none */
+    int frequency;                      /**< Clock in Hz, 0 for unpaced */
+} tShiftConfig;
+
+/** @brief Most data lines of a parallel bus. */
+#define PARALLEL_WIDTH_MAX          16
+/** @brief Most dirty rectangles kept, more are merged into them. */
+#define PARALLEL_DIRTY_MAX          8
+/** @brief Fastest paced parallel bus, in words a second. 0 runs as fast as
+ ** the register writes allow. */
+#define PARALLEL_FREQ_MAX           20000000
+/** @brief MIPI DCS command setting the columns written, see
+ ** gpioParallelFlush(). */
+#define PARALLEL_DCS_COLUMN         0x2A
+/** @brief MIPI DCS command setting the rows written. */
+#define PARALLEL_DCS_PAGE           0x2B
+/** @brief MIPI DCS command writing pixels to the window set. */
+#define PARALLEL_DCS_MEMORY_WRITE   0x2C
+
+/** @brief Strobes of a parallel bus. */
+typedef enum {
+    parallel8080 = 0,   /**< WR and RD, a write is latched as WR rises */
+    parallel6800 = 1    /**< E and R/W, a write is latched as E falls */
+} eParallelBus;
+
+/** @brief A parallel bus to a display controller or character LCD. See
+ ** gpioParallelOpen(). */
+typedef struct {
+    eParallelBus bus;                               /**< Strobes used */
+    int          width;                             /**< Data lines, 1 - #PARALLEL_WIDTH_MAX */
+    int          gpioNumberData[PARALLEL_WIDTH_MAX]; /**< D0 upwards */
+    int          gpioNumberWr;                      /**< WR, or E of a 6800 bus */
+    int          gpioNumberRd;                      /**< RD, or R/W of a 6800 bus, -1 if write only */
+    int          gpioNumberDc;                      /**< D/C or RS, low for commands */
+    int          gpioNumberCs;                      /**< Active low select, -1 if none */
+    int          frequency;                         /**< Words a second, 0 for unpaced */
+} tParallelConfig;
+
+/** @brief Most columns and most rows of a keypad matrix. */
+#define KEYPAD_LINES                8
+/** @brief Shortest keypad scan period. */
+#define KEYPAD_PERIOD_MIN_NS        20000
+/** @brief Longest keypad scan period. */
+#define KEYPAD_PERIOD_MAX_NS        100000000
+/** @brief Longest wait between driving a column and reading the rows. */
+#define KEYPAD_SETTLE_MAX_NS        100000
+/** @brief Key events queued until read. Later events are dropped. */
+#define KEYPAD_EVENTS               256
 
+/** @brief A matrix of keys, each joining a column to a row, or with no
+ ** columns a row of buttons to ground. See gpioKeypadStart(). */
+typedef struct {
+    int      columns;                       /**< Columns driven, 0 - #KEYPAD_LINES */
+    int      gpioNumberColumn[KEYPAD_LINES]; /**< Column pins */
+    int      rows;                          /**< Rows read, 1 - #KEYPAD_LINES */
+    int      gpioNumberRow[KEYPAD_LINES];    /**< Row pins, pulled up */
+    uint32_t period_ns;                     /**< Scan period */
+    uint32_t settle_ns;                     /**< Wait after driving a column, 0 for none */
+    uint32_t samples;                       /**< Scans a key must hold a new state for,
+                                                 1 - #DEBOUNCE_SAMPLES_MAX */
+    int      cpu;                           /**< Cpu the thread runs on, -1 for any */
+} tKeypadConfig;
 
-/* Revision specific TODO not sure if it should be public maybe private revisions
- * header?*/
+/** @brief A key pressed or released. See gpioKeypadRead(). */
+typedef struct {
+    uint64_t time_ns;   /**< Scan which saw the debounced change */
+    uint32_t dropped;   /**< Events dropped just before this one as the queue was full */
+    uint8_t  column;    /**< Column of the key, 0 without columns */
+    uint8_t  row;       /**< Row of the key */
+    uint8_t  pressed;   /**< 1 if pressed, 0 if released */
+} tKeypadEvent;
+
+/** @brief Shared memory segment the GPIO daemon publishes by default. */
+#define SHM_NAME_DEFAULT            "/rpigpio"
+/** @brief Output changes queued for the daemon. Further changes fail until
+ ** it has applied some. */
+#define SHM_REQUESTS                256
+/** @brief Edge events kept for readers, older ones are overwritten. */
+#define SHM_EVENTS                  1024
+/** @brief Shortest daemon period. */
+#define SHM_PERIOD_MIN_NS           10000
+/** @brief Longest daemon period. */
+#define SHM_PERIOD_MAX_NS           100000000
+
+/** @brief Pins which changed between two of the daemon's GPLEV0 snapshots.
+ ** See gpioShmReadEvents(). */
+typedef struct {
+    uint64_t time_ns;   /**< When the later snapshot was taken, timeNowNs() */
+    uint32_t levels;    /**< The later snapshot */
+    uint32_t changed;   /**< Bit n set if GPIO n changed */
+} tShmEvent;
+
+/** @brief Requested I2C bus timing. See gpioI2cSetTiming(). */
+typedef struct {
+    uint32_t frequency;             /**< Highest SCL frequency wanted (Hertz) */
+    uint16_t fallingDelay;          /**< Core clocks from SCL falling to SDA
+                                         changing, 0 for divider / 16 */
+    uint16_t risingDelay;           /**< Core clocks from SCL rising to SDA
+                                         being sampled, 0 for divider / 16 */
+    uint16_t clockStretchTimeout;   /**< SCL clocks a slave may stretch the
+                                         clock for, up to 0xFFFE, 0 for
+                                         #I2C_CLKT_DEFAULT or
+                                         #I2C_CLKT_DISABLE */
+} tI2cTiming;
+
+/** @brief The I2C bus timing in use. See gpioI2cGetClock(). */
+typedef struct {
+    uint32_t divider;               /**< Core clocks per SCL clock, CDIV */
+    uint32_t frequency;             /**< SCL frequency achieved (Hertz), rounded down */
+    uint32_t byteTime_ns;           /**< Time to clock a byte and its ACK */
+    uint16_t fallingDelay;          /**< FEDL in core clocks */
+    uint16_t risingDelay;           /**< REDL in core clocks */
+    uint16_t clockStretchTimeout;   /**< TOUT in SCL clocks, 0 if disabled */
+} tI2cClock;
+
+/** @brief One transaction on the BSC: a write, a read, or a write then a
+ ** read. See gpioI2cTransfer(). */
+typedef struct {
+    uint8_t         address;        /**< 7-bit slave address */
+    const uint8_t * writeData;      /**< Bytes written, may be NULL if none */
+    uint16_t        writeLength;    /**< Bytes to write */
+    uint8_t *       readBuffer;     /**< Bytes read, may be NULL if none */
+    uint16_t        readLength;     /**< Bytes to read */
+    errStatus       status;         /**< Set to the result of the transaction */
+} tI2cTransfer;
+
+/** @brief The call a #tI2cRecord records. */
+typedef enum {
+    i2cRecordClock = 0,     /**< gpioI2cSetClock() */
+    i2cRecordAddress,       /**< gpioI2cSet7BitSlave() */
+    i2cRecordWrite,         /**< gpioI2cWriteData(), followed by the bytes written */
+    i2cRecordRead,          /**< gpioI2cReadData(), followed by the bytes read */
+    i2cRecordTiming         /**< gpioI2cSetTiming(), followed by its #tI2cTiming */
+} eI2cRecord;
+
+/** @brief One I2C call in a file written by gpioI2cRecordStart(), in host
+ ** byte order. */
+typedef struct {
+    uint64_t time_ns;       /**< Start of the call, from the start of recording */
+    uint32_t duration_ns;   /**< Time the call took */
+    uint32_t frequency;     /**< Clock set, for #i2cRecordClock and #i2cRecordTiming */
+    int32_t  status;        /**< #errStatus returned */
+    uint16_t length;        /**< Bytes following the record */
+    uint8_t  address;       /**< 7-bit slave address */
+    uint8_t  type;          /**< An #eI2cRecord */
+} tI2cRecord;
+
+/** @brief Result of gpioI2cReplay(). */
+typedef struct {
+    uint64_t calls;             /**< Calls replayed */
+    uint64_t statusMismatches;  /**< Calls returning a different #errStatus */
+    uint64_t dataMismatches;    /**< Reads returning different bytes */
+    uint64_t recorded_ns;       /**< Total duration of the calls when recorded */
+    uint64_t replayed_ns;       /**< Total duration of the calls when replayed */
+    uint64_t lateMax_ns;        /**< Most a timed replay started a call late */
+} tI2cReplayStats;
+
+/** @brief Socket the I2C arbiter listens on by default. */
+#define I2C_ARBITER_PATH            "/tmp/rpigpio_i2c"
+/** @brief Most clients connected to the arbiter at once. */
+#define I2C_ARBITER_CLIENTS         16
+/** @brief Most transactions in one batch. */
+#define I2C_ARBITER_BATCH           32
+/** @brief Largest batch or reply message, headers and data, in bytes. */
+#define I2C_ARBITER_MESSAGE         4096
+
+/** @brief Use of the arbiter by one client. */
+typedef struct {
+    int      pid;           /**< Process of the client, 0 if the slot is free */
+    uint64_t batches;       /**< Batches run */
+    uint64_t transactions;  /**< Transactions run */
+    uint64_t wait_ns;       /**< Total time batches waited for the bus */
+    uint64_t waitMax_ns;    /**< Longest a batch waited for the bus */
+} tI2cArbiterClient;
+
+/** @brief Arbiter metrics. See gpioI2cArbiterGetStats(). */
+typedef struct {
+    uint32_t clients;       /**< Clients connected */
+    uint32_t depth;         /**< Batches waiting for the bus */
+    uint32_t depthMax;      /**< Most batches waiting at once */
+    uint64_t batches;       /**< Batches run */
+    uint64_t transactions;  /**< Transactions run */
+    uint64_t rejected;      /**< Malformed batches, refused connections and
+                                clients dropped for not reading replies */
+    uint64_t busy_ns;       /**< Time spent running batches */
+    tI2cArbiterClient client[I2C_ARBITER_CLIENTS];  /**< Per connection slot.
+                                A slot is zeroed when a new client takes it */
+} tI2cArbiterStats;
+
+/** @brief A DMA control block as read by the DMA engine. Blocks must be 32
+ ** byte aligned. gpioWaveBuild() keeps the word each block copies in the
+ ** block's first reserved word. */
+typedef struct {
+    uint32_t ti;          /**< Transfer information */
+    uint32_t source;      /**< Source bus address */
+    uint32_t dest;        /**< Destination bus address */
+    uint32_t length;      /**< Transfer length in bytes */
+    uint32_t stride;      /**< 2D stride, unused */
+    uint32_t next;        /**< Bus address of the next block, 0 to stop */
+    uint32_t reserved[2]; /**< Ignored by the DMA engine */
+} tDmaControlBlock;
+
+/* Revision specific. The lists below are kept for reference, the library
+ * itself uses the board table in board.c. */
 /** @brief Pin count on a PCB rev1 Raspberry Pi */
 #define REV1_PINCNT 17
 /** @brief Pin count on a PCB rev2 Raspberry Pi */
@@ -142,9 +634,230 @@ int dbgPrint(FILE * stream, const char * file, int line, const char * format, ..
 /** @brief valid PCB revision values */
 typedef enum {
     pcbRevError = 0,
-    pcbRev1 = 1,
-    pcbRev2 = 2,
+    pcbRev1 = 1,    /**< 26 pin P1 header, I2C on BSC0 */
+    pcbRev2 = 2,    /**< 26 pin P1 header, I2C on BSC1 */
+    pcbRevJ8 = 3,   /**< 40 pin J8 header (B+ and later), I2C on BSC1 */
 } tPcbRev;
 
+/** @brief The SoC families the library knows the peripheral layout of. */
+typedef enum {
+    socBcm2835 = 0, /**< Pi 1, Zero, Compute Module 1 */
+    socBcm2836 = 1, /**< Pi 2 */
+    socBcm2837 = 2, /**< Pi 3, Zero 2, Compute Module 3 */
+    socBcm2711 = 3, /**< Pi 4, Pi 400, Compute Module 4 */
+} tSoc;
+
+/** @brief The way the pull up/down resistors are controlled. */
+typedef enum {
+    pullCtrlGppud    = 0, /**< GPPUD + GPPUDCLKx clocking sequence */
+    pullCtrlGppuppdn = 1, /**< BCM2711 GPPUPPDNx direct registers */
+} tPullCtrl;
+
+/** @brief Description of a board family. One entry in the board table.
+ *  @details A revision code matches an entry when
+ *           (revision & revisionMask) == revisionValue. */
+typedef struct {
+    uint32_t     revisionValue;  /**< Masked revision code to match */
+    uint32_t     revisionMask;   /**< Bits of the revision code compared */
+    const char * name;           /**< Human readable board family */
+    tSoc         soc;            /**< SoC on the board */
+    tPcbRev      header;         /**< Header layout */
+    uint32_t     peripheralBase; /**< Physical address of the peripherals */
+    uint32_t     validPins;      /**< Bit n set if GPIO n is on the header */
+    tPullCtrl    pullCtrl;       /**< Pull resistor control method */
+    int          sda;            /**< GPIO number of the header SDA pin */
+    int          scl;            /**< GPIO number of the header SCL pin */
+    uint32_t     bscOffset;      /**< Offset of header BSC from peripheralBase */
+    uint32_t     oscillatorHz;   /**< Oscillator clock manager source */
+    uint32_t     plldHz;         /**< PLLD clock manager source */
+    uint32_t     coreClockHz;    /**< Default core clock, the BSC source */
+} tBoard;
+
+/* Function Prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+errStatus gpioSetMapMode(eMapMode mode);
+errStatus gpioSetMapBlocks(uint32_t blocks);
+errStatus gpioSetup(void);
+errStatus gpioCleanup(void);
+errStatus gpioSetFunction(int gpioNumber, eFunction function);
+errStatus gpioSetPin(int gpioNumber, eState state);
+errStatus gpioReadPin(int gpioNumber, eState * state);
+errStatus gpioSetPullResistor(int gpioNumber, eResistor resistor);
+errStatus gpioSetMask(uint32_t mask);
+errStatus gpioClearMask(uint32_t mask);
+errStatus gpioReadLevels(uint32_t * levels);
+errStatus gpioGetI2cPins(int * gpioNumberScl, int * gpioNumberSda);
+errStatus gpioGetBoard(const tBoard ** board);
+errStatus gpioGetRegisters(volatile uint32_t ** gpioRegisters);
+
+errStatus gpioParseRevision(const char * cpuinfoLine, uint32_t * revision);
+errStatus gpioLookupBoard(uint32_t revision, const tBoard ** board);
+
+errStatus gpioPwmSetup(void);
+errStatus gpioPwmCleanup(void);
+errStatus gpioPwmSetClock(uint32_t frequencyHz);
+errStatus gpioPwmSetOutput(int gpioNumber, uint32_t frequencyHz, uint32_t duty);
+errStatus gpioPwmStop(int gpioNumber);
+errStatus gpioClockStart(int gpioNumber, uint32_t frequencyHz);
+errStatus gpioClockStop(int gpioNumber);
+
+errStatus gpioWaveSetup(eWavePacing pacing, uint32_t tick_ns, int dmaChannel,
+                        uint32_t * achieved_ns);
+errStatus gpioWaveCleanup(void);
+errStatus gpioWavePlay(const tWaveStep * steps, size_t stepCount, int loop);
+errStatus gpioWaveBusy(int * busy);
+errStatus gpioWaveStop(void);
+errStatus gpioWaveBuild(const tWaveStep * steps, size_t stepCount, uint32_t tick_ns,
+                        eWavePacing pacing, int loop, tDmaControlBlock * blocks,
+                        uint32_t blocksBus, size_t * blockCount);
+
+errStatus gpioCaptureStart(eWavePacing pacing, uint32_t tick_ns, int dmaChannel,
+                           size_t halfSamples, tCaptureCallback callback,
+                           void * context, uint32_t * achieved_ns);
+errStatus gpioCaptureStop(void);
+errStatus gpioCaptureGetStats(tCaptureStats * stats);
+
+errStatus gpioDebounceInit(tDebounce * debounce, uint32_t pinMask,
+                           uint32_t samples, uint32_t levels);
+errStatus gpioDebounceUpdate(tDebounce * debounce, uint32_t levels, uint32_t * changed);
+
+errStatus gpioEncoderStart(eEncoderSample sample, uint32_t period_ns, int cpu);
+errStatus gpioEncoderAdd(int gpioNumberA, int gpioNumberB, int * encoder);
+errStatus gpioEncoderRemove(int encoder);
+errStatus gpioEncoderRead(int encoder, tEncoderState * state);
+errStatus gpioEncoderStop(void);
+
+errStatus gpioPulseStart(uint32_t period_ns, int cpu);
+errStatus gpioPulseAdd(int gpioNumber, uint32_t window);
+errStatus gpioPulseRemove(int gpioNumber);
+errStatus gpioPulseRead(int gpioNumber, tPulseMeasure * measure);
+errStatus gpioPulseStop(void);
+
+errStatus gpioSoftI2cOpen(int gpioNumberSda, int gpioNumberScl, int frequency, int * bus);
+errStatus gpioSoftI2cClose(int bus);
+errStatus gpioSoftI2cTransfer(tSoftI2cTransfer * transfers, int count);
+
+errStatus gpioOneWireOpen(int gpioNumber, int * bus);
+errStatus gpioOneWireClose(int bus);
+errStatus gpioOneWireReset(const int * buses, int count, uint32_t * present);
+errStatus gpioOneWireWrite(const int * buses, int count, const uint8_t * const * data,
+                           size_t length);
+errStatus gpioOneWireRead(const int * buses, int count, uint8_t * const * data,
+                          size_t length);
+errStatus gpioOneWireSearch(const int * buses, int count, uint64_t * const * roms,
+                            int max, int * found);
+uint8_t gpioOneWireCrc8(const uint8_t * data, size_t length);
+
+errStatus gpioSoftSpiOpen(const tSoftSpiConfig * config, int * bus);
+errStatus gpioSoftSpiClose(int bus);
+errStatus gpioSoftSpiTransfer(int bus, const uint8_t * const * txData,
+                              uint8_t * const * rxBuffer, size_t length);
+
+errStatus gpioLedOpen(const int * gpioNumbers, int strips, int leds);
+errStatus gpioLedClose(void);
+errStatus gpioLedSetPixel(int strip, int led, uint32_t rgb);
+errStatus gpioLedEncode(void);
+errStatus gpioLedShow(eLedDrive drive);
+
+errStatus gpioShiftOpen(const tShiftConfig * config, int * group);
+errStatus gpioShiftClose(int group);
+errStatus gpioShiftWrite(int group, int chain, const uint8_t * data);
+errStatus gpioShiftUpdate(int group);
+errStatus gpioShiftRead(int group, int chain, uint8_t * data);
+
+errStatus gpioParallelOpen(const tParallelConfig * config);
+errStatus gpioParallelClose(void);
+errStatus gpioParallelCommand(uint16_t command);
+errStatus gpioParallelWrite(const void * data, size_t count);
+errStatus gpioParallelRead(void * buffer, size_t count);
+errStatus gpioParallelSetFrame(const uint16_t * pixels, int width, int height);
+errStatus gpioParallelMarkDirty(int x, int y, int width, int height);
+errStatus gpioParallelFlush(void);
+
+errStatus gpioKeypadStart(const tKeypadConfig * config);
+errStatus gpioKeypadRead(tKeypadEvent * events, int max, int * count);
+errStatus gpioKeypadGetKeys(uint64_t * keys);
+errStatus gpioKeypadStop(void);
+
+errStatus gpioShmStart(const char * name, uint32_t period_ns, int mode, int cpu);
+errStatus gpioShmStop(void);
+errStatus gpioShmAttach(const char * name);
+errStatus gpioShmDetach(void);
+errStatus gpioShmReadLevels(uint32_t * levels, uint64_t * time_ns);
+errStatus gpioShmReadEvents(tShmEvent * events, int max, int * count, uint32_t * lost);
+errStatus gpioShmWrite(uint32_t set, uint32_t clear);
+errStatus gpioShmSetFunction(int gpioNumber, eFunction function);
+errStatus gpioShmSetPullResistor(int gpioNumber, eResistor resistor);
+
+errStatus gpioSoftPwmStart(uint32_t period_ns, int cpu);
+errStatus gpioSoftPwmSetDuty(int gpioNumber, uint32_t high_ns);
+errStatus gpioSoftPwmRelease(int gpioNumber);
+errStatus gpioSoftPwmStop(void);
+errStatus gpioSoftPwmGetStats(tSoftPwmStats * stats);
+
+errStatus gpioI2cSetup(void);
+errStatus gpioI2cCleanup(void);
+errStatus gpioI2cSetClock(int frequency);
+errStatus gpioI2cSetTiming(const tI2cTiming * timing, tI2cClock * achieved);
+errStatus gpioI2cGetClock(tI2cClock * clock);
+errStatus gpioI2cSet7BitSlave(uint8_t slaveAddress);
+errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength);
+errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead);
+errStatus gpioI2cTransfer(tI2cTransfer * transfers, int count);
+
+errStatus gpioI2cRecordStart(const char * path);
+errStatus gpioI2cRecordStop(void);
+errStatus gpioI2cReplay(const char * path, int timed, tI2cReplayStats * stats);
+
+errStatus gpioI2cArbiterStart(const char * path, int mode);
+errStatus gpioI2cArbiterStop(void);
+errStatus gpioI2cArbiterGetStats(tI2cArbiterStats * stats);
+errStatus gpioI2cArbiterConnect(const char * path);
+errStatus gpioI2cArbiterDisconnect(void);
+errStatus gpioI2cArbiterTransfer(int frequency, tI2cTransfer * transfers, int count);
+
+errStatus gpioStatsSnapshot(tStats * stats);
+errStatus gpioStatsReset(void);
+errStatus gpioStatsDump(FILE * stream);
+uint64_t gpioStatsPercentile(const tStatsApi * entry, int percent);
+
+errStatus gpioTraceStart(void);
+errStatus gpioTraceStop(void);
+errStatus gpioTraceWrite(FILE * stream);
+
+const char * gpioErrToString(errStatus error);
+int dbgPrint(FILE * stream, const char * file, int line, const char * format, ...);
+int gpioLogWrite(eLogLevel level, FILE * stream, const char * file, int line,
+                 const char * format, ...);
+errStatus gpioLogSetLevel(eLogLevel level);
+errStatus gpioLogSetSink(tLogSink sink, void * context);
+int gpioLogDrain(void);
+errStatus gpioLogStop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @brief Macro which covers the first three arguments of dbgPrint. */
+#define DBG_INFO stderr,__FILE__,__LINE__
+
+/** @brief Logs a message at \p level to stderr. Removed at compile time if
+ *  \p level is above #GPIO_LOG_LEVEL. */
+#define GPIO_LOG(level, ...)                                                \
+    do {                                                                    \
+        if ((level) <= GPIO_LOG_LEVEL)                                      \
+        {                                                                   \
+            gpioLogWrite((level), stderr, __FILE__, __LINE__, __VA_ARGS__); \
+        }                                                                   \
+    } while (0)
+
+#if GPIO_LOG_LEVEL < GPIO_LOG_ERROR
+/** @brief Every dbgPrint() is removed when logging is compiled out. */
+#define dbgPrint(...) ((void)0)
+#endif
+
 
 #endif /* _RPI_GPIO_H_ */
@@ -0,0 +1,282 @@
+/**
+ * @file
+ *  @brief C++ pin and port types validated at compile time.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  The pin number and function are template arguments, so an invalid pin or
+ *  function fails to compile and the GPFSEL register, shift and set / clear
+ *  masks are constants. Whether the board in use has the pin on its header is
+ *  checked once, by setup(). After that Pin::set(), Pin::clear() and
+ *  Port::set() are each a single store to GPSET0 or GPCLR0.
+ *
+ *  @code
+ *  typedef rpiGpio::Pin<25, output> Led;
+ *  typedef rpiGpio::Port<rpiGpio::Pin<22>, rpiGpio::Pin<23>, rpiGpio::Pin<24> > Bar;
+ *
+ *  gpioSetup();
+ *  Led::setup();
+ *  Bar::setup();
+ *  Led::set();
+ *  Bar::write(5);  // GPIO22 and GPIO24 high, GPIO23 low
+ *  @endcode
+ *
+ *  Requires C++11.
+ */
+
+#ifndef _RPI_GPIO_HPP_
+#define _RPI_GPIO_HPP_
+
+#include "rpiGpio.h"
+
+#ifdef GPIO_SIM
+extern "C" uint32_t simRegRead(volatile uint32_t * reg);
+extern "C" void simRegWrite(volatile uint32_t * reg, uint32_t value);
+#endif
+
+namespace rpiGpio {
+
+/** @brief Highest GPIO on any header, rev1 P1, rev2 P1 or J8. */
+static const int headerPinMax = 27;
+
+namespace detail {
+
+/** @brief The GPIO registers, fetched by Port::setup(). */
+inline volatile uint32_t *& registers()
+{
+    static volatile uint32_t * gpioRegisters = 0;
+    return gpioRegisters;
+}
+
+/** @brief Reads the GPIO register at byte \p offset. */
+inline uint32_t regRead(uint32_t offset)
+{
+#ifdef GPIO_SIM
+    return simRegRead(registers() + offset / sizeof(uint32_t));
+#else
+    return registers()[offset / sizeof(uint32_t)];
+#endif
+}
+
+/** @brief Writes \p value to the GPIO register at byte \p offset. */
+inline void regWrite(uint32_t offset, uint32_t value)
+{
+#ifdef GPIO_SIM
+    simRegWrite(registers() + offset / sizeof(uint32_t), value);
+#else
+    registers()[offset / sizeof(uint32_t)] = value;
+#endif
+}
+
+/** @brief Compile time properties of a list of pins. */
+template <typename... Pins> struct PinList;
+
+/** @brief The empty list terminates the recursion. */
+template <> struct PinList<>
+{
+    static constexpr uint32_t mask = 0;
+    static constexpr uint32_t fselMask(uint32_t) { return 0; }
+    static constexpr uint32_t fselValue(uint32_t) { return 0; }
+    static constexpr uint32_t spread(uint32_t) { return 0; }
+    static inline uint32_t gather(uint32_t, int) { return 0; }
+};
+
+/** @brief The first pin combined with the rest of the list. */
+template <typename First, typename... Rest> struct PinList<First, Rest...>
+{
+    static_assert((First::mask & PinList<Rest...>::mask) == 0,
+                  "A pin appears in a port more than once");
+
+    /** @brief Bit n set for GPIO n in the list. */
+    static constexpr uint32_t mask = First::mask | PinList<Rest...>::mask;
+
+    /** @brief Function select bits of the list within GPFSEL at \p offset. */
+    static constexpr uint32_t fselMask(uint32_t offset)
+    {
+        return (First::fselOffset == offset ? GPFSEL_BITS << First::fselShift : 0) |
+               PinList<Rest...>::fselMask(offset);
+    }
+
+    /** @brief Function select values of the list within GPFSEL at \p offset. */
+    static constexpr uint32_t fselValue(uint32_t offset)
+    {
+        return (First::fselOffset == offset ?
+                (uint32_t)First::function << First::fselShift : 0) |
+               PinList<Rest...>::fselValue(offset);
+    }
+
+    /** @brief Moves bit i of \p value to the i-th pin of the list. */
+    static constexpr uint32_t spread(uint32_t value)
+    {
+        return (value & 0x1 ? First::mask : 0) | PinList<Rest...>::spread(value >> 1);
+    }
+
+    /** @brief Moves the i-th pin of \p levels to bit \p bit + i. */
+    static inline uint32_t gather(uint32_t levels, int bit)
+    {
+        return (levels & First::mask ? 0x1u << bit : 0) |
+               PinList<Rest...>::gather(levels, bit + 1);
+    }
+};
+
+} /* namespace detail */
+
+/**
+ * @brief   A group of pins written and read together.
+ * @details Every pin in the group is set or cleared with a single store to
+ *          GPSET0 / GPCLR0. Bit i of the values taken and returned is the
+ *          i-th pin of the group. */
+template <typename... Pins>
+class Port
+{
+public:
+    /** @brief Bit n set for GPIO n in the port. */
+    static constexpr uint32_t mask = detail::PinList<Pins...>::mask;
+
+    /**
+     * @brief   Checks the pins are on this board's header and sets their
+     *          functions, one read-modify-write per GPFSEL register.
+     * @details gpioSetup() must have been called.
+     * @return  An error from #errStatus. */
+    static errStatus setup()
+    {
+        errStatus rtn = ERROR_DEFAULT;
+        const tBoard * board = 0;
+        uint32_t offset = 0;
+
+        if ((rtn = gpioGetBoard(&board)) != OK ||
+            (rtn = gpioGetRegisters(&detail::registers())) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioSetup() must be called first.");
+        }
+
+        else if ((board->validPins & mask) != mask)
+        {
+            dbgPrint(DBG_INFO, "pins 0x%x are not on the %s header.",
+                     mask & ~board->validPins, board->name);
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else
+        {
+            for (offset = GPFSEL0_OFFSET; offset <= GPFSEL2_OFFSET; offset += sizeof(uint32_t))
+            {
+                if (detail::PinList<Pins...>::fselMask(offset))
+                {
+                    detail::regWrite(offset,
+                        (detail::regRead(offset) & ~detail::PinList<Pins...>::fselMask(offset)) |
+                        detail::PinList<Pins...>::fselValue(offset));
+                }
+            }
+            rtn = OK;
+        }
+
+        return rtn;
+    }
+
+    /** @brief Drives every pin high. */
+    static inline void set() { detail::regWrite(GPSET0_OFFSET, mask); }
+
+    /** @brief Drives every pin low. */
+    static inline void clear() { detail::regWrite(GPCLR0_OFFSET, mask); }
+
+    /** @brief Drives pin i to bit i of \p value. One GPSET0 and one GPCLR0
+     ** store, the set is done first. */
+    static inline void write(uint32_t value)
+    {
+        uint32_t high = detail::PinList<Pins...>::spread(value);
+
+        detail::regWrite(GPSET0_OFFSET, high);
+        detail::regWrite(GPCLR0_OFFSET, mask & ~high);
+    }
+
+    /** @brief As write() with the value known at compile time. Stores to
+     ** GPSET0 or GPCLR0 are omitted if no pin needs them. */
+    template <uint32_t Value>
+    static inline void write()
+    {
+        static constexpr uint32_t high = detail::PinList<Pins...>::spread(Value);
+
+        if (high)
+        {
+            detail::regWrite(GPSET0_OFFSET, high);
+        }
+
+        if (mask & ~high)
+        {
+            detail::regWrite(GPCLR0_OFFSET, mask & ~high);
+        }
+    }
+
+    /** @brief Reads every pin with a single GPLEV0 load.
+     ** @return Bit i is the level of pin i. */
+    static inline uint32_t read()
+    {
+        return detail::PinList<Pins...>::gather(detail::regRead(GPLEV0_OFFSET), 0);
+    }
+};
+
+/**
+ * @brief   A single pin with its number and function fixed at compile time.
+ * @tparam  Number      The GPIO number, which must be on a header.
+ * @tparam  Function    The function selected by setup(). */
+template <int Number, eFunction Function = output>
+class Pin
+{
+    static_assert(Number >= 0 && Number <= headerPinMax,
+                  "GPIO is not on any Raspberry Pi header");
+    static_assert(Function >= eFunctionMin && Function <= eFunctionMax,
+                  "Function is out of range");
+
+public:
+    /** @brief The GPIO number. */
+    static constexpr int number = Number;
+    /** @brief The function selected by setup(). */
+    static constexpr eFunction function = Function;
+    /** @brief Bit of the pin in GPSET0, GPCLR0 and GPLEV0. */
+    static constexpr uint32_t mask = 0x1u << Number;
+    /** @brief Offset of the GPFSEL register holding the pin's function. */
+    static constexpr uint32_t fselOffset = GPFSEL0_OFFSET + (Number / 10) * sizeof(uint32_t);
+    /** @brief Shift of the pin's function within its GPFSEL register. */
+    static constexpr uint32_t fselShift = (Number % 10) * 3;
+
+    /** @brief See Port::setup(). */
+    static errStatus setup() { return Port<Pin>::setup(); }
+
+    /** @brief Drives the pin high. */
+    static inline void set() { detail::regWrite(GPSET0_OFFSET, mask); }
+
+    /** @brief Drives the pin low. */
+    static inline void clear() { detail::regWrite(GPCLR0_OFFSET, mask); }
+
+    /** @brief Drives the pin to \p state. */
+    static inline void write(eState state)
+    {
+        detail::regWrite(state == high ? GPSET0_OFFSET : GPCLR0_OFFSET, mask);
+    }
+
+    /** @brief Reads the pin. */
+    static inline eState read()
+    {
+        return detail::regRead(GPLEV0_OFFSET) & mask ? high : low;
+    }
+};
+
+} /* namespace rpiGpio */
+
+#endif /* _RPI_GPIO_HPP_ */
@@ -0,0 +1,80 @@
+/**
+ * @file
+ *  @brief Header file for the simulated register backend.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  These functions are only available when linking against librpigpiosim.a,
+ *  built with "make sim" in the src directory. That library behaves as
+ *  librpigpio.a but every register access is served by a model of the
+ *  peripheral rather than /dev/mem, so programs run on any Linux machine.
+ */
+
+#ifndef _RPI_GPIO_SIM_H_
+#define _RPI_GPIO_SIM_H_
+
+#include "rpiGpio.h"
+
+/** @brief Revision code reported by the simulated board unless changed with
+ *  simSetRevision(). A Pi 3 Model B. */
+#define SIM_DEFAULT_REVISION        0xa02082
+
+/** @brief A simulated I2C slave. Callbacks are made with the simulator lock
+ *  held so must not call back into the library. Any may be NULL. */
+typedef struct {
+    /** Address phase. Return 0 to NACK. \p read is non zero for a read. */
+    int     (*start)(void * context, int read);
+    /** A byte written by the master. Return 0 to NACK. */
+    int     (*write)(void * context, uint8_t byte);
+    /** Return the next byte read by the master. */
+    uint8_t (*read)(void * context);
+    /** The transfer has finished. */
+    void    (*stop)(void * context);
+    /** Passed to every callback. */
+    void *  context;
+} tSimI2cDevice;
+
+/** @brief Called on every change of the simulated GPIO levels. */
+typedef void (*tSimLevelWatch)(void * context, uint64_t time_ns,
+                               uint32_t levels, uint32_t changed);
+
+errStatus simSetRevision(uint32_t revision);
+errStatus simSetInputs(uint32_t mask, uint32_t levels);
+errStatus simSetLevelWatch(tSimLevelWatch watch, void * context);
+errStatus simI2cAttach(uint8_t address, const tSimI2cDevice * device);
+errStatus simI2cAttachRegisterFile(uint8_t address);
+errStatus simI2cDetach(uint8_t address);
+errStatus simI2cAttachPins(int gpioNumberSda, int gpioNumberScl, uint8_t address,
+                           const tSimI2cDevice * device);
+errStatus simI2cAttachPinsRegisterFile(int gpioNumberSda, int gpioNumberScl,
+                                       uint8_t address);
+errStatus simI2cDetachPins(int gpioNumberSda);
+errStatus simOneWireAttach(int gpioNumber, uint64_t rom, int16_t temperature);
+errStatus simOneWireDetach(int gpioNumber);
+errStatus simShiftAttachOutputs(int gpioNumberClock, int gpioNumberLatch,
+                                int gpioNumberData, int registers);
+errStatus simShiftAttachInputs(int gpioNumberClock, int gpioNumberLoad,
+                               int gpioNumberData, int registers);
+errStatus simShiftSetInputs(int gpioNumberData, const uint8_t * data);
+errStatus simShiftGetOutputs(int gpioNumberData, uint8_t * data);
+errStatus simShiftDetach(int gpioNumberData);
+errStatus simSwitchSet(int gpioNumberA, int gpioNumberB, int closed);
+errStatus simPeekRegister(uint32_t offset, uint32_t * value);
+errStatus simCmGetFaults(uint32_t * faults);
+
+#endif /* _RPI_GPIO_SIM_H_ */
@@ -0,0 +1,823 @@
+/**
+ * @file
+ *  @brief Shares the BSC between processes through a Unix socket.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  The BSC has no locking, and each process maps it separately, so two
+ *  processes transferring at once corrupt each other's transactions. The
+ *  arbiter is a thread in the one process which owns the BSC. Clients
+ *  connect to its SOCK_SEQPACKET socket and send a batch of transactions as
+ *  one message, which the arbiter runs back to back with
+ *  gpioI2cTransfer(), so no other client's transaction comes between them,
+ *  and answers with one message of statuses and read data.
+ *
+ *  A client has at most one batch outstanding, as gpioI2cArbiterTransfer()
+ *  waits for the reply. Between batches the arbiter takes any newly
+ *  arrived batches and runs the next waiting one after the client it last
+ *  served, so clients are served round robin however often each sends.
+ */
+
+#include "arbiter.h"
+
+/* Local / internal prototypes */
+static int arbiterParse(tArbiterConn * conn, tI2cTransfer * transfers, uint32_t * frequency);
+static int arbiterLive(const char * path);
+static void arbiterClose(int slot);
+static void arbiterAccept(void);
+static void arbiterReceive(int slot);
+static void arbiterRun(int slot);
+static void * arbiterThread(void * unused);
+
+/**** Globals ****/
+/** @brief Listening socket, -1 if the arbiter is not running. */
+static int gArbiterListen = -1;
+
+/** @brief Path the arbiter is bound to. */
+static struct sockaddr_un gArbiterAddress;
+
+/** @brief Connections, only used by the arbiter thread. */
+static tArbiterConn gArbiterConns[I2C_ARBITER_CLIENTS];
+
+/** @brief Reply being built, only used by the arbiter thread. */
+static uint8_t gArbiterReply[I2C_ARBITER_MESSAGE];
+
+/** @brief Slot served last, the search for the next batch starts after it. */
+static int gArbiterLast = 0;
+
+/** @brief Metrics, written by the thread. */
+static tI2cArbiterStats gArbiterStats;
+
+/** @brief Protects gArbiterStats. */
+static pthread_mutex_t gArbiterStatsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The arbiter thread. */
+static pthread_t gArbiterThread;
+
+/** @brief Non zero while the arbiter thread should run. */
+static volatile int gArbiterRunning = 0;
+
+/** @brief This process's connection to an arbiter, -1 if not connected. */
+static int gArbiterSocket = -1;
+
+/** @brief Serialises this process's batches and protects gArbiterMessage. */
+static pthread_mutex_t gArbiterClientLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Batch and reply of this process's connection. */
+static uint8_t gArbiterMessage[I2C_ARBITER_MESSAGE];
+
+/**
+ * @brief           Starts the arbiter thread listening for clients.
+ * @details         gpioI2cSetup() must have been called. From then on this
+ *                  process should use the BSC only through the arbiter, by
+ *                  connecting to it like any other client. A socket left at
+ *                  \p path by an arbiter which did not stop cleanly is
+ *                  replaced, but not one an arbiter is listening on or a
+ *                  file which is not a socket.
+ * @param[in] path  Path of the socket, such as #I2C_ARBITER_PATH.
+ * @param mode      Permissions of the socket, such as 0660 to allow a group
+ *                  of users to be clients. Not reduced by the umask.
+ * @return          An error from #errStatus, ERROR_ALREADY_INITIALISED if
+ *                  another arbiter is listening on \p path. */
+errStatus gpioI2cArbiterStart(const char * path, int mode)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    struct stat status;
+    int slot = 0;
+
+    if (gArbiterListen >= 0)
+    {
+        dbgPrint(DBG_INFO, "The arbiter is already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (path == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter path was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (strlen(path) >= sizeof(gArbiterAddress.sun_path) || mode < 0 || mode > 0777)
+    {
+        dbgPrint(DBG_INFO, "path %s or mode 0%o is out of range.", path, mode);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (lstat(path, &status) == 0 && !S_ISSOCK(status.st_mode))
+    {
+        dbgPrint(DBG_INFO, "%s exists and is not a socket.", path);
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (arbiterLive(path))
+    {
+        dbgPrint(DBG_INFO, "Another arbiter is listening on %s.", path);
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else
+    {
+        memset(&gArbiterAddress, 0, sizeof(gArbiterAddress));
+        gArbiterAddress.sun_family = AF_UNIX;
+        strcpy(gArbiterAddress.sun_path, path);
+        unlink(path);
+
+        if ((gArbiterListen = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0 ||
+            bind(gArbiterListen, (struct sockaddr *)&gArbiterAddress,
+                 sizeof(gArbiterAddress)) != 0 ||
+            chmod(path, (mode_t)mode) != 0 ||
+            listen(gArbiterListen, I2C_ARBITER_CLIENTS) != 0)
+        {
+            dbgPrint(DBG_INFO, "Listening on %s failed. errno: %s.", path, strerror(errno));
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            memset(&gArbiterStats, 0, sizeof(gArbiterStats));
+
+            for (slot = 0; slot < I2C_ARBITER_CLIENTS; slot++)
+            {
+                gArbiterConns[slot].fd = -1;
+                gArbiterConns[slot].pending = 0;
+            }
+
+            gArbiterLast = 0;
+            gArbiterRunning = 1;
+
+            if ((errno = pthread_create(&gArbiterThread, NULL, arbiterThread, NULL)) != 0)
+            {
+                dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+                gArbiterRunning = 0;
+                rtn = ERROR_EXTERNAL;
+            }
+
+            else
+            {
+                rtn = OK;
+            }
+        }
+
+        if (rtn != OK && gArbiterListen >= 0)
+        {
+            close(gArbiterListen);
+            unlink(path);
+            gArbiterListen = -1;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the arbiter, after the batch running if any, and
+ *          disconnects every client. Waiting batches fail with
+ *          #ERROR_EXTERNAL.
+ * @return  An error from #errStatus. */
+errStatus gpioI2cArbiterStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    int slot = 0;
+
+    if (gArbiterListen < 0)
+    {
+        dbgPrint(DBG_INFO, "The arbiter is not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gArbiterRunning = 0;
+        pthread_join(gArbiterThread, NULL);
+
+        for (slot = 0; slot < I2C_ARBITER_CLIENTS; slot++)
+        {
+            if (gArbiterConns[slot].fd >= 0)
+            {
+                arbiterClose(slot);
+            }
+        }
+
+        close(gArbiterListen);
+        unlink(gArbiterAddress.sun_path);
+        gArbiterListen = -1;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Copies the arbiter's metrics.
+ * @param[out] stats The metrics.
+ * @return          An error from #errStatus. */
+errStatus gpioI2cArbiterGetStats(tI2cArbiterStats * stats)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (stats == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stats was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gArbiterStatsLock);
+        *stats = gArbiterStats;
+        pthread_mutex_unlock(&gArbiterStatsLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Connects this process to an arbiter, which may be in
+ *                  this or another process. gpioSetup() is not needed.
+ * @param[in] path  Path passed to gpioI2cArbiterStart().
+ * @return          An error from #errStatus. */
+errStatus gpioI2cArbiterConnect(const char * path)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    struct sockaddr_un address;
+
+    pthread_mutex_lock(&gArbiterClientLock);
+
+    if (gArbiterSocket >= 0)
+    {
+        dbgPrint(DBG_INFO, "Already connected, call gpioI2cArbiterDisconnect() first.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (path == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter path was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (strlen(path) >= sizeof(address.sun_path))
+    {
+        dbgPrint(DBG_INFO, "path %s is too long.", path);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, path);
+
+        if ((gArbiterSocket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) < 0 ||
+            connect(gArbiterSocket, (struct sockaddr *)&address, sizeof(address)) != 0)
+        {
+            dbgPrint(DBG_INFO, "Connecting to %s failed. errno: %s.", path, strerror(errno));
+            rtn = ERROR_EXTERNAL;
+
+            if (gArbiterSocket >= 0)
+            {
+                close(gArbiterSocket);
+                gArbiterSocket = -1;
+            }
+        }
+
+        else
+        {
+            rtn = OK;
+        }
+    }
+
+    pthread_mutex_unlock(&gArbiterClientLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Closes the connection made by gpioI2cArbiterConnect().
+ * @return  An error from #errStatus. */
+errStatus gpioI2cArbiterDisconnect(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gArbiterClientLock);
+
+    if (gArbiterSocket < 0)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioI2cArbiterConnect() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        close(gArbiterSocket);
+        gArbiterSocket = -1;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gArbiterClientLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Runs a batch of transactions through the arbiter, as
+ *                  gpioI2cTransfer() would, with no other client's
+ *                  transactions between them. Waits for the result. May be
+ *                  called from several threads, which take turns.
+ * @param frequency Clock for the batch, or 0 to keep the current one, which
+ *                  may be another client's.
+ * @param[in,out] transfers The transactions, each given its \p status.
+ * @param count     Number of transactions, 1 to #I2C_ARBITER_BATCH. The
+ *                  batch and the reply must each fit #I2C_ARBITER_MESSAGE.
+ * @return          OK if every transaction succeeded, otherwise the status of
+ *                  the first that failed, or #ERROR_EXTERNAL if the arbiter
+ *                  could not be reached. */
+errStatus gpioI2cArbiterTransfer(int frequency, tI2cTransfer * transfers, int count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tArbiterHeader header;
+    tArbiterOp op;
+    int32_t status = 0;
+    size_t request = 0;
+    size_t reply = 0;
+    size_t offset = 0;
+    ssize_t received = 0;
+    int index = 0;
+
+    pthread_mutex_lock(&gArbiterClientLock);
+
+    if (gArbiterSocket < 0)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioI2cArbiterConnect() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (transfers == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter transfers was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (count < 1 || count > I2C_ARBITER_BATCH ||
+             (frequency != 0 && (frequency < I2C_CLOCK_FREQ_MIN || frequency > I2C_CLOCK_FREQ_MAX)))
+    {
+        dbgPrint(DBG_INFO, "count %d or frequency %d is out of range.", count, frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        request = sizeof(header) + count * sizeof(op);
+        reply = sizeof(header) + count * sizeof(status);
+        rtn = OK;
+
+        for (index = 0; index < count; index++)
+        {
+            request += transfers[index].writeLength;
+            reply += transfers[index].readLength;
+
+            if ((transfers[index].writeLength && transfers[index].writeData == NULL) ||
+                (transfers[index].readLength && transfers[index].readBuffer == NULL))
+            {
+                rtn = ERROR_NULL;
+            }
+        }
+
+        if (rtn != OK)
+        {
+            dbgPrint(DBG_INFO, "A transaction has data but a NULL pointer.");
+        }
+
+        else if (request > I2C_ARBITER_MESSAGE || reply > I2C_ARBITER_MESSAGE)
+        {
+            dbgPrint(DBG_INFO, "The batch, %u bytes, or its reply, %u bytes, exceeds %d.",
+                     (unsigned)request, (unsigned)reply, I2C_ARBITER_MESSAGE);
+            rtn = ERROR_RANGE;
+        }
+
+        else
+        {
+            memset(&header, 0, sizeof(header));
+            header.magic = ARBITER_MAGIC;
+            header.frequency = (uint32_t)frequency;
+            header.count = (uint16_t)count;
+            memcpy(gArbiterMessage, &header, sizeof(header));
+            offset = sizeof(header) + count * sizeof(op);
+
+            for (index = 0; index < count; index++)
+            {
+                memset(&op, 0, sizeof(op));
+                op.address = transfers[index].address;
+                op.writeLength = transfers[index].writeLength;
+                op.readLength = transfers[index].readLength;
+                memcpy(gArbiterMessage + sizeof(header) + index * sizeof(op), &op, sizeof(op));
+
+                if (op.writeLength)
+                {
+                    memcpy(gArbiterMessage + offset, transfers[index].writeData, op.writeLength);
+                    offset += op.writeLength;
+                }
+            }
+
+            if (send(gArbiterSocket, gArbiterMessage, request, MSG_NOSIGNAL) != (ssize_t)request ||
+                (received = recv(gArbiterSocket, gArbiterMessage, sizeof(gArbiterMessage), 0)) !=
+                (ssize_t)reply)
+            {
+                dbgPrint(DBG_INFO, "The arbiter did not answer, %d bytes received. errno: %s.",
+                         (int)received, strerror(errno));
+                rtn = ERROR_EXTERNAL;
+            }
+
+            else
+            {
+                offset = sizeof(header) + count * sizeof(status);
+
+                for (index = 0; index < count; index++)
+                {
+                    memcpy(&status, gArbiterMessage + sizeof(header) + index * sizeof(status),
+                           sizeof(status));
+                    transfers[index].status = (errStatus)status;
+
+                    if (transfers[index].readLength)
+                    {
+                        memcpy(transfers[index].readBuffer, gArbiterMessage + offset,
+                               transfers[index].readLength);
+                        offset += transfers[index].readLength;
+                    }
+
+                    if (status != OK && rtn == OK)
+                    {
+                        rtn = (errStatus)status;
+                    }
+                }
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gArbiterClientLock);
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function, checks a received batch and points
+ *                  \p transfers at its data and at the reply.
+ * @param[in] conn  The connection holding the batch.
+ * @param[out] transfers The transactions.
+ * @param[out] frequency The batch's clock, 0 to keep the current one.
+ * @return          Transactions in the batch, or -1 if it is malformed. */
+static int arbiterParse(tArbiterConn * conn, tI2cTransfer * transfers, uint32_t * frequency)
+{
+    tArbiterHeader header;
+    tArbiterOp op;
+    size_t request = 0;
+    size_t reply = 0;
+    int count = -1;
+    int index = 0;
+
+    if (conn->length >= sizeof(header))
+    {
+        memcpy(&header, conn->request, sizeof(header));
+        request = sizeof(header) + header.count * sizeof(op);
+        reply = sizeof(header) + header.count * sizeof(int32_t);
+    }
+
+    if (request && header.magic == ARBITER_MAGIC &&
+        header.count >= 1 && header.count <= I2C_ARBITER_BATCH &&
+        (header.frequency == 0 ||
+         (header.frequency >= I2C_CLOCK_FREQ_MIN && header.frequency <= I2C_CLOCK_FREQ_MAX)) &&
+        conn->length >= request)
+    {
+        for (index = 0; index < header.count; index++)
+        {
+            memcpy(&op, conn->request + sizeof(header) + index * sizeof(op), sizeof(op));
+            transfers[index].address = op.address;
+            transfers[index].writeLength = op.writeLength;
+            transfers[index].readLength = op.readLength;
+            transfers[index].writeData = conn->request + request;
+            transfers[index].readBuffer = gArbiterReply + reply;
+            transfers[index].status = ERROR_DEFAULT;
+            request += op.writeLength;
+            reply += op.readLength;
+        }
+
+        if (request == conn->length && reply <= sizeof(gArbiterReply))
+        {
+            memcpy(gArbiterReply, &header, sizeof(header));
+            *frequency = header.frequency;
+            count = header.count;
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief           Internal function, checks for an arbiter listening on a
+ *                  socket.
+ * @param[in] path  The socket.
+ * @return          Non zero if a connection was accepted. */
+static int arbiterLive(const char * path)
+{
+    struct sockaddr_un address;
+    int live = 0;
+    int fd = -1;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) >= 0)
+    {
+        live = connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0;
+        close(fd);
+    }
+
+    return live;
+}
+
+
+/**
+ * @brief           Internal function, closes a connection, dropping any batch
+ *                  it had waiting.
+ * @param slot      The connection. */
+static void arbiterClose(int slot)
+{
+    close(gArbiterConns[slot].fd);
+    gArbiterConns[slot].fd = -1;
+
+    pthread_mutex_lock(&gArbiterStatsLock);
+    gArbiterStats.clients--;
+    gArbiterStats.depth -= gArbiterConns[slot].pending;
+    pthread_mutex_unlock(&gArbiterStatsLock);
+
+    gArbiterConns[slot].pending = 0;
+}
+
+
+/**
+ * @brief   Internal function, accepts a client into a free slot, or refuses
+ *          it if there is none. */
+static void arbiterAccept(void)
+{
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    int fd = -1;
+    int slot = 0;
+
+    if ((fd = accept4(gArbiterListen, NULL, NULL, SOCK_CLOEXEC)) >= 0)
+    {
+        for (slot = 0; slot < I2C_ARBITER_CLIENTS && gArbiterConns[slot].fd >= 0; slot++)
+        {
+        }
+
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        {
+            credentials.pid = -1;
+        }
+
+        pthread_mutex_lock(&gArbiterStatsLock);
+
+        if (slot == I2C_ARBITER_CLIENTS)
+        {
+            GPIO_LOG(logWarning, "I2C arbiter refused pid %d, %d clients are connected.",
+                     (int)credentials.pid, I2C_ARBITER_CLIENTS);
+            gArbiterStats.rejected++;
+            close(fd);
+        }
+
+        else
+        {
+            gArbiterConns[slot].fd = fd;
+            gArbiterConns[slot].pending = 0;
+            memset(&gArbiterStats.client[slot], 0, sizeof(gArbiterStats.client[slot]));
+            gArbiterStats.client[slot].pid = (int)credentials.pid;
+            gArbiterStats.clients++;
+        }
+
+        pthread_mutex_unlock(&gArbiterStatsLock);
+    }
+}
+
+
+/**
+ * @brief           Internal function, takes a batch from a client, or closes
+ *                  the connection if the client has gone.
+ * @param slot      The connection. */
+static void arbiterReceive(int slot)
+{
+    tArbiterConn * conn = &gArbiterConns[slot];
+    ssize_t received = 0;
+
+    /* MSG_TRUNC returns the full length, so an oversized batch is seen */
+    received = recv(conn->fd, conn->request, sizeof(conn->request), MSG_TRUNC | MSG_DONTWAIT);
+
+    if (received > (ssize_t)sizeof(conn->request))
+    {
+        GPIO_LOG(logWarning, "I2C arbiter dropped a client sending %d bytes.", (int)received);
+        pthread_mutex_lock(&gArbiterStatsLock);
+        gArbiterStats.rejected++;
+        pthread_mutex_unlock(&gArbiterStatsLock);
+        arbiterClose(slot);
+    }
+
+    /* 0 is the client closing its end */
+    else if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        arbiterClose(slot);
+    }
+
+    else if (received > 0)
+    {
+        conn->length = (size_t)received;
+        conn->arrival_ns = timeNowNs();
+        conn->pending = 1;
+
+        pthread_mutex_lock(&gArbiterStatsLock);
+        gArbiterStats.depth++;
+
+        if (gArbiterStats.depth > gArbiterStats.depthMax)
+        {
+            gArbiterStats.depthMax = gArbiterStats.depth;
+        }
+
+        pthread_mutex_unlock(&gArbiterStatsLock);
+    }
+}
+
+
+/**
+ * @brief           Internal function, runs a client's batch and sends the
+ *                  reply.
+ * @param slot      The connection, which must have a batch waiting. */
+static void arbiterRun(int slot)
+{
+    tArbiterConn * conn = &gArbiterConns[slot];
+    tI2cTransfer transfers[I2C_ARBITER_BATCH];
+    tI2cArbiterClient * client = NULL;
+    errStatus clock = OK;
+    uint32_t frequency = 0;
+    uint64_t start = timeNowNs();
+    uint64_t wait = start - conn->arrival_ns;
+    size_t length = 0;
+    int32_t status = 0;
+    int count = arbiterParse(conn, transfers, &frequency);
+    int index = 0;
+
+    if (count > 0)
+    {
+        /* If the clock cannot be set every transaction fails with its error */
+        if (frequency == 0 || (clock = gpioI2cSetClock((int)frequency)) == OK)
+        {
+            gpioI2cTransfer(transfers, count);
+        }
+
+        length = sizeof(tArbiterHeader) + count * sizeof(status);
+
+        for (index = 0; index < count; index++)
+        {
+            status = clock == OK ? transfers[index].status : clock;
+            memcpy(gArbiterReply + sizeof(tArbiterHeader) + index * sizeof(status),
+                   &status, sizeof(status));
+            length += transfers[index].readLength;
+        }
+    }
+
+    pthread_mutex_lock(&gArbiterStatsLock);
+    client = &gArbiterStats.client[slot];
+    gArbiterStats.depth--;
+
+    if (count > 0)
+    {
+        gArbiterStats.batches++;
+        gArbiterStats.transactions += count;
+        gArbiterStats.busy_ns += timeNowNs() - start;
+        client->batches++;
+        client->transactions += count;
+        client->wait_ns += wait;
+        client->waitMax_ns = wait > client->waitMax_ns ? wait : client->waitMax_ns;
+    }
+
+    else
+    {
+        gArbiterStats.rejected++;
+    }
+
+    pthread_mutex_unlock(&gArbiterStatsLock);
+
+    conn->pending = 0;
+
+    if (count <= 0)
+    {
+        GPIO_LOG(logWarning, "I2C arbiter dropped pid %d for a malformed batch.", client->pid);
+        arbiterClose(slot);
+    }
+
+    /* Never waits, a client which stops reading must not hold up the others */
+    else if (send(conn->fd, gArbiterReply, length, MSG_NOSIGNAL | MSG_DONTWAIT) !=
+             (ssize_t)length)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            GPIO_LOG(logWarning, "I2C arbiter dropped pid %d, which is not reading replies.",
+                     client->pid);
+            pthread_mutex_lock(&gArbiterStatsLock);
+            gArbiterStats.rejected++;
+            pthread_mutex_unlock(&gArbiterStatsLock);
+        }
+
+        arbiterClose(slot);
+    }
+}
+
+
+/**
+ * @brief           Internal function, the arbiter thread.
+ * @param unused    Unused.
+ * @return          NULL. */
+static void * arbiterThread(void * unused)
+{
+    struct pollfd fds[I2C_ARBITER_CLIENTS + 1];
+    int slots[I2C_ARBITER_CLIENTS + 1];
+    int pending = 0;
+    int count = 0;
+    int index = 0;
+    int slot = 0;
+
+    (void)unused;
+
+    while (gArbiterRunning)
+    {
+        fds[0].fd = gArbiterListen;
+        fds[0].events = POLLIN;
+        count = 1;
+        pending = 0;
+
+        /* Clients with a batch waiting are not read until it has run */
+        for (slot = 0; slot < I2C_ARBITER_CLIENTS; slot++)
+        {
+            if (gArbiterConns[slot].fd >= 0 && !gArbiterConns[slot].pending)
+            {
+                fds[count].fd = gArbiterConns[slot].fd;
+                fds[count].events = POLLIN;
+                slots[count++] = slot;
+            }
+
+            pending |= gArbiterConns[slot].pending;
+        }
+
+        if (poll(fds, count, pending ? 0 : ARBITER_POLL_MS) > 0)
+        {
+            if (fds[0].revents & POLLIN)
+            {
+                arbiterAccept();
+            }
+
+            for (index = 1; index < count; index++)
+            {
+                if (fds[index].revents)
+                {
+                    arbiterReceive(slots[index]);
+                }
+            }
+        }
+
+        /* Round robin, starting after the client served last */
+        for (index = 1; index <= I2C_ARBITER_CLIENTS; index++)
+        {
+            slot = (gArbiterLast + index) % I2C_ARBITER_CLIENTS;
+
+            if (gArbiterConns[slot].pending)
+            {
+                arbiterRun(slot);
+                gArbiterLast = slot;
+                break;
+            }
+        }
+    }
+
+    return NULL;
+}
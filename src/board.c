@@ -0,0 +1,271 @@
+/**
+ * @file
+ *  @brief Contains the board table and revision detection.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Revision codes are documented at:
+ *      https://www.raspberrypi.com/documentation/computers/raspberry-pi.html
+ */
+
+#include "board.h"
+
+/** @brief GPIO pins on the rev1 26 pin P1 header. See #REV1_PINS. */
+#define REV1_PIN_MASK   (PIN_BIT(0)  | PIN_BIT(1)  | PIN_BIT(4)  | PIN_BIT(7)  | \
+                         PIN_BIT(8)  | PIN_BIT(9)  | PIN_BIT(10) | PIN_BIT(11) | \
+                         PIN_BIT(14) | PIN_BIT(15) | PIN_BIT(17) | PIN_BIT(18) | \
+                         PIN_BIT(21) | PIN_BIT(22) | PIN_BIT(23) | PIN_BIT(24) | \
+                         PIN_BIT(25))
+
+/** @brief GPIO pins on the rev2 26 pin P1 header. See #REV2_PINS. */
+#define REV2_PIN_MASK   (PIN_BIT(2)  | PIN_BIT(3)  | PIN_BIT(4)  | PIN_BIT(7)  | \
+                         PIN_BIT(8)  | PIN_BIT(9)  | PIN_BIT(10) | PIN_BIT(11) | \
+                         PIN_BIT(14) | PIN_BIT(15) | PIN_BIT(17) | PIN_BIT(18) | \
+                         PIN_BIT(22) | PIN_BIT(23) | PIN_BIT(24) | PIN_BIT(25) | \
+                         PIN_BIT(27))
+
+/** @brief The board table. The first matching entry is used.
+ ** @details Old style revision codes (bit 23 clear) are matched on the code
+ ** itself. New style codes are matched on their processor field as all boards
+ ** built around a given SoC share a peripheral base and J8 header. */
+static const tBoard boardTable[] = {
+    /* Old style: 0002 - 0003 */
+    {0x000002, 0xFFFFFE, "Model B rev1", socBcm2835, pcbRev1,
+     BCM2835_PERI_BASE, REV1_PIN_MASK, pullCtrlGppud,
+     REV1_SDA, REV1_SCL, BSC0_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    /* Old style: 0004 - 0007 */
+    {0x000004, 0xFFFFFC, "Model A/B rev2", socBcm2835, pcbRev2,
+     BCM2835_PERI_BASE, REV2_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    /* Old style: 0008 - 000f */
+    {0x000008, 0xFFFFF8, "Model A/B rev2", socBcm2835, pcbRev2,
+     BCM2835_PERI_BASE, REV2_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    /* Old style: 0010 - 0013 */
+    {0x000010, 0xFFFFFC, "Model A+/B+/CM1", socBcm2835, pcbRevJ8,
+     BCM2835_PERI_BASE, J8_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    /* Old style: 0014 - 0015 */
+    {0x000014, 0xFFFFFE, "Model A+/CM1", socBcm2835, pcbRevJ8,
+     BCM2835_PERI_BASE, J8_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    /* New style */
+    {BOARD_NEW_STYLE | (socBcm2835 << 12),
+     BOARD_NEW_STYLE | BOARD_NEW_STYLE_SOC_MASK, "BCM2835 J8", socBcm2835,
+     pcbRevJ8, BCM2835_PERI_BASE, J8_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    {BOARD_NEW_STYLE | (socBcm2836 << 12),
+     BOARD_NEW_STYLE | BOARD_NEW_STYLE_SOC_MASK, "BCM2836 J8", socBcm2836,
+     pcbRevJ8, BCM2836_PERI_BASE, J8_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2835_CORE_HZ},
+
+    {BOARD_NEW_STYLE | (socBcm2837 << 12),
+     BOARD_NEW_STYLE | BOARD_NEW_STYLE_SOC_MASK, "BCM2837 J8", socBcm2837,
+     pcbRevJ8, BCM2837_PERI_BASE, J8_PIN_MASK, pullCtrlGppud,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2835_OSC_HZ, BCM2835_PLLD_HZ,
+     BCM2837_CORE_HZ},
+
+    {BOARD_NEW_STYLE | (socBcm2711 << 12),
+     BOARD_NEW_STYLE | BOARD_NEW_STYLE_SOC_MASK, "BCM2711 J8", socBcm2711,
+     pcbRevJ8, BCM2711_PERI_BASE, J8_PIN_MASK, pullCtrlGppuppdn,
+     REV2_SDA, REV2_SCL, BSC1_BASE_OFFSET, BCM2711_OSC_HZ, BCM2711_PLLD_HZ,
+     BCM2711_CORE_HZ},
+};
+
+/** @brief Number of entries in boardTable. */
+#define BOARD_TABLE_SIZE    (sizeof(boardTable) / sizeof(boardTable[0]))
+
+/**
+ * @brief                   Parses the revision code from a line of
+ *                          /proc/cpuinfo.
+ * @details                 The line should be of the form
+ *                          "Revision\t: a02082". This is split out of
+ *                          gpioSetup() so that detection can be checked
+ *                          against canned cpuinfo lines.
+ * @param[in] cpuinfoLine   A single line from /proc/cpuinfo.
+ * @param[out] revision     Populated with the revision code on success.
+ * @return                  An error from #errStatus. #ERROR_RANGE is returned
+ *                          if the line is not a revision line. */
+errStatus gpioParseRevision(const char * cpuinfoLine, uint32_t * revision)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const char * colon = NULL;
+    char * end = NULL;
+    unsigned long value = 0;
+
+    if (cpuinfoLine == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter cpuinfoLine was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (revision == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter revision was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (strstr(cpuinfoLine, "Revision") != cpuinfoLine ||
+             (colon = strchr(cpuinfoLine, ':')) == NULL)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        value = strtoul(colon + 1, &end, 16);
+
+        if (end == colon + 1)
+        {
+            dbgPrint(DBG_INFO, "No revision code after ':' in \"%s\".", cpuinfoLine);
+            rtn = ERROR_RANGE;
+        }
+
+        else
+        {
+            *revision = (uint32_t)value;
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Finds the board table entry for a revision code.
+ * @param revision      Revision code as found in /proc/cpuinfo.
+ * @param[out] board    Populated with a pointer to the matching table entry.
+ * @return              An error from #errStatus. #ERROR_RANGE is returned if
+ *                      the revision is not a known board. */
+errStatus gpioLookupBoard(uint32_t revision, const tBoard ** board)
+{
+    errStatus rtn = ERROR_RANGE;
+    unsigned int index = 0;
+
+    if (board == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter board was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        revision &= BOARD_REVISION_MASK;
+
+        for (index = 0; index < BOARD_TABLE_SIZE; index++)
+        {
+            if ((revision & boardTable[index].revisionMask) ==
+                boardTable[index].revisionValue)
+            {
+                *board = &boardTable[index];
+                rtn = OK;
+                break;
+            }
+        }
+
+        if (rtn != OK)
+        {
+            dbgPrint(DBG_INFO, "Revision 0x%x is not a known board.", revision);
+        }
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which detects the board the library
+ *                      is running on.
+ * @details             /proc/cpuinfo is searched first. If it has no revision
+ *                      line the device tree revision property is used.
+ * @param[out] board    Populated with a pointer to the board table entry.
+ * @return              An error from #errStatus. */
+errStatus boardDetect(const tBoard ** board)
+{
+    errStatus rtn = ERROR_EXTERNAL;
+    uint32_t revision = 0;
+    FILE * cpuinfo = NULL;
+    FILE * dtRevision = NULL;
+    uint8_t dtBytes[4];
+
+#ifdef GPIO_SIM
+    revision = simRevision();
+    rtn = OK;
+#endif
+
+    if (rtn != OK && (cpuinfo = fopen(BOARD_CPUINFO_PATH, "r")) != NULL)
+    {
+        char * line = NULL;
+        size_t lineSize = 0;
+
+        while (rtn != OK && getline(&line, &lineSize, cpuinfo) >= 0)
+        {
+            if (gpioParseRevision(line, &revision) == OK)
+            {
+                rtn = OK;
+            }
+        }
+
+        free(line);
+        fclose(cpuinfo);
+    }
+
+    else if (rtn != OK)
+    {
+        dbgPrint(DBG_INFO, "can't open %s. errno: %s.", BOARD_CPUINFO_PATH,
+                 strerror(errno));
+    }
+
+    if (rtn != OK && (dtRevision = fopen(BOARD_DT_REVISION_PATH, "rb")) != NULL)
+    {
+        if (fread(dtBytes, sizeof(dtBytes), 1, dtRevision) == 1)
+        {
+            revision = ((uint32_t)dtBytes[0] << 24) | ((uint32_t)dtBytes[1] << 16) |
+                       ((uint32_t)dtBytes[2] << 8)  |  (uint32_t)dtBytes[3];
+            rtn = OK;
+        }
+        fclose(dtRevision);
+    }
+
+    if (rtn != OK)
+    {
+        dbgPrint(DBG_INFO, "did not find revision in cpuinfo or device tree.");
+    }
+
+    else if ((rtn = gpioLookupBoard(revision, board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioLookupBoard() failed. %s", gpioErrToString(rtn));
+    }
+
+    return rtn;
+}
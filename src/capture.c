@@ -0,0 +1,441 @@
+/**
+ * @file
+ *  @brief Contains source for DMA paced GPLEV0 capture.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A DMA channel copies GPLEV0 into a circular buffer of two halves, each
+ *  copy preceded by a word written into the PWM or PCM FIFO so samples are
+ *  one tick apart whatever the CPU is doing. After each half the channel
+ *  copies the system timer into that half's stamp. A thread watches the
+ *  stamps, copies out each completed half and passes it to the callback.
+ *  A stamp more than one half later than the last drained shows halves were
+ *  overwritten before they were drained.
+ */
+
+#include "capture.h"
+
+/* Local / internal prototypes */
+static void captureBuild(const tDmaMemory * memory, tCaptureRing * ring,
+                         eWavePacing pacing);
+static void captureBlock(tDmaControlBlock * block, uint32_t bus, uint32_t ti,
+                         uint32_t source, uint32_t dest);
+static void captureDrain(tCaptureRing * ring);
+static void * captureThread(void * unused);
+static void captureRelease(void);
+
+/**** Globals ****/
+/** @brief Protects gCaptureRing.stats. */
+static pthread_mutex_t gCaptureLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The draining thread. */
+static pthread_t gCaptureThread;
+
+/** @brief Non zero while the draining thread should run. */
+static volatile int gCaptureRunning = 0;
+
+/** @brief Registers of the DMA channel capturing. */
+static volatile uint32_t * gCaptureDma = NULL;
+
+/** @brief The DMA channel capturing. */
+static int gCaptureChannel = -1;
+
+/** @brief Peripheral pacing the capture, valid while gCapturePaced. */
+static eWavePacing gCapturePacing = wavePacePwm;
+
+/** @brief Non zero once dmaPaceStart() has succeeded. */
+static int gCapturePaced = 0;
+
+/** @brief Memory holding the chain, samples and stamps. */
+static tDmaMemory gCaptureMemory;
+
+/** @brief The buffer and the draining position. */
+static tCaptureRing gCaptureRing;
+
+/** @brief Callback passed each completed half. */
+static tCaptureCallback gCaptureCallback = NULL;
+
+/** @brief Context passed to gCaptureCallback. */
+static void * gCaptureContext = NULL;
+
+/** @brief Sleep of the draining thread, a quarter of a half. */
+static uint64_t gCapturePollNs = 0;
+
+/**
+ * @brief               Starts sampling GPLEV0 every tick into a circular
+ *                      buffer, passing each completed half to \p callback.
+ * @details             gpioSetup() must have been called. Requires root.
+ *                      The pacing peripheral must not also be used by
+ *                      gpioWaveSetup(). Each sample takes two control blocks
+ *                      so the shortest usable tick depends on the DMA engine's
+ *                      load, around 1 us.
+ * @param pacing        The peripheral pacing the samples.
+ * @param tick_ns       Time between samples, #WAVE_TICK_NS_MIN to
+ *                      #WAVE_TICK_NS_MAX. It is rounded to whole pacing clocks.
+ * @param dmaChannel    DMA channel 0 - 14, or -1 for
+ *                      #CAPTURE_DEFAULT_DMA_CHANNEL.
+ * @param halfSamples   Samples per half, #CAPTURE_HALF_MIN to
+ *                      #CAPTURE_HALF_MAX. The callback must return within the
+ *                      time taken to fill a half.
+ * @param callback      Called from the capture thread with each half.
+ * @param context       Passed to \p callback.
+ * @param[out] achieved_ns  Populated with the tick used, may be NULL.
+ * @return              An error from #errStatus. */
+errStatus gpioCaptureStart(eWavePacing pacing, uint32_t tick_ns, int dmaChannel,
+                           size_t halfSamples, tCaptureCallback callback,
+                           void * context, uint32_t * achieved_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    int channel = dmaChannel < 0 ? CAPTURE_DEFAULT_DMA_CHANNEL : dmaChannel;
+    uint32_t tick = 0;
+
+    if (gCaptureRunning)
+    {
+        dbgPrint(DBG_INFO, "gpioCaptureStart() has already been called.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (callback == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter callback was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (halfSamples < CAPTURE_HALF_MIN || halfSamples > CAPTURE_HALF_MAX)
+    {
+        dbgPrint(DBG_INFO, "halfSamples %u is out of range.", (uint32_t)halfSamples);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = dmaPaceStart(pacing, tick_ns, &tick)) != OK)
+    {
+        dbgPrint(DBG_INFO, "dmaPaceStart() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        gCapturePaced = 1;
+        gCapturePacing = pacing;
+        gCaptureChannel = channel;
+
+        if ((rtn = dmaChannelOpen(channel, &gCaptureDma)) != OK)
+        {
+            dbgPrint(DBG_INFO, "dmaChannelOpen() failed. %s", gpioErrToString(rtn));
+            gCaptureDma = NULL;
+        }
+
+        else if ((rtn = dmaMemAlloc((2 * halfSamples * CAPTURE_BLOCKS_PER_SAMPLE + 2) *
+                                    sizeof(tDmaControlBlock) +
+                                    (2 * halfSamples + 2) * sizeof(uint32_t),
+                                    &gCaptureMemory)) != OK)
+        {
+            dbgPrint(DBG_INFO, "dmaMemAlloc() failed. %s", gpioErrToString(rtn));
+        }
+
+        else if ((gCaptureRing.copy = malloc(halfSamples * sizeof(uint32_t))) == NULL)
+        {
+            dbgPrint(DBG_INFO, "malloc() failed for %u samples.", (uint32_t)halfSamples);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            gCaptureRing.half = halfSamples;
+            gCaptureRing.half_us = (uint32_t)((uint64_t)halfSamples * tick / 1000);
+            gCaptureCallback = callback;
+            gCaptureContext = context;
+            gCapturePollNs = (uint64_t)halfSamples * tick / 4;
+            gCapturePollNs = gCapturePollNs < CAPTURE_POLL_MIN_NS ? CAPTURE_POLL_MIN_NS :
+                                                                    gCapturePollNs;
+            captureBuild(&gCaptureMemory, &gCaptureRing, pacing);
+            gCaptureRunning = 1;
+
+            if ((rtn = dmaChannelStart(gCaptureDma, gCaptureMemory.bus)) != OK)
+            {
+                dbgPrint(DBG_INFO, "dmaChannelStart() failed. %s", gpioErrToString(rtn));
+            }
+
+            else if ((errno = pthread_create(&gCaptureThread, NULL, captureThread,
+                                             NULL)) != 0)
+            {
+                dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+                rtn = ERROR_EXTERNAL;
+            }
+
+            else if (achieved_ns != NULL)
+            {
+                *achieved_ns = tick;
+            }
+        }
+
+        if (rtn != OK)
+        {
+            gCaptureRunning = 0;
+            captureRelease();
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the capture. Halves not yet drained are discarded.
+ * @return  An error from #errStatus. */
+errStatus gpioCaptureStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gCaptureRunning)
+    {
+        dbgPrint(DBG_INFO, "Capture is not running. Ensure gpioCaptureStart() was called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gCaptureRunning = 0;
+        pthread_join(gCaptureThread, NULL);
+        captureRelease();
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reads the capture counters. They are kept after
+ *                      gpioCaptureStop() and reset by gpioCaptureStart().
+ * @param[out] stats    Populated with the counters.
+ * @return              An error from #errStatus. */
+errStatus gpioCaptureGetStats(tCaptureStats * stats)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (stats == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stats was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gCaptureLock);
+        *stats = gCaptureRing.stats;
+        pthread_mutex_unlock(&gCaptureLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which lays out the chain, samples
+ *                      and stamps in \p memory and resets \p ring.
+ * @details             Each half is a pacing block and a GPLEV0 block per
+ *                      sample, then a block copying the system timer to the
+ *                      half's stamp. The last block links back to the first.
+ * @param[in] memory    Memory sized for the chain.
+ * @param[in,out] ring  half and copy are used. The rest is reset.
+ * @param pacing        The pacing peripheral. */
+static void captureBuild(const tDmaMemory * memory, tCaptureRing * ring,
+                         eWavePacing pacing)
+{
+    tDmaControlBlock * blocks = memory->virt;
+    size_t blockCount = 2 * ring->half * CAPTURE_BLOCKS_PER_SAMPLE + 2;
+    uint32_t samplesBus = memory->bus + blockCount * sizeof(tDmaControlBlock);
+    uint32_t stampsBus = samplesBus + 2 * ring->half * sizeof(uint32_t);
+    uint32_t bus = memory->bus;
+    size_t sample = 0;
+    int half = 0;
+
+    ring->samples = (uint32_t *)(blocks + blockCount);
+    ring->stamps = ring->samples + 2 * ring->half;
+    ring->next = 0;
+    ring->seen[0] = ring->seen[1] = 0;
+    ring->lastStamp[0] = ring->lastStamp[1] = 0;
+    ring->drained = 0;
+    ring->lastDrained = 0;
+    ring->index = 0;
+    memset(&ring->stats, 0, sizeof(ring->stats));
+
+    for (half = 0; half < 2; half++)
+    {
+        for (sample = 0; sample < ring->half; sample++)
+        {
+            captureBlock(blocks++, bus, DMA_PACE_TI(pacing),
+                         bus + offsetof(tDmaControlBlock, reserved), DMA_PACE_FIFO(pacing));
+            bus += sizeof(tDmaControlBlock);
+
+            captureBlock(blocks++, bus, DMA_TI_NO_WIDE_BURSTS | DMA_TI_WAIT_RESP,
+                         DMA_PERI_BUS(GPIO_BASE_OFFSET + GPLEV0_OFFSET),
+                         samplesBus + (half * ring->half + sample) * sizeof(uint32_t));
+            bus += sizeof(tDmaControlBlock);
+        }
+
+        captureBlock(blocks++, bus, DMA_TI_NO_WIDE_BURSTS | DMA_TI_WAIT_RESP,
+                     DMA_PERI_BUS(ST_BASE_OFFSET + ST_CLO_OFFSET),
+                     stampsBus + half * sizeof(uint32_t));
+        bus += sizeof(tDmaControlBlock);
+    }
+
+    (blocks - 1)->next = memory->bus;
+}
+
+
+/**
+ * @brief           Internal function which fills in a block copying one word,
+ *                  linked to the block after it.
+ * @param block     The block.
+ * @param bus       Bus address of \p block.
+ * @param ti        Transfer information.
+ * @param source    Source bus address.
+ * @param dest      Destination bus address. */
+static void captureBlock(tDmaControlBlock * block, uint32_t bus, uint32_t ti,
+                         uint32_t source, uint32_t dest)
+{
+    block->ti = ti;
+    block->source = source;
+    block->dest = dest;
+    block->length = sizeof(uint32_t);
+    block->stride = 0;
+    block->next = bus + sizeof(tDmaControlBlock);
+    block->reserved[0] = 0;
+    block->reserved[1] = 0;
+}
+
+
+/**
+ * @brief               Internal function which passes every completed half
+ *                      to the callback, in order.
+ * @details             A half is complete when its stamp changes. It is still
+ *                      intact if the other half has not completed since, and
+ *                      does not complete while it is copied. A stamp more than
+ *                      a half on from the last drained means halves between
+ *                      were lost.
+ * @param[in,out] ring  The buffer. */
+static void captureDrain(tCaptureRing * ring)
+{
+    volatile uint32_t * stamps = ring->stamps;
+    uint32_t stamp = 0;
+    uint32_t other = 0;
+    uint64_t lost = 0;
+    int half = 0;
+    int torn = 0;
+    int done = 0;
+
+    while (!done)
+    {
+        half = ring->next;
+        stamp = stamps[half];
+
+        if (ring->seen[half] ? stamp == ring->lastStamp[half] : stamp == 0)
+        {
+            done = 1;
+        }
+
+        else
+        {
+            /* Halves completed since the last drained were overwritten */
+            lost = 0;
+            if (ring->drained && stamp - ring->lastDrained > ring->half_us + ring->half_us / 2)
+            {
+                lost = (stamp - ring->lastDrained + ring->half_us / 2) / ring->half_us - 1;
+            }
+
+            other = stamps[half ^ 1];
+            torn = ring->seen[half ^ 1] && other != ring->lastStamp[half ^ 1];
+            memcpy(ring->copy, ring->samples + half * ring->half,
+                   ring->half * sizeof(uint32_t));
+            torn |= stamps[half ^ 1] != other;
+
+            ring->index += lost * ring->half;
+
+            if (!torn)
+            {
+                gCaptureCallback(gCaptureContext, ring->copy, ring->half, ring->index);
+            }
+
+            pthread_mutex_lock(&gCaptureLock);
+            ring->stats.overruns += lost + torn;
+            ring->stats.halves += !torn;
+            ring->stats.samples += torn ? 0 : ring->half;
+            pthread_mutex_unlock(&gCaptureLock);
+
+            ring->index += ring->half;
+            ring->seen[half] = 1;
+            ring->lastStamp[half] = stamp;
+            ring->drained = 1;
+            ring->lastDrained = stamp;
+            ring->next = half ^ 1;
+        }
+    }
+}
+
+
+/**
+ * @brief           Internal function run by the draining thread.
+ * @param unused    Unused.
+ * @return          NULL. */
+static void * captureThread(void * unused)
+{
+    struct timespec poll = {gCapturePollNs / TIMING_NSEC_IN_SEC,
+                            gCapturePollNs % TIMING_NSEC_IN_SEC};
+
+    while (gCaptureRunning)
+    {
+        captureDrain(&gCaptureRing);
+        nanosleep(&poll, NULL);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief   Internal function which undoes whatever gpioCaptureStart() did. */
+static void captureRelease(void)
+{
+    if (gCaptureDma != NULL)
+    {
+        dmaChannelClose(gCaptureChannel);
+    }
+
+    if (gCaptureMemory.virt != NULL)
+    {
+        dmaMemFree(&gCaptureMemory);
+    }
+
+    if (gCapturePaced)
+    {
+        dmaPaceStop(gCapturePacing);
+    }
+
+    free(gCaptureRing.copy);
+
+    gCaptureRing.copy = NULL;
+    gCaptureRing.samples = NULL;
+    gCaptureRing.stamps = NULL;
+    gCaptureDma = NULL;
+    gCaptureChannel = -1;
+    gCapturePaced = 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file
+ *  @brief Contains source for the bit parallel input debouncer.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Every pin has a counter of consecutive samples differing from its
+ *  debounced level. The counters are held vertically, bit b of every pin's
+ *  counter in one word, so all 32 pins are counted with a handful of bitwise
+ *  operations per sample and no per pin branches. A pin whose counter
+ *  reaches the threshold takes the new level and reports an edge, a sample
+ *  matching the debounced level resets its counter, so a glitch shorter than
+ *  the threshold is never reported.
+ */
+
+#include "debounce.h"
+
+/**
+ * @brief               Prepares a debouncer.
+ * @param[out] debounce The debouncer to set up.
+ * @param pinMask       Bit n set to filter GPIO n. Other pins never report
+ *                      edges.
+ * @param samples       Consecutive samples a new level must be held for,
+ *                      1 to #DEBOUNCE_SAMPLES_MAX. 1 reports every change.
+ * @param levels        The initial debounced levels, usually a GPLEV0 read.
+ * @return              An error from #errStatus. */
+errStatus gpioDebounceInit(tDebounce * debounce, uint32_t pinMask,
+                           uint32_t samples, uint32_t levels)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (debounce == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter debounce was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (samples < 1 || samples > DEBOUNCE_SAMPLES_MAX)
+    {
+        dbgPrint(DBG_INFO, "samples %u is not 1 - %u.", samples, DEBOUNCE_SAMPLES_MAX);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memset(debounce, 0, sizeof(*debounce));
+        debounce->mask = pinMask;
+        debounce->samples = samples;
+        debounce->levels = levels & pinMask;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/**
+ * @brief               Filters one sample of every pin.
+ * @details             Constant work per sample whatever the number of pins
+ *                      or edges. The debounced levels are in
+ *                      tDebounce::levels, so rising edges are
+ *                      changed & levels and falling edges changed & ~levels.
+ * @param debounce      Set up by gpioDebounceInit().
+ * @param levels        The sample, a GPLEV0 value. Pins outside the mask are
+ *                      ignored.
+ * @param[out] changed  Bit n set if GPIO n took a new debounced level.
+ * @return              An error from #errStatus. */
+errStatus gpioDebounceUpdate(tDebounce * debounce, uint32_t levels, uint32_t * changed)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t differs = 0;
+    uint32_t carry = 0;
+    uint32_t reached = 0;
+    uint32_t bit = 0;
+    int plane = 0;
+
+    if (debounce == NULL || changed == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter debounce or changed was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        differs = (levels ^ debounce->levels) & debounce->mask;
+        carry = differs;
+        reached = differs;
+
+        for (plane = 0; plane < DEBOUNCE_COUNTER_BITS; plane++)
+        {
+            /* Clear counters of pins matching their level, add one to the rest */
+            bit = debounce->counter[plane] & differs;
+            debounce->counter[plane] = bit ^ carry;
+            carry &= bit;
+
+            /* Pins whose counter now equals the threshold */
+            reached &= debounce->samples & (0x1u << plane) ?
+                       debounce->counter[plane] : ~debounce->counter[plane];
+        }
+
+        for (plane = 0; plane < DEBOUNCE_COUNTER_BITS; plane++)
+        {
+            debounce->counter[plane] &= ~reached;
+        }
+
+        debounce->levels ^= reached;
+        *changed = reached;
+        rtn = OK;
+    }
+
+    return rtn;
+}
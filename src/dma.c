@@ -0,0 +1,401 @@
+/**
+ * @file
+ *  @brief Contains source for the DMA channels and their pacing.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  A DMA channel is paced by waiting on the DREQ of the PWM or PCM transmit
+ *  FIFO. The FIFO is clocked from PLLD to drain one word per tick, so each
+ *  word a channel writes into it waits one tick.
+ */
+
+#include "dma.h"
+
+/**** Globals ****/
+/** @brief Pointer which will be mmaped to the DMA registers. */
+static volatile uint32_t * gDmaMap = NULL;
+
+/** @brief Bit n set while channel n is open. */
+static uint32_t gDmaChannels = 0;
+
+/** @brief Bit n set while #eWavePacing n is started. */
+static uint32_t gDmaPacers = 0;
+
+/** @brief PWM registers, mapped by gpioPwmSetup(). */
+static volatile uint32_t * gDmaPwmMap = NULL;
+
+/** @brief PCM registers, while pacing with PCM. */
+static volatile uint32_t * gDmaPcmMap = NULL;
+
+/** @brief Set if dmaPaceStart() called gpioPwmSetup() and so cleans it up. */
+static int gDmaOwnsPwm = 0;
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which claims a DMA channel,
+ *                      mapping the DMA registers on first use.
+ * @param channel       0 - #DMA_CHANNEL_MAX. Channels 7 and above are "lite"
+ *                      channels, which is accounted for by keeping every
+ *                      transfer under #DMA_LENGTH_MAX. The firmware and kernel
+ *                      use some channels so this should be configurable by
+ *                      the user.
+ * @param[out] regs     Populated with the channel's registers.
+ * @return              An error from #errStatus. */
+errStatus dmaChannelOpen(int channel, volatile uint32_t ** regs)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+
+    if (regs == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter regs was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (channel < 0 || channel > DMA_CHANNEL_MAX)
+    {
+        dbgPrint(DBG_INFO, "channel %d is out of range.", channel);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gDmaChannels & (0x1 << channel))
+    {
+        dbgPrint(DBG_INFO, "DMA channel %d is already in use.", channel);
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (gDmaMap == NULL &&
+             ((rtn = gpioGetBoard(&board)) != OK ||
+              (rtn = periphMap(board, DMA_BASE_OFFSET, &gDmaMap)) != OK))
+    {
+        dbgPrint(DBG_INFO, "Mapping the DMA registers failed. %s", gpioErrToString(rtn));
+        gDmaMap = NULL;
+    }
+
+    else
+    {
+        gDmaChannels |= 0x1 << channel;
+        *regs = gDmaMap + channel * DMA_CHANNEL_SIZE / sizeof(uint32_t);
+
+        REG_WRITE(DMA_REG(gDmaMap, DMA_ENABLE_OFFSET),
+                  REG_READ(DMA_REG(gDmaMap, DMA_ENABLE_OFFSET)) | (0x1 << channel));
+        dmaChannelStop(*regs);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which stops and releases a channel
+ *                      from dmaChannelOpen(). The registers are unmapped when
+ *                      the last channel is closed.
+ * @param channel       The channel.
+ * @return              An error from #errStatus. */
+errStatus dmaChannelClose(int channel)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (channel < 0 || channel > DMA_CHANNEL_MAX || !(gDmaChannels & (0x1 << channel)))
+    {
+        dbgPrint(DBG_INFO, "DMA channel %d is not open.", channel);
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        dmaChannelStop(gDmaMap + channel * DMA_CHANNEL_SIZE / sizeof(uint32_t));
+        gDmaChannels &= ~(0x1 << channel);
+        rtn = OK;
+
+        if (gDmaChannels == 0)
+        {
+            rtn = periphUnmap(gDmaMap);
+            gDmaMap = NULL;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief                   Internal function which starts a channel on a
+ *                          chain of control blocks.
+ * @param regs              Registers from dmaChannelOpen().
+ * @param controlBlockBus   Bus address of the first, 32 byte aligned, block.
+ * @return                  An error from #errStatus. */
+errStatus dmaChannelStart(volatile uint32_t * regs, uint32_t controlBlockBus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (regs == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter regs was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (controlBlockBus & (sizeof(tDmaControlBlock) - 1))
+    {
+        dbgPrint(DBG_INFO, "Control block 0x%x is not 32 byte aligned.", controlBlockBus);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        REG_WRITE(DMA_REG(regs, DMA_CS_OFFSET), DMA_CS_END | DMA_CS_INT);
+        REG_WRITE(DMA_REG(regs, DMA_DEBUG_OFFSET), DMA_DEBUG_CLEAR);
+        REG_WRITE(DMA_REG(regs, DMA_CONBLK_AD_OFFSET), controlBlockBus);
+        REG_WRITE(DMA_REG(regs, DMA_CS_OFFSET), DMA_CS_WAIT_WRITES |
+                  DMA_CS_PANIC_PRIORITY(15) | DMA_CS_PRIORITY(8) | DMA_CS_ACTIVE);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which stops a channel, letting the
+ *                      current transfer finish, and resets it.
+ * @param regs          Registers from dmaChannelOpen().
+ * @return              An error from #errStatus. */
+errStatus dmaChannelStop(volatile uint32_t * regs)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    struct timespec sleepTime = {0, 1000};
+    int polls = 0;
+
+    if (regs == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter regs was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        REG_WRITE(DMA_REG(regs, DMA_CS_OFFSET), DMA_CS_ABORT);
+
+        for (polls = 0; polls < DMA_STOP_POLLS &&
+                        (REG_READ(DMA_REG(regs, DMA_CS_OFFSET)) & DMA_CS_ACTIVE); polls++)
+        {
+            nanosleep(&sleepTime, NULL);
+        }
+
+        REG_WRITE(DMA_REG(regs, DMA_CS_OFFSET), DMA_CS_RESET);
+        REG_WRITE(DMA_REG(regs, DMA_DEBUG_OFFSET), DMA_DEBUG_CLEAR);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which clocks a FIFO to pace DMA at
+ *                      one word per tick.
+ * @details             gpioSetup() must have been called. The clock is PLLD /
+ *                      #DMA_PACE_CLOCK_DIVI, replacing the PWM or PCM clock,
+ *                      so #wavePacePwm can not be used alongside hardware PWM
+ *                      output. gpioPwmSetup() is called if required as it
+ *                      maps the clock manager.
+ * @param pacing        The peripheral.
+ * @param tick_ns       Tick, #WAVE_TICK_NS_MIN to #WAVE_TICK_NS_MAX. It is
+ *                      rounded to whole pacing clocks.
+ * @param[out] achieved_ns  Populated with the tick used.
+ * @return              An error from #errStatus. */
+errStatus dmaPaceStart(eWavePacing pacing, uint32_t tick_ns, uint32_t * achieved_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+    volatile uint32_t * cm = NULL;
+    uint32_t clockHz = 0;
+    uint32_t range = 0;
+
+    if (achieved_ns == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter achieved_ns was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (pacing < wavePacePwm || pacing > wavePacePcm)
+    {
+        dbgPrint(DBG_INFO, "pacing value: %d was out of range.", pacing);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gDmaPacers & (0x1 << pacing))
+    {
+        dbgPrint(DBG_INFO, "pacing %d is already in use.", pacing);
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (tick_ns < WAVE_TICK_NS_MIN || tick_ns > WAVE_TICK_NS_MAX)
+    {
+        dbgPrint(DBG_INFO, "tick_ns %u is out of range.", tick_ns);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetBoard(&board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. Ensure gpioSetup() was called.");
+    }
+
+    else if ((clockHz = board->plldHz / DMA_PACE_CLOCK_DIVI) == 0 ||
+             (range = (uint32_t)(((uint64_t)tick_ns * clockHz + 500000000) / 1000000000)) <
+             DMA_PWM_RANGE_MIN ||
+             (pacing == wavePacePcm &&
+              (range < DMA_PCM_FRAME_MIN || range > DMA_PCM_FRAME_MAX)))
+    {
+        dbgPrint(DBG_INFO, "tick_ns %u is not usable with a %u Hz clock.", tick_ns, clockHz);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gDmaPwmMap == NULL &&
+             (gDmaOwnsPwm = (pwmGetRegisters(&gDmaPwmMap, &cm) == ERROR_NOT_INITIALISED)) &&
+             (rtn = gpioPwmSetup()) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioPwmSetup() failed. %s", gpioErrToString(rtn));
+        gDmaOwnsPwm = 0;
+    }
+
+    else if ((rtn = pwmGetRegisters(&gDmaPwmMap, &cm)) != OK)
+    {
+        dbgPrint(DBG_INFO, "pwmGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if (pacing == wavePacePcm &&
+             (rtn = periphMap(board, PCM_BASE_OFFSET, &gDmaPcmMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "periphMap() failed for PCM. %s", gpioErrToString(rtn));
+        gDmaPcmMap = NULL;
+    }
+
+    else if (pacing == wavePacePwm)
+    {
+        REG_WRITE(DMA_REG(gDmaPwmMap, PWM_CTL_OFFSET), 0);
+
+        if ((rtn = cmStart(CM_PWMCTL_OFFSET, CM_PWMDIV_OFFSET, CM_SRC_PLLD,
+                           DMA_PACE_CLOCK_DIVI << CM_DIVI_SHIFT)) == OK)
+        {
+            /* Channel 1 serialises one FIFO word every range clocks */
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_RNG1_OFFSET), range);
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_DMAC_OFFSET),
+                      PWM_DMAC_ENAB | PWM_DMAC_PANIC(15) | PWM_DMAC_DREQ(15));
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_CTL_OFFSET), PWM_CLRF1);
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_CTL_OFFSET), PWM_USEF1 | PWM_MODE1 | PWM_PWEN1);
+        }
+    }
+
+    else
+    {
+        REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET), 0);
+
+        if ((rtn = cmStart(CM_PCMCTL_OFFSET, CM_PCMDIV_OFFSET, CM_SRC_PLLD,
+                           DMA_PACE_CLOCK_DIVI << CM_DIVI_SHIFT)) == OK)
+        {
+            /* One 8 bit channel per frame, so one FIFO word every range clocks */
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET), PCM_CS_EN);
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_MODE_OFFSET), PCM_MODE_FLEN(range - 1));
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_TXC_OFFSET), PCM_TXC_CH1EN);
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET), PCM_CS_EN | PCM_CS_TXCLR);
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_DREQ_OFFSET),
+                      PCM_DREQ_TX(30) | PCM_DREQ_TX_PANIC(16));
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET), PCM_CS_EN | PCM_CS_DMAEN);
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET),
+                      PCM_CS_EN | PCM_CS_DMAEN | PCM_CS_TXON);
+        }
+
+        else
+        {
+            periphUnmap(gDmaPcmMap);
+            gDmaPcmMap = NULL;
+        }
+    }
+
+    if (rtn == OK)
+    {
+        gDmaPacers |= 0x1 << pacing;
+        *achieved_ns = (uint32_t)((uint64_t)range * 1000000000 / clockHz);
+    }
+
+    else if (gDmaPacers == 0 && gDmaPwmMap != NULL)
+    {
+        gDmaPwmMap = NULL;
+
+        if (gDmaOwnsPwm)
+        {
+            gpioPwmCleanup();
+            gDmaOwnsPwm = 0;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which stops a peripheral started
+ *                      by dmaPaceStart().
+ * @param pacing        The peripheral.
+ * @return              An error from #errStatus. */
+errStatus dmaPaceStop(eWavePacing pacing)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (pacing < wavePacePwm || pacing > wavePacePcm || !(gDmaPacers & (0x1 << pacing)))
+    {
+        dbgPrint(DBG_INFO, "pacing %d is not started.", pacing);
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        if (pacing == wavePacePwm)
+        {
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_CTL_OFFSET), 0);
+            REG_WRITE(DMA_REG(gDmaPwmMap, PWM_DMAC_OFFSET), 0);
+            rtn = cmStop(CM_PWMCTL_OFFSET);
+        }
+
+        else
+        {
+            REG_WRITE(DMA_REG(gDmaPcmMap, PCM_CS_OFFSET), 0);
+            rtn = cmStop(CM_PCMCTL_OFFSET);
+            periphUnmap(gDmaPcmMap);
+            gDmaPcmMap = NULL;
+        }
+
+        gDmaPacers &= ~(0x1 << pacing);
+
+        if (gDmaPacers == 0)
+        {
+            gDmaPwmMap = NULL;
+
+            if (gDmaOwnsPwm)
+            {
+                gpioPwmCleanup();
+                gDmaOwnsPwm = 0;
+            }
+        }
+    }
+
+    return rtn;
+}
@@ -0,0 +1,542 @@
+/**
+ * @file
+ *  @brief Contains source for the quadrature encoder decoder.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A thread samples every encoder from one GPLEV0 read per period. Each
+ *  encoder's previous and current A and B levels index a 16 entry table
+ *  giving -1, 0 or +1, so decoding is a table lookup per encoder with no
+ *  branching on the state. A sample in which no encoder pin changed skips the
+ *  decode, and in encoderSampleEvents mode GPEDS0 is read instead so GPLEV0
+ *  is only read after an edge. The thread publishes each encoder's state
+ *  under a sequence count, so gpioEncoderRead() never blocks the thread and
+ *  retries if it reads while the thread is writing. Edge detection is shared
+ *  with pulse.c through gpioEdgeDetect(), and interrupts the kernel while it
+ *  is enabled, see "Edge Detection and the Kernel" in the usage page.
+ */
+
+#include "encoder.h"
+
+/* Local / internal prototypes */
+static void encoderEdgeDetect(int slot, int enable);
+static void encoderPublish(int slot, const tEncoderChannel * channel);
+static int encoderRebuild(tEncoderChannel * active, int * order, uint32_t * pins,
+                          uint32_t levels);
+static void * encoderThread(void * unused);
+
+/**** Globals ****/
+/** @brief Count to add to a transition (previous A B << 2 | current A B).
+ ** Transitions changing both pins are counted as errors instead, see
+ ** #ENCODER_INVALID_MASK. */
+static const int8_t encoderTable[16] = {
+     0, -1, +1,  0,
+    +1,  0,  0, -1,
+    -1,  0,  0, +1,
+     0, +1, -1,  0,
+};
+
+/** @brief Protects gEncoderConfig. */
+static pthread_mutex_t gEncoderLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Encoders as configured by gpioEncoderAdd(). */
+static tEncoderConfig gEncoderConfig[ENCODER_MAX];
+
+/** @brief Non zero when gEncoderConfig has changes the thread has not seen. */
+static volatile int gEncoderDirty = 0;
+
+/** @brief Last generation handed out, so a reused slot is never mistaken for
+ *  its previous encoder. */
+static uint32_t gEncoderGeneration = 0;
+
+/** @brief State of each encoder as last published by the thread. */
+static tEncoderPublished gEncoderPublished[ENCODER_MAX];
+
+/** @brief What the thread samples. */
+static eEncoderSample gEncoderSample = encoderSampleLevels;
+
+/** @brief Sampling period. */
+static uint32_t gEncoderPeriod_ns = 0;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gEncoderMap = NULL;
+
+/** @brief The sampling thread. */
+static pthread_t gEncoderThread;
+
+/** @brief Non zero while the sampling thread should run. */
+static volatile int gEncoderRunning = 0;
+
+/**
+ * @brief           Starts the encoder sampling thread.
+ * @details         gpioSetup() must have been called. The thread is given
+ *                  SCHED_FIFO priority if permitted, and run only on \p cpu
+ *                  if \p cpu is not negative. The period must be shorter
+ *                  than the time between edges of the fastest encoder, a
+ *                  sample seeing both pins change counts an error.
+ *                  Encoders are added with gpioEncoderAdd().
+ * @param sample    What is read each period.
+ * @param period_ns The sampling period, #ENCODER_PERIOD_MIN_NS to
+ *                  #ENCODER_PERIOD_MAX_NS.
+ * @param cpu       The cpu to run on, or -1 for any.
+ * @return          An error from #errStatus. */
+errStatus gpioEncoderStart(eEncoderSample sample, uint32_t period_ns, int cpu)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gEncoderRunning)
+    {
+        dbgPrint(DBG_INFO, "Encoders are already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (sample != encoderSampleLevels && sample != encoderSampleEvents)
+    {
+        dbgPrint(DBG_INFO, "sample %d is not valid.", sample);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (period_ns < ENCODER_PERIOD_MIN_NS || period_ns > ENCODER_PERIOD_MAX_NS)
+    {
+        dbgPrint(DBG_INFO, "period_ns %u is out of range.", period_ns);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (cpu >= CPU_SETSIZE)
+    {
+        dbgPrint(DBG_INFO, "cpu %d is out of range.", cpu);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetRegisters(&gEncoderMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        memset(gEncoderConfig, 0, sizeof(gEncoderConfig));
+        memset(gEncoderPublished, 0, sizeof(gEncoderPublished));
+        gEncoderSample = sample;
+        gEncoderPeriod_ns = period_ns;
+        gEncoderDirty = 1;
+        gEncoderRunning = 1;
+
+        if ((errno = pthread_create(&gEncoderThread, NULL, encoderThread, NULL)) != 0)
+        {
+            dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+            gEncoderRunning = 0;
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            timeThreadRealtime(gEncoderThread, cpu, "Encoder");
+
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Adds an encoder, decoded from the next sample.
+ * @details             Both pins are made inputs, any pull resistor is left
+ *                      to the caller. The count starts at 0.
+ * @param gpioNumberA   The A channel, GPIO00 - GPIO31.
+ * @param gpioNumberB   The B channel, GPIO00 - GPIO31.
+ * @param[out] encoder  Set to the encoder's handle for gpioEncoderRead().
+ * @return              An error from #errStatus. */
+errStatus gpioEncoderAdd(int gpioNumberA, int gpioNumberB, int * encoder)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t used = 0;
+    int slot = 0;
+    int empty = -1;
+
+    if (!gEncoderRunning)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioEncoderStart() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (encoder == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter encoder was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (gpioNumberA < 0 || gpioNumberA > 31 || gpioNumberB < 0 ||
+             gpioNumberB > 31 || gpioNumberA == gpioNumberB)
+    {
+        dbgPrint(DBG_INFO, "gpioNumberA %d and gpioNumberB %d can not be an encoder.",
+                 gpioNumberA, gpioNumberB);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if ((rtn = gpioSetFunction(gpioNumberA, input)) != OK ||
+             (rtn = gpioSetFunction(gpioNumberB, input)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gEncoderLock);
+
+        for (slot = 0; slot < ENCODER_MAX; slot++)
+        {
+            if (gEncoderConfig[slot].inUse)
+            {
+                used |= 0x1u << gEncoderConfig[slot].pinA | 0x1u << gEncoderConfig[slot].pinB;
+            }
+
+            else if (empty < 0)
+            {
+                empty = slot;
+            }
+        }
+
+        if (used & (0x1u << gpioNumberA | 0x1u << gpioNumberB))
+        {
+            dbgPrint(DBG_INFO, "gpioNumberA %d or gpioNumberB %d is already an encoder.",
+                     gpioNumberA, gpioNumberB);
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if (empty < 0)
+        {
+            dbgPrint(DBG_INFO, "All %d encoders are in use.", ENCODER_MAX);
+            rtn = ERROR_RANGE;
+        }
+
+        else
+        {
+            gEncoderConfig[empty].pinA = gpioNumberA;
+            gEncoderConfig[empty].pinB = gpioNumberB;
+            __atomic_store_n(&gEncoderConfig[empty].generation, ++gEncoderGeneration,
+                             __ATOMIC_RELAXED);
+            gEncoderConfig[empty].inUse = 1;
+            encoderEdgeDetect(empty, 1);
+            gEncoderDirty = 1;
+            *encoder = empty;
+            rtn = OK;
+        }
+
+        pthread_mutex_unlock(&gEncoderLock);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Removes an encoder. Its pins are left as inputs.
+ * @param encoder   As returned by gpioEncoderAdd().
+ * @return          An error from #errStatus. */
+errStatus gpioEncoderRemove(int encoder)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (encoder < 0 || encoder >= ENCODER_MAX || !gEncoderConfig[encoder].inUse)
+    {
+        dbgPrint(DBG_INFO, "encoder %d is not in use.", encoder);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gEncoderLock);
+        encoderEdgeDetect(encoder, 0);
+        gEncoderConfig[encoder].inUse = 0;
+        gEncoderDirty = 1;
+        pthread_mutex_unlock(&gEncoderLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reads an encoder's count and velocity.
+ * @details             Takes no lock, so may be called at any rate from any
+ *                      thread without delaying the sampling thread. Until
+ *                      the thread has sampled a new encoder its state reads
+ *                      as zero.
+ * @param encoder       As returned by gpioEncoderAdd().
+ * @param[out] state    Populated with the encoder's state.
+ * @return              An error from #errStatus. */
+errStatus gpioEncoderRead(int encoder, tEncoderState * state)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tEncoderPublished * published = NULL;
+    uint32_t sequence = 0;
+    uint32_t generation = 0;
+
+    if (state == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter state was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (encoder < 0 || encoder >= ENCODER_MAX || !gEncoderConfig[encoder].inUse)
+    {
+        dbgPrint(DBG_INFO, "encoder %d is not in use.", encoder);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        published = &gEncoderPublished[encoder];
+
+        do
+        {
+            sequence = seqReadBegin(&published->sequence);
+            generation = published->generation;
+            *state = published->state;
+        } while (seqReadRetry(&published->sequence, sequence));
+
+        if (generation != __atomic_load_n(&gEncoderConfig[encoder].generation,
+                                          __ATOMIC_RELAXED))
+        {
+            memset(state, 0, sizeof(*state));
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the sampling thread and removes every encoder.
+ * @return  An error from #errStatus. */
+errStatus gpioEncoderStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    int slot = 0;
+
+    if (!gEncoderRunning)
+    {
+        dbgPrint(DBG_INFO, "Encoders are not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gEncoderRunning = 0;
+        pthread_join(gEncoderThread, NULL);
+
+        pthread_mutex_lock(&gEncoderLock);
+        for (slot = 0; slot < ENCODER_MAX; slot++)
+        {
+            if (gEncoderConfig[slot].inUse)
+            {
+                encoderEdgeDetect(slot, 0);
+                gEncoderConfig[slot].inUse = 0;
+            }
+        }
+        pthread_mutex_unlock(&gEncoderLock);
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function which enables or disables edge
+ *                  detection on an encoder's pins in encoderSampleEvents
+ *                  mode. gEncoderLock must be held.
+ * @param slot      The encoder.
+ * @param enable    Non zero to enable.
+ */
+static void encoderEdgeDetect(int slot, int enable)
+{
+    uint32_t mask = 0x1u << gEncoderConfig[slot].pinA | 0x1u << gEncoderConfig[slot].pinB;
+
+    if (gEncoderSample == encoderSampleEvents)
+    {
+        gpioEdgeDetect(mask, enable);
+    }
+}
+
+
+/**
+ * @brief           Internal function which publishes an encoder's state.
+ * @param slot      The encoder.
+ * @param channel   The thread's state of the encoder.
+ */
+static void encoderPublish(int slot, const tEncoderChannel * channel)
+{
+    tEncoderPublished * published = &gEncoderPublished[slot];
+
+    seqWriteBegin(&published->sequence);
+    published->generation = channel->generation;
+    published->state = channel->state;
+    seqWriteEnd(&published->sequence);
+}
+
+
+/**
+ * @brief               Internal function which takes the configured encoders,
+ *                      starting any new encoder from \p levels.
+ *                      gEncoderLock must be held.
+ * @param active        The thread's state, indexed by slot.
+ * @param[out] order    Populated with the slots in use.
+ * @param[out] pins     Populated with every encoder pin.
+ * @param levels        The latest GPLEV0 sample.
+ * @return              Number of slots in use.
+ */
+static int encoderRebuild(tEncoderChannel * active, int * order, uint32_t * pins,
+                          uint32_t levels)
+{
+    const tEncoderConfig * config = NULL;
+    tEncoderChannel * channel = NULL;
+    int count = 0;
+    int slot = 0;
+
+    *pins = 0;
+
+    for (slot = 0; slot < ENCODER_MAX; slot++)
+    {
+        config = &gEncoderConfig[slot];
+        channel = &active[slot];
+
+        if (!config->inUse)
+        {
+            continue;
+        }
+
+        if (channel->generation != config->generation)
+        {
+            memset(channel, 0, sizeof(*channel));
+            channel->generation = config->generation;
+            channel->pinA = config->pinA;
+            channel->pinB = config->pinB;
+            channel->last = ((levels >> config->pinA) & 0x1) << 1 |
+                            ((levels >> config->pinB) & 0x1);
+            encoderPublish(slot, channel);
+        }
+
+        *pins |= 0x1u << config->pinA | 0x1u << config->pinB;
+        order[count++] = slot;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Internal function run by the sampling thread.
+ * @details Each period reads GPLEV0, or in encoderSampleEvents mode GPEDS0
+ *          and only then GPLEV0, and decodes every encoder if any encoder
+ *          pin changed. Changed encoders are published straight away, every
+ *          encoder once per #ENCODER_VELOCITY_NS with its velocity.
+ * @return  NULL */
+static void * encoderThread(void * unused)
+{
+    tEncoderChannel active[ENCODER_MAX];
+    tEncoderChannel * channel = NULL;
+    int order[ENCODER_MAX];
+    uint32_t pins = 0;
+    uint32_t events = 0;
+    uint32_t levels = REG_READ(ENCODER_GPLEV0);
+    uint32_t previous = levels;
+    uint32_t current = 0;
+    uint32_t transition = 0;
+    uint64_t next = timeNowNs();
+    uint64_t windowStart = next;
+    uint64_t now = 0;
+    int count = 0;
+    int index = 0;
+
+    memset(active, 0, sizeof(active));
+
+    while (gEncoderRunning)
+    {
+        if (gEncoderDirty && pthread_mutex_trylock(&gEncoderLock) == 0)
+        {
+            gEncoderDirty = 0;
+            levels = REG_READ(ENCODER_GPLEV0);
+            count = encoderRebuild(active, order, &pins, levels);
+            pthread_mutex_unlock(&gEncoderLock);
+        }
+
+        if (gEncoderSample == encoderSampleLevels)
+        {
+            levels = REG_READ(ENCODER_GPLEV0);
+        }
+
+        /* Clear before reading levels, so a later edge is seen next period */
+        else if ((events = REG_READ(ENCODER_GPEDS0) & pins) != 0)
+        {
+            REG_WRITE(ENCODER_GPEDS0, events);
+            levels = REG_READ(ENCODER_GPLEV0);
+        }
+
+        if ((levels ^ previous) & pins)
+        {
+            for (index = 0; index < count; index++)
+            {
+                channel = &active[order[index]];
+                current = ((levels >> channel->pinA) & 0x1) << 1 |
+                          ((levels >> channel->pinB) & 0x1);
+
+                if (current != channel->last)
+                {
+                    transition = channel->last << 2 | current;
+                    channel->state.count += encoderTable[transition];
+                    channel->state.errors += (ENCODER_INVALID_MASK >> transition) & 0x1;
+                    channel->last = current;
+                    encoderPublish(order[index], channel);
+                }
+            }
+        }
+
+        previous = levels;
+        now = timeNowNs();
+
+        if (now - windowStart >= ENCODER_VELOCITY_NS)
+        {
+            for (index = 0; index < count; index++)
+            {
+                channel = &active[order[index]];
+                channel->state.velocity = (channel->state.count - channel->windowCount) *
+                                          (int64_t)TIMING_NSEC_IN_SEC /
+                                          (int64_t)(now - windowStart);
+                channel->windowCount = channel->state.count;
+                encoderPublish(order[index], channel);
+            }
+
+            windowStart = now;
+        }
+
+        timeNextPeriod(&next, gEncoderPeriod_ns);
+        timeWaitUntil(next, ENCODER_SPIN_NS);
+    }
+
+    return NULL;
+}
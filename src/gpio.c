@@ -26,101 +26,55 @@
  */
 
 #include "gpio.h"
+#include "board.h"
+#include "periph.h"
+#include "stats.h"
+#include "trace.h"
 
 /* Local / internal prototypes */
 static errStatus gpioValidatePin(int gpioNumber);
 
 /**** Globals ****/
-/** @brief Pointer which will be mmap'd to the GPIO memory in /dev/mem */
+/** @brief Pointer which will be mmap'd to the GPIO memory in /dev/gpiomem or /dev/mem */
 static volatile uint32_t * gGpioMap = NULL;
 
-/** @brief PCB revision that executable is being run on */
-static tPcbRev pcbRev = pcbRevError;
+/** @brief Board table entry for the board the executable is being run on */
+static const tBoard * gBoard = NULL;
+
+/** @brief Serialises read-modify-writes of GPREN0 and GPFEN0, which the
+ ** encoder and pulse threads share. */
+static pthread_mutex_t gGpioEdgeLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Serialises read-modify-writes of the GPFSEL registers, which
+ ** gpioSetFunction() and the drivers using fselWrite() share. */
+static pthread_mutex_t gGpioFselLock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * @brief   Maps the memory used for GPIO access. This function must be called
  *          prior to any of the other GPIO calls.
+ * @details The board is detected first so the GPIO block is mapped at the
+ *          peripheral base of the SoC in use. How it is mapped is selected
+ *          with gpioSetMapMode().
  * @return  An error from #errStatus. */
 errStatus gpioSetup(void)
 {
-    int mem_fd = 0;
     errStatus rtn = ERROR_DEFAULT;
 
-    if ((mem_fd = open("/dev/mem", O_RDWR)) < 0)
+    if (gGpioMap != NULL)
     {
-        dbgPrint(DBG_INFO, "open() failed. /dev/mem. errno %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
+        dbgPrint(DBG_INFO, "gpioSetup was already called.");
+        rtn = ERROR_ALREADY_INITIALISED;
     }
 
-    else if ((gGpioMap = (volatile uint32_t *)mmap(NULL,
-                                                   GPIO_MAP_SIZE,
-                                                   PROT_READ|PROT_WRITE,
-                                                   MAP_SHARED,
-                                                   mem_fd,
-                                                   GPIO_BASE)) == MAP_FAILED)
+    else if ((rtn = boardDetect(&gBoard)) != OK)
     {
-        dbgPrint(DBG_INFO, "mmap() failed. errno: %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
+        dbgPrint(DBG_INFO, "boardDetect() failed. %s", gpioErrToString(rtn));
     }
 
-    /* Close the fd, we have now mapped it */
-    else if (close(mem_fd) != OK)
+    else if ((rtn = periphMap(gBoard, GPIO_BASE_OFFSET, &gGpioMap)) != OK)
     {
-        dbgPrint(DBG_INFO, "close() failed. errno: %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
-    }
-
-    else
-    {
-        FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
-        if (cpuinfo)
-        {
-            char* line = NULL;
-            ssize_t linelen;
-            size_t foo;
-
-            while (((linelen = getline(&line, &foo, cpuinfo)) >= 0))
-            {
-                if (strstr(line, "Revision") == line)
-                {
-                    char* rev = strstr(line, ":");
-                    if (rev)
-                    {
-                        long revision = strtol(rev + 1, NULL, 16);
-
-                        if (revision <= 3)
-                        {
-                            pcbRev = pcbRev1;
-                        }
-                        
-                        else
-                        {
-                            pcbRev = pcbRev2;
-                        }
-                    }
-                }
-            } /* while */
-            if (pcbRev != pcbRevError)
-            {
-                rtn = OK;
-            }
-            else
-            {
-                dbgPrint(DBG_INFO, "did not find revision in cpuinfo.");
-                rtn = ERROR_EXTERNAL;
-            }
-
-            if (line)
-            {
-                free(line);
-            }
-            fclose(cpuinfo);
-        }
-        else
-        {
-            dbgPrint(DBG_INFO, "can't open /proc/cpuinfo. errno: %s.", strerror(errno));
-            rtn = ERROR_EXTERNAL;
-        }
+        dbgPrint(DBG_INFO, "periphMap() failed. %s", gpioErrToString(rtn));
+        gGpioMap = NULL;
     }
 
     return rtn;
@@ -141,17 +95,16 @@ errStatus gpioCleanup(void)
         rtn = ERROR_NULL;
     }
 
-    else if (munmap((void *)gGpioMap, GPIO_MAP_SIZE) != OK)
+    else if ((rtn = periphUnmap(gGpioMap)) != OK)
     {
-        dbgPrint(DBG_INFO, "mummap() failed. errno %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
+        dbgPrint(DBG_INFO, "periphUnmap() failed. %s", gpioErrToString(rtn));
     }
 
     else
     {
         gGpioMap = NULL;
-        rtn = OK;
     }
+
     return rtn;
 }
 
@@ -165,6 +118,9 @@ errStatus gpioSetFunction(int gpioNumber, eFunction function)
 {
     errStatus rtn = ERROR_DEFAULT;
 
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gGpioMap == NULL)
     {
         dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() called successfully.");
@@ -184,16 +140,22 @@ errStatus gpioSetFunction(int gpioNumber, eFunction function)
 
     else
     {
-        /* Clear what ever function bits currently exist - this puts the pin
-         * into input mode.*/
-        *(gGpioMap + (gpioNumber / 10)) &= ~(GPFSEL_BITS << ((gpioNumber % 10) * 3));
+        volatile uint32_t * fsel = gGpioMap + (gpioNumber / 10);
+        uint32_t shift = (gpioNumber % 10) * 3;
 
-        /* Set the three pins for the pin to the desired value */
-        *(gGpioMap + (gpioNumber / 10)) |=  (function << ((gpioNumber % 10) * 3));
+        /* Replace what ever function bits currently exist with the desired
+         * value in a single write so the pin never passes through input. */
+        pthread_mutex_lock(&gGpioFselLock);
+        REG_WRITE(*fsel, (REG_READ(*fsel) & ~(GPFSEL_BITS << shift)) |
+                         ((uint32_t)function << shift));
+        pthread_mutex_unlock(&gGpioFselLock);
 
         rtn = OK;
     }
 
+    TRACE_END("gpioSetFunction", traceStart);
+    STATS_END(statsGpioSetFunction, rtn);
+
     return rtn;
 }
 
@@ -209,6 +171,9 @@ errStatus gpioSetPin(int gpioNumber, eState state)
 {
     errStatus rtn = ERROR_DEFAULT;
 
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gGpioMap == NULL)
     {
        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
@@ -224,7 +189,8 @@ errStatus gpioSetPin(int gpioNumber, eState state)
     {
         /* The offsets are all in bytes. Divide by sizeof uint32_t to allow
          * pointer addition. */
-        GPIO_GPSET0 = 0x1 << gpioNumber;
+        REG_WRITE(GPIO_GPSET0, 0x1 << gpioNumber);
+        TRACE_LEVELS(0x1u << gpioNumber, 0x1u << gpioNumber);
         rtn = OK;
     }
 
@@ -232,7 +198,8 @@ errStatus gpioSetPin(int gpioNumber, eState state)
     {
         /* The offsets are all in bytes. Divide by sizeof uint32_t to allow
          * pointer addition. */
-        GPIO_GPCLR0 = 0x1 << gpioNumber;
+        REG_WRITE(GPIO_GPCLR0, 0x1 << gpioNumber);
+        TRACE_LEVELS(0x1u << gpioNumber, 0);
         rtn = OK;
     }
 
@@ -242,6 +209,9 @@ errStatus gpioSetPin(int gpioNumber, eState state)
        rtn = ERROR_RANGE;
     }
 
+    TRACE_END("gpioSetPin", traceStart);
+    STATS_END(statsGpioSetPin, rtn);
+
     return rtn;
 }
 
@@ -256,6 +226,9 @@ errStatus gpioReadPin(int gpioNumber, eState * state)
 {
     errStatus rtn = ERROR_DEFAULT;
 
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gGpioMap == NULL)
     {
         dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
@@ -276,7 +249,7 @@ errStatus gpioReadPin(int gpioNumber, eState * state)
     else
     {
         /* Check if the appropriate bit is high */
-        if (GPIO_GPLEV0 & (0x1 << gpioNumber))
+        if (REG_READ(GPIO_GPLEV0) & (0x1 << gpioNumber))
         {
             *state = high;
         }
@@ -286,9 +259,124 @@ errStatus gpioReadPin(int gpioNumber, eState * state)
             *state = low;
         }
 
+        TRACE_LEVELS(0x1u << gpioNumber, *state == high ? 0x1u << gpioNumber : 0);
+        rtn = OK;
+    }
+
+    TRACE_END("gpioReadPin", traceStart);
+    STATS_END(statsGpioReadPin, rtn);
+
+    return rtn;
+}
+
+/**
+ * @brief               Sets every pin in \p mask high with a single write.
+ * @details             The pins should be configured as outputs with
+ *                      gpioSetFunction() prior to this.
+ * @param mask          Bit n set drives GPIO n high. Other pins are untouched.
+ * @return              An error from #errStatus. */
+errStatus gpioSetMask(uint32_t mask)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
+    if (gGpioMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (mask & ~gBoard->validPins)
+    {
+        dbgPrint(DBG_INFO, "mask 0x%x contains invalid pins.", mask);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        REG_WRITE(GPIO_GPSET0, mask);
+        TRACE_LEVELS(mask, mask);
         rtn = OK;
     }
 
+    TRACE_END("gpioSetMask", traceStart);
+    STATS_END(statsGpioSetMask, rtn);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Sets every pin in \p mask low with a single write.
+ * @param mask          Bit n set drives GPIO n low. Other pins are untouched.
+ * @return              An error from #errStatus. */
+errStatus gpioClearMask(uint32_t mask)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
+    if (gGpioMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (mask & ~gBoard->validPins)
+    {
+        dbgPrint(DBG_INFO, "mask 0x%x contains invalid pins.", mask);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        REG_WRITE(GPIO_GPCLR0, mask);
+        TRACE_LEVELS(mask, 0);
+        rtn = OK;
+    }
+
+    TRACE_END("gpioClearMask", traceStart);
+    STATS_END(statsGpioClearMask, rtn);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reads the level of GPIO00 to GPIO31 with a single read.
+ * @param[out] levels   Populated with GPLEV0, bit n is the level of GPIO n.
+ * @return              An error from #errStatus. */
+errStatus gpioReadLevels(uint32_t * levels)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
+    if (gGpioMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (levels == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter levels was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        *levels = REG_READ(GPIO_GPLEV0);
+        rtn = OK;
+    }
+
+    TRACE_END("gpioReadLevels", traceStart);
+    STATS_END(statsGpioReadLevels, rtn);
+
     return rtn;
 }
 
@@ -304,6 +392,9 @@ errStatus gpioSetPullResistor(int gpioNumber, eResistor resistorOption)
     errStatus rtn = ERROR_DEFAULT;
     struct timespec sleepTime;
 
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gGpioMap == NULL)
     {
        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
@@ -321,25 +412,42 @@ errStatus gpioSetPullResistor(int gpioNumber, eResistor resistorOption)
        rtn = ERROR_RANGE;
     }
 
+    /* The BCM2711 has a 2 bit field per pin which is written directly */
+    else if (gBoard->pullCtrl == pullCtrlGppuppdn)
+    {
+        uint32_t shift = (gpioNumber % 16) * 2;
+        uint32_t value = resistorOption == pullup   ? GPPUPPDN_PULLUP   :
+                         resistorOption == pulldown ? GPPUPPDN_PULLDOWN :
+                                                      GPPUPPDN_DISABLE;
+        volatile uint32_t * reg = gGpioMap + GPPUPPDN0_OFFSET / sizeof(uint32_t)
+                                           + gpioNumber / 16;
+
+        REG_WRITE(*reg, (REG_READ(*reg) & ~(GPPUPPDN_BITS << shift)) | (value << shift));
+
+        rtn = OK;
+    }
+
     else
     {
         sleepTime.tv_sec  = 0;
         sleepTime.tv_nsec = 1000 * RESISTOR_SLEEP_US;
 
         /* Set the GPPUD register with the desired resistor type */
-        GPIO_GPPUD = resistorOption;
+        REG_WRITE(GPIO_GPPUD, resistorOption);
         /* Wait for control signal to be set up */
         nanosleep(&sleepTime, NULL);
         /* Clock the control signal for desired resistor */
-        GPIO_GPPUDCLK0 = (0x1 << gpioNumber);
+        REG_WRITE(GPIO_GPPUDCLK0, 0x1 << gpioNumber);
         /* Hold to set */
         nanosleep(&sleepTime, NULL);
-        GPIO_GPPUD = 0;
-        GPIO_GPPUDCLK0 = 0;
+        REG_WRITE(GPIO_GPPUD, 0);
+        REG_WRITE(GPIO_GPPUDCLK0, 0);
 
         rtn = OK;
     }
 
+    TRACE_END("gpioSetPullResistor", traceStart);
+    STATS_END(statsGpioSetPullResistor, rtn);
 
     return rtn;
 }
@@ -375,17 +483,77 @@ errStatus gpioGetI2cPins(int * gpioNumberScl, int * gpioNumberSda)
         rtn = ERROR_NULL;
     }
 
-    else if (pcbRev == pcbRev1)
+    else
     {
-        *gpioNumberScl = REV1_SCL;
-        *gpioNumberSda = REV1_SDA;
+        *gpioNumberScl = gBoard->scl;
+        *gpioNumberSda = gBoard->sda;
         rtn = OK;
     }
 
-    else if (pcbRev == pcbRev2)
+    return rtn;
+}
+
+
+/**
+ * @brief               Get the board table entry for the board in use.
+ * @details             The entry holds the peripheral base, valid pins and
+ *                      the BSC wired to the header I2C pins.
+ * @param[out] board    Populated with a pointer to the board table entry.
+ * @return              An error from #errStatus. */
+errStatus gpioGetBoard(const tBoard ** board)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gBoard == NULL)
+    {
+        dbgPrint(DBG_INFO, "gBoard was NULL. Ensure gpioSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (board == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter board is NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
     {
-        *gpioNumberScl = REV2_SCL;
-        *gpioNumberSda = REV2_SDA;
+        *board = gBoard;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief                   Get the mapped GPIO register block.
+ * @details                 For callers which validate their pins once and
+ *                          then access the registers directly, such as
+ *                          rpiGpio.hpp. The pointer is valid until
+ *                          gpioCleanup().
+ * @param[out] gpioRegisters Populated with a pointer to GPFSEL0, the first
+ *                          register of the block.
+ * @return                  An error from #errStatus. */
+errStatus gpioGetRegisters(volatile uint32_t ** gpioRegisters)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gGpioMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (gpioRegisters == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter gpioRegisters is NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        *gpioRegisters = gGpioMap;
         rtn = OK;
     }
 
@@ -418,106 +586,87 @@ const char * gpioErrToString(errStatus error)
 }
 
 
+/****************************** Internal Functions ******************************/
+
 /**
- * @brief            Debug function wrapper for fprintf().
- * @details          Allows file and line information to be added easier
- *                   to output strings. #DBG_INFO is a macro which is useful
- *                   to call as the "first" parameter to this function. Note
- *                   this function will add on a newline to the end of a format
- *                   string so one is generally not required in \p format.
- * @param[in] stream Output stream for strings, e.g. stderr, stdout.
- * @param[in] file   Name of file to be printed. Should be retrieved with __FILE__.
- * @param line       Line number to print. Should be retrieved with __LINE__.
- * @param[in] format Formatted string in the format which printf() would accept.
- * @param ...        Additional arguments - to fill in placeholders in parameter
- *                   \p format.
- * @return           This function uses the printf() family functions and the
- *                   returned integer is what is returned from these calls: If
- *                   successful the number or characters printed is returned,
- *                   if unsuccessful a negative value.
- */
-int dbgPrint(FILE * stream, const char * file, int line, const char * format, ...)
+ * @brief               Internal function which Validates that the pin
+ *                      \p gpioNumber is valid for the Raspberry Pi.
+ * @details             Valid pins are taken from the board table entry found
+ *                      by gpioSetup().
+ * @param gpioNumber    The pin number to check.
+ * @return              An error from #errStatus. */
+static errStatus gpioValidatePin(int gpioNumber)
 {
-    va_list arguments;
-    int rtn = 0;
-    int tempRtn = 0;
+    errStatus rtn = ERROR_INVALID_PIN_NUMBER;
 
-    if (stream != NULL)
+    if (gBoard == NULL)
     {
-        if ((tempRtn = fprintf(stream,"[%s:%d] ", file, line)) < 0)
-        {
-            return tempRtn;
-        }
-        rtn += tempRtn;
-
-        va_start(arguments, format);
-        if ((tempRtn = vfprintf(stream, format, arguments)) < 0)
-        {
-            return tempRtn;
-        }
-        rtn += tempRtn;
-        va_end(arguments);
-
-        if ((tempRtn = fprintf(stream,"\n")) < 0)
-        {
-            return tempRtn;
-        }
-        rtn += tempRtn;
+        rtn = ERROR_RANGE;
+    }
 
+    else if (gpioNumber >= 0 && gpioNumber < 32 &&
+             (gBoard->validPins & (0x1u << gpioNumber)))
+    {
+        rtn = OK;
     }
+
     return rtn;
 }
 
-/****************************** Internal Functions ******************************/
 
 /**
- * @brief               Internal function which Validates that the pin
- *                      \p gpioNumber is valid for the Raspberry Pi.
- * @details             The first time this function is called it will perform
- *                      some basic initalisation on internal variables.
- * @param gpioNumber    The pin number to check.
- * @return              An error from #errStatus. */
-static errStatus gpioValidatePin(int gpioNumber)
+ * @brief           Internal function which enables or disables rising and
+ *                  falling edge detection on pins.
+ * @details         Shared by every module polling GPEDS0, so each only
+ *                  changes its own pins. Disabling also clears any event
+ *                  latched on the pins. While detection is enabled the
+ *                  kernel's GPIO bank interrupt fires on every edge of
+ *                  \p mask, see "Edge Detection and the Kernel" in the
+ *                  usage page.
+ * @param mask      The pins, GPIO00 - GPIO31.
+ * @param enable    Non zero to enable.
+ */
+void gpioEdgeDetect(uint32_t mask, int enable)
 {
-    errStatus rtn = ERROR_INVALID_PIN_NUMBER;
-    int index = 0;
-    /* TODO REV1 and REV2 have the same pincount. REV2 technically has more if 
-     * P5 is supported. If there is a REV3 the size of this array will need to
-     * be addressed. */
-    static uint32_t validPins[REV2_PINCNT] = {0};
-    static uint32_t pinCnt = 0;
-
-    if (pinCnt == 0)
+    pthread_mutex_lock(&gGpioEdgeLock);
+    if (gGpioMap == NULL)
     {
-        if (pcbRev == pcbRevError)
-        {
-            rtn = ERROR_RANGE;
-        }
+        dbgPrint(DBG_INFO, "gGpioMap was NULL. Ensure gpioSetup() was called successfully.");
+    }
 
-        else if (pcbRev == pcbRev1)
-        {
-            const uint32_t validPinsForRev1[REV1_PINCNT] = REV1_PINS;
-            memcpy(validPins, validPinsForRev1, sizeof(validPinsForRev1));
-            pinCnt = REV1_PINCNT;
-        }
-        else if (pcbRev == pcbRev2)
-        {
-            const uint32_t validPinsForRev2[REV2_PINCNT] = REV2_PINS;
-            memcpy(validPins, validPinsForRev2, sizeof(validPinsForRev2));
-            pinCnt = REV2_PINCNT;
-        }
+    else if (enable)
+    {
+        REG_WRITE(GPIO_GPREN0, REG_READ(GPIO_GPREN0) | mask);
+        REG_WRITE(GPIO_GPFEN0, REG_READ(GPIO_GPFEN0) | mask);
     }
 
-    for (index = 0; index < pinCnt; index++)
+    else
     {
-        if (gpioNumber == validPins[index])
-        {
-            rtn = OK;
-            break;
-        }
+        REG_WRITE(GPIO_GPREN0, REG_READ(GPIO_GPREN0) & ~mask);
+        REG_WRITE(GPIO_GPFEN0, REG_READ(GPIO_GPFEN0) & ~mask);
+        REG_WRITE(GPIO_GPEDS0, mask);
     }
+    pthread_mutex_unlock(&gGpioEdgeLock);
+}
 
-    return rtn;
+
+/**
+ * @brief   Internal function which takes the lock on the GPFSEL registers.
+ * @details Held across a read-modify-write, so a driver's thread and a
+ *          gpioSetFunction() call on another pin in the same register
+ *          never lose each other's bits. Released with gpioFselUnlock().
+ */
+void gpioFselLock(void)
+{
+    pthread_mutex_lock(&gGpioFselLock);
 }
 
 
+/**
+ * @brief   Internal function which releases the lock taken by
+ *          gpioFselLock().
+ */
+void gpioFselUnlock(void)
+{
+    pthread_mutex_unlock(&gGpioFselLock);
+}
@@ -22,6 +22,14 @@
  */
 
 #include "i2c.h"
+#include "periph.h"
+#include "stats.h"
+#include "trace.h"
+#include "record.h"
+
+/* Local / internal prototypes */
+static errStatus i2cDivider(uint32_t frequency, uint32_t * divider, int * byteTime_ns);
+static void i2cSleep(const struct timespec * sleepTime);
 
 /** @brief Pointer which will be mmap'd to the I2C memory in /dev/mem */
 static volatile uint32_t * gI2cMap = NULL;
@@ -31,38 +39,25 @@ static int i2cByteTxTime_ns;
 
 /**
  * @brief       Initial setup of I2C functionality.
- * @details     gpioSetup() should be called prior to this.
+ * @details     gpioSetup() should be called prior to this. The BSC used is
+ *              the one the board table lists for the header I2C pins.
  * @return      An error from #errStatus. */
 errStatus gpioI2cSetup(void)
 {
-    int mem_fd = 0;
     int sda;
     int scl;
     errStatus rtn = ERROR_DEFAULT;
-    off_t bscBase;
+    const tBoard * board = NULL;
 
-    if ((rtn = gpioGetI2cPins(&scl, &sda)) != OK)
+    /* The board table holds which BSC is wired to the header I2C pins */
+    if ((rtn = gpioGetBoard(&board)) != OK)
     {
-        dbgPrint(DBG_INFO, "gpioGetI2cPins() failed. %s", gpioErrToString(rtn));
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. %s", gpioErrToString(rtn));
     }
 
-    /* Find the correct BSC to use from I2C pins */
-    else if (sda == REV1_SDA && scl == REV1_SCL)
-    {
-        bscBase = BSC0_BASE;
-    }
-    else if (sda == REV2_SDA && scl == REV2_SCL)
-    {
-        bscBase = BSC1_BASE;
-    }
-    else 
-    {
-        rtn = ERROR_INVALID_PIN_NUMBER;
-    }
-
-    if (rtn != OK)
+    else if ((rtn = gpioGetI2cPins(&scl, &sda)) != OK)
     {
-        dbgPrint(DBG_INFO, "Return was not OK. %s", gpioErrToString(rtn));
+        dbgPrint(DBG_INFO, "gpioGetI2cPins() failed. %s", gpioErrToString(rtn));
     }
 
     else if (gI2cMap != NULL)
@@ -71,29 +66,10 @@ errStatus gpioI2cSetup(void)
         rtn = ERROR_ALREADY_INITIALISED;
     }
 
-    else if ((mem_fd = open("/dev/mem", O_RDWR)) < 0)
+    else if ((rtn = periphMap(board, board->bscOffset, &gI2cMap)) != OK)
     {
-        dbgPrint(DBG_INFO, "open() failed for /dev/mem. errno: %s.",
-                 strerror(errno));
-        rtn = ERROR_EXTERNAL;
-    }
-
-    else if ((gI2cMap = (volatile uint32_t *)mmap(NULL,
-                                                  I2C_MAP_SIZE,
-                                                  PROT_READ|PROT_WRITE,
-                                                  MAP_SHARED,
-                                                  mem_fd,
-                                                  bscBase)) == MAP_FAILED)
-    {
-        dbgPrint(DBG_INFO, "mmap() failed. errno: %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
-    }
-
-    /* Close the fd, we have now mapped it */
-    else if (close(mem_fd) != OK)
-    {
-        dbgPrint(DBG_INFO, "close() failed. errno: %s.", strerror(errno));
-        rtn = ERROR_EXTERNAL;
+        dbgPrint(DBG_INFO, "periphMap() failed. %s", gpioErrToString(rtn));
+        gI2cMap = NULL;
     }
 
     /* There are external Pullup resistors on the Pi. Disable the internals */
@@ -134,13 +110,13 @@ errStatus gpioI2cSetup(void)
         /* Setup the Control Register.
          * Enable the BSC Controller.
          * Clear the FIFO. */
-        I2C_C = BSC_I2CEN | BSC_CLEAR ;
+        REG_WRITE(I2C_C, BSC_I2CEN | BSC_CLEAR);
 
         /* Setup the Status Register
          * Clear NACK ERR flag.
          * Clear Clock stretch flag.
          * Clear Done flag. */
-        I2C_S = BSC_ERR | BSC_CLKT | BSC_DONE;
+        REG_WRITE(I2C_S, BSC_ERR | BSC_CLKT | BSC_DONE);
 
         rtn = OK;
     }
@@ -188,19 +164,17 @@ errStatus gpioI2cCleanup(void)
     else
     {
         /* Disable the BSC Controller */
-        I2C_C &= ~BSC_I2CEN;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) & ~BSC_I2CEN);
 
         /* Unmap the memory */
-        if (munmap((void *)gI2cMap, I2C_MAP_SIZE) != OK)
+        if ((rtn = periphUnmap(gI2cMap)) != OK)
         {
-            dbgPrint(DBG_INFO, "mummap() failed. errno: %s.", strerror(errno));
-            rtn = ERROR_EXTERNAL;
+            dbgPrint(DBG_INFO, "periphUnmap() failed. %s", gpioErrToString(rtn));
         }
 
         else
         {
             gI2cMap = NULL;
-            rtn = OK;
         }
     }
 
@@ -218,6 +192,10 @@ errStatus gpioI2cSet7BitSlave(uint8_t slaveAddress)
 {
     errStatus rtn = ERROR_DEFAULT;
 
+    RECORD_BEGIN();
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gI2cMap == NULL)
     {
         dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
@@ -226,10 +204,14 @@ errStatus gpioI2cSet7BitSlave(uint8_t slaveAddress)
 
     else
     {
-        I2C_A = slaveAddress;
+        REG_WRITE(I2C_A, slaveAddress);
         rtn = OK;
     }
 
+    RECORD_END(i2cRecordAddress, slaveAddress, 0, NULL, 0, rtn);
+    TRACE_END("gpioI2cSet7BitSlave", traceStart);
+    STATS_END(statsI2cSet7BitSlave, rtn);
+
     return rtn;
 }
 
@@ -247,6 +229,10 @@ errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength)
     uint16_t dataRemaining = dataLength;
     struct timespec sleepTime;
 
+    RECORD_BEGIN();
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gI2cMap == NULL)
     {
         dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
@@ -264,27 +250,30 @@ errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength)
         sleepTime.tv_sec  = 0;
 
         /* Clear the FIFO */
-        I2C_C |= BSC_CLEAR;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) | BSC_CLEAR);
 
         /* Configure Control for a write */
-        I2C_C &= ~BSC_READ;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) & ~BSC_READ);
 
         /* Set the Data Length register to dataLength */
-        I2C_DLEN = dataLength;
+        REG_WRITE(I2C_DLEN, dataLength);
 
         /* Configure Control Register for a Start */
-        I2C_C |= BSC_ST;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) | BSC_ST);
 
         /* Main transmit Loop - While Not Done */
-        while (!(I2C_S & BSC_DONE))
+        while (!(REG_READ(I2C_S) & BSC_DONE))
         {
-            while ((I2C_S & BSC_TXD) && dataRemaining)
+            while ((REG_READ(I2C_S) & BSC_TXD) && dataRemaining)
             {
-                I2C_FIFO = data[dataIndex];
+                REG_WRITE(I2C_FIFO, data[dataIndex]);
                 dataIndex++;
                 dataRemaining--;
             }
 
+            TRACE_COUNTER("i2c fifo", dataIndex - (dataLength - REG_READ(I2C_DLEN)));
+            TRACE_COUNTER("i2c remaining", REG_READ(I2C_DLEN));
+
             /* FIFO should be full at this point. If data remaining to be added
              * sleep for time it should take to approximately half empty FIFO */
             if (dataRemaining)
@@ -296,24 +285,24 @@ errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength)
              * bytes are in the FIFO to be transmitted */ /* TODO DOUBLE? */
             else
             {
-                sleepTime.tv_nsec = I2C_DLEN * i2cByteTxTime_ns;
+                sleepTime.tv_nsec = REG_READ(I2C_DLEN) * i2cByteTxTime_ns;
             }
 
-            nanosleep(&sleepTime, NULL);
+            i2cSleep(&sleepTime);
         }
 
         /* Received a NACK */
-        if (I2C_S & BSC_ERR)
+        if (REG_READ(I2C_S) & BSC_ERR)
         {
-            I2C_S |= BSC_ERR;
+            REG_WRITE(I2C_S, BSC_ERR);
             dbgPrint(DBG_INFO, "Received a NACK.");
             rtn = ERROR_I2C_NACK;
         }
 
         /* Received Clock Timeout error */
-        else if (I2C_S & BSC_CLKT)
+        else if (REG_READ(I2C_S) & BSC_CLKT)
         {
-            I2C_S |= BSC_CLKT;
+            REG_WRITE(I2C_S, BSC_CLKT);
             dbgPrint(DBG_INFO, "Received a Clock Stretch Timeout.");
             rtn = ERROR_I2C_CLK_TIMEOUT;
         }
@@ -330,10 +319,15 @@ errStatus gpioI2cWriteData(const uint8_t * data, uint16_t dataLength)
         }
 
         /* Clear the DONE flag */
-        I2C_S |= BSC_DONE;
+        REG_WRITE(I2C_S, BSC_DONE);
 
     }
 
+    RECORD_END(i2cRecordWrite, gI2cMap != NULL ? (uint8_t)REG_READ(I2C_A) : 0, 0,
+               data, dataLength, rtn);
+    TRACE_END("gpioI2cWriteData", traceStart);
+    STATS_END(statsI2cWriteData, rtn);
+
     return rtn;
 }
 
@@ -352,6 +346,10 @@ errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead)
     uint16_t dataRemaining = bytesToRead;
     struct timespec sleepTime;
 
+    RECORD_BEGIN();
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
+
     if (gI2cMap == NULL)
     {
         dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
@@ -369,28 +367,31 @@ errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead)
         sleepTime.tv_sec  = 0;
 
         /* Clear the FIFO */
-        I2C_C |= BSC_CLEAR;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) | BSC_CLEAR);
 
         /* Configure Control for a write */
-        I2C_C |= BSC_READ;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) | BSC_READ);
 
         /* Set the Data Length register to dataLength */
-        I2C_DLEN = bytesToRead;
+        REG_WRITE(I2C_DLEN, bytesToRead);
 
         /* Configure Control Register for a Start */
-        I2C_C |= BSC_ST;
+        REG_WRITE(I2C_C, REG_READ(I2C_C) | BSC_ST);
 
         /* Main Receive Loop - While Transfer is not done */
-        while (!(I2C_S & BSC_DONE))
+        while (!(REG_READ(I2C_S) & BSC_DONE))
         {
             /* FIFO Contains Data. Read until empty */
-            while ((I2C_S & BSC_RXD) && dataRemaining)
+            while ((REG_READ(I2C_S) & BSC_RXD) && dataRemaining)
             {
-                buffer[bufferIndex] = I2C_FIFO;
+                buffer[bufferIndex] = REG_READ(I2C_FIFO);
                 bufferIndex++;
                 dataRemaining--;
             }
 
+            TRACE_COUNTER("i2c fifo", bytesToRead - REG_READ(I2C_DLEN) - bufferIndex);
+            TRACE_COUNTER("i2c remaining", REG_READ(I2C_DLEN));
+
             /* FIFO should be empty at this point. If more than one full FIFO
              * remains to be read sleep for time to approximately half fill
              * FIFO */
@@ -402,36 +403,36 @@ errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead)
             /* Otherwise, sleep for the number of bytes to be received */ /*TODO DOUBLE ?*/
             else
             {
-                sleepTime.tv_nsec = I2C_DLEN * i2cByteTxTime_ns;
+                sleepTime.tv_nsec = REG_READ(I2C_DLEN) * i2cByteTxTime_ns;
             }
 
             /* Sleep for approximate time to receive half the FIFO */
-            sleepTime.tv_nsec = i2cByteTxTime_ns * (I2C_DLEN > BSC_FIFO_SIZE ?
-                                                    BSC_FIFO_SIZE/2 : I2C_DLEN/2);
+            sleepTime.tv_nsec = i2cByteTxTime_ns * (REG_READ(I2C_DLEN) > BSC_FIFO_SIZE ?
+                                                    BSC_FIFO_SIZE/2 : REG_READ(I2C_DLEN)/2);
 
-            nanosleep(&sleepTime, NULL);
+            i2cSleep(&sleepTime);
         }
 
         /* FIFO Contains Data. Read until empty */
-        while ((I2C_S & BSC_RXD) && dataRemaining)
+        while ((REG_READ(I2C_S) & BSC_RXD) && dataRemaining)
         {
-            buffer[bufferIndex] = I2C_FIFO;
+            buffer[bufferIndex] = REG_READ(I2C_FIFO);
             bufferIndex++;
             dataRemaining--;
         }
 
         /* Received a NACK */
-        if (I2C_S & BSC_ERR)
+        if (REG_READ(I2C_S) & BSC_ERR)
         {
-            I2C_S |= BSC_ERR;
+            REG_WRITE(I2C_S, BSC_ERR);
             dbgPrint(DBG_INFO, "Received a NACK");
             rtn = ERROR_I2C_NACK;
         }
 
         /* Received Clock Timeout error. */
-        else if (I2C_S & BSC_CLKT)
+        else if (REG_READ(I2C_S) & BSC_CLKT)
         {
-            I2C_S |= BSC_CLKT;
+            REG_WRITE(I2C_S, BSC_CLKT);
             dbgPrint(DBG_INFO, "Received a Clock Stretch Timeout");
             rtn = ERROR_I2C_CLK_TIMEOUT;
         }
@@ -448,23 +449,119 @@ errStatus gpioI2cReadData(uint8_t * buffer, uint16_t bytesToRead)
         }
 
         /* Clear the DONE flag */
-        I2C_S |= BSC_DONE;
+        REG_WRITE(I2C_S, BSC_DONE);
+
+    }
+
+    RECORD_END(i2cRecordRead, gI2cMap != NULL ? (uint8_t)REG_READ(I2C_A) : 0, 0,
+               buffer, bytesToRead, rtn);
+    TRACE_END("gpioI2cReadData", traceStart);
+    STATS_END(statsI2cReadData, rtn);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Runs several transactions back to back.
+ * @details         Each transaction addresses its slave, writes
+ *                  \p writeLength bytes and then, if \p readLength is non
+ *                  zero, reads \p readLength bytes. The BSC ends the write
+ *                  with a STOP before the read's START. A transaction which
+ *                  fails does not stop the ones after it. The slave address
+ *                  is left as that of the last transaction.
+ * @param[in,out] transfers The transactions, each given its \p status.
+ * @param count     Number of transactions.
+ * @return          OK if every transaction succeeded, otherwise the status of
+ *                  the first that failed. */
+errStatus gpioI2cTransfer(tI2cTransfer * transfers, int count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tI2cTransfer * transfer = NULL;
+    uint8_t none = 0;
+    int index = 0;
+
+    TRACE_BEGIN(traceStart);
+
+    if (gI2cMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (transfers == NULL)
+    {
+        dbgPrint(DBG_INFO, "transfers was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        rtn = OK;
+
+        for (index = 0; index < count; index++)
+        {
+            transfer = &transfers[index];
 
+            if ((transfer->writeLength && transfer->writeData == NULL) ||
+                (transfer->readLength && transfer->readBuffer == NULL))
+            {
+                dbgPrint(DBG_INFO, "Transaction %d has data but a NULL pointer.", index);
+                transfer->status = ERROR_NULL;
+            }
+
+            else
+            {
+                transfer->status = gpioI2cSet7BitSlave(transfer->address);
+
+                /* A transaction with nothing to read still addresses the slave */
+                if (transfer->status == OK && (transfer->writeLength || !transfer->readLength))
+                {
+                    transfer->status = gpioI2cWriteData(transfer->writeLength ?
+                                                        transfer->writeData : &none,
+                                                        transfer->writeLength);
+                }
+
+                if (transfer->status == OK && transfer->readLength)
+                {
+                    transfer->status = gpioI2cReadData(transfer->readBuffer,
+                                                       transfer->readLength);
+                }
+            }
+
+            if (transfer->status != OK && rtn == OK)
+            {
+                rtn = transfer->status;
+            }
+        }
     }
 
+    TRACE_END("gpioI2cTransfer", traceStart);
+
     return rtn;
 }
 
 
 /**
  * @brief           Sets the I2C Clock Frequency
- * @details         @note The desired frequency should be in the range:
+ * @details         The bus runs at or just below \p frequency, see
+ *                  gpioI2cSetTiming(). The data delays are reset to a
+ *                  sixteenth of the new divider, as delays set for a
+ *                  slower clock may exceed half of it. The clock stretch
+ *                  timeout is left as it is.
+ *                  @note The desired frequency should be in the range:
  *                  #I2C_CLOCK_FREQ_MIN <= \p frequency <= #I2C_CLOCK_FREQ_MAX.
  * @param frequency Desired frequency in Hertz.
  * @return          An error from #errStatus */
 errStatus gpioI2cSetClock(int frequency)
 {
     errStatus rtn = ERROR_DEFAULT;
+    uint32_t divider = 0;
+    int byteTime_ns = 0;
+
+    RECORD_BEGIN();
+    STATS_BEGIN();
+    TRACE_BEGIN(traceStart);
 
     /*
      * CDIV = 0 then diviser actually 32768
@@ -474,17 +571,216 @@ errStatus gpioI2cSetClock(int frequency)
         rtn = ERROR_RANGE;
     }
 
+    else if ((rtn = i2cDivider((uint32_t)frequency, &divider, &byteTime_ns)) != OK)
+    {
+        dbgPrint(DBG_INFO, "i2cDivider() failed. %s", gpioErrToString(rtn));
+    }
+
     else
     {
-         /*Note CDIV is always rounded down to an even number */
-        I2C_DIV = CORE_CLK_HZ / frequency;
-        i2cByteTxTime_ns = (int)(1.0 / ((float)frequency / NSEC_IN_SEC)
-                                 * CLOCKS_PER_BYTE);
+        REG_WRITE(I2C_DEL, divider / I2C_DELAY_DIVISOR << BSC_DEL_FEDL_SHIFT |
+                           divider / I2C_DELAY_DIVISOR << BSC_DEL_REDL_SHIFT);
+        REG_WRITE(I2C_DIV, divider);
+        i2cByteTxTime_ns = byteTime_ns;
+        rtn = OK;
+    }
+
+    RECORD_END(i2cRecordClock, 0, (uint32_t)frequency, NULL, 0, rtn);
+    TRACE_END("gpioI2cSetClock", traceStart);
+    STATS_END(statsI2cSetClock, rtn);
+
+    return rtn;
+
+}
+
+
+/**
+ * @brief           Sets the I2C clock, data delays and clock stretch timeout.
+ * @details         The divider is the smallest even one which does not exceed
+ *                  \p timing->frequency with the board's core clock, so the
+ *                  bus runs at or just below the rate asked for. Each data
+ *                  delay must be no more than half the divider.
+ * @param[in] timing    The timing wanted. #I2C_CLOCK_FREQ_MIN <=
+ *                      frequency <= #I2C_CLOCK_FREQ_MAX.
+ * @param[out] achieved Populated with the timing set, may be NULL.
+ * @return          An error from #errStatus. On error the timing is unchanged. */
+errStatus gpioI2cSetTiming(const tI2cTiming * timing, tI2cClock * achieved)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t divider = 0;
+    uint32_t fallingDelay = 0;
+    uint32_t risingDelay = 0;
+    int byteTime_ns = 0;
+
+    RECORD_BEGIN();
+
+    if (gI2cMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (timing == NULL)
+    {
+        dbgPrint(DBG_INFO, "timing was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (timing->frequency < I2C_CLOCK_FREQ_MIN || timing->frequency > I2C_CLOCK_FREQ_MAX)
+    {
+        dbgPrint(DBG_INFO, "frequency %u Hz is out of range.", timing->frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = i2cDivider(timing->frequency, &divider, &byteTime_ns)) != OK)
+    {
+        dbgPrint(DBG_INFO, "i2cDivider() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        fallingDelay = timing->fallingDelay ? timing->fallingDelay :
+                                              divider / I2C_DELAY_DIVISOR;
+        risingDelay = timing->risingDelay ? timing->risingDelay :
+                                            divider / I2C_DELAY_DIVISOR;
+
+        if (fallingDelay > divider / 2 || risingDelay > divider / 2)
+        {
+            dbgPrint(DBG_INFO, "Data delays %u / %u exceed half the divider %u.",
+                     fallingDelay, risingDelay, divider);
+            rtn = ERROR_RANGE;
+        }
+
+        else
+        {
+            /* Nothing is written until everything has been checked */
+            REG_WRITE(I2C_DEL, fallingDelay << BSC_DEL_FEDL_SHIFT |
+                               risingDelay << BSC_DEL_REDL_SHIFT);
+            REG_WRITE(I2C_CLKT, timing->clockStretchTimeout == 0 ? I2C_CLKT_DEFAULT :
+                                timing->clockStretchTimeout == I2C_CLKT_DISABLE ? 0 :
+                                timing->clockStretchTimeout);
+            REG_WRITE(I2C_DIV, divider);
+            i2cByteTxTime_ns = byteTime_ns;
+            rtn = OK;
+        }
+    }
+
+    RECORD_END(i2cRecordTiming, 0, timing != NULL ? timing->frequency : 0,
+               (const uint8_t *)timing, sizeof(*timing), rtn);
+
+    if (rtn == OK && achieved != NULL)
+    {
+        rtn = gpioI2cGetClock(achieved);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Reads back the I2C timing in use.
+ * @details         The frequency and byte time are computed from the divider
+ *                  and the board's core clock. The byte time is that used to
+ *                  pace the transfer loops.
+ * @param[out] clock    Populated with the timing.
+ * @return          An error from #errStatus. */
+errStatus gpioI2cGetClock(tI2cClock * clock)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+    uint32_t delay = 0;
+
+    if (gI2cMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gI2cMap was NULL. Ensure gpioI2cSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (clock == NULL)
+    {
+        dbgPrint(DBG_INFO, "clock was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((rtn = gpioGetBoard(&board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        /* CDIV is rounded down to an even number, 0 is 32768 */
+        clock->divider = REG_READ(I2C_DIV) & BSC_DIV_MAX;
+        clock->divider = clock->divider ? clock->divider : 32768;
+        clock->frequency = board->coreClockHz / clock->divider;
+        clock->byteTime_ns = (uint32_t)((uint64_t)CLOCKS_PER_BYTE * clock->divider *
+                                        NSEC_IN_SEC / board->coreClockHz);
+
+        delay = REG_READ(I2C_DEL);
+        clock->fallingDelay = (delay >> BSC_DEL_FEDL_SHIFT) & BSC_DEL_MAX;
+        clock->risingDelay = (delay >> BSC_DEL_REDL_SHIFT) & BSC_DEL_MAX;
+        clock->clockStretchTimeout = REG_READ(I2C_CLKT) & BSC_CLKT_MAX;
 
         rtn = OK;
     }
 
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which finds the smallest even
+ *                      divider giving at most \p frequency.
+ * @param frequency     The SCL frequency wanted (Hertz), non zero.
+ * @param[out] divider  Populated with the divider.
+ * @param[out] byteTime_ns  Populated with the time to clock a byte and its
+ *                      ACK with the divider.
+ * @return              An error from #errStatus. */
+static errStatus i2cDivider(uint32_t frequency, uint32_t * divider, int * byteTime_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+
+    if ((rtn = gpioGetBoard(&board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        /* Round up, then up again to even, as the BSC drops the low bit */
+        *divider = (board->coreClockHz + frequency - 1) / frequency;
+        *divider = (*divider + 1) & ~0x1u;
+
+        if (*divider < BSC_DIV_MIN)
+        {
+            *divider = BSC_DIV_MIN;
+        }
+
+        else if (*divider > BSC_DIV_MAX)
+        {
+            *divider = BSC_DIV_MAX;
+        }
+
+        *byteTime_ns = (int)((uint64_t)CLOCKS_PER_BYTE * *divider * NSEC_IN_SEC /
+                             board->coreClockHz);
+        rtn = OK;
+    }
 
     return rtn;
+}
+
+
+/**
+ * @brief               Internal function which sleeps while the BSC
+ *                      transfers, traced as its own span.
+ * @param[in] sleepTime How long to sleep. */
+static void i2cSleep(const struct timespec * sleepTime)
+{
+    TRACE_BEGIN(traceStart);
+
+    nanosleep(sleepTime, NULL);
 
+    TRACE_END("i2c sleep", traceStart);
 }
@@ -0,0 +1,80 @@
+/**
+ * @file
+ *  @brief Contains defines for arbiter.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  A batch is sent as one #tArbiterHeader, then a #tArbiterOp per
+ *  transaction, then the bytes each writes. The reply is the header, an
+ *  int32_t status per transaction and then the bytes each read. Both are
+ *  single SOCK_SEQPACKET messages of at most #I2C_ARBITER_MESSAGE bytes.
+ */
+
+#ifndef _ARBITER_H_
+#define _ARBITER_H_
+
+/* For struct ucred */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/** @brief tArbiterHeader::magic, "I2CA". */
+#define ARBITER_MAGIC               0x41433249
+
+/** @brief How often the thread checks it should stop while idle. */
+#define ARBITER_POLL_MS             50
+
+/** @brief Starts a batch and its reply. */
+typedef struct {
+    uint32_t magic;         /**< #ARBITER_MAGIC */
+    uint32_t frequency;     /**< Clock for the batch, 0 to keep the current one */
+    uint16_t count;         /**< Transactions */
+    uint16_t pad;           /**< Zero */
+} tArbiterHeader;
+
+/** @brief One transaction of a batch. */
+typedef struct {
+    uint8_t  address;       /**< 7-bit slave address */
+    uint8_t  pad;           /**< Zero */
+    uint16_t writeLength;   /**< Bytes to write, sent after the last op */
+    uint16_t readLength;    /**< Bytes to read, returned after the statuses */
+    uint16_t pad2;          /**< Zero */
+} tArbiterOp;
+
+/** @brief A connection to the arbiter, as its thread holds it. */
+typedef struct {
+    int      fd;                            /**< Socket, -1 if the slot is free */
+    int      pending;                       /**< Non zero if request holds a batch */
+    uint64_t arrival_ns;                    /**< When the batch was received */
+    size_t   length;                        /**< Bytes of request */
+    uint8_t  request[I2C_ARBITER_MESSAGE];  /**< The batch */
+} tArbiterConn;
+
+#endif /*_ARBITER_H_*/
@@ -0,0 +1,62 @@
+/**
+ * @file
+ *  @brief Contains defines for board.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+#include "rpiGpio.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#ifdef GPIO_SIM
+#include "sim.h"
+#endif
+
+/** @brief File searched for the "Revision" line. */
+#define BOARD_CPUINFO_PATH          "/proc/cpuinfo"
+
+/** @brief Device tree property holding the revision as a big endian word.
+ ** Used if /proc/cpuinfo has no revision line (e.g. some 64 bit kernels). */
+#define BOARD_DT_REVISION_PATH      "/proc/device-tree/system/linux,revision"
+
+/** @brief Bits of the revision code which identify the board. Anything above
+ ** bit 23 are warranty / OTP flags. */
+#define BOARD_REVISION_MASK         0x00FFFFFF
+
+/** @brief Bit set in new style revision codes. */
+#define BOARD_NEW_STYLE             0x00800000
+
+/** @brief Processor field of a new style revision code. */
+#define BOARD_NEW_STYLE_SOC_MASK    0x0000F000
+
+/** @brief Builds a valid pin mask bit for \p pin. */
+#define PIN_BIT(pin)                (0x1u << (pin))
+
+/** @brief GPIO00 to GPIO27 are all routed to the 40 pin J8 header. */
+#define J8_PIN_MASK                 0x0FFFFFFF
+
+errStatus boardDetect(const tBoard ** board);
+
+#endif /*_BOARD_H_*/
@@ -0,0 +1,61 @@
+/**
+ * @file
+ *  @brief Contains defines for capture.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include "rpiGpio.h"
+#include "dma.h"
+#include "reg.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+/** @brief Control blocks per sample: one waiting a tick, one copying GPLEV0. */
+#define CAPTURE_BLOCKS_PER_SAMPLE   2
+
+/** @brief Shortest sleep of the draining thread. */
+#define CAPTURE_POLL_MIN_NS         100000
+
+/** @brief The circular buffer and the draining thread's position in it. */
+typedef struct {
+    uint32_t *    samples;      /**< Both halves, written by the DMA engine */
+    uint32_t *    stamps;       /**< System timer when each half completed */
+    uint32_t *    copy;         /**< A half, copied out before the callback */
+    size_t        half;         /**< Samples per half */
+    uint32_t      half_us;      /**< Time to fill a half */
+    int           next;         /**< Half expected to complete next */
+    int           seen[2];      /**< lastStamp is valid */
+    uint32_t      lastStamp[2]; /**< Stamp of the last completion drained */
+    int           drained;      /**< lastDrained is valid */
+    uint32_t      lastDrained;  /**< Stamp of the last half drained */
+    uint64_t      index;        /**< Capture position of the start of next */
+    tCaptureStats stats;        /**< Counters, guarded by gCaptureLock */
+} tCaptureRing;
+
+#endif /*_CAPTURE_H_*/
@@ -0,0 +1,114 @@
+/**
+ * @file
+ *  @brief Contains defines for dma.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _DMA_H_
+#define _DMA_H_
+
+#include "rpiGpio.h"
+#include "periph.h"
+#include "pwm.h"
+#include "reg.h"
+#include <stdint.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+/** @brief VideoCore mailbox device, used to allocate memory DMA can see. */
+#define MBOX_DEV_PATH               "/dev/vcio"
+
+/** @brief ioctl passing a property message to the VideoCore. */
+#define MBOX_IOCTL_PROPERTY         _IOWR(100, 0, char *)
+
+/** @brief Set in the response code of a message the VideoCore handled. */
+#define MBOX_RESPONSE_OK            0x80000000
+
+/** @brief Mailbox property tags. */
+#define MBOX_TAG_MEM_ALLOC          0x0003000C
+#define MBOX_TAG_MEM_LOCK           0x0003000D
+#define MBOX_TAG_MEM_UNLOCK         0x0003000E
+#define MBOX_TAG_MEM_RELEASE        0x0003000F
+
+/** @brief Words in a mailbox message: header, one tag of up to three words
+ ** and the end tag. */
+#define MBOX_MSG_WORDS              9
+
+/** @brief Allocation flag: uncached, bus alias 0xC0000000. */
+#define MBOX_MEM_DIRECT             0x4
+/** @brief Allocation flag: cached in L2 only, bus alias 0x40000000. The BCM2835
+ ** ARM does not see the L2 so this is coherent with it. */
+#define MBOX_MEM_L1_NONALLOCATING   0xC
+
+/** @brief Physical address, as used with /dev/mem, of bus address \p bus. */
+#define DMA_BUS_TO_PHYS(bus)        ((bus) & ~0xC0000000)
+
+/** @brief Bus address of the peripheral register at \p offset. */
+#define DMA_PERI_BUS(offset)        (PERI_BUS_BASE + (offset))
+
+/** @brief Polls waiting for a channel to abort before resetting it anyway. */
+#define DMA_STOP_POLLS              1000
+
+/** @brief The pacing clock is PLLD / this, 10 MHz on BCM2835 - BCM2837 and
+ ** 15 MHz on BCM2711. An integer divisor keeps every tick the same length. */
+#define DMA_PACE_CLOCK_DIVI         50
+
+/** @brief Longest PCM frame, FLEN + 1, in pacing clocks. */
+#define DMA_PCM_FRAME_MAX           1024
+
+/** @brief Shortest PCM tick in pacing clocks. The 8 bit channel must fit. */
+#define DMA_PCM_FRAME_MIN           8
+
+/** @brief Shortest PWM tick in pacing clocks. */
+#define DMA_PWM_RANGE_MIN           4
+
+/** @brief Bus address of the FIFO pacing with \p pacing. */
+#define DMA_PACE_FIFO(pacing)       ((pacing) == wavePacePwm ?                      \
+                                     DMA_PERI_BUS(PWM_BASE_OFFSET + PWM_FIF1_OFFSET) : \
+                                     DMA_PERI_BUS(PCM_BASE_OFFSET + PCM_FIFO_OFFSET))
+
+/** @brief Transfer information of a block writing words into the FIFO pacing
+ ** with \p pacing, each waiting one tick. */
+#define DMA_PACE_TI(pacing)         (DMA_TI_NO_WIDE_BURSTS | DMA_TI_WAIT_RESP |      \
+                                     DMA_TI_DEST_DREQ |                             \
+                                     DMA_TI_PERMAP((pacing) == wavePacePwm ?        \
+                                                   DMA_DREQ_PWM : DMA_DREQ_PCM_TX))
+
+/** @brief Register at byte \p offset of the block at \p regs. */
+#define DMA_REG(regs, offset)       *((regs) + (offset) / sizeof(uint32_t))
+
+/** @brief Memory shared with the DMA engine. */
+typedef struct {
+    uint32_t handle; /**< VideoCore handle */
+    uint32_t bus;    /**< Bus address, as written into control blocks */
+    void *   virt;   /**< Uncached mapping of the memory */
+    size_t   size;   /**< Bytes, a whole number of pages */
+} tDmaMemory;
+
+errStatus dmaMemAlloc(size_t size, tDmaMemory * memory);
+errStatus dmaMemFree(tDmaMemory * memory);
+errStatus dmaChannelOpen(int channel, volatile uint32_t ** regs);
+errStatus dmaChannelClose(int channel);
+errStatus dmaChannelStart(volatile uint32_t * regs, uint32_t controlBlockBus);
+errStatus dmaChannelStop(volatile uint32_t * regs);
+errStatus dmaPaceStart(eWavePacing pacing, uint32_t tick_ns, uint32_t * achieved_ns);
+errStatus dmaPaceStop(eWavePacing pacing);
+
+#endif /*_DMA_H_*/
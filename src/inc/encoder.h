@@ -0,0 +1,81 @@
+/**
+ * @file
+ *  @brief Contains defines for encoder.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _ENCODER_H_
+#define _ENCODER_H_
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "gpio.h"
+#include "timing.h"
+#include "seqlock.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+/** @brief Waits longer than this sleep until this long before the sample
+ *  then spin. */
+#define ENCODER_SPIN_NS             50000
+
+/** @brief Bit n of this is set if transition n of the decode table changes
+ *  both pins. */
+#define ENCODER_INVALID_MASK        0x1248
+
+/** @brief GPLEV0 register */
+#define ENCODER_GPLEV0      *(gEncoderMap + GPLEV0_OFFSET / sizeof(uint32_t))
+/** @brief GPEDS0 register */
+#define ENCODER_GPEDS0      *(gEncoderMap + GPEDS0_OFFSET / sizeof(uint32_t))
+
+/** @brief An encoder slot as configured by gpioEncoderAdd(). */
+typedef struct {
+    int      inUse;         /**< Non zero if the slot has an encoder */
+    uint32_t generation;    /**< Changed each time the slot is reused */
+    int      pinA;          /**< GPIO of the A channel */
+    int      pinB;          /**< GPIO of the B channel */
+} tEncoderConfig;
+
+/** @brief An encoder's state as published by the thread. */
+typedef struct {
+    uint32_t      sequence;     /**< Odd while being written */
+    uint32_t      generation;   /**< Configuration the state belongs to */
+    tEncoderState state;        /**< The published state */
+} tEncoderPublished;
+
+/** @brief The decoding state of an encoder, private to the thread. */
+typedef struct {
+    uint32_t      generation;   /**< Configuration being decoded */
+    int           pinA;         /**< GPIO of the A channel */
+    int           pinB;         /**< GPIO of the B channel */
+    uint32_t      last;         /**< Previous A << 1 | B */
+    int64_t       windowCount;  /**< count at the start of the window */
+    tEncoderState state;        /**< Working state */
+} tEncoderChannel;
+
+#endif /*_ENCODER_H_*/
@@ -0,0 +1,77 @@
+/**
+ * @file
+ *  @brief Function select changes for many pins at once.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Open drain lines are emulated by switching a pin between an output
+ *  latched low and an input held high by a pull up. Drivers working many
+ *  lines at once collect the pins to switch into masks and apply them here
+ *  with one read-modify-write per GPFSEL register touched, however many
+ *  pins change. The writes are made under the lock gpioSetFunction() takes,
+ *  so a driver's thread never loses a function set on another pin.
+ */
+
+#ifndef _FSEL_H_
+#define _FSEL_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "gpio.h"
+#include <stdint.h>
+
+/** @brief GPFSEL registers holding GPIO00 - GPIO31. */
+#define FSEL_REGS                   4
+
+/**
+ * @brief           Makes \p inputs inputs and \p outputs outputs.
+ * @param gpio      The GPIO registers, from gpioGetRegisters().
+ * @param inputs    Bit n set to make GPIO n an input.
+ * @param outputs   Bit n set to make GPIO n an output. Must not overlap
+ *                  \p inputs.
+ */
+static inline void fselWrite(volatile uint32_t * gpio, uint32_t inputs, uint32_t outputs)
+{
+    uint32_t field[FSEL_REGS] = {0};
+    uint32_t value[FSEL_REGS] = {0};
+    uint32_t pending = 0;
+    uint32_t shift = 0;
+    int pin = 0;
+    int reg = 0;
+
+    for (pending = inputs | outputs; pending; pending &= pending - 1)
+    {
+        pin = __builtin_ctz(pending);
+        reg = pin / 10;
+        shift = (pin % 10) * 3;
+        field[reg] |= GPFSEL_BITS << shift;
+        value[reg] |= ((outputs >> pin) & 0x1) * ((uint32_t)output << shift);
+    }
+
+    gpioFselLock();
+    for (reg = 0; reg < FSEL_REGS; reg++)
+    {
+        if (field[reg])
+        {
+            REG_WRITE(gpio[reg], (REG_READ(gpio[reg]) & ~field[reg]) | value[reg]);
+        }
+    }
+    gpioFselUnlock();
+}
+
+#endif /*_FSEL_H_*/
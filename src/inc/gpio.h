@@ -29,6 +29,7 @@
 #define _GPIO_H_
 
 #include "rpiGpio.h"
+#include "reg.h"
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,10 +39,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <time.h>
-
-/** The size the GPIO mapping is required to be. GPPUDCLK1_OFFSET is the last
- ** register offset of interest. */
-#define GPIO_MAP_SIZE               (GPPUDCLK1_OFFSET)
+#include <pthread.h>
 
 /** Number of GPIO pins which are available on the Raspberry Pi. */
 #define NUMBER_GPIO                 17
@@ -60,6 +58,16 @@
 #define GPIO_GPPUD      *(gGpioMap + GPPUD_OFFSET / sizeof(uint32_t))
 /** @brief GPIO_GPPUDCLK0 register */
 #define GPIO_GPPUDCLK0  *(gGpioMap + GPPUDCLK0_OFFSET / sizeof(uint32_t))
+/** @brief GPIO_GPEDS0 register */
+#define GPIO_GPEDS0     *(gGpioMap + GPEDS0_OFFSET / sizeof(uint32_t))
+/** @brief GPIO_GPREN0 register */
+#define GPIO_GPREN0     *(gGpioMap + GPREN0_OFFSET / sizeof(uint32_t))
+/** @brief GPIO_GPFEN0 register */
+#define GPIO_GPFEN0     *(gGpioMap + GPFEN0_OFFSET / sizeof(uint32_t))
+
+void gpioEdgeDetect(uint32_t mask, int enable);
+void gpioFselLock(void);
+void gpioFselUnlock(void);
 
 #endif /*_GPIO_H_*/
 
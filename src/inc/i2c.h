@@ -29,6 +29,7 @@
 #define _I2C_H_
 
 #include "rpiGpio.h"
+#include "reg.h"
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,9 +40,6 @@
 #include <stdio.h>
 #include <time.h>
 
-/** @brief The size the I2C mapping is required to be. */
-#define I2C_MAP_SIZE                BSC_DEL_OFFSET
-
 /** @brief Default I2C clock frequency (Hertz) */
 #define I2C_DEFAULT_FREQ_HZ         100000
 
@@ -51,6 +49,9 @@
 /** @brief Clock pulses per I2C byte - 8 bits + ACK */
 #define CLOCKS_PER_BYTE             9
 
+/** @brief Default data delays are the divider over this, as Linux uses */
+#define I2C_DELAY_DIVISOR           16
+
 /** @brief BSC_C register */
 #define I2C_C                       *(gI2cMap + BSC_C_OFFSET / sizeof(uint32_t))
 /** @brief BSC_DIV register */
@@ -63,6 +64,10 @@
 #define I2C_S                       *(gI2cMap + BSC_S_OFFSET / sizeof(uint32_t))
 /** @brief BSC_FIFO register */
 #define I2C_FIFO                    *(gI2cMap + BSC_FIFO_OFFSET / sizeof(uint32_t))
+/** @brief BSC_DEL register */
+#define I2C_DEL                     *(gI2cMap + BSC_DEL_OFFSET / sizeof(uint32_t))
+/** @brief BSC_CLKT register */
+#define I2C_CLKT                    *(gI2cMap + BSC_CLKT_OFFSET / sizeof(uint32_t))
 
 
 #endif /*_I2C_H_*/
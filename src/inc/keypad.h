@@ -0,0 +1,50 @@
+/**
+ * @file
+ *  @brief Contains defines for keypad.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _KEYPAD_H_
+#define _KEYPAD_H_
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "fsel.h"
+#include "ring.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+/** @brief Settle waits are short, so always spin. Scans need no precise
+ *  timing, so the thread sleeps between them. */
+#define KEYPAD_SPIN_NS              1000000
+
+/** @brief GPLEV0 register */
+#define KEYPAD_GPLEV0       *(gKeypadMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+#endif /*_KEYPAD_H_*/
@@ -0,0 +1,72 @@
+/**
+ * @file
+ *  @brief Contains defines for led.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LED_H_
+#define _LED_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "wave.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* WS2812 class timing, from the start of a bit cell */
+/** @brief A 0 bit is cleared this long after setting the pins starts. */
+#define LED_T0H_NS                  350
+/** @brief A 0 bit cleared later than this may be read as a 1. */
+#define LED_T0H_LATE_NS             550
+/** @brief A 1 bit is cleared this long after the pins are set. */
+#define LED_T1H_NS                  800
+/** @brief A bit cell. */
+#define LED_CELL_NS                 1250
+/** @brief A cell longer than this has a low long enough to be taken for the
+ *  latch by some parts. */
+#define LED_CELL_LATE_NS            5000
+/** @brief Low time which latches a frame. Newer parts need 280 us. */
+#define LED_RESET_NS                300000
+
+/** @brief Tick of a DMA frame, a third of a cell. */
+#define LED_TICK_NS                 400
+
+/** @brief Low ticks a DMA frame starts with. They fill the pacing FIFO, so
+ *  the first cell is paced. */
+#define LED_LEAD_TICKS              32
+
+/** @brief Bits sent per LED, green, red then blue, MSB first. */
+#define LED_BITS                    24
+
+/** @brief Every wait in a cell is short, so always spin. */
+#define LED_SPIN_NS                 1000000
+
+/** @brief Waits for a DMA frame to finish poll this often. */
+#define LED_POLL_NS                 100000
+
+/** @brief GPSET0 register */
+#define LED_GPSET0          *(gLedMap + GPSET0_OFFSET / sizeof(uint32_t))
+/** @brief GPCLR0 register */
+#define LED_GPCLR0          *(gLedMap + GPCLR0_OFFSET / sizeof(uint32_t))
+
+#endif /*_LED_H_*/
@@ -0,0 +1,72 @@
+/**
+ * @file
+ *  @brief Contains defines for log.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include "rpiGpio.h"
+#include "ring.h"
+#include "timing.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+/** @brief Maximum length of one formatted record, including the newline.
+ ** Longer messages are truncated. */
+#define LOG_RECORD_SIZE             200
+
+/** @brief Number of records the ring holds. Must be a power of two. */
+#define LOG_RING_CAPACITY           256
+
+/** @brief Call sites tracked by each thread's rate limiter. Power of two. */
+#define LOG_RATE_SITES              32
+
+/** @brief Messages allowed from one call site within #LOG_RATE_WINDOW_NS. */
+#define LOG_RATE_BURST              5
+
+/** @brief Rate limiting window. */
+#define LOG_RATE_WINDOW_NS          1000000000ULL
+
+/** @brief How often the drain thread checks the ring. */
+#define LOG_DRAIN_PERIOD_NS         10000000
+
+/** @brief One formatted message waiting to be written. */
+typedef struct {
+    FILE *    stream;                   /**< Stream passed to dbgPrint() */
+    eLogLevel level;                    /**< Level of the message */
+    uint16_t  length;                   /**< Characters in text */
+    char      text[LOG_RECORD_SIZE];    /**< Formatted message */
+} tLogRecord;
+
+/** @brief Rate limiter state of one call site. */
+typedef struct {
+    const char * file;                  /**< __FILE__ of the call site */
+    int          line;                  /**< __LINE__ of the call site */
+    uint64_t     windowStart_ns;        /**< Start of the current window */
+    uint32_t     count;                 /**< Messages in the current window */
+    uint32_t     suppressed;            /**< Messages dropped by the limiter */
+} tLogRateSite;
+
+#endif /*_LOG_H_*/
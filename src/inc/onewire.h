@@ -0,0 +1,79 @@
+/**
+ * @file
+ *  @brief Contains defines for onewire.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _ONEWIRE_H_
+#define _ONEWIRE_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "fsel.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Standard speed timing, from the start of a slot or reset */
+/** @brief A 1 or read slot releases the line after this. */
+#define ONE_WIRE_RELEASE_NS         6000
+/** @brief A read slot samples the line after this. */
+#define ONE_WIRE_SAMPLE_NS          12000
+/** @brief A 1 released or a sample read later than this may be wrong. */
+#define ONE_WIRE_LATE_NS            15000
+/** @brief A 0 slot releases the line after this. */
+#define ONE_WIRE_LOW0_NS            60000
+/** @brief A 0 slot held low longer than this is out of spec. Past
+ ** #ONE_WIRE_RESET_NS devices take it as a reset. */
+#define ONE_WIRE_LOW0_MAX_NS        120000
+/** @brief A slot, including recovery. */
+#define ONE_WIRE_SLOT_NS            70000
+/** @brief A reset holds the line low for this long. */
+#define ONE_WIRE_RESET_NS           480000
+/** @brief Presence is sampled this long after the reset is released. */
+#define ONE_WIRE_PRESENCE_NS        70000
+/** @brief A presence sample later than this may miss the pulse. */
+#define ONE_WIRE_PRESENCE_LATE_NS   75000
+/** @brief From the reset being released to the end of the reset. */
+#define ONE_WIRE_RESET_HIGH_NS      480000
+
+/** @brief Times in a row a search pass with a late slot is run again. */
+#define ONE_WIRE_RETRIES            8
+
+/** @brief Every wait in a slot is short, so always spin. */
+#define ONE_WIRE_SPIN_NS            1000000
+
+/** @brief GPLEV0 register */
+#define ONE_WIRE_GPLEV0     *(gOneWireMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief A bus's part in a search ROM. */
+typedef struct {
+    uint32_t pin;               /**< Pin mask */
+    int      lastDiscrepancy;   /**< Bit, 1 - 64, the last pass branched 0 at */
+    int      lastZero;          /**< Bit this pass branched 0 at */
+    int      done;              /**< Every device found */
+    int      aborted;           /**< No device answered in this pass */
+    uint64_t rom;               /**< ROM being found */
+    uint64_t lastRom;           /**< ROM found by the last pass */
+    int      found;             /**< ROMs stored */
+} tOneWireSearch;
+
+#endif /*_ONEWIRE_H_*/
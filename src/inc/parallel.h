@@ -0,0 +1,56 @@
+/**
+ * @file
+ *  @brief Contains defines for parallel.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/** @brief A read strobe is held this long before the data is sampled, the
+ *  frame memory read access time of common TFT controllers. */
+#define PARALLEL_READ_NS            400
+
+/** @brief Every wait is short, so always spin. */
+#define PARALLEL_SPIN_NS            1000000
+
+/** @brief GPSET0 register */
+#define PARALLEL_GPSET0     *(gParallelMap + GPSET0_OFFSET / sizeof(uint32_t))
+/** @brief GPCLR0 register */
+#define PARALLEL_GPCLR0     *(gParallelMap + GPCLR0_OFFSET / sizeof(uint32_t))
+/** @brief GPLEV0 register */
+#define PARALLEL_GPLEV0     *(gParallelMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief A region of the frame, inclusive. */
+typedef struct {
+    int x0;     /**< First column */
+    int y0;     /**< First row */
+    int x1;     /**< Last column */
+    int y1;     /**< Last row */
+} tParallelRect;
+
+#endif /*_PARALLEL_H_*/
@@ -0,0 +1,45 @@
+/**
+ * @file
+ *  @brief Contains defines for periph.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _PERIPH_H_
+#define _PERIPH_H_
+
+#include "rpiGpio.h"
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+
+/** @brief Device exposing the whole peripheral space. Requires root. */
+#define PERIPH_DEV_MEM              "/dev/mem"
+
+/** @brief Device exposing only the GPIO block. Usable by the gpio group. */
+#define PERIPH_DEV_GPIOMEM          "/dev/gpiomem"
+
+errStatus periphMap(const tBoard * board, uint32_t offset, volatile uint32_t ** map);
+errStatus periphUnmap(volatile uint32_t * map);
+
+#endif /*_PERIPH_H_*/
@@ -0,0 +1,76 @@
+/**
+ * @file
+ *  @brief Contains defines for pulse.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _PULSE_H_
+#define _PULSE_H_
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "gpio.h"
+#include "timing.h"
+#include "seqlock.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+/** @brief Channels are GPIO00 - GPIO31, all sampled from GPLEV0. */
+#define PULSE_CHANNELS              32
+
+/** @brief Waits longer than this sleep until this long before the sample
+ *  then spin. */
+#define PULSE_SPIN_NS               50000
+
+/** @brief GPLEV0 register */
+#define PULSE_GPLEV0        *(gPulseMap + GPLEV0_OFFSET / sizeof(uint32_t))
+/** @brief GPEDS0 register */
+#define PULSE_GPEDS0        *(gPulseMap + GPEDS0_OFFSET / sizeof(uint32_t))
+
+/** @brief A pin's measurement as published by the thread. */
+typedef struct {
+    uint32_t      sequence;     /**< See seqlock.h */
+    uint32_t      generation;   /**< Configuration the measurement belongs to */
+    tPulseMeasure measure;      /**< The published measurement */
+} tPulsePublished;
+
+/** @brief A pin's recent edges, private to the thread. Cycle i starts at
+ ** rise[i] and is high for high[i]. The rings hold window + 1 rising edges,
+ ** so window complete cycles. */
+typedef struct {
+    uint32_t      generation;               /**< Configuration being measured */
+    uint32_t      window;                   /**< Cycles averaged */
+    uint64_t      rise[PULSE_WINDOW_MAX + 1]; /**< Rising edge times */
+    uint64_t      high[PULSE_WINDOW_MAX + 1]; /**< High time of each cycle */
+    uint32_t      newest;                   /**< Ring index of the last rise */
+    uint64_t      rises;                    /**< Rising edges seen */
+    uint64_t      highSum;                  /**< high of the cycles averaged */
+    tPulseMeasure measure;                  /**< Working measurement */
+} tPulseChannel;
+
+#endif /*_PULSE_H_*/
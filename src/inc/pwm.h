@@ -0,0 +1,59 @@
+/**
+ * @file
+ *  @brief Contains defines for pwm.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _PWM_H_
+#define _PWM_H_
+
+#include "rpiGpio.h"
+#include "periph.h"
+#include "reg.h"
+#include <stdint.h>
+#include <time.h>
+
+/** @brief PWM clock selected by gpioPwmSetup(). */
+#define PWM_DEFAULT_CLOCK_HZ        9600000
+
+/** @brief Polls of CM_BUSY before giving up on a clock generator stopping. */
+#define CM_BUSY_POLLS               1000
+
+/** @brief Number of general purpose clocks. */
+#define GPCLK_COUNT                 3
+
+/** @brief PWM register at byte \p offset */
+#define PWM_REG(offset)     *(gPwmMap + (offset) / sizeof(uint32_t))
+/** @brief Clock manager register at byte \p offset */
+#define CM_REG(offset)      *(gCmMap + (offset) / sizeof(uint32_t))
+
+/** @brief A pin which can carry a PWM channel or general purpose clock. */
+typedef struct {
+    int       gpioNumber; /**< The GPIO */
+    int       channel;    /**< PWM channel 0 - 1 or GPCLK 0 - 2 */
+    eFunction function;   /**< Function routing the channel to the GPIO */
+} tPwmPin;
+
+errStatus pwmGetRegisters(volatile uint32_t ** pwm, volatile uint32_t ** cm);
+errStatus cmStop(uint32_t ctlOffset);
+errStatus cmStart(uint32_t ctlOffset, uint32_t divOffset, uint32_t source,
+                  uint32_t divisor);
+
+#endif /*_PWM_H_*/
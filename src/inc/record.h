@@ -0,0 +1,76 @@
+/**
+ * @file
+ *  @brief Contains defines for record.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _RECORD_H_
+#define _RECORD_H_
+
+#include "rpiGpio.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+/** @brief tRecordHeader::magic, "I2CR". */
+#define RECORD_MAGIC                0x52433249
+/** @brief tRecordHeader::version, changed whenever the format changes.
+ *  Version 2 added #i2cRecordTiming, version 1 files replay unchanged. */
+#define RECORD_VERSION              2
+/** @brief stdio buffer of the recording, so most records cost a memcpy. */
+#define RECORD_BUFFER               65536
+/** @brief A timed replay sleeps until this long before each call, then spins. */
+#define RECORD_SPIN_NS              100000
+/** @brief Bytes of the largest write or read, as its length is 16 bits. */
+#define RECORD_DATA_MAX             65536
+
+/** @brief Placed at the top of a recorded function, after the locals. */
+#define RECORD_BEGIN()  uint64_t recordStart_ns = gI2cRecording ? timeNowNs() : 0
+/** @brief Placed before the return of a recorded function. The arguments are
+ *  only evaluated while recording. */
+#define RECORD_END(type, address, frequency, data, length, rtn)                 \
+    do                                                                          \
+    {                                                                           \
+        if (gI2cRecording)                                                      \
+        {                                                                       \
+            recordAdd((type), (address), (frequency), (data), (length), (rtn),  \
+                      recordStart_ns);                                          \
+        }                                                                       \
+    } while (0)
+
+/** @brief Starts a recording file. */
+typedef struct {
+    uint32_t magic;         /**< #RECORD_MAGIC */
+    uint32_t version;       /**< #RECORD_VERSION */
+    uint64_t start_ns;      /**< CLOCK_REALTIME when recording started */
+} tRecordHeader;
+
+/** @brief Non zero while recording. Read by RECORD_BEGIN() and RECORD_END(). */
+extern volatile int gI2cRecording;
+
+void recordAdd(eI2cRecord type, uint8_t address, uint32_t frequency, const uint8_t * data,
+               uint16_t length, errStatus rtn, uint64_t start_ns);
+
+#endif /*_RECORD_H_*/
@@ -0,0 +1,48 @@
+/**
+ * @file
+ *  @brief Contains the register access macros.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Every peripheral register access goes through these macros. On hardware
+ *  they are plain volatile loads and stores. In the simulated build
+ *  (make sim, librpigpiosim.a) they call into sim.c which models the
+ *  peripherals behind the registers.
+ */
+
+#ifndef _REG_H_
+#define _REG_H_
+
+#include <stdint.h>
+
+#ifdef GPIO_SIM
+uint32_t simRegRead(volatile uint32_t * reg);
+void simRegWrite(volatile uint32_t * reg, uint32_t value);
+
+/** @brief Reads the register lvalue \p reg. */
+#define REG_READ(reg)               simRegRead(&(reg))
+/** @brief Writes \p value to the register lvalue \p reg. */
+#define REG_WRITE(reg, value)       simRegWrite(&(reg), (value))
+#else
+/** @brief Reads the register lvalue \p reg. */
+#define REG_READ(reg)               (reg)
+/** @brief Writes \p value to the register lvalue \p reg. */
+#define REG_WRITE(reg, value)       ((reg) = (value))
+#endif
+
+#endif /*_REG_H_*/
@@ -0,0 +1,191 @@
+/**
+ * @file
+ *  @brief Contains a bounded lock free multi producer / multi consumer ring.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  This is Dmitry Vyukov's bounded queue. Each cell carries a sequence number
+ *  which tells producers and consumers whether the cell is theirs, so the only
+ *  contended operation is one compare and swap on the head or tail.
+ *  The ring holds no pointers, only offsets, so it may live in shared memory.
+ */
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/** @brief Assumed cache line size. Head and tail are kept on separate lines. */
+#define RING_CACHE_LINE             64
+
+/** @brief Bytes used by one cell holding an element of \p elemSize bytes. */
+#define RING_CELL_SIZE(elemSize)    ((sizeof(uint32_t) + (elemSize) + 7) & ~7u)
+
+/** @brief Bytes of storage needed for a ring of \p capacity elements. */
+#define RING_BYTES(capacity, elemSize) \
+    (sizeof(tRing) + (capacity) * RING_CELL_SIZE(elemSize))
+
+/** @brief Ring header. Followed in memory by the cells. */
+typedef struct {
+    uint32_t mask;                                      /**< capacity - 1 */
+    uint32_t cellSize;                                  /**< Bytes per cell */
+    uint32_t elemSize;                                  /**< Bytes per element */
+    uint8_t  pad0[RING_CACHE_LINE - 3 * sizeof(uint32_t)];
+    uint32_t head;                                      /**< Next push position */
+    uint8_t  pad1[RING_CACHE_LINE - sizeof(uint32_t)];
+    uint32_t tail;                                      /**< Next pop position */
+    uint8_t  pad2[RING_CACHE_LINE - sizeof(uint32_t)];
+} tRing;
+
+/**
+ * @brief           Returns the sequence number of cell \p index.
+ * @param ring      The ring.
+ * @param index     Cell index, already masked.
+ * @return          Pointer to the sequence number, followed by the element. */
+static inline uint32_t * ringCell(tRing * ring, uint32_t index)
+{
+    return (uint32_t *)((uint8_t *)(ring + 1) + (size_t)index * ring->cellSize);
+}
+
+/**
+ * @brief           Initialises a ring in \p storage.
+ * @param storage   At least RING_BYTES(capacity, elemSize) bytes, 8 byte aligned.
+ * @param capacity  Number of elements. Must be a power of two.
+ * @param elemSize  Size of each element in bytes.
+ * @return          The ring, or NULL if capacity is not a power of two. */
+static inline tRing * ringInit(void * storage, uint32_t capacity, uint32_t elemSize)
+{
+    tRing * ring = (tRing *)storage;
+    uint32_t index = 0;
+
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+    {
+        return NULL;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->mask = capacity - 1;
+    ring->cellSize = RING_CELL_SIZE(elemSize);
+    ring->elemSize = elemSize;
+
+    for (index = 0; index < capacity; index++)
+    {
+        __atomic_store_n(ringCell(ring, index), index, __ATOMIC_RELAXED);
+    }
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    return ring;
+}
+
+/**
+ * @brief           Pushes a copy of \p elem. Safe from any number of threads.
+ * @param ring      The ring.
+ * @param[in] elem  ring->elemSize bytes to push.
+ * @return          1 if pushed, 0 if the ring was full. */
+static inline int ringPush(tRing * ring, const void * elem)
+{
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t * cell = NULL;
+    int32_t diff = 0;
+
+    for (;;)
+    {
+        cell = ringCell(ring, pos & ring->mask);
+        diff = (int32_t)(__atomic_load_n(cell, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+
+        else if (diff < 0)
+        {
+            return 0;
+        }
+
+        else
+        {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(cell + 1, elem, ring->elemSize);
+    __atomic_store_n(cell, pos + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/**
+ * @brief           Pops the oldest element. Safe from any number of threads.
+ * @param ring      The ring.
+ * @param[out] elem ring->elemSize bytes to copy the element into.
+ * @return          1 if an element was popped, 0 if the ring was empty. */
+static inline int ringPop(tRing * ring, void * elem)
+{
+    uint32_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t * cell = NULL;
+    int32_t diff = 0;
+
+    for (;;)
+    {
+        cell = ringCell(ring, pos & ring->mask);
+        diff = (int32_t)(__atomic_load_n(cell, __ATOMIC_ACQUIRE) - (pos + 1));
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+
+        else if (diff < 0)
+        {
+            return 0;
+        }
+
+        else
+        {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    memcpy(elem, cell + 1, ring->elemSize);
+    __atomic_store_n(cell, pos + ring->mask + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
+
+/**
+ * @brief           Approximate number of elements in the ring.
+ * @param ring      The ring.
+ * @return          Elements pushed but not yet popped. */
+static inline uint32_t ringCount(tRing * ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_RELAXED) -
+           __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+}
+
+#endif /*_RING_H_*/
@@ -0,0 +1,80 @@
+/**
+ * @file
+ *  @brief Sequence counts for publishing state to lock free readers.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  One thread writes, any number read. The sequence is odd while the writer
+ *  is updating, so a reader which saw it odd, or saw it change while it
+ *  copied, copies again. The writer never waits for readers.
+ */
+
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+#include <stdint.h>
+
+/**
+ * @brief           Marks the start of an update. Only the writer may call.
+ * @param sequence  The sequence count of the state being updated.
+ */
+static inline void seqWriteBegin(uint32_t * sequence)
+{
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief           Marks the end of an update.
+ * @param sequence  The sequence count of the state updated.
+ */
+static inline void seqWriteEnd(uint32_t * sequence)
+{
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief           Waits for no update to be in progress, before copying.
+ * @param sequence  The sequence count of the state to be copied.
+ * @return          Value to pass to seqReadRetry().
+ */
+static inline uint32_t seqReadBegin(const uint32_t * sequence)
+{
+    uint32_t start = 0;
+
+    while ((start = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 0x1)
+    {
+    }
+
+    return start;
+}
+
+/**
+ * @brief           Checks a copy was not torn by an update.
+ * @param sequence  The sequence count of the state copied.
+ * @param start     As returned by seqReadBegin().
+ * @return          Non zero if the copy must be taken again.
+ */
+static inline int seqReadRetry(const uint32_t * sequence, uint32_t start)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n(sequence, __ATOMIC_RELAXED) != start;
+}
+
+#endif /*_SEQLOCK_H_*/
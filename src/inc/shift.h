@@ -0,0 +1,68 @@
+/**
+ * @file
+ *  @brief Contains defines for shift.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SHIFT_H_
+#define _SHIFT_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/** @brief Most bits shifted through each chain in a pass. */
+#define SHIFT_BITS_MAX              (SHIFT_REGISTERS_MAX * 8)
+
+/** @brief Waits longer than this sleep until this long before the edge then
+ *  spin. */
+#define SHIFT_SPIN_NS               50000
+
+/** @brief GPSET0 register */
+#define SHIFT_GPSET0        *(gShiftMap + GPSET0_OFFSET / sizeof(uint32_t))
+/** @brief GPCLR0 register */
+#define SHIFT_GPCLR0        *(gShiftMap + GPCLR0_OFFSET / sizeof(uint32_t))
+/** @brief GPLEV0 register */
+#define SHIFT_GPLEV0        *(gShiftMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief An open group. */
+typedef struct {
+    int      inUse;                                 /**< Opened */
+    int      chains;                                /**< Chains used */
+    int      registers;                             /**< Registers in each chain */
+    uint32_t clock;                                 /**< Clock pin mask */
+    uint32_t latch;                                 /**< Latch pin mask */
+    uint32_t load;                                  /**< Load pin mask, may be the latch */
+    uint32_t out[SHIFT_CHAINS];                     /**< Data out pin mask of each chain */
+    uint32_t in[SHIFT_CHAINS];                      /**< Data in pin mask of each chain */
+    uint32_t outAll;                                /**< Every data out pin */
+    uint32_t inAll;                                 /**< Every data in pin */
+    uint32_t half_ns;                               /**< Half a clock, 0 if unpaced */
+    int      dirty;                                 /**< Outputs changed since shifted */
+    uint8_t  outputs[SHIFT_CHAINS][SHIFT_REGISTERS_MAX]; /**< Shadow of the outputs */
+    uint8_t  inputs[SHIFT_CHAINS][SHIFT_REGISTERS_MAX];  /**< Inputs of the last pass */
+    uint32_t set[SHIFT_BITS_MAX];                   /**< GPSET0 of each bit, in shift order */
+    uint32_t clear[SHIFT_BITS_MAX];                 /**< GPCLR0 of each bit, with the clock */
+} tShiftGroup;
+
+#endif /*_SHIFT_H_*/
@@ -0,0 +1,129 @@
+/**
+ * @file
+ *  @brief Contains defines for shm.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  The daemon publishes to a segment laid out as #tShmSegment, which
+ *  clients may only read, and takes requests from a second segment, the
+ *  name with #SHM_REQUEST_SUFFIX, laid out as #tShmRequests. Neither holds
+ *  pointers, so they may be mapped at any address in each process.
+ */
+
+#ifndef _SHM_H_
+#define _SHM_H_
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "ring.h"
+#include "seqlock.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** @brief tShmSegment::magic, "RPGS". */
+#define SHM_MAGIC                   0x53475052
+/** @brief tShmSegment::version, changed whenever the layout changes. */
+#define SHM_VERSION                 2
+
+/** @brief Longest segment name, including the leading '/' and
+ ** #SHM_REQUEST_SUFFIX. */
+#define SHM_NAME_LENGTH             64
+
+/** @brief Appended to the segment name to name the request segment. */
+#define SHM_REQUEST_SUFFIX          ".requests"
+
+/** @brief Bytes used by one cell of the request ring. The daemon and
+ ** clients use this, never the geometry in the ring header, which any
+ ** client could overwrite. */
+#define SHM_REQUEST_CELL            RING_CELL_SIZE(sizeof(tShmRequest))
+
+/** @brief A request a client claimed but has not written after this long,
+ ** as if it was killed in between, is skipped so the queue moves on. */
+#define SHM_CLAIM_TIMEOUT_NS        100000000
+
+/** @brief A segment whose snapshot is older than this was left by a daemon
+ ** which is no longer running, so gpioShmStart() may replace it. */
+#define SHM_STALE_NS                1000000000
+
+/** @brief GPLEV0 register */
+#define SHM_GPLEV0          *(gShmMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief What a request asks the daemon to do. */
+typedef enum {
+    shmWrite = 0,       /**< Set and clear pins */
+    shmFunction,        /**< Set a pin's function */
+    shmPull             /**< Set a pin's pull resistor */
+} eShmRequest;
+
+/** @brief An output change queued by a client. */
+typedef struct {
+    uint32_t type;      /**< An #eShmRequest */
+    uint32_t set;       /**< Pins to set, or the GPIO number */
+    uint32_t clear;     /**< Pins to clear, or the function or resistor */
+} tShmRequest;
+
+/** @brief An event and the index it was published at. */
+typedef struct {
+    uint32_t  sequence; /**< Odd while the daemon writes the slot */
+    uint32_t  pad;      /**< Keeps index aligned */
+    uint64_t  index;    /**< Event number, the slot holds index % #SHM_EVENTS */
+    tShmEvent event;    /**< The event */
+} tShmSlot;
+
+/** @brief The segment the daemon publishes to, read only to clients. */
+typedef struct {
+    uint32_t magic;                     /**< #SHM_MAGIC once set up */
+    uint32_t version;                   /**< #SHM_VERSION */
+    uint32_t size;                      /**< sizeof(tShmSegment) */
+    uint32_t period_ns;                 /**< Daemon period */
+    int32_t  pid;                       /**< Process running the daemon */
+    uint8_t  pad0[RING_CACHE_LINE - 5 * sizeof(uint32_t)];
+    uint32_t sequence;                  /**< Seqlock of the snapshot below */
+    uint32_t levels;                    /**< GPLEV0 snapshot */
+    uint64_t time_ns;                   /**< When the snapshot was taken */
+    uint64_t events;                    /**< Events published */
+    uint32_t rejected;                  /**< Requests the daemon refused */
+    uint8_t  pad1[RING_CACHE_LINE - 3 * sizeof(uint32_t) - 2 * sizeof(uint64_t)];
+    tShmSlot slots[SHM_EVENTS];         /**< The latest events */
+} tShmSegment;
+
+/** @brief The segment clients queue requests on. */
+typedef struct {
+    uint32_t magic;                     /**< #SHM_MAGIC once set up */
+    uint32_t version;                   /**< #SHM_VERSION */
+    uint32_t size;                      /**< sizeof(tShmRequests) */
+    uint32_t pad;                       /**< Keeps requests aligned */
+    uint64_t requests[RING_BYTES(SHM_REQUESTS, sizeof(tShmRequest)) / sizeof(uint64_t) + 1];
+                                        /**< Ring of #tShmRequest */
+} tShmRequests;
+
+#endif /*_SHM_H_*/
@@ -0,0 +1,201 @@
+/**
+ * @file
+ *  @brief Contains defines for sim.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include "rpiGpioSim.h"
+#include "reg.h"
+#include "periph.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+/** @brief Size of one simulated peripheral block in bytes. */
+#define SIM_BLOCK_SIZE              4096
+
+/** @brief Number of blocks which may be mapped at once. */
+#define SIM_BLOCK_MAX               16
+
+/** @brief Number of simulated register file devices available. */
+#define SIM_REGISTER_FILES          8
+
+/** @brief DMA memory bus addresses start here, the uncached alias. */
+#define SIM_DMA_BUS_BASE            0xC0000000
+
+/** @brief Number of DMA memory allocations at once. */
+#define SIM_DMA_ALLOCS              8
+
+/** @brief A paced channel runs at most this far ahead of its schedule before
+ ** sleeping, so fast ticks do not need a sleep per word. */
+#define SIM_DMA_AHEAD_NS            1000000
+
+/** @brief Clock pulses per I2C byte - 8 bits + ACK */
+#define CLOCKS_PER_BYTE_SIM         9
+
+/** @brief Number of 7-bit I2C addresses. */
+#define SIM_I2C_ADDRESSES           128
+
+/** @brief Number of I2C buses on GPIO pins, see simI2cAttachPins(). */
+#define SIM_PIN_BUSES               8
+
+/** @brief What a slave on a GPIO pin bus is doing. */
+typedef enum {
+    simPinBusIdle = 0,  /**< Waiting for a START */
+    simPinBusAddress,   /**< Receiving the address byte */
+    simPinBusReceive,   /**< Receiving data from the master */
+    simPinBusAck,       /**< Acknowledging a received byte */
+    simPinBusTransmit,  /**< Sending data to the master */
+    simPinBusMasterAck  /**< Master acknowledging a sent byte */
+} tSimPinBusState;
+
+/** @brief A slave on two GPIO pins, decoded from the pin levels. */
+typedef struct {
+    int             inUse;      /**< Attached */
+    uint32_t        sda;        /**< SDA pin mask */
+    uint32_t        scl;        /**< SCL pin mask */
+    uint8_t         address;    /**< 7-bit address answered */
+    tSimI2cDevice   device;     /**< The slave */
+    tSimPinBusState state;      /**< Position in the transfer */
+    int             read;       /**< Transfer is a read */
+    int             bits;       /**< Bits of byte shifted */
+    uint8_t         byte;       /**< Byte being received or sent */
+    int             masterAck;  /**< Master acknowledged the last byte */
+    int             driveLow;   /**< Slave pulling SDA low */
+    uint32_t        last;       /**< SDA and SCL at the last update */
+} tSimPinBus;
+
+/** @brief Number of simulated 1-Wire devices, see simOneWireAttach(). */
+#define SIM_ONE_WIRE_DEVICES        32
+
+/** @brief A master low for longer than this is a reset. */
+#define SIM_ONE_WIRE_RESET_NS       300000
+
+/** @brief A master low for less than this writes a 1, otherwise a 0. A
+ *  device sending a 0 holds the line low for this long. */
+#define SIM_ONE_WIRE_BIT_NS         30000
+
+/** @brief Length of a device's presence pulse. */
+#define SIM_ONE_WIRE_PRESENCE_NS    120000
+
+/** @brief Bytes in a DS18B20 scratchpad, including its CRC. */
+#define SIM_ONE_WIRE_SCRATCHPAD     9
+
+/** @brief What a 1-Wire device is doing. */
+typedef enum {
+    simOneWireIdle = 0, /**< Waiting for a reset */
+    simOneWireRom,      /**< Receiving a ROM command */
+    simOneWireSearch,   /**< Taking part in a search ROM */
+    simOneWireMatch,    /**< Receiving the ROM of a match ROM */
+    simOneWireFunction, /**< Receiving a function command */
+    simOneWireSend      /**< Sending the scratchpad */
+} tSimOneWireState;
+
+/** @brief A DS18B20 like device on a GPIO pin. */
+typedef struct {
+    int              inUse;         /**< Attached */
+    uint32_t         pin;           /**< Pin mask */
+    uint64_t         rom;           /**< 64-bit ROM code, family code in the low byte */
+    int16_t          temperature;   /**< In 1/16 C */
+    tSimOneWireState state;         /**< Position in the transaction */
+    int              bits;          /**< Bits received or sent in this state */
+    int              phase;         /**< Search: bit, complement, direction */
+    uint64_t         shift;         /**< Bits received, LSB first */
+    uint8_t          send[SIM_ONE_WIRE_SCRATCHPAD]; /**< Bytes being sent */
+    uint64_t         holdUntil_ns;  /**< Holding the line low until */
+} tSimOneWireDevice;
+
+/** @brief Number of simulated shift register chains, see
+ *  simShiftAttachOutputs() and simShiftAttachInputs(). */
+#define SIM_SHIFT_CHAINS            16
+
+/** @brief Most registers in a simulated chain. */
+#define SIM_SHIFT_REGISTERS         32
+
+/** @brief Number of simulated switches, see simSwitchSet(). */
+#define SIM_SWITCHES                64
+
+/** @brief A chain of 74HC595s or of 74HC165s. */
+typedef struct {
+    int      inUse;                     /**< Attached */
+    int      input;                     /**< 74HC165s, otherwise 74HC595s */
+    uint32_t clock;                     /**< SRCLK / CLK pin mask */
+    uint32_t strobe;                    /**< RCLK / SH/LD pin mask */
+    uint32_t data;                      /**< SER / QH pin mask */
+    int      registers;                 /**< Registers in the chain */
+    uint8_t  stage[SIM_SHIFT_REGISTERS * 8]; /**< Shift stages, one per byte */
+    uint8_t  parallel[SIM_SHIFT_REGISTERS];  /**< Latched outputs or inputs */
+} tSimShiftChain;
+
+/** @brief The peripheral a simulated block models. */
+typedef enum {
+    simModelMemory = 0, /**< Plain memory, reads return what was written */
+    simModelGpio,       /**< GPIO block */
+    simModelBsc,        /**< BSC (I2C) block */
+    simModelDma,        /**< DMA channels, see simdma.c */
+    simModelCm,         /**< Clock manager */
+    simModelPwm,        /**< PWM */
+} tSimModel;
+
+/** @brief Clock manager words modelled, the generators up to CM_PWMDIV. Each
+ ** control register is at an even word and its divisor at the next. */
+#define SIM_CM_REGS                 64
+
+/** @brief Reads of a disabled generator's control register which still
+ ** return BUSY, as the generator finishes its cycle. */
+#define SIM_CM_BUSY_READS           2
+
+/** @brief State of a simulated BSC. */
+typedef struct {
+    uint8_t         fifo[BSC_FIFO_SIZE];    /**< Data FIFO */
+    int             fifoHead;               /**< Index of the oldest byte */
+    int             fifoCount;              /**< Bytes in the FIFO */
+    int             active;                 /**< Transfer in progress (TA) */
+    int             addressPhase;           /**< Slave address not yet sent */
+    int             read;                   /**< Transfer is a read */
+    int             stalled;                /**< Waiting on the FIFO */
+    uint32_t        remaining;              /**< Bytes left, read back as DLEN */
+    uint32_t        status;                 /**< DONE, ERR and CLKT bits */
+    uint64_t        byteTime_ns;            /**< Time for 9 SCL periods */
+    uint64_t        nextEvent_ns;           /**< When the next byte completes */
+    tSimI2cDevice * device;                 /**< Addressed slave or NULL */
+} tSimBsc;
+
+/** @brief A simulated peripheral block. */
+typedef struct {
+    uint32_t  regs[SIM_BLOCK_SIZE / sizeof(uint32_t)]; /**< Register storage */
+    uint32_t  offset;                                  /**< Peripheral offset */
+    tSimModel model;                                   /**< What it models */
+    int       mapped;                                  /**< In use */
+    tSimBsc   bsc;                                     /**< BSC state */
+    uint8_t   cmBusyReads[SIM_CM_REGS];                /**< Clock manager reads
+                                                            until BUSY clears */
+} tSimBlock;
+
+uint32_t simRevision(void);
+volatile uint32_t * simPeriphReg(uint32_t offset);
+void simDmaWrite(uint32_t * regs, uint32_t index, uint32_t value);
+
+#endif /*_SIM_H_*/
@@ -0,0 +1,90 @@
+/**
+ * @file
+ *  @brief Contains defines for softi2c.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SOFTI2C_H_
+#define _SOFTI2C_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "fsel.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/** @brief Waits longer than this sleep until this long before the quarter
+ *  clock then spin. */
+#define SOFT_I2C_SPIN_NS            50000
+
+/** @brief Quarters of a clock period. SCL is low at the start of each bit. */
+#define SOFT_I2C_QUARTERS           4
+
+/** @brief The quarter in which SCL has been released and SDA is sampled. */
+#define SOFT_I2C_SAMPLE_QUARTER     2
+
+/** @brief GPLEV0 register */
+#define SOFT_I2C_GPLEV0     *(gSoftI2cMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief Clocks a lane drives, each one bit period long. */
+typedef enum {
+    softI2cOpStart = 0, /**< START, or repeated START */
+    softI2cOpStop,      /**< STOP */
+    softI2cOpBit0,      /**< A 0 bit, or an ACK */
+    softI2cOpBit1,      /**< A 1 bit, a NACK, or SDA released for the slave */
+    softI2cOpIdle,      /**< Both lines released */
+    softI2cOpMax
+} eSoftI2cOp;
+
+/** @brief Where a lane is in its transaction. */
+typedef enum {
+    softI2cStageStart = 0,  /**< Sending START */
+    softI2cStageAddress,    /**< Sending the address byte */
+    softI2cStageWrite,      /**< Sending data */
+    softI2cStageRead,       /**< Receiving data */
+    softI2cStageStop,       /**< Sending STOP */
+    softI2cStageDone        /**< Finished */
+} eSoftI2cStage;
+
+/** @brief An open bus. */
+typedef struct {
+    int      inUse;     /**< Opened */
+    uint32_t sda;       /**< SDA pin mask */
+    uint32_t scl;       /**< SCL pin mask */
+    int      frequency; /**< Clock in Hz */
+} tSoftI2cBus;
+
+/** @brief A transaction being clocked on its bus. */
+typedef struct {
+    tSoftI2cTransfer * transfer;    /**< The caller's transaction */
+    uint32_t           sda;         /**< SDA pin mask */
+    uint32_t           scl;         /**< SCL pin mask */
+    eSoftI2cStage      stage;       /**< Where the transaction is */
+    int                reading;     /**< The address byte selects a read */
+    int                bit;         /**< Bit of the byte, 0 - 7, 8 for the ACK */
+    int                index;       /**< Byte of the write or read */
+    uint8_t            byte;        /**< Byte being sent or received */
+    eSoftI2cOp         op;          /**< This clock */
+    int                sample;      /**< SDA read during this clock */
+} tSoftI2cLane;
+
+#endif /*_SOFTI2C_H_*/
@@ -0,0 +1,69 @@
+/**
+ * @file
+ *  @brief Contains defines for softpwm.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SOFTPWM_H_
+#define _SOFTPWM_H_
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+/** @brief Channels are GPIO00 - GPIO31, all driven through GPSET0 / GPCLR0. */
+#define SOFT_PWM_CHANNELS           32
+
+/** @brief One edge per channel plus the edge at the start of the period. */
+#define SOFT_PWM_EDGES_MAX          (SOFT_PWM_CHANNELS + 1)
+
+/** @brief Waits longer than this sleep until this long before the edge then
+ *  spin, so a slow PWM does not hold a core. */
+#define SOFT_PWM_SPIN_NS            50000
+
+/** @brief GPSET0 register */
+#define SOFT_PWM_GPSET0     *(gSoftPwmMap + GPSET0_OFFSET / sizeof(uint32_t))
+/** @brief GPCLR0 register */
+#define SOFT_PWM_GPCLR0     *(gSoftPwmMap + GPCLR0_OFFSET / sizeof(uint32_t))
+
+/** @brief Pins written at an offset into the period. */
+typedef struct {
+    uint32_t offset_ns; /**< Time from the start of the period */
+    uint32_t setMask;   /**< Written to GPSET0 */
+    uint32_t clearMask; /**< Written to GPCLR0, after GPSET0 */
+} tSoftPwmEdge;
+
+/** @brief Every edge of a period, sorted by offset_ns. */
+typedef struct {
+    tSoftPwmEdge edges[SOFT_PWM_EDGES_MAX]; /**< The edges */
+    int          count;                     /**< Edges in use */
+} tSoftPwmSchedule;
+
+#endif /*_SOFTPWM_H_*/
@@ -0,0 +1,73 @@
+/**
+ * @file
+ *  @brief Contains defines for softspi.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _SOFTSPI_H_
+#define _SOFTSPI_H_
+
+#include "rpiGpio.h"
+#include "reg.h"
+#include "timing.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/** @brief Bytes per lane whose edges are computed before clocking starts. */
+#define SOFT_SPI_CHUNK              32
+
+/** @brief Bits per lane in a chunk. */
+#define SOFT_SPI_CHUNK_BITS         (SOFT_SPI_CHUNK * 8)
+
+/** @brief Waits longer than this sleep until this long before the edge then
+ *  spin. */
+#define SOFT_SPI_SPIN_NS            50000
+
+/** @brief GPSET0 register */
+#define SOFT_SPI_GPSET0     *(gSoftSpiMap + GPSET0_OFFSET / sizeof(uint32_t))
+/** @brief GPCLR0 register */
+#define SOFT_SPI_GPCLR0     *(gSoftSpiMap + GPCLR0_OFFSET / sizeof(uint32_t))
+/** @brief GPLEV0 register */
+#define SOFT_SPI_GPLEV0     *(gSoftSpiMap + GPLEV0_OFFSET / sizeof(uint32_t))
+
+/** @brief The pins an edge drives high and low. */
+typedef struct {
+    uint32_t set;       /**< Written to GPSET0 */
+    uint32_t clear;     /**< Written to GPCLR0, after GPSET0 */
+} tSoftSpiEdge;
+
+/** @brief An open bus. */
+typedef struct {
+    int              inUse;                     /**< Opened */
+    int              lanes;                     /**< Lanes used */
+    uint32_t         sclk;                      /**< SCLK pin mask */
+    uint32_t         mosi[SOFT_SPI_LANES];      /**< MOSI pin mask of each lane */
+    uint32_t         miso[SOFT_SPI_LANES];      /**< MISO pin mask of each lane */
+    uint32_t         mosiAll;                   /**< Every MOSI pin */
+    uint32_t         misoAll;                   /**< Every MISO pin */
+    uint32_t         cs;                        /**< Every chip select pin */
+    int              cpol;                      /**< SCLK idles high */
+    int              cpha;                      /**< Data is sampled on the trailing edge */
+    eSoftSpiBitOrder order;                     /**< Bit order */
+    uint32_t         half_ns;                   /**< Half a clock, 0 if unpaced */
+} tSoftSpiBus;
+
+#endif /*_SOFTSPI_H_*/
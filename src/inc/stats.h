@@ -0,0 +1,47 @@
+/**
+ * @file
+ *  @brief Contains defines for stats.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include "rpiGpio.h"
+#include "timing.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef GPIO_STATS
+/** @brief Placed at the top of an instrumented function, after the locals. */
+#define STATS_BEGIN()           uint64_t statsStart_ns = timeNowNs()
+/** @brief Placed before the return of an instrumented function. */
+#define STATS_END(api, rtn)     statsRecord((api), (rtn), statsStart_ns)
+#else
+/** @brief Compiled out. Build with STATS=1 to enable. */
+#define STATS_BEGIN()
+/** @brief Compiled out. Build with STATS=1 to enable. */
+#define STATS_END(api, rtn)
+#endif
+
+void statsRecord(eStatsApi api, errStatus rtn, uint64_t start_ns);
+
+#endif /*_STATS_H_*/
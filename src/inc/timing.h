@@ -0,0 +1,100 @@
+/**
+ * @file
+ *  @brief Contains timing helpers shared by the library sources.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _TIMING_H_
+#define _TIMING_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+/** @brief nano seconds in a second */
+#define TIMING_NSEC_IN_SEC          1000000000ULL
+
+/**
+ * @brief   Monotonic time in nano seconds.
+ * @details CLOCK_MONOTONIC is served from the vDSO so this does not enter
+ *          the kernel.
+ * @return  Nano seconds since an arbitrary fixed point. */
+static inline uint64_t timeNowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * TIMING_NSEC_IN_SEC + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief           Waits for \p target_ns.
+ * @details         Sleeps until \p spin_ns before, then spins, so a long wait
+ *                  does not hold a core but the wake up is still accurate.
+ * @param target_ns A timeNowNs() value.
+ * @param spin_ns   Time spun for before \p target_ns.
+ */
+static inline void timeWaitUntil(uint64_t target_ns, uint64_t spin_ns)
+{
+    struct timespec wake;
+    uint64_t now = timeNowNs();
+
+    if (target_ns > now + spin_ns)
+    {
+        wake.tv_sec = (target_ns - spin_ns) / TIMING_NSEC_IN_SEC;
+        wake.tv_nsec = (target_ns - spin_ns) % TIMING_NSEC_IN_SEC;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+    }
+
+    while (timeNowNs() < target_ns)
+    {
+    }
+}
+
+/**
+ * @brief               Advances a periodic deadline by one period.
+ * @details             If whole periods have already been missed the
+ *                      deadline restarts from now rather than chasing them
+ *                      with back to back iterations.
+ * @param[in,out] next_ns The deadline, a timeNowNs() value.
+ * @param period_ns     The period.
+ * @return              Non zero if periods were missed.
+ */
+static inline int timeNextPeriod(uint64_t * next_ns, uint64_t period_ns)
+{
+    uint64_t now = timeNowNs();
+    int missed = 0;
+
+    *next_ns += period_ns;
+
+    /* Periods were missed, restart rather than chase them */
+    if (now > *next_ns + period_ns)
+    {
+        *next_ns = now;
+        missed = 1;
+    }
+
+    return missed;
+}
+
+void timeThreadRealtime(pthread_t thread, int cpu, const char * name);
+
+#endif /*_TIMING_H_*/
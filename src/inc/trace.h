@@ -0,0 +1,86 @@
+/**
+ * @file
+ *  @brief Contains defines for trace.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/* For pthread_getname_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "rpiGpio.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Events each thread can hold, later ones are dropped. */
+#define TRACE_EVENTS                32768
+
+#ifdef GPIO_TRACE
+/** @brief Declares \p var, the start of a span, 0 while not tracing. */
+#define TRACE_BEGIN(var)            uint64_t var = gTraceRunning ? timeNowNs() : 0
+/** @brief Ends the span started by TRACE_BEGIN(\p var). */
+#define TRACE_END(name, var)        do { if (var) traceSpan((name), (var)); } while (0)
+/** @brief Records \p value on the counter track \p name. \p value is only
+ *  evaluated while tracing. */
+#define TRACE_COUNTER(name, value)                                              \
+    do { if (gTraceRunning) traceCounter((name), (int64_t)(value)); } while (0)
+/** @brief Records the levels of the pins in \p mask on their counter tracks. */
+#define TRACE_LEVELS(mask, levels)                                              \
+    do { if (gTraceRunning) traceLevels((mask), (levels)); } while (0)
+
+/** @brief Non zero while tracing. */
+extern volatile int gTraceRunning;
+#else
+/** @brief Compiled out. Build with TRACE=1 to enable. */
+#define TRACE_BEGIN(var)
+/** @brief Compiled out. Build with TRACE=1 to enable. */
+#define TRACE_END(name, var)
+/** @brief Compiled out. Build with TRACE=1 to enable. */
+#define TRACE_COUNTER(name, value)
+/** @brief Compiled out. Build with TRACE=1 to enable. */
+#define TRACE_LEVELS(mask, levels)
+#endif
+
+/** @brief What a #tTraceEvent records. */
+typedef enum {
+    traceSpanEvent = 0,     /**< A span, value is its duration */
+    traceCounterEvent       /**< A counter, value is its new value */
+} eTraceEvent;
+
+/** @brief One event in a thread's buffer. */
+typedef struct {
+    uint64_t     time_ns;   /**< Start of the span or time of the counter */
+    int64_t      value;     /**< Duration or counter value */
+    const char * name;      /**< Span or counter track, a string literal */
+    uint32_t     type;      /**< An #eTraceEvent */
+} tTraceEvent;
+
+void traceSpan(const char * name, uint64_t start_ns);
+void traceCounter(const char * name, int64_t value);
+void traceLevels(uint32_t mask, uint32_t levels);
+
+#endif /*_TRACE_H_*/
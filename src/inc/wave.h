@@ -0,0 +1,42 @@
+/**
+ * @file
+ *  @brief Contains defines for wave.c.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _WAVE_H_
+#define _WAVE_H_
+
+#include "rpiGpio.h"
+#include "dma.h"
+#include "reg.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+/** @brief Ticks a single pacing block can wait for. */
+#define WAVE_TICKS_PER_BLOCK        (DMA_LENGTH_MAX / sizeof(uint32_t))
+
+/** @brief Transfer information of a block writing GPSET0 / GPCLR0. */
+#define WAVE_TI_GPIO                (DMA_TI_NO_WIDE_BURSTS | DMA_TI_WAIT_RESP)
+
+errStatus waveGetTick(uint32_t * tick_ns);
+
+#endif /*_WAVE_H_*/
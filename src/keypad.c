@@ -0,0 +1,402 @@
+/**
+ * @file
+ *  @brief Scans a keypad matrix or a row of buttons on a thread.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  Columns are latched low and driven one at a time by making that column
+ *  an output and the others inputs, so an idle column floats and two keys
+ *  pressed in one row never join a high output to a low one. Driving a
+ *  column is one read-modify-write of the GPFSEL register holding the
+ *  columns, a load and a store, and every row is then read with one GPLEV0
+ *  load, so an 8x8 scan is 16 loads and 8 stores. The last column is left
+ *  driven until the next scan.
+ *
+ *  Each scan gives a word of keys, bit column * #KEYPAD_LINES + row set if
+ *  pressed, which is debounced with gpioDebounceUpdate() 32 keys at a time.
+ *  Changed keys are pushed as events onto a lock free ring, so the scanning
+ *  thread never waits for a reader.
+ */
+
+#include "keypad.h"
+
+/* Local / internal prototypes */
+static uint64_t keypadScan(void);
+static void keypadPush(uint64_t changed, uint64_t keys, uint64_t now);
+static void * keypadThread(void * unused);
+
+/**** Globals ****/
+/** @brief The GPIO registers. */
+static volatile uint32_t * gKeypadMap = NULL;
+
+/** @brief The configuration passed to gpioKeypadStart(). */
+static tKeypadConfig gKeypadConfig;
+
+/** @brief Every column pin. */
+static uint32_t gKeypadColumns = 0;
+
+/** @brief Storage for the event ring. */
+static uint64_t gKeypadRingStorage[RING_BYTES(KEYPAD_EVENTS, sizeof(tKeypadEvent)) /
+                                   sizeof(uint64_t) + 1];
+
+/** @brief The event ring, within gKeypadRingStorage. */
+static tRing * gKeypadRing = NULL;
+
+/** @brief Events dropped since the last one pushed. Only used by the thread. */
+static uint32_t gKeypadDropped = 0;
+
+/** @brief Debounced keys, as gpioKeypadGetKeys() returns them. */
+static uint64_t gKeypadKeys = 0;
+
+/** @brief The scanning thread. */
+static pthread_t gKeypadThread;
+
+/** @brief Non zero while the scanning thread should run. */
+static volatile int gKeypadRunning = 0;
+
+/**
+ * @brief           Starts scanning a keypad on a thread.
+ * @details         gpioSetup() must have been called. Columns are latched
+ *                  low and made inputs, rows are made inputs with their pull
+ *                  ups enabled. The thread is given SCHED_FIFO priority if
+ *                  permitted. Functions of other pins sharing a GPFSEL
+ *                  register with the columns must not be changed by
+ *                  another thread while scanning, as with 1-Wire.
+ * @param[in] config The pins, timing and debouncing. Copied.
+ * @return          An error from #errStatus. */
+errStatus gpioKeypadStart(const tKeypadConfig * config)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins = 0;
+    int valid = 1;
+    int index = 0;
+
+    if (gKeypadRunning)
+    {
+        dbgPrint(DBG_INFO, "The keypad is already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (config == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter config was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (config->columns < 0 || config->columns > KEYPAD_LINES ||
+             config->rows < 1 || config->rows > KEYPAD_LINES ||
+             config->period_ns < KEYPAD_PERIOD_MIN_NS || config->period_ns > KEYPAD_PERIOD_MAX_NS ||
+             config->settle_ns > KEYPAD_SETTLE_MAX_NS ||
+             config->samples < 1 || config->samples > DEBOUNCE_SAMPLES_MAX ||
+             config->cpu >= CPU_SETSIZE)
+    {
+        dbgPrint(DBG_INFO, "columns %d, rows %d, period_ns %u, settle_ns %u, samples %u "
+                 "or cpu %d is out of range.", config->columns, config->rows,
+                 config->period_ns, config->settle_ns, config->samples, config->cpu);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        for (index = 0; index < config->columns + config->rows; index++)
+        {
+            int gpioNumber = index < config->columns ? config->gpioNumberColumn[index] :
+                             config->gpioNumberRow[index - config->columns];
+
+            valid &= gpioNumber >= 0 && gpioNumber <= 31 && !(pins & (0x1u << gpioNumber));
+            pins |= 0x1u << (gpioNumber & 0x1F);
+        }
+
+        if (!valid)
+        {
+            dbgPrint(DBG_INFO, "Pins are invalid or repeated.");
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if ((rtn = gpioGetRegisters(&gKeypadMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            gKeypadColumns = 0;
+
+            for (index = 0; index < config->columns; index++)
+            {
+                gKeypadColumns |= 0x1u << config->gpioNumberColumn[index];
+            }
+
+            /* Low is latched before any column becomes an output */
+            if ((rtn = gpioClearMask(gKeypadColumns)) == OK)
+            {
+                fselWrite(gKeypadMap, pins, 0);
+            }
+
+            for (index = 0; index < config->rows && rtn == OK; index++)
+            {
+                rtn = gpioSetPullResistor(config->gpioNumberRow[index], pullup);
+            }
+        }
+
+        if (rtn == OK)
+        {
+            gKeypadConfig = *config;
+            gKeypadRing = ringInit(gKeypadRingStorage, KEYPAD_EVENTS, sizeof(tKeypadEvent));
+            gKeypadDropped = 0;
+            gKeypadKeys = 0;
+            gKeypadRunning = 1;
+
+            if ((errno = pthread_create(&gKeypadThread, NULL, keypadThread, NULL)) != 0)
+            {
+                dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+                gKeypadRunning = 0;
+                rtn = ERROR_EXTERNAL;
+            }
+
+            else
+            {
+                timeThreadRealtime(gKeypadThread, config->cpu, "Keypad");
+            }
+        }
+
+        else if (valid)
+        {
+            dbgPrint(DBG_INFO, "Setting up the pins failed. %s", gpioErrToString(rtn));
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Takes queued key events, oldest first. Never blocks and
+ *                  may be called from any thread.
+ * @param[out] events Filled with up to \p max events.
+ * @param max       Size of \p events.
+ * @param[out] count Set to the events taken, 0 if there were none.
+ * @return          An error from #errStatus. */
+errStatus gpioKeypadRead(tKeypadEvent * events, int max, int * count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gKeypadRing == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioKeypadStart() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (events == NULL || count == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter events or count was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        for (*count = 0; *count < max && ringPop(gKeypadRing, &events[*count]); (*count)++)
+        {
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Gets the keys held down as of the last scan, debounced.
+ * @param[out] keys Bit column * #KEYPAD_LINES + row set for each key held.
+ * @return          An error from #errStatus. */
+errStatus gpioKeypadGetKeys(uint64_t * keys)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gKeypadRing == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioKeypadStart() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (keys == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter keys was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        *keys = __atomic_load_n(&gKeypadKeys, __ATOMIC_RELAXED);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the scanning thread and releases the columns. Events not
+ *          yet read may still be read until the next gpioKeypadStart().
+ * @return  An error from #errStatus. */
+errStatus gpioKeypadStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gKeypadRunning)
+    {
+        dbgPrint(DBG_INFO, "The keypad is not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gKeypadRunning = 0;
+        pthread_join(gKeypadThread, NULL);
+        fselWrite(gKeypadMap, gKeypadColumns, 0);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief   Internal function, drives each column in turn and reads the
+ *          rows.
+ * @return  Bit column * #KEYPAD_LINES + row set for each key pressed,
+ *          before debouncing. */
+static uint64_t keypadScan(void)
+{
+    uint64_t keys = 0;
+    uint32_t low = 0;
+    uint32_t column = 0;
+    int index = 0;
+    int row = 0;
+
+    do
+    {
+        if (gKeypadColumns)
+        {
+            column = 0x1u << gKeypadConfig.gpioNumberColumn[index];
+            fselWrite(gKeypadMap, gKeypadColumns & ~column, column);
+
+            if (gKeypadConfig.settle_ns)
+            {
+                timeWaitUntil(timeNowNs() + gKeypadConfig.settle_ns, KEYPAD_SPIN_NS);
+            }
+        }
+
+        low = ~REG_READ(KEYPAD_GPLEV0);
+
+        for (row = 0; row < gKeypadConfig.rows; row++)
+        {
+            keys |= (uint64_t)((low >> gKeypadConfig.gpioNumberRow[row]) & 0x1) <<
+                    (index * KEYPAD_LINES + row);
+        }
+    }
+    while (++index < gKeypadConfig.columns);
+
+    return keys;
+}
+
+
+/**
+ * @brief           Internal function, queues an event for each changed key.
+ * @param changed   Keys whose debounced state changed.
+ * @param keys      Debounced keys.
+ * @param now       Time of the scan. */
+static void keypadPush(uint64_t changed, uint64_t keys, uint64_t now)
+{
+    tKeypadEvent event;
+    int bit = 0;
+
+    memset(&event, 0, sizeof(event));
+    event.time_ns = now;
+
+    for (; changed; changed &= changed - 1)
+    {
+        bit = __builtin_ctzll(changed);
+        event.column = (uint8_t)(bit / KEYPAD_LINES);
+        event.row = (uint8_t)(bit % KEYPAD_LINES);
+        event.pressed = (uint8_t)((keys >> bit) & 0x1);
+        event.dropped = gKeypadDropped;
+
+        if (ringPush(gKeypadRing, &event))
+        {
+            gKeypadDropped = 0;
+        }
+
+        else
+        {
+            gKeypadDropped++;
+        }
+    }
+}
+
+
+/**
+ * @brief           Internal function, the scanning thread.
+ * @param unused    Unused.
+ * @return          NULL. */
+static void * keypadThread(void * unused)
+{
+    tDebounce debounce[2];
+    uint64_t keys = 0;
+    uint64_t changed = 0;
+    uint64_t next = timeNowNs();
+    uint64_t now = 0;
+    uint32_t half = 0;
+    int index = 0;
+
+    (void)unused;
+
+    for (index = 0; index < 2; index++)
+    {
+        gpioDebounceInit(&debounce[index], 0xFFFFFFFFu, gKeypadConfig.samples, 0);
+    }
+
+    while (gKeypadRunning)
+    {
+        now = timeNowNs();
+        keys = keypadScan();
+        changed = 0;
+
+        /* Columns 4 - 7 are only debounced if present */
+        for (index = 0; index < (gKeypadConfig.columns > 4 ? 2 : 1); index++)
+        {
+            gpioDebounceUpdate(&debounce[index], (uint32_t)(keys >> (index * 32)), &half);
+            changed |= (uint64_t)half << (index * 32);
+        }
+
+        if (changed)
+        {
+            keys = (uint64_t)debounce[1].levels << 32 | debounce[0].levels;
+            __atomic_store_n(&gKeypadKeys, keys, __ATOMIC_RELAXED);
+            keypadPush(changed, keys, now);
+        }
+
+        timeNextPeriod(&next, gKeypadConfig.period_ns);
+        timeWaitUntil(next, 0);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,500 @@
+/**
+ * @file
+ *  @brief Drives strips of WS2812 class addressable LEDs.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  Up to #LED_STRIPS strips on separate pins are driven together, sharing
+ *  every bit cell. A cell sets every strip's pin, clears those sending a 0
+ *  after #LED_T0H_NS and the rest after #LED_T1H_NS, so only the middle
+ *  store depends on the data. Encoding a frame computes that store for
+ *  every cell. Each byte is spread to one bit per byte of a word by a table
+ *  and the strips' words are shifted together, leaving, for each bit, a
+ *  byte of which strips send a 1. A second table maps that byte to the
+ *  strips' pins. A cell then costs a table lookup rather than a loop over
+ *  the strips.
+ */
+
+#include "led.h"
+
+/* Local / internal prototypes */
+static void ledEncode(void);
+static errStatus ledSendSpin(void);
+static errStatus ledSendDma(void);
+
+/**** Globals ****/
+/** @brief Serialises frames and protects the globals below. */
+static pthread_mutex_t gLedLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gLedMap = NULL;
+
+/** @brief Strips opened, 0 if not open. */
+static int gLedStrips = 0;
+
+/** @brief LEDs on each strip. */
+static int gLedCount = 0;
+
+/** @brief Every strip's pin. */
+static uint32_t gLedPins = 0;
+
+/** @brief Bytes sent to each strip, strip after strip, in the order sent. */
+static uint8_t * gLedFrame = NULL;
+
+/** @brief The pins cleared after #LED_T0H_NS in each cell. */
+static uint32_t * gLedCells = NULL;
+
+/** @brief Steps of a DMA frame. */
+static tWaveStep * gLedSteps = NULL;
+
+/** @brief The frame has changed since it was encoded. */
+static int gLedDirty = 0;
+
+/** @brief Bit i of the index moved to bit 8 * i. */
+static uint64_t gLedSpread[256];
+
+/** @brief Pins of the strips set in the index. */
+static uint32_t gLedLanes[256];
+
+/** @brief The next frame may not start before this, so the last latches. */
+static uint64_t gLedLatchNs = 0;
+
+/**
+ * @brief               Opens strips of WS2812 class LEDs, one per pin, all
+ *                      of the same length.
+ * @details             The pins are made outputs, driven low. Every LED is
+ *                      off until set.
+ * @param gpioNumbers   Pin of each strip.
+ * @param strips        Strips, 1 - #LED_STRIPS.
+ * @param leds          LEDs on each strip, 1 - #LED_COUNT_MAX.
+ * @return              An error from #errStatus. */
+errStatus gpioLedOpen(const int * gpioNumbers, int strips, int leds)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins = 0;
+    size_t cells = (size_t)leds * LED_BITS;
+    int valid = 1;
+    int index = 0;
+    int bit = 0;
+
+    pthread_mutex_lock(&gLedLock);
+
+    if (gLedStrips)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen() has already been called.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (gpioNumbers == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter gpioNumbers was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (strips < 1 || strips > LED_STRIPS || leds < 1 || leds > LED_COUNT_MAX)
+    {
+        dbgPrint(DBG_INFO, "strips %d or leds %d is out of range.", strips, leds);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        for (index = 0; index < strips; index++)
+        {
+            valid &= gpioNumbers[index] >= 0 && gpioNumbers[index] <= 31 &&
+                     !(pins & (0x1u << gpioNumbers[index]));
+            pins |= 0x1u << (gpioNumbers[index] & 0x1F);
+        }
+
+        if (!valid)
+        {
+            dbgPrint(DBG_INFO, "Pins are invalid or repeated.");
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if ((rtn = gpioGetRegisters(&gLedMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+        }
+
+        else if ((gLedFrame = calloc((size_t)strips * leds, 3)) == NULL ||
+                 (gLedCells = malloc(cells * sizeof(uint32_t))) == NULL ||
+                 (gLedSteps = malloc((cells * 3 + 2) * sizeof(tWaveStep))) == NULL)
+        {
+            dbgPrint(DBG_INFO, "malloc() failed for %d LEDs.", leds);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        /* Low is latched before the pins become outputs */
+        else if ((rtn = gpioClearMask(pins)) == OK)
+        {
+            for (index = 0; index < strips && rtn == OK; index++)
+            {
+                rtn = gpioSetFunction(gpioNumbers[index], output);
+            }
+        }
+
+        if (rtn == OK)
+        {
+            for (index = 0; index < 256; index++)
+            {
+                gLedSpread[index] = 0;
+                gLedLanes[index] = 0;
+
+                for (bit = 0; bit < 8; bit++)
+                {
+                    gLedSpread[index] |= (uint64_t)((index >> bit) & 0x1) << (bit * 8);
+                    gLedLanes[index] |= bit < strips && (index & (0x1 << bit)) ?
+                                        0x1u << gpioNumbers[bit] : 0;
+                }
+            }
+
+            gLedStrips = strips;
+            gLedCount = leds;
+            gLedPins = pins;
+            gLedDirty = 1;
+            gLedLatchNs = timeNowNs() + LED_RESET_NS;
+        }
+
+        else
+        {
+            free(gLedFrame);
+            free(gLedCells);
+            free(gLedSteps);
+            gLedFrame = NULL;
+            gLedCells = NULL;
+            gLedSteps = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&gLedLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Frees the frame opened by gpioLedOpen(). The pins are left low
+ *          outputs and the LEDs as last shown.
+ * @return  An error from #errStatus. */
+errStatus gpioLedClose(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gLedLock);
+
+    if (!gLedStrips)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        free(gLedFrame);
+        free(gLedCells);
+        free(gLedSteps);
+        gLedFrame = NULL;
+        gLedCells = NULL;
+        gLedSteps = NULL;
+        gLedStrips = 0;
+        gLedCount = 0;
+        gLedPins = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gLedLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Sets the colour of an LED in the frame. It is shown by
+ *                  the next gpioLedShow().
+ * @param strip     The strip, in the order passed to gpioLedOpen().
+ * @param led       The LED, 0 nearest the pin.
+ * @param rgb       Red in bits 16 - 23, green in bits 8 - 15, blue in bits
+ *                  0 - 7.
+ * @return          An error from #errStatus. */
+errStatus gpioLedSetPixel(int strip, int led, uint32_t rgb)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint8_t * pixel = NULL;
+
+    pthread_mutex_lock(&gLedLock);
+
+    if (!gLedStrips)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (strip < 0 || strip >= gLedStrips || led < 0 || led >= gLedCount)
+    {
+        dbgPrint(DBG_INFO, "strip %d or led %d is out of range.", strip, led);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        pixel = gLedFrame + ((size_t)strip * gLedCount + led) * 3;
+        pixel[0] = (uint8_t)(rgb >> 8);
+        pixel[1] = (uint8_t)(rgb >> 16);
+        pixel[2] = (uint8_t)rgb;
+        gLedDirty = 1;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gLedLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Encodes the frame into its bit cells now, rather than in the next
+ *          gpioLedShow(), which then only sends it.
+ * @return  An error from #errStatus. */
+errStatus gpioLedEncode(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gLedLock);
+
+    if (!gLedStrips)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        ledEncode();
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gLedLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Sends the frame to every strip, encoding it first if it
+ *                  has changed.
+ * @details         A frame starts once the last has latched.
+ *                  #ledDriveSpin returns once the frame is sent. Preemption
+ *                  corrupts it, so run the caller SCHED_FIFO, ideally on a
+ *                  cpu removed from the scheduler with isolcpus=. A cell
+ *                  found to have been stretched enough to be misread fails
+ *                  the call with #ERROR_EXTERNAL, after the rest of the frame
+ *                  is sent. Showing the frame again repairs it.
+ *                  #ledDriveDma returns once the frame has started and uses
+ *                  no CPU time. gpioWaveSetup() must have been called with
+ *                  #wavePacePwm and a #LED_TICK_NS tick, and replaces any
+ *                  other waveform playing.
+ * @param drive     How the cells are timed.
+ * @return          An error from #errStatus. */
+errStatus gpioLedShow(eLedDrive drive)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gLedLock);
+
+    if (!gLedStrips)
+    {
+        dbgPrint(DBG_INFO, "gpioLedOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (drive != ledDriveSpin && drive != ledDriveDma)
+    {
+        dbgPrint(DBG_INFO, "drive value: %d was out of range.", drive);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        if (gLedDirty)
+        {
+            ledEncode();
+        }
+
+        rtn = drive == ledDriveSpin ? ledSendSpin() : ledSendDma();
+    }
+
+    pthread_mutex_unlock(&gLedLock);
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief   Internal function, computes the pins cleared after #LED_T0H_NS in
+ *          every cell of the frame.
+ * @details Each strip's byte is spread so bit i lands in byte i, and shifted
+ *          by the strip, so byte i of the sum holds bit i of every strip. */
+static void ledEncode(void)
+{
+    size_t bytes = (size_t)gLedCount * 3;
+    size_t index = 0;
+    uint32_t * cell = gLedCells;
+    uint64_t lanes = 0;
+    int strip = 0;
+    int bit = 0;
+
+    for (index = 0; index < bytes; index++)
+    {
+        lanes = 0;
+
+        for (strip = 0; strip < gLedStrips; strip++)
+        {
+            lanes |= gLedSpread[gLedFrame[strip * bytes + index]] << strip;
+        }
+
+        for (bit = 7; bit >= 0; bit--)
+        {
+            *cell++ = gLedPins & ~gLedLanes[(lanes >> (bit * 8)) & 0xFF];
+        }
+    }
+
+    gLedDirty = 0;
+}
+
+
+/**
+ * @brief   Internal function, sends the frame timing each cell by spinning.
+ * @details A 0 is timed from before the pins are set and a 1 from after,
+ *          so a 0 is never long and a 1 never short whatever the stores
+ *          cost. A 0 is checked against the time before, so a late one is
+ *          caught.
+ * @return  An error from #errStatus. */
+static errStatus ledSendSpin(void)
+{
+    errStatus rtn = OK;
+    size_t cells = (size_t)gLedCount * LED_BITS;
+    size_t index = 0;
+    uint64_t before = 0;
+    uint64_t start = 0;
+    uint64_t previous = 0;
+    int late = 0;
+
+    timeWaitUntil(gLedLatchNs, LED_SPIN_NS);
+    previous = timeNowNs();
+
+    for (index = 0; index < cells; index++)
+    {
+        before = timeNowNs();
+        REG_WRITE(LED_GPSET0, gLedPins);
+        start = timeNowNs();
+        late |= before - previous > LED_CELL_LATE_NS;
+
+        timeWaitUntil(before + LED_T0H_NS, LED_SPIN_NS);
+
+        if (gLedCells[index])
+        {
+            REG_WRITE(LED_GPCLR0, gLedCells[index]);
+        }
+
+        late |= timeNowNs() - before > LED_T0H_LATE_NS;
+        timeWaitUntil(start + LED_T1H_NS, LED_SPIN_NS);
+        REG_WRITE(LED_GPCLR0, gLedPins);
+        previous = before;
+        timeWaitUntil(start + LED_CELL_NS, LED_SPIN_NS);
+    }
+
+    gLedLatchNs = timeNowNs() + LED_RESET_NS;
+
+    if (late)
+    {
+        dbgPrint(DBG_INFO, "Bit cells were late, the frame may be corrupt.");
+        rtn = ERROR_EXTERNAL;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Internal function, sends the frame as a DMA waveform of three
+ *          ticks per cell.
+ * @details The frame starts with enough low ticks to fill the pacing FIFO,
+ *          otherwise the first cells run at the speed of the DMA engine, and
+ *          ends with the latch. The last frame is waited for.
+ * @return  An error from #errStatus. */
+static errStatus ledSendDma(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    size_t cells = (size_t)gLedCount * LED_BITS;
+    size_t index = 0;
+    tWaveStep * step = gLedSteps;
+    uint32_t tick_ns = 0;
+    int busy = 1;
+
+    if ((rtn = waveGetTick(&tick_ns)) != OK)
+    {
+        dbgPrint(DBG_INFO, "waveGetTick() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if (tick_ns != LED_TICK_NS)
+    {
+        dbgPrint(DBG_INFO, "The waveform tick is %u ns, not %u.", tick_ns, LED_TICK_NS);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        step->setMask = 0;
+        step->clearMask = 0;
+        step->delay_ns = LED_LEAD_TICKS * LED_TICK_NS;
+        step++;
+
+        for (index = 0; index < cells; index++)
+        {
+            step[0].setMask = gLedPins;
+            step[0].clearMask = 0;
+            step[0].delay_ns = LED_TICK_NS;
+            step[1].setMask = 0;
+            step[1].clearMask = gLedCells[index];
+            step[1].delay_ns = LED_TICK_NS;
+            step[2].setMask = 0;
+            step[2].clearMask = gLedPins;
+            step[2].delay_ns = LED_TICK_NS;
+            step += 3;
+        }
+
+        step->setMask = 0;
+        step->clearMask = 0;
+        step->delay_ns = LED_RESET_NS;
+
+        while ((rtn = gpioWaveBusy(&busy)) == OK && busy)
+        {
+            timeWaitUntil(timeNowNs() + LED_POLL_NS, 0);
+        }
+
+        if (rtn == OK)
+        {
+            rtn = gpioWavePlay(gLedSteps, cells * 3 + 2, 0);
+        }
+    }
+
+    return rtn;
+}
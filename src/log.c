@@ -0,0 +1,407 @@
+/**
+ * @file
+ *  @brief Contains source for the debug logging.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Messages are formatted by the calling thread into a thread local record
+ *  and pushed onto a lock free ring. A background thread, started on the
+ *  first message, drains the ring into the record's stream or the user's
+ *  sink. The calling thread never blocks on I/O; if the ring is full the
+ *  message is dropped and counted. Each thread also limits how often a single
+ *  call site may log so a fault which repeats on every call does not flood
+ *  the ring.
+ */
+
+#include "log.h"
+
+/* Local / internal prototypes */
+static int logWriteV(eLogLevel level, FILE * stream, const char * file, int line,
+                     const char * format, va_list arguments);
+static int logRateLimit(const char * file, int line, uint32_t * suppressed);
+static void logOutput(const tLogRecord * record);
+static void logInit(void);
+static void * logThread(void * unused);
+static void logAtExit(void);
+
+/**** Globals ****/
+/** @brief Storage for the record ring. */
+static uint64_t gLogRingStorage[RING_BYTES(LOG_RING_CAPACITY, sizeof(tLogRecord))
+                                / sizeof(uint64_t) + 1];
+
+/** @brief The record ring, within gLogRingStorage. */
+static tRing * gLogRing = NULL;
+
+/** @brief Ensures logInit() runs once. */
+static pthread_once_t gLogOnce = PTHREAD_ONCE_INIT;
+
+/** @brief The drain thread. */
+static pthread_t gLogThread;
+
+/** @brief Non zero while the drain thread is running. */
+static int gLogThreadRunning = 0;
+
+/** @brief Set to ask the drain thread to exit. */
+static int gLogStopRequest = 0;
+
+/** @brief Messages above this level are discarded at run time. */
+static eLogLevel gLogLevel = logWarning;
+
+/** @brief User sink, or NULL to write to each record's stream. */
+static tLogSink gLogSink = NULL;
+
+/** @brief Context passed to gLogSink. */
+static void * gLogSinkContext = NULL;
+
+/** @brief Records dropped because the ring was full. */
+static uint32_t gLogDropped = 0;
+
+/** @brief This thread's record, formatted before being pushed. */
+static __thread tLogRecord tLogScratch;
+
+/** @brief This thread's rate limiter state. */
+static __thread tLogRateSite tLogSites[LOG_RATE_SITES];
+
+/**
+ * @brief            Debug function wrapper for fprintf().
+ * @details          Allows file and line information to be added easier
+ *                   to output strings. #DBG_INFO is a macro which is useful
+ *                   to call as the "first" parameter to this function. Note
+ *                   this function will add on a newline to the end of a format
+ *                   string so one is generally not required in \p format.
+ *                   The message is logged at #logError through
+ *                   gpioLogWrite() so this does not block on \p stream.
+ * @param[in] stream Output stream for strings, e.g. stderr, stdout.
+ * @param[in] file   Name of file to be printed. Should be retrieved with __FILE__.
+ * @param line       Line number to print. Should be retrieved with __LINE__.
+ * @param[in] format Formatted string in the format which printf() would accept.
+ * @param ...        Additional arguments - to fill in placeholders in parameter
+ *                   \p format.
+ * @return           The number of characters queued, 0 if the message was
+ *                   discarded or a negative value if formatting failed.
+ */
+int (dbgPrint)(FILE * stream, const char * file, int line, const char * format, ...)
+{
+    va_list arguments;
+    int rtn = 0;
+
+    va_start(arguments, format);
+    rtn = logWriteV(logError, stream, file, line, format, arguments);
+    va_end(arguments);
+
+    return rtn;
+}
+
+
+/**
+ * @brief            Logs a message at \p level.
+ * @details          Usually called through GPIO_LOG(). The message is
+ *                   formatted as "[file:line] message\n".
+ * @param level      Level of the message.
+ * @param[in] stream Stream the drain thread writes to if no sink is set.
+ * @param[in] file   Name of file to be printed.
+ * @param line       Line number to print.
+ * @param[in] format printf() style format string.
+ * @param ...        Arguments for \p format.
+ * @return           As dbgPrint(). */
+int gpioLogWrite(eLogLevel level, FILE * stream, const char * file, int line,
+                 const char * format, ...)
+{
+    va_list arguments;
+    int rtn = 0;
+
+    va_start(arguments, format);
+    rtn = logWriteV(level, stream, file, line, format, arguments);
+    va_end(arguments);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Sets the most verbose level which is logged at run time.
+ * @details     The default is #logWarning. Levels above #GPIO_LOG_LEVEL are
+ *              already removed at compile time.
+ * @param level The most verbose level to log.
+ * @return      An error from #errStatus. */
+errStatus gpioLogSetLevel(eLogLevel level)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (level < logError || level > logDebug)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        __atomic_store_n(&gLogLevel, level, __ATOMIC_RELAXED);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Sends records to \p sink instead of their stream.
+ * @details             The sink is called from whichever thread drains the
+ *                      ring, normally the background drain thread.
+ * @param sink          The sink, or NULL to write to each record's stream.
+ * @param[in] context   Passed to every \p sink call.
+ * @return              An error from #errStatus. */
+errStatus gpioLogSetSink(tLogSink sink, void * context)
+{
+    __atomic_store_n(&gLogSinkContext, context, __ATOMIC_RELAXED);
+    __atomic_store_n(&gLogSink, sink, __ATOMIC_RELEASE);
+
+    return OK;
+}
+
+
+/**
+ * @brief   Writes out every queued record from the calling thread.
+ * @details Not normally needed as the drain thread does this, but may be
+ *          used to flush before a point of interest.
+ * @return  The number of records written. */
+int gpioLogDrain(void)
+{
+    tLogRecord record;
+    int count = 0;
+    uint32_t dropped = 0;
+
+    pthread_once(&gLogOnce, logInit);
+
+    while (ringPop(gLogRing, &record))
+    {
+        logOutput(&record);
+        count++;
+    }
+
+    if ((dropped = __atomic_exchange_n(&gLogDropped, 0, __ATOMIC_RELAXED)) != 0)
+    {
+        record.stream = stderr;
+        record.level = logWarning;
+        record.length = snprintf(record.text, sizeof(record.text),
+                                 "[log] %u messages dropped\n", dropped);
+        logOutput(&record);
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Stops the drain thread and writes out every queued record.
+ * @details Registered with atexit() so messages are not lost at exit. Any
+ *          later message is written synchronously.
+ * @return  An error from #errStatus. */
+errStatus gpioLogStop(void)
+{
+    pthread_once(&gLogOnce, logInit);
+
+    if (__atomic_exchange_n(&gLogThreadRunning, 0, __ATOMIC_ACQ_REL))
+    {
+        __atomic_store_n(&gLogStopRequest, 1, __ATOMIC_RELEASE);
+        pthread_join(gLogThread, NULL);
+    }
+
+    gpioLogDrain();
+
+    return OK;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief   Internal function which formats and queues one message.
+ * @return  As dbgPrint(). */
+static int logWriteV(eLogLevel level, FILE * stream, const char * file, int line,
+                     const char * format, va_list arguments)
+{
+    tLogRecord * record = &tLogScratch;
+    uint32_t suppressed = 0;
+    int length = 0;
+    int tempRtn = 0;
+
+    if (stream == NULL || level > __atomic_load_n(&gLogLevel, __ATOMIC_RELAXED))
+    {
+        return 0;
+    }
+
+    if (!logRateLimit(file, line, &suppressed))
+    {
+        return 0;
+    }
+
+    pthread_once(&gLogOnce, logInit);
+
+    /* Leave room for the newline */
+    if ((tempRtn = snprintf(record->text, LOG_RECORD_SIZE - 1, "[%s:%d] ",
+                            file, line)) < 0)
+    {
+        return tempRtn;
+    }
+    length = tempRtn < LOG_RECORD_SIZE - 1 ? tempRtn : LOG_RECORD_SIZE - 2;
+
+    if ((tempRtn = vsnprintf(record->text + length, LOG_RECORD_SIZE - 1 - length,
+                             format, arguments)) < 0)
+    {
+        return tempRtn;
+    }
+    length += tempRtn;
+    length = length < LOG_RECORD_SIZE - 1 ? length : LOG_RECORD_SIZE - 2;
+
+    if (suppressed && length < LOG_RECORD_SIZE - 2)
+    {
+        tempRtn = snprintf(record->text + length, LOG_RECORD_SIZE - 1 - length,
+                           " (%u similar suppressed)", suppressed);
+        length += tempRtn > 0 ? tempRtn : 0;
+        length = length < LOG_RECORD_SIZE - 1 ? length : LOG_RECORD_SIZE - 2;
+    }
+
+    record->text[length++] = '\n';
+    record->length = (uint16_t)length;
+    record->stream = stream;
+    record->level = level;
+
+    /* Without the drain thread, e.g. during exit, write directly */
+    if (!__atomic_load_n(&gLogThreadRunning, __ATOMIC_ACQUIRE))
+    {
+        logOutput(record);
+    }
+
+    else if (!ringPush(gLogRing, record))
+    {
+        __atomic_add_fetch(&gLogDropped, 1, __ATOMIC_RELAXED);
+        length = 0;
+    }
+
+    return length;
+}
+
+
+/**
+ * @brief               Internal function which decides if a call site may log.
+ * @details             Each call site may log #LOG_RATE_BURST messages per
+ *                      #LOG_RATE_WINDOW_NS. The state is thread local.
+ * @param[in] file      __FILE__ of the call site.
+ * @param line          __LINE__ of the call site.
+ * @param[out] suppressed Populated with the number of messages suppressed
+ *                      since this site last logged.
+ * @return              Non zero if the message should be logged. */
+static int logRateLimit(const char * file, int line, uint32_t * suppressed)
+{
+    uint32_t hash = ((uint32_t)(uintptr_t)file ^ ((uint32_t)line * 2654435761u));
+    tLogRateSite * site = &tLogSites[(hash >> 16) & (LOG_RATE_SITES - 1)];
+    uint64_t now = timeNowNs();
+
+    if (site->file != file || site->line != line)
+    {
+        site->file = file;
+        site->line = line;
+        site->windowStart_ns = now;
+        site->count = 0;
+        site->suppressed = 0;
+    }
+
+    else if (now - site->windowStart_ns >= LOG_RATE_WINDOW_NS)
+    {
+        site->windowStart_ns = now;
+        site->count = 0;
+    }
+
+    if (site->count >= LOG_RATE_BURST)
+    {
+        site->suppressed++;
+        return 0;
+    }
+
+    site->count++;
+    *suppressed = site->suppressed;
+    site->suppressed = 0;
+
+    return 1;
+}
+
+
+/**
+ * @brief           Internal function which writes one record to the sink or
+ *                  its stream with a single call.
+ * @param[in] record The record to write.
+ */
+static void logOutput(const tLogRecord * record)
+{
+    tLogSink sink = __atomic_load_n(&gLogSink, __ATOMIC_ACQUIRE);
+
+    if (sink != NULL)
+    {
+        sink(__atomic_load_n(&gLogSinkContext, __ATOMIC_RELAXED),
+             record->level, record->text, record->length);
+    }
+
+    else
+    {
+        fwrite(record->text, 1, record->length, record->stream);
+    }
+}
+
+
+/**
+ * @brief   Internal function which creates the ring and drain thread.
+ */
+static void logInit(void)
+{
+    gLogRing = ringInit(gLogRingStorage, LOG_RING_CAPACITY, sizeof(tLogRecord));
+
+    if (pthread_create(&gLogThread, NULL, logThread, NULL) == 0)
+    {
+        __atomic_store_n(&gLogThreadRunning, 1, __ATOMIC_RELEASE);
+        atexit(logAtExit);
+    }
+}
+
+
+/**
+ * @brief           Internal function which is the drain thread.
+ * @details         Polls the ring so that logging never has to wake it.
+ * @param unused    Unused.
+ * @return          NULL. */
+static void * logThread(void * unused)
+{
+    struct timespec period = {0, LOG_DRAIN_PERIOD_NS};
+
+    while (!__atomic_load_n(&gLogStopRequest, __ATOMIC_ACQUIRE))
+    {
+        if (gpioLogDrain() == 0)
+        {
+            nanosleep(&period, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief   Internal function registered with atexit().
+ */
+static void logAtExit(void)
+{
+    gpioLogStop();
+}
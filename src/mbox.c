@@ -0,0 +1,223 @@
+/**
+ * @file
+ *  @brief Contains source for allocating memory the DMA engine can read.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  The DMA engine reads control blocks and data by bus address, bypassing the
+ *  ARM caches, so they are placed in memory allocated from the VideoCore
+ *  through the mailbox and mapped uncached via /dev/mem. Both require root.
+ */
+
+#include "dma.h"
+
+/* Local / internal prototypes */
+static errStatus mboxProperty(int fd, uint32_t tag, const uint32_t * args,
+                              int argCount, uint32_t * result);
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which allocates memory visible to
+ *                      both the ARM and the DMA engine.
+ * @param size          Bytes required. Rounded up to whole pages.
+ * @param[out] memory   Populated with the allocation. Release it with
+ *                      dmaMemFree().
+ * @return              An error from #errStatus. */
+errStatus dmaMemAlloc(size_t size, tDmaMemory * memory)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    uint32_t args[3] = {0};
+    int mboxFd = -1;
+    int memFd = -1;
+    void * map = MAP_FAILED;
+
+    if (memory == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter memory was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (size == 0)
+    {
+        dbgPrint(DBG_INFO, "Parameter size was 0.");
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetBoard(&board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. Ensure gpioSetup() was called.");
+    }
+
+    else if ((mboxFd = open(MBOX_DEV_PATH, 0)) < 0)
+    {
+        dbgPrint(DBG_INFO, "open() failed for %s. errno: %s.",
+                 MBOX_DEV_PATH, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        memset(memory, 0, sizeof(*memory));
+        memory->size = (size + pageSize - 1) & ~(pageSize - 1);
+
+        args[0] = (uint32_t)memory->size;
+        args[1] = (uint32_t)pageSize;
+        args[2] = board->soc == socBcm2835 ? MBOX_MEM_L1_NONALLOCATING : MBOX_MEM_DIRECT;
+
+        if ((rtn = mboxProperty(mboxFd, MBOX_TAG_MEM_ALLOC, args, 3,
+                                &memory->handle)) != OK || memory->handle == 0)
+        {
+            dbgPrint(DBG_INFO, "Mailbox allocation of %u bytes failed.",
+                     (uint32_t)memory->size);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else if ((rtn = mboxProperty(mboxFd, MBOX_TAG_MEM_LOCK, &memory->handle, 1,
+                                     &memory->bus)) != OK || memory->bus == 0)
+        {
+            dbgPrint(DBG_INFO, "Mailbox lock failed.");
+            mboxProperty(mboxFd, MBOX_TAG_MEM_RELEASE, &memory->handle, 1, args);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else if ((memFd = open(PERIPH_DEV_MEM, O_RDWR | O_SYNC)) < 0 ||
+                 (map = mmap(NULL, memory->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                             memFd, (off_t)DMA_BUS_TO_PHYS(memory->bus))) == MAP_FAILED)
+        {
+            dbgPrint(DBG_INFO, "Mapping bus address 0x%x failed. errno: %s.",
+                     memory->bus, strerror(errno));
+            mboxProperty(mboxFd, MBOX_TAG_MEM_UNLOCK, &memory->handle, 1, args);
+            mboxProperty(mboxFd, MBOX_TAG_MEM_RELEASE, &memory->handle, 1, args);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            memory->virt = map;
+            memset(memory->virt, 0, memory->size);
+        }
+
+        if (memFd >= 0)
+        {
+            close(memFd);
+        }
+
+        close(mboxFd);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which releases memory from
+ *                      dmaMemAlloc().
+ * @details             No channel may still be reading the memory.
+ * @param[in] memory    The allocation.
+ * @return              An error from #errStatus. */
+errStatus dmaMemFree(tDmaMemory * memory)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t result = 0;
+    int mboxFd = -1;
+
+    if (memory == NULL || memory->virt == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter memory was NULL or not allocated.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((mboxFd = open(MBOX_DEV_PATH, 0)) < 0)
+    {
+        dbgPrint(DBG_INFO, "open() failed for %s. errno: %s.",
+                 MBOX_DEV_PATH, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        munmap(memory->virt, memory->size);
+
+        if ((rtn = mboxProperty(mboxFd, MBOX_TAG_MEM_UNLOCK, &memory->handle, 1,
+                                &result)) != OK ||
+            (rtn = mboxProperty(mboxFd, MBOX_TAG_MEM_RELEASE, &memory->handle, 1,
+                                &result)) != OK)
+        {
+            dbgPrint(DBG_INFO, "Mailbox release of handle %u failed.", memory->handle);
+        }
+
+        memset(memory, 0, sizeof(*memory));
+        close(mboxFd);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which sends one tag to the
+ *                      VideoCore and waits for its response.
+ * @param fd            Open #MBOX_DEV_PATH.
+ * @param[in] args      Tag arguments.
+ * @param argCount      Words in \p args, up to 3.
+ * @param[out] result   Populated with the first word of the response.
+ * @return              An error from #errStatus. */
+static errStatus mboxProperty(int fd, uint32_t tag, const uint32_t * args,
+                              int argCount, uint32_t * result)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t msg[MBOX_MSG_WORDS] __attribute__((aligned(16)));
+    int index = 0;
+
+    memset(msg, 0, sizeof(msg));
+    msg[0] = sizeof(msg);       /* Message size */
+    msg[1] = 0;                 /* Request */
+    msg[2] = tag;
+    msg[3] = 3 * sizeof(uint32_t);            /* Value buffer size */
+    msg[4] = argCount * sizeof(uint32_t);     /* Request length */
+
+    for (index = 0; index < argCount; index++)
+    {
+        msg[5 + index] = args[index];
+    }
+
+    msg[8] = 0;                 /* End tag */
+
+    if (ioctl(fd, MBOX_IOCTL_PROPERTY, msg) < 0)
+    {
+        dbgPrint(DBG_INFO, "ioctl() failed for tag 0x%x. errno: %s.", tag, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (!(msg[1] & MBOX_RESPONSE_OK))
+    {
+        dbgPrint(DBG_INFO, "Tag 0x%x was not handled, response 0x%x.", tag, msg[1]);
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        *result = msg[5];
+        rtn = OK;
+    }
+
+    return rtn;
+}
@@ -0,0 +1,664 @@
+/**
+ * @file
+ *  @brief Contains source for the multi bus 1-Wire master.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  Each bus is one GPIO, released by making it an input, held high by a pull
+ *  up, and pulled low by making it an output latched low. Slot timing is
+ *  kept by spinning on the monotonic clock from the start of each slot.
+ *
+ *  Every call drives a list of buses in lockstep, so probes on separate
+ *  pins are reset, addressed and read together. In a slot the pins of all
+ *  the buses are pulled low together, those writing a 1 or reading are
+ *  released together and all are sampled with one GPLEV0 load, each step
+ *  one read-modify-write per GPFSEL register touched. A search ROM runs on
+ *  every bus at once, each following its own branches.
+ *
+ *  A slot the calling thread was preempted in may have the wrong bits, so
+ *  calls check the time after each step and fail with #ERROR_EXTERNAL if it
+ *  was late. Running the thread SCHED_FIFO makes this unlikely.
+ */
+
+#include "onewire.h"
+
+/* Local / internal prototypes */
+static errStatus oneWirePins(const int * buses, int count, uint32_t * pins);
+static uint32_t oneWireSlot(uint32_t low, uint32_t early, int * late);
+static errStatus oneWireWriteByte(const uint32_t * pins, int count, const uint8_t * bytes);
+
+/**** Globals ****/
+/** @brief Serialises bus use and protects gOneWirePin. */
+static pthread_mutex_t gOneWireLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Pin mask of each open bus, 0 if closed. */
+static uint32_t gOneWirePin[ONE_WIRE_BUSES];
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gOneWireMap = NULL;
+
+/**
+ * @brief               Opens a 1-Wire bus on a GPIO.
+ * @details             The pin is made an input with its pull up enabled and
+ *                      its output latch cleared. An external 4.7k pull up is
+ *                      still needed, the internal one is too weak.
+ * @param gpioNumber    The pin.
+ * @param[out] bus      The bus.
+ * @return              An error from #errStatus. */
+errStatus gpioOneWireOpen(int gpioNumber, int * bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t used = 0;
+    int index = 0;
+    int empty = -1;
+
+    pthread_mutex_lock(&gOneWireLock);
+
+    for (index = 0; index < ONE_WIRE_BUSES; index++)
+    {
+        used |= gOneWirePin[index];
+
+        if (!gOneWirePin[index] && empty < 0)
+        {
+            empty = index;
+        }
+    }
+
+    if (bus == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if (gpioNumber < 0 || gpioNumber > 31 || (used & (0x1u << gpioNumber)))
+    {
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (empty < 0)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioSetFunction(gpioNumber, input)) != OK)
+    {
+    }
+
+    else if ((rtn = gpioGetRegisters(&gOneWireMap)) != OK)
+    {
+    }
+
+    else if ((rtn = gpioSetPullResistor(gpioNumber, pullup)) != OK ||
+             (rtn = gpioClearMask(0x1u << gpioNumber)) != OK)
+    {
+    }
+
+    else
+    {
+        gOneWirePin[empty] = 0x1u << gpioNumber;
+        *bus = empty;
+    }
+
+    pthread_mutex_unlock(&gOneWireLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Closes a bus opened by gpioOneWireOpen(). Its pin is left an
+ *              input.
+ * @param bus   The bus.
+ * @return      An error from #errStatus. */
+errStatus gpioOneWireClose(int bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gOneWireLock);
+
+    if (bus < 0 || bus >= ONE_WIRE_BUSES || !gOneWirePin[bus])
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        gOneWirePin[bus] = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gOneWireLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Resets several buses together and checks for presence.
+ * @param buses     The buses.
+ * @param count     Number of buses, 1 to #ONE_WIRE_BUSES.
+ * @param[out] present Bit i set if a device answered on buses[i].
+ * @return          An error from #errStatus. */
+errStatus gpioOneWireReset(const int * buses, int count, uint32_t * present)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins[ONE_WIRE_BUSES];
+    uint32_t low = 0;
+    uint32_t levels = 0;
+    uint64_t start = 0;
+    int index = 0;
+
+    pthread_mutex_lock(&gOneWireLock);
+
+    if (present == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if ((rtn = oneWirePins(buses, count, pins)) == OK)
+    {
+        for (index = 0; index < count; index++)
+        {
+            low |= pins[index];
+        }
+
+        start = timeNowNs();
+        fselWrite(gOneWireMap, 0, low);
+        timeWaitUntil(start + ONE_WIRE_RESET_NS, ONE_WIRE_SPIN_NS);
+        fselWrite(gOneWireMap, low, 0);
+
+        start = timeNowNs();
+        timeWaitUntil(start + ONE_WIRE_PRESENCE_NS, ONE_WIRE_SPIN_NS);
+        levels = REG_READ(ONE_WIRE_GPLEV0);
+
+        if (timeNowNs() - start > ONE_WIRE_PRESENCE_LATE_NS)
+        {
+            rtn = ERROR_EXTERNAL;
+        }
+
+        *present = 0;
+
+        for (index = 0; index < count; index++)
+        {
+            *present |= levels & pins[index] ? 0 : 0x1u << index;
+        }
+
+        timeWaitUntil(start + ONE_WIRE_RESET_HIGH_NS, ONE_WIRE_SPIN_NS);
+    }
+
+    pthread_mutex_unlock(&gOneWireLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Writes bytes to several buses together.
+ * @param buses     The buses.
+ * @param count     Number of buses, 1 to #ONE_WIRE_BUSES.
+ * @param[in] data  One pointer per bus to \p length bytes.
+ * @param length    Bytes per bus.
+ * @return          An error from #errStatus. */
+errStatus gpioOneWireWrite(const int * buses, int count, const uint8_t * const * data,
+                           size_t length)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins[ONE_WIRE_BUSES];
+    uint8_t bytes[ONE_WIRE_BUSES];
+    size_t offset = 0;
+    int index = 0;
+
+    pthread_mutex_lock(&gOneWireLock);
+
+    if ((rtn = oneWirePins(buses, count, pins)) != OK)
+    {
+    }
+
+    else
+    {
+        for (index = 0; index < count && rtn == OK; index++)
+        {
+            if (data == NULL || data[index] == NULL)
+            {
+                rtn = ERROR_NULL;
+            }
+        }
+
+        for (offset = 0; offset < length && rtn == OK; offset++)
+        {
+            for (index = 0; index < count; index++)
+            {
+                bytes[index] = data[index][offset];
+            }
+
+            rtn = oneWireWriteByte(pins, count, bytes);
+        }
+    }
+
+    pthread_mutex_unlock(&gOneWireLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Reads bytes from several buses together.
+ * @param buses     The buses.
+ * @param count     Number of buses, 1 to #ONE_WIRE_BUSES.
+ * @param[out] data One pointer per bus to \p length bytes.
+ * @param length    Bytes per bus.
+ * @return          An error from #errStatus. */
+errStatus gpioOneWireRead(const int * buses, int count, uint8_t * const * data,
+                          size_t length)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins[ONE_WIRE_BUSES];
+    uint32_t low = 0;
+    uint32_t levels = 0;
+    size_t offset = 0;
+    int late = 0;
+    int index = 0;
+    int bit = 0;
+
+    pthread_mutex_lock(&gOneWireLock);
+
+    if ((rtn = oneWirePins(buses, count, pins)) != OK)
+    {
+    }
+
+    else
+    {
+        for (index = 0; index < count; index++)
+        {
+            if (data == NULL || data[index] == NULL)
+            {
+                rtn = ERROR_NULL;
+            }
+
+            low |= pins[index];
+        }
+
+        for (offset = 0; offset < length && rtn == OK; offset++)
+        {
+            for (index = 0; index < count; index++)
+            {
+                data[index][offset] = 0;
+            }
+
+            /* LSB first, every bus sampled by the same load */
+            for (bit = 0; bit < 8; bit++)
+            {
+                levels = oneWireSlot(low, low, &late);
+
+                for (index = 0; index < count; index++)
+                {
+                    data[index][offset] |= levels & pins[index] ? 0x1 << bit : 0;
+                }
+            }
+        }
+
+        if (rtn == OK && late)
+        {
+            rtn = ERROR_EXTERNAL;
+        }
+    }
+
+    pthread_mutex_unlock(&gOneWireLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Finds the ROM codes of the devices on several buses.
+ * @details         A search ROM runs on every bus together, each bus taking
+ *                  its own branches, so the time taken is that of the bus
+ *                  with the most devices. A pass with a late slot is run
+ *                  again, up to #ONE_WIRE_RETRIES times in a row. ROMs whose
+ *                  CRC is wrong are not stored.
+ * @param buses     The buses.
+ * @param count     Number of buses, 1 to #ONE_WIRE_BUSES.
+ * @param[out] roms One pointer per bus to room for \p max ROMs.
+ * @param max       Most ROMs stored per bus.
+ * @param[out] found ROMs found on each bus, one per bus.
+ * @return          An error from #errStatus. */
+errStatus gpioOneWireSearch(const int * buses, int count, uint64_t * const * roms,
+                            int max, int * found)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tOneWireSearch search[ONE_WIRE_BUSES];
+    uint32_t pins[ONE_WIRE_BUSES];
+    uint8_t command[ONE_WIRE_BUSES];
+    uint32_t present = 0;
+    uint32_t active = 0;
+    uint32_t ones = 0;
+    uint32_t idBits = 0;
+    uint32_t cmpBits = 0;
+    uint8_t bytes[8];
+    int searching = 0;
+    int retries = 0;
+    int late = 0;
+    int index = 0;
+    int bit = 0;
+    int id = 0;
+    int cmp = 0;
+    int direction = 0;
+
+    if (roms == NULL || found == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if (max < 1)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memset(search, 0, sizeof(search));
+        memset(command, ONE_WIRE_SEARCH_ROM, sizeof(command));
+        rtn = OK;
+
+        for (index = 0; index < count && index < ONE_WIRE_BUSES; index++)
+        {
+            found[index] = 0;
+
+            if (roms[index] == NULL)
+            {
+                rtn = ERROR_NULL;
+            }
+        }
+    }
+
+    searching = rtn == OK;
+
+    while (searching)
+    {
+        rtn = gpioOneWireReset(buses, count, &present);
+        late = rtn == ERROR_EXTERNAL;
+
+        pthread_mutex_lock(&gOneWireLock);
+
+        if (rtn == OK)
+        {
+            oneWirePins(buses, count, pins);
+            active = 0;
+
+            for (index = 0; index < count; index++)
+            {
+                search[index].pin = pins[index];
+                search[index].done |= !(present & (0x1u << index));
+                search[index].aborted = search[index].done;
+                search[index].lastZero = 0;
+                search[index].rom = search[index].lastRom;
+                active |= search[index].done ? 0 : pins[index];
+            }
+
+            /* Buses whose search is done sit out the pass with their line released */
+            for (index = 0; index < count; index++)
+            {
+                pins[index] = search[index].done ? 0 : pins[index];
+            }
+
+            rtn = oneWireWriteByte(pins, count, command);
+            late = rtn == ERROR_EXTERNAL;
+
+            for (bit = 1; bit <= 64 && rtn == OK; bit++)
+            {
+                idBits = oneWireSlot(active, active, &late);
+                cmpBits = oneWireSlot(active, active, &late);
+                ones = 0;
+
+                for (index = 0; index < count; index++)
+                {
+                    tOneWireSearch * bus = &search[index];
+
+                    if (bus->aborted)
+                    {
+                        continue;
+                    }
+
+                    id = (idBits & bus->pin) != 0;
+                    cmp = (cmpBits & bus->pin) != 0;
+
+                    if (id && cmp)
+                    {
+                        bus->aborted = 1;
+                        active &= ~bus->pin;
+                        continue;
+                    }
+
+                    else if (id != cmp)
+                    {
+                        direction = id;
+                    }
+
+                    else
+                    {
+                        direction = bit < bus->lastDiscrepancy ?
+                                    (int)((bus->rom >> (bit - 1)) & 0x1) :
+                                    bit == bus->lastDiscrepancy;
+
+                        if (!direction)
+                        {
+                            bus->lastZero = bit;
+                        }
+                    }
+
+                    bus->rom = (bus->rom & ~(0x1ull << (bit - 1))) | ((uint64_t)direction << (bit - 1));
+                    ones |= direction ? bus->pin : 0;
+                }
+
+                oneWireSlot(active, ones, &late);
+            }
+        }
+
+        /* A pass with a late reset or slot is run again from the same branches */
+        if (late)
+        {
+            late = 0;
+            rtn = OK;
+
+            if (++retries > ONE_WIRE_RETRIES)
+            {
+                dbgPrint(DBG_INFO, "Slots were late, the search failed.");
+                rtn = ERROR_EXTERNAL;
+                searching = 0;
+            }
+        }
+
+        else
+        {
+            searching = 0;
+            retries = 0;
+
+            for (index = 0; index < count && rtn == OK; index++)
+            {
+                tOneWireSearch * bus = &search[index];
+
+                if (bus->aborted)
+                {
+                    bus->done = 1;
+                    continue;
+                }
+
+                for (bit = 0; bit < 8; bit++)
+                {
+                    bytes[bit] = (uint8_t)(bus->rom >> (bit * 8));
+                }
+
+                if (gpioOneWireCrc8(bytes, 7) == bytes[7])
+                {
+                    roms[index][bus->found++] = bus->rom;
+                }
+
+                bus->lastRom = bus->rom;
+                bus->lastDiscrepancy = bus->lastZero;
+                bus->done = bus->lastDiscrepancy == 0 || bus->found == max;
+                found[index] = bus->found;
+                searching |= !bus->done;
+            }
+        }
+
+        pthread_mutex_unlock(&gOneWireLock);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           The Dallas / Maxim CRC-8 used by ROM codes and scratchpads.
+ * @param data      The bytes.
+ * @param length    Number of bytes.
+ * @return          The CRC. Over bytes followed by their CRC it is 0. */
+uint8_t gpioOneWireCrc8(const uint8_t * data, size_t length)
+{
+    uint8_t crc = 0;
+    size_t index = 0;
+    int bit = 0;
+
+    for (index = 0; index < length && data != NULL; index++)
+    {
+        crc ^= data[index];
+
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x1 ? (crc >> 1) ^ 0x8C : crc >> 1;
+        }
+    }
+
+    return crc;
+}
+
+
+/**
+ * @brief           Internal function, looks up the pins of a list of buses.
+ * @param buses     The buses.
+ * @param count     Number of buses.
+ * @param[out] pins Pin mask of each bus.
+ * @return          An error from #errStatus. */
+static errStatus oneWirePins(const int * buses, int count, uint32_t * pins)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t seen = 0;
+    int index = 0;
+
+    if (buses == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if (count < 1 || count > ONE_WIRE_BUSES)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        rtn = OK;
+
+        for (index = 0; index < count && rtn == OK; index++)
+        {
+            if (buses[index] < 0 || buses[index] >= ONE_WIRE_BUSES ||
+                !gOneWirePin[buses[index]] || (seen & (0x1u << buses[index])))
+            {
+                rtn = ERROR_RANGE;
+            }
+
+            else
+            {
+                seen |= 0x1u << buses[index];
+                pins[index] = gOneWirePin[buses[index]];
+            }
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function, runs one slot on several buses.
+ * @param low       Pins pulled low at the start of the slot.
+ * @param early     Pins of \p low writing a 1 or reading, released early.
+ * @param[in,out] late Set if the sample or the release of a 0 was late.
+ * @return          GPLEV0 sampled during the slot. */
+static uint32_t oneWireSlot(uint32_t low, uint32_t early, int * late)
+{
+    uint32_t levels = 0;
+    uint64_t start = timeNowNs();
+
+    fselWrite(gOneWireMap, 0, low);
+    timeWaitUntil(start + ONE_WIRE_RELEASE_NS, ONE_WIRE_SPIN_NS);
+    fselWrite(gOneWireMap, early, 0);
+    timeWaitUntil(start + ONE_WIRE_SAMPLE_NS, ONE_WIRE_SPIN_NS);
+    levels = REG_READ(ONE_WIRE_GPLEV0);
+    *late |= timeNowNs() - start > ONE_WIRE_LATE_NS;
+    timeWaitUntil(start + ONE_WIRE_LOW0_NS, ONE_WIRE_SPIN_NS);
+    fselWrite(gOneWireMap, low & ~early, 0);
+
+    /* Preempted while holding a 0, which may have reset the devices */
+    *late |= timeNowNs() - start > ONE_WIRE_LOW0_MAX_NS;
+    timeWaitUntil(start + ONE_WIRE_SLOT_NS, ONE_WIRE_SPIN_NS);
+
+    return levels;
+}
+
+
+/**
+ * @brief           Internal function, writes one byte to each bus, LSB
+ *                  first.
+ * @param pins      Pin mask of each bus, 0 to leave a bus out.
+ * @param count     Number of buses.
+ * @param bytes     The byte for each bus.
+ * @return          An error from #errStatus. */
+static errStatus oneWireWriteByte(const uint32_t * pins, int count, const uint8_t * bytes)
+{
+    errStatus rtn = OK;
+    uint32_t low = 0;
+    uint32_t ones = 0;
+    int late = 0;
+    int index = 0;
+    int bit = 0;
+
+    for (index = 0; index < count; index++)
+    {
+        low |= pins[index];
+    }
+
+    for (bit = 0; bit < 8; bit++)
+    {
+        ones = 0;
+
+        for (index = 0; index < count; index++)
+        {
+            ones |= (bytes[index] >> bit) & 0x1 ? pins[index] : 0;
+        }
+
+        oneWireSlot(low, ones, &late);
+    }
+
+    if (late)
+    {
+        rtn = ERROR_EXTERNAL;
+    }
+
+    return rtn;
+}
@@ -0,0 +1,791 @@
+/**
+ * @file
+ *  @brief Drives an 8080 or 6800 style parallel bus to a display.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A table per data byte gives the GPSET0 value driving that byte onto its
+ *  data lines, the GPCLR0 value being the rest of the data lines. A word is
+ *  then a GPCLR0 store, which on an 8080 bus also drops WR, a GPSET0 store,
+ *  which on a 6800 bus also raises E, and the store ending the strobe which
+ *  latches it. The strobe cannot share a store with the data as the
+ *  controller needs the data set up before that edge.
+ *
+ *  A frame of RGB565 pixels may be given, in which case only the
+ *  rectangles marked dirty are sent, each as a MIPI DCS column, page and
+ *  memory write.
+ */
+
+#include "parallel.h"
+
+/* Local / internal prototypes */
+static int parallelPin(int gpioNumber, int optional, uint32_t * pins);
+static void parallelWait(uint64_t * next);
+static void parallelBegin(int data);
+static void parallelEnd(void);
+static void parallelSend(uint32_t word, uint64_t * next);
+static void parallelWindow(const tParallelRect * rect);
+
+/**** Globals ****/
+/** @brief Serialises transfers and protects the globals below. */
+static pthread_mutex_t gParallelLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gParallelMap = NULL;
+
+/** @brief The bus is open. */
+static int gParallelOpen = 0;
+
+/** @brief The configuration passed to gpioParallelOpen(). */
+static tParallelConfig gParallelConfig;
+
+/** @brief Every data line. */
+static uint32_t gParallelData = 0;
+
+/** @brief WR or E. */
+static uint32_t gParallelStrobe = 0;
+
+/** @brief RD or R/W, 0 if write only. */
+static uint32_t gParallelRead = 0;
+
+/** @brief D/C. */
+static uint32_t gParallelDc = 0;
+
+/** @brief CS, 0 if none. */
+static uint32_t gParallelCs = 0;
+
+/** @brief Half a word, 0 if unpaced. */
+static uint32_t gParallelHalfNs = 0;
+
+/** @brief Data lines of D0 - D7 set for each value of the byte. */
+static uint32_t gParallelLow[256];
+
+/** @brief Data lines of D8 - D15 set for each value of the byte. */
+static uint32_t gParallelHigh[256];
+
+/** @brief Frame from gpioParallelSetFrame(), NULL if none. */
+static const uint16_t * gParallelPixels = NULL;
+
+/** @brief Columns of the frame. */
+static int gParallelWidth = 0;
+
+/** @brief Rows of the frame. */
+static int gParallelHeight = 0;
+
+/** @brief Regions of the frame to send. */
+static tParallelRect gParallelDirty[PARALLEL_DIRTY_MAX];
+
+/** @brief Entries of gParallelDirty in use. */
+static int gParallelDirtyCount = 0;
+
+/**
+ * @brief           Opens the parallel bus.
+ * @details         Every pin is made an output, data low, D/C high and the
+ *                  strobes and CS idle. Reads need the RD or R/W pin.
+ * @param[in] config The pins, bus type and pacing. Copied.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelOpen(const tParallelConfig * config)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins = 0;
+    uint32_t pin = 0;
+    int valid = 1;
+    int index = 0;
+    int bit = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has already been called.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (config == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter config was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((config->bus != parallel8080 && config->bus != parallel6800) ||
+             config->width < 1 || config->width > PARALLEL_WIDTH_MAX ||
+             config->frequency < 0 || config->frequency > PARALLEL_FREQ_MAX)
+    {
+        dbgPrint(DBG_INFO, "bus %d, width %d or frequency %d is out of range.",
+                 config->bus, config->width, config->frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memset(gParallelLow, 0, sizeof(gParallelLow));
+        memset(gParallelHigh, 0, sizeof(gParallelHigh));
+
+        for (bit = 0; bit < config->width; bit++)
+        {
+            pin = pins;
+            valid &= parallelPin(config->gpioNumberData[bit], 0, &pins);
+
+            for (index = 0; index < 256; index++)
+            {
+                if (bit < 8 && (index & (0x1 << bit)))
+                {
+                    gParallelLow[index] |= pins & ~pin;
+                }
+
+                else if (bit >= 8 && (index & (0x1 << (bit - 8))))
+                {
+                    gParallelHigh[index] |= pins & ~pin;
+                }
+            }
+        }
+
+        gParallelData = pins;
+        valid &= parallelPin(config->gpioNumberWr, 0, &pins);
+        gParallelStrobe = pins & ~gParallelData;
+        pin = pins;
+        valid &= parallelPin(config->gpioNumberRd, 1, &pins);
+        gParallelRead = pins & ~pin;
+        pin = pins;
+        valid &= parallelPin(config->gpioNumberDc, 0, &pins);
+        gParallelDc = pins & ~pin;
+        pin = pins;
+        valid &= parallelPin(config->gpioNumberCs, 1, &pins);
+        gParallelCs = pins & ~pin;
+
+        if (!valid)
+        {
+            dbgPrint(DBG_INFO, "Pins are invalid or repeated.");
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if ((rtn = gpioGetRegisters(&gParallelMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            /* Idle: 8080 WR and RD high, 6800 E and R/W low */
+            if (config->bus == parallel8080)
+            {
+                rtn = gpioSetMask(gParallelStrobe | gParallelRead | gParallelDc | gParallelCs);
+                rtn = rtn == OK ? gpioClearMask(gParallelData) : rtn;
+            }
+
+            else
+            {
+                rtn = gpioSetMask(gParallelDc | gParallelCs);
+                rtn = rtn == OK ? gpioClearMask(gParallelData | gParallelStrobe |
+                                                gParallelRead) : rtn;
+            }
+
+            for (pin = pins; pin && rtn == OK; pin &= pin - 1)
+            {
+                rtn = gpioSetFunction(__builtin_ctz(pin), output);
+            }
+
+            if (rtn != OK)
+            {
+                dbgPrint(DBG_INFO, "Setting up the pins failed. %s", gpioErrToString(rtn));
+            }
+
+            else
+            {
+                gParallelConfig = *config;
+                gParallelHalfNs = config->frequency ? 500000000u / config->frequency : 0;
+                gParallelPixels = NULL;
+                gParallelDirtyCount = 0;
+                gParallelOpen = 1;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Closes the bus opened by gpioParallelOpen(). The pins are left as
+ *          they are and the frame is forgotten.
+ * @return  An error from #errStatus. */
+errStatus gpioParallelClose(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gParallelPixels = NULL;
+        gParallelDirtyCount = 0;
+        gParallelOpen = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Writes a command word, with D/C low. Its parameters are
+ *                  written by gpioParallelWrite().
+ * @param command   The command. Bits above the bus width are ignored.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelCommand(uint16_t command)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint64_t next = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        parallelBegin(0);
+        next = timeNowNs();
+        parallelSend(command, &next);
+        parallelEnd();
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Writes data words, with D/C high.
+ * @param[in] data  A uint8_t per word on a bus of up to 8 lines, otherwise a
+ *                  uint16_t. Bits above the bus width are ignored.
+ * @param count     Words to write.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelWrite(const void * data, size_t count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const uint8_t * bytes = data;
+    const uint16_t * words = data;
+    uint64_t next = 0;
+    size_t index = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (data == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter data was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        parallelBegin(1);
+        next = timeNowNs();
+
+        for (index = 0; index < count; index++)
+        {
+            parallelSend(gParallelConfig.width > 8 ? words[index] : bytes[index], &next);
+        }
+
+        parallelEnd();
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Reads data words, with D/C high.
+ * @details         The data lines are inputs during the read, then outputs
+ *                  again. Each strobe is held for #PARALLEL_READ_NS, or half
+ *                  a word if the bus is paced slower.
+ * @param[out] buffer A uint8_t per word on a bus of up to 8 lines, otherwise
+ *                  a uint16_t.
+ * @param count     Words to read.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelRead(void * buffer, size_t count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint8_t * bytes = buffer;
+    uint16_t * words = buffer;
+    uint32_t hold_ns = 0;
+    uint32_t levels = 0;
+    uint32_t pin = 0;
+    uint16_t word = 0;
+    size_t index = 0;
+    int bit = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (buffer == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter buffer was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (!gParallelRead)
+    {
+        dbgPrint(DBG_INFO, "The bus was opened without a read pin.");
+        rtn = ERROR_UNSUPPORTED;
+    }
+
+    else
+    {
+        hold_ns = gParallelHalfNs > PARALLEL_READ_NS ? gParallelHalfNs : PARALLEL_READ_NS;
+        rtn = OK;
+
+        for (pin = gParallelData; pin && rtn == OK; pin &= pin - 1)
+        {
+            rtn = gpioSetFunction(__builtin_ctz(pin), input);
+        }
+
+        parallelBegin(1);
+
+        /* R/W stays high for the whole read */
+        if (rtn == OK && gParallelConfig.bus == parallel6800)
+        {
+            REG_WRITE(PARALLEL_GPSET0, gParallelRead);
+        }
+
+        for (index = 0; index < count && rtn == OK; index++)
+        {
+            if (gParallelConfig.bus == parallel8080)
+            {
+                REG_WRITE(PARALLEL_GPCLR0, gParallelRead);
+                timeWaitUntil(timeNowNs() + hold_ns, PARALLEL_SPIN_NS);
+                levels = REG_READ(PARALLEL_GPLEV0);
+                REG_WRITE(PARALLEL_GPSET0, gParallelRead);
+            }
+
+            else
+            {
+                REG_WRITE(PARALLEL_GPSET0, gParallelStrobe);
+                timeWaitUntil(timeNowNs() + hold_ns, PARALLEL_SPIN_NS);
+                levels = REG_READ(PARALLEL_GPLEV0);
+                REG_WRITE(PARALLEL_GPCLR0, gParallelStrobe);
+            }
+
+            for (bit = 0, word = 0; bit < gParallelConfig.width; bit++)
+            {
+                pin = bit < 8 ? gParallelLow[0x1 << bit] : gParallelHigh[0x1 << (bit - 8)];
+                word |= levels & pin ? 0x1 << bit : 0;
+            }
+
+            if (gParallelConfig.width > 8)
+            {
+                words[index] = word;
+            }
+
+            else
+            {
+                bytes[index] = (uint8_t)word;
+            }
+
+            timeWaitUntil(timeNowNs() + hold_ns, PARALLEL_SPIN_NS);
+        }
+
+        if (gParallelConfig.bus == parallel6800)
+        {
+            REG_WRITE(PARALLEL_GPCLR0, gParallelRead);
+        }
+
+        parallelEnd();
+
+        for (pin = gParallelData; pin; pin &= pin - 1)
+        {
+            gpioSetFunction(__builtin_ctz(pin), output);
+        }
+
+        if (rtn != OK)
+        {
+            dbgPrint(DBG_INFO, "Setting the data lines to inputs failed. %s",
+                     gpioErrToString(rtn));
+        }
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Gives the frame shown by gpioParallelFlush() and marks
+ *                  all of it dirty.
+ * @details         The frame is not copied, so it must stay valid while the
+ *                  bus is open. Changes to it are only sent once marked with
+ *                  gpioParallelMarkDirty().
+ * @param[in] pixels RGB565 pixels, row after row, \p width * \p height.
+ * @param width     Columns, 1 - 65535.
+ * @param height    Rows, 1 - 65535.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelSetFrame(const uint16_t * pixels, int width, int height)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelOpen() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (pixels == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter pixels was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (width < 1 || width > 0xFFFF || height < 1 || height > 0xFFFF)
+    {
+        dbgPrint(DBG_INFO, "width %d or height %d is out of range.", width, height);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        gParallelPixels = pixels;
+        gParallelWidth = width;
+        gParallelHeight = height;
+        gParallelDirty[0].x0 = 0;
+        gParallelDirty[0].y0 = 0;
+        gParallelDirty[0].x1 = width - 1;
+        gParallelDirty[0].y1 = height - 1;
+        gParallelDirtyCount = 1;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Marks a region of the frame changed, to be sent by the
+ *                  next gpioParallelFlush().
+ * @details         The region is clipped to the frame. Overlapping regions
+ *                  are merged and once #PARALLEL_DIRTY_MAX are kept a new one
+ *                  is merged into whichever grows least.
+ * @param x         First column.
+ * @param y         First row.
+ * @param width     Columns.
+ * @param height    Rows.
+ * @return          An error from #errStatus. */
+errStatus gpioParallelMarkDirty(int x, int y, int width, int height)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tParallelRect rect;
+    tParallelRect merged;
+    long grow = 0;
+    long best = 0;
+    int found = 0;
+    int index = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen || gParallelPixels == NULL)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelSetFrame() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        rect.x0 = x > 0 ? x : 0;
+        rect.y0 = y > 0 ? y : 0;
+        rect.x1 = x + width - 1 < gParallelWidth - 1 ? x + width - 1 : gParallelWidth - 1;
+        rect.y1 = y + height - 1 < gParallelHeight - 1 ? y + height - 1 : gParallelHeight - 1;
+
+        while (rect.x0 <= rect.x1 && rect.y0 <= rect.y1)
+        {
+            /* An overlapping region is absorbed, the first found if full */
+            for (index = 0, found = -1, best = -1; index < gParallelDirtyCount; index++)
+            {
+                merged.x0 = rect.x0 < gParallelDirty[index].x0 ? rect.x0 : gParallelDirty[index].x0;
+                merged.y0 = rect.y0 < gParallelDirty[index].y0 ? rect.y0 : gParallelDirty[index].y0;
+                merged.x1 = rect.x1 > gParallelDirty[index].x1 ? rect.x1 : gParallelDirty[index].x1;
+                merged.y1 = rect.y1 > gParallelDirty[index].y1 ? rect.y1 : gParallelDirty[index].y1;
+                grow = (long)(merged.x1 - merged.x0 + 1) * (merged.y1 - merged.y0 + 1) -
+                       (long)(gParallelDirty[index].x1 - gParallelDirty[index].x0 + 1) *
+                       (gParallelDirty[index].y1 - gParallelDirty[index].y0 + 1);
+
+                if (rect.x0 <= gParallelDirty[index].x1 && gParallelDirty[index].x0 <= rect.x1 &&
+                    rect.y0 <= gParallelDirty[index].y1 && gParallelDirty[index].y0 <= rect.y1)
+                {
+                    found = index;
+                    break;
+                }
+
+                else if (gParallelDirtyCount == PARALLEL_DIRTY_MAX && (best < 0 || grow < best))
+                {
+                    found = index;
+                    best = grow;
+                }
+            }
+
+            if (found < 0)
+            {
+                gParallelDirty[gParallelDirtyCount++] = rect;
+                break;
+            }
+
+            rect.x0 = rect.x0 < gParallelDirty[found].x0 ? rect.x0 : gParallelDirty[found].x0;
+            rect.y0 = rect.y0 < gParallelDirty[found].y0 ? rect.y0 : gParallelDirty[found].y0;
+            rect.x1 = rect.x1 > gParallelDirty[found].x1 ? rect.x1 : gParallelDirty[found].x1;
+            rect.y1 = rect.y1 > gParallelDirty[found].y1 ? rect.y1 : gParallelDirty[found].y1;
+            gParallelDirty[found] = gParallelDirty[--gParallelDirtyCount];
+        }
+
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Sends the dirty regions of the frame.
+ * @details Each region is sent as #PARALLEL_DCS_COLUMN and
+ *          #PARALLEL_DCS_PAGE, each with the first and last as two bytes,
+ *          most significant first, then #PARALLEL_DCS_MEMORY_WRITE and the
+ *          pixels row after row. A pixel is one word on a bus of more than
+ *          8 lines, otherwise its high byte then its low byte.
+ * @return  An error from #errStatus. */
+errStatus gpioParallelFlush(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tParallelRect * rect = NULL;
+    const uint16_t * row = NULL;
+    uint64_t next = 0;
+    int index = 0;
+    int x = 0;
+    int y = 0;
+
+    pthread_mutex_lock(&gParallelLock);
+
+    if (!gParallelOpen || gParallelPixels == NULL)
+    {
+        dbgPrint(DBG_INFO, "gpioParallelSetFrame() has not been called.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        for (index = 0; index < gParallelDirtyCount; index++)
+        {
+            rect = &gParallelDirty[index];
+            parallelWindow(rect);
+            next = timeNowNs();
+
+            for (y = rect->y0; y <= rect->y1; y++)
+            {
+                row = gParallelPixels + (size_t)y * gParallelWidth;
+
+                for (x = rect->x0; x <= rect->x1; x++)
+                {
+                    if (gParallelConfig.width > 8)
+                    {
+                        parallelSend(row[x], &next);
+                    }
+
+                    else
+                    {
+                        parallelSend(row[x] >> 8, &next);
+                        parallelSend(row[x], &next);
+                    }
+                }
+            }
+
+            parallelEnd();
+        }
+
+        gParallelDirtyCount = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gParallelLock);
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function, adds a pin to \p pins.
+ * @param gpioNumber The pin, or -1 if \p optional.
+ * @param optional  -1 is accepted and adds nothing.
+ * @param[in,out] pins Pins so far.
+ * @return          0 if the pin is out of range or already in \p pins. */
+static int parallelPin(int gpioNumber, int optional, uint32_t * pins)
+{
+    int valid = 0;
+
+    if (gpioNumber == -1 && optional)
+    {
+        valid = 1;
+    }
+
+    else if (gpioNumber >= 0 && gpioNumber <= 31 && !(*pins & (0x1u << gpioNumber)))
+    {
+        *pins |= 0x1u << gpioNumber;
+        valid = 1;
+    }
+
+    return valid;
+}
+
+
+/**
+ * @brief           Internal function, waits half a word if the bus is paced.
+ * @param[in,out] next Time of the last edge, advanced to this one. */
+static void parallelWait(uint64_t * next)
+{
+    if (gParallelHalfNs)
+    {
+        *next += gParallelHalfNs;
+        timeWaitUntil(*next, PARALLEL_SPIN_NS);
+    }
+}
+
+
+/**
+ * @brief       Internal function, sets D/C and selects the controller.
+ * @param data  D/C high for data, otherwise low for a command. */
+static void parallelBegin(int data)
+{
+    if (data)
+    {
+        REG_WRITE(PARALLEL_GPSET0, gParallelDc);
+    }
+
+    else
+    {
+        REG_WRITE(PARALLEL_GPCLR0, gParallelDc);
+    }
+
+    if (gParallelCs)
+    {
+        REG_WRITE(PARALLEL_GPCLR0, gParallelCs);
+    }
+}
+
+
+/**
+ * @brief   Internal function, deselects the controller. */
+static void parallelEnd(void)
+{
+    if (gParallelCs)
+    {
+        REG_WRITE(PARALLEL_GPSET0, gParallelCs);
+    }
+}
+
+
+/**
+ * @brief           Internal function, writes a word.
+ * @details         An 8080 bus drops WR with the data lines cleared and
+ *                  raises it once they are set. A 6800 bus raises E with the
+ *                  data lines set and drops it once they are.
+ * @param word      The word.
+ * @param[in,out] next For parallelWait(). */
+static void parallelSend(uint32_t word, uint64_t * next)
+{
+    uint32_t set = gParallelLow[word & 0xFF] | gParallelHigh[(word >> 8) & 0xFF];
+
+    if (gParallelConfig.bus == parallel8080)
+    {
+        REG_WRITE(PARALLEL_GPCLR0, (gParallelData ^ set) | gParallelStrobe);
+        REG_WRITE(PARALLEL_GPSET0, set);
+        parallelWait(next);
+        REG_WRITE(PARALLEL_GPSET0, gParallelStrobe);
+    }
+
+    else
+    {
+        REG_WRITE(PARALLEL_GPCLR0, gParallelData ^ set);
+        REG_WRITE(PARALLEL_GPSET0, set | gParallelStrobe);
+        parallelWait(next);
+        REG_WRITE(PARALLEL_GPCLR0, gParallelStrobe);
+    }
+
+    parallelWait(next);
+}
+
+
+/**
+ * @brief       Internal function, sets the window written to \p rect and
+ *              starts a memory write, leaving D/C high for the pixels.
+ * @param rect  The region. */
+static void parallelWindow(const tParallelRect * rect)
+{
+    uint64_t next = 0;
+
+    parallelBegin(0);
+    next = timeNowNs();
+    parallelSend(PARALLEL_DCS_COLUMN, &next);
+    parallelBegin(1);
+    parallelSend(rect->x0 >> 8, &next);
+    parallelSend(rect->x0, &next);
+    parallelSend(rect->x1 >> 8, &next);
+    parallelSend(rect->x1, &next);
+    parallelBegin(0);
+    parallelSend(PARALLEL_DCS_PAGE, &next);
+    parallelBegin(1);
+    parallelSend(rect->y0 >> 8, &next);
+    parallelSend(rect->y0, &next);
+    parallelSend(rect->y1 >> 8, &next);
+    parallelSend(rect->y1, &next);
+    parallelBegin(0);
+    parallelSend(PARALLEL_DCS_MEMORY_WRITE, &next);
+    parallelBegin(1);
+}
@@ -0,0 +1,387 @@
+/**
+ * @file
+ *  @brief Contains source for mapping the peripheral blocks.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "periph.h"
+
+/* Local / internal prototypes */
+static errStatus periphMapFile(const char * path, off_t offset, size_t size,
+                               volatile uint32_t ** map);
+static int periphCombined(uint32_t offset);
+
+/** @brief A peripheral block which may share the combined mapping. */
+typedef struct {
+    eMapBlock block;   /**< Flag passed to gpioSetMapBlocks() */
+    uint32_t offset;   /**< Offset from the peripheral base */
+} tPeriphBlock;
+
+/** @brief Every peripheral block the library may use. */
+static const tPeriphBlock periphBlocks[] = {
+    {mapBlockGpio, GPIO_BASE_OFFSET},
+    {mapBlockBsc0, BSC0_BASE_OFFSET},
+    {mapBlockBsc1, BSC1_BASE_OFFSET},
+    {mapBlockCm,   CM_BASE_OFFSET},
+    {mapBlockPwm,  PWM_BASE_OFFSET},
+    {mapBlockPcm,  PCM_BASE_OFFSET},
+    {mapBlockDma,  DMA_BASE_OFFSET},
+};
+
+/** @brief Number of entries in periphBlocks. */
+#define PERIPH_BLOCK_COUNT  (sizeof(periphBlocks) / sizeof(periphBlocks[0]))
+
+/**** Globals ****/
+/** @brief How peripheral blocks are mapped. */
+static eMapMode gMapMode = mapAuto;
+
+/** @brief #eMapBlock flags of the blocks held by the combined mapping. */
+static uint32_t gMapBlocks = mapBlockGpio;
+
+/** @brief Number of periphMap() calls not yet matched by periphUnmap(). */
+static int gMapCount = 0;
+
+/** @brief The combined mapping when in #mapCombined mode. */
+static volatile uint32_t * gWindow = NULL;
+
+/** @brief Peripheral offset (page aligned) at which gWindow starts. */
+static uint32_t gWindowStart = 0;
+
+/** @brief Size of gWindow in bytes. */
+static size_t gWindowSize = 0;
+
+/** @brief Number of blocks currently handed out from gWindow. */
+static int gWindowCount = 0;
+
+/**
+ * @brief       Selects how the peripheral blocks are mapped.
+ * @details     This must be called before gpioSetup(). In the default
+ *              #mapAuto mode GPIO is mapped through /dev/gpiomem, which does
+ *              not require root, falling back to /dev/mem. The other blocks
+ *              always come from /dev/mem. Every mapping is a single page.
+ *              In #mapCombined mode a single /dev/mem mapping spans the
+ *              blocks chosen with gpioSetMapBlocks(), only GPIO by default,
+ *              and any other block gets its own page from /dev/mem.
+ * @param mode  The mapping mode to use.
+ * @return      An error from #errStatus. */
+errStatus gpioSetMapMode(eMapMode mode)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (mode < mapAuto || mode > mapCombined)
+    {
+        dbgPrint(DBG_INFO, "mode value: %d was out of range.", mode);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gMapCount != 0)
+    {
+        dbgPrint(DBG_INFO, "Mapping mode must be set before gpioSetup().");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else
+    {
+        gMapMode = mode;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/**
+ * @brief           Selects the blocks held by the #mapCombined mapping.
+ * @details         This must be called before gpioSetup(). The mapping runs
+ *                  from the lowest to the highest block chosen, so choosing
+ *                  blocks far apart maps everything in between: DMA with
+ *                  BSC1 is about 8 MB. Under CONFIG_IO_STRICT_DEVMEM a block
+ *                  claimed by a kernel driver, such as BSC1 by i2c-bcm2835,
+ *                  cannot be mapped, so leave such blocks out of the set.
+ * @param blocks    #eMapBlock flags combined with bitwise OR.
+ * @return          An error from #errStatus. */
+errStatus gpioSetMapBlocks(uint32_t blocks)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (blocks == 0 || (blocks & ~(uint32_t)mapBlockAll) != 0)
+    {
+        dbgPrint(DBG_INFO, "blocks value: 0x%x was out of range.", blocks);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gMapCount != 0)
+    {
+        dbgPrint(DBG_INFO, "Mapping blocks must be set before gpioSetup().");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else
+    {
+        gMapBlocks = blocks;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which maps a peripheral block.
+ * @details             The block is mapped as one page aligned page, or found
+ *                      within the combined mapping if gpioSetMapBlocks()
+ *                      chose it.
+ * @param[in] board     Board table entry providing the peripheral base.
+ * @param offset        Offset of the block from the peripheral base, e.g.
+ *                      #GPIO_BASE_OFFSET.
+ * @param[out] map      Populated with a pointer to the first register of the
+ *                      block.
+ * @return              An error from #errStatus. */
+errStatus periphMap(const tBoard * board, uint32_t offset, volatile uint32_t ** map)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    off_t physical = 0;
+    off_t aligned = 0;
+    volatile uint32_t * page = NULL;
+    unsigned int index = 0;
+
+    if (board == NULL || map == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter board or map was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (gMapMode == mapCombined && periphCombined(offset))
+    {
+        if (gWindow == NULL)
+        {
+            uint32_t first = offset;
+            uint32_t last = offset;
+
+            for (index = 0; index < PERIPH_BLOCK_COUNT; index++)
+            {
+                if (gMapBlocks & periphBlocks[index].block)
+                {
+                    first = periphBlocks[index].offset < first ?
+                            periphBlocks[index].offset : first;
+                    last = periphBlocks[index].offset > last ?
+                           periphBlocks[index].offset : last;
+                }
+            }
+
+            gWindowStart = first & ~(pageSize - 1);
+            gWindowSize = ((last - gWindowStart) & ~(pageSize - 1)) + pageSize;
+
+            rtn = periphMapFile(PERIPH_DEV_MEM,
+                                (off_t)board->peripheralBase + gWindowStart,
+                                gWindowSize, &gWindow);
+        }
+
+        else
+        {
+            rtn = OK;
+        }
+
+        if (rtn != OK)
+        {
+            dbgPrint(DBG_INFO, "Combined mapping failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            *map = gWindow + (offset - gWindowStart) / sizeof(uint32_t);
+            gWindowCount++;
+            gMapCount++;
+        }
+    }
+
+    else
+    {
+        /* /dev/gpiomem always maps the GPIO block at offset 0 */
+        if (offset == GPIO_BASE_OFFSET &&
+            (gMapMode == mapAuto || gMapMode == mapGpiomem))
+        {
+            rtn = periphMapFile(PERIPH_DEV_GPIOMEM, 0, pageSize, &page);
+
+            if (rtn == OK)
+            {
+                *map = page;
+            }
+
+            else if (gMapMode == mapGpiomem)
+            {
+                dbgPrint(DBG_INFO, "%s could not be mapped.", PERIPH_DEV_GPIOMEM);
+            }
+        }
+
+        else if (gMapMode == mapGpiomem)
+        {
+            dbgPrint(DBG_INFO, "%s only exposes GPIO. Offset 0x%x unavailable.",
+                     PERIPH_DEV_GPIOMEM, offset);
+            rtn = ERROR_RANGE;
+        }
+
+        if (rtn != OK && gMapMode != mapGpiomem)
+        {
+            physical = (off_t)board->peripheralBase + offset;
+            aligned = physical & ~((off_t)pageSize - 1);
+
+            if ((rtn = periphMapFile(PERIPH_DEV_MEM, aligned, pageSize, &page)) == OK)
+            {
+                *map = page + (physical - aligned) / sizeof(uint32_t);
+            }
+        }
+
+        if (rtn == OK)
+        {
+            gMapCount++;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Internal function which unmaps a block mapped by periphMap().
+ * @details     The combined mapping is only unmapped once every block within
+ *              it has been unmapped.
+ * @param map   The pointer returned by periphMap().
+ * @return      An error from #errStatus. */
+errStatus periphUnmap(volatile uint32_t * map)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uintptr_t pageMask = (uintptr_t)sysconf(_SC_PAGESIZE) - 1;
+
+    if (map == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter map was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (gWindow != NULL && map >= gWindow &&
+             map < gWindow + gWindowSize / sizeof(uint32_t))
+    {
+        rtn = OK;
+        gMapCount--;
+
+        if (--gWindowCount == 0)
+        {
+            if (munmap((void *)gWindow, gWindowSize) != OK)
+            {
+                dbgPrint(DBG_INFO, "munmap() failed. errno: %s.", strerror(errno));
+                rtn = ERROR_EXTERNAL;
+            }
+            gWindow = NULL;
+        }
+    }
+
+    else if (munmap((void *)((uintptr_t)map & ~pageMask), pageMask + 1) != OK)
+    {
+        dbgPrint(DBG_INFO, "munmap() failed. errno: %s.", strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        gMapCount--;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which maps \p size bytes of \p path.
+ * @param[in] path      Device to open.
+ * @param offset        Page aligned offset into the device.
+ * @param size          Number of bytes to map.
+ * @param[out] map      Populated with the mapping.
+ * @return              An error from #errStatus. */
+static errStatus periphMapFile(const char * path, off_t offset, size_t size,
+                               volatile uint32_t ** map)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    int mem_fd = 0;
+    void * mapping = MAP_FAILED;
+
+    if ((mem_fd = open(path, O_RDWR | O_SYNC)) < 0)
+    {
+        dbgPrint(DBG_INFO, "open() failed. %s. errno %s.", path, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        mapping = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, mem_fd, offset);
+
+        if (mapping == MAP_FAILED)
+        {
+            dbgPrint(DBG_INFO, "mmap() failed. %s. errno: %s.", path, strerror(errno));
+            rtn = ERROR_EXTERNAL;
+        }
+
+        /* Close the fd, we have now mapped it */
+        else if (close(mem_fd) != OK)
+        {
+            dbgPrint(DBG_INFO, "close() failed. errno: %s.", strerror(errno));
+            munmap(mapping, size);
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            *map = (volatile uint32_t *)mapping;
+            rtn = OK;
+        }
+
+        if (rtn != OK && mapping == MAP_FAILED)
+        {
+            close(mem_fd);
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function which checks whether a block belongs in
+ *                  the combined mapping.
+ * @param offset    Offset of the block from the peripheral base.
+ * @return          1 if gpioSetMapBlocks() chose the block, else 0. */
+static int periphCombined(uint32_t offset)
+{
+    int combined = 0;
+    unsigned int index = 0;
+
+    for (index = 0; index < PERIPH_BLOCK_COUNT; index++)
+    {
+        if (periphBlocks[index].offset == offset &&
+            (gMapBlocks & periphBlocks[index].block))
+        {
+            combined = 1;
+        }
+    }
+
+    return combined;
+}
@@ -0,0 +1,469 @@
+/**
+ * @file
+ *  @brief Contains source for the pulse width and frequency measurement.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A thread samples GPLEV0 every period and timestamps each edge of the
+ *  measured pins at the middle of the period in which it happened, so a
+ *  single edge is uncertain by up to a period either way. Period and high
+ *  time are instead measured from the first to the last edge of a window of
+ *  cycles, so the uncertainty is divided by the cycles in the window and
+ *  scheduler jitter averages out. Window sums are kept as the edges arrive,
+ *  so an edge costs the same whatever the window. GPEDS0 is read alongside
+ *  GPLEV0 to count pulses too short to be seen in a sample. Edge detection
+ *  is shared with encoder.c through gpioEdgeDetect(), and interrupts the
+ *  kernel while it is enabled, see "Edge Detection and the Kernel" in the
+ *  usage page.
+ */
+
+#include "pulse.h"
+
+/* Local / internal prototypes */
+static void pulsePublish(int pin, const tPulseChannel * channel);
+static void pulseEdge(tPulseChannel * channel, int rising, uint64_t time_ns);
+static void * pulseThread(void * unused);
+
+/**** Globals ****/
+/** @brief Protects the configuration. */
+static pthread_mutex_t gPulseLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Bit n set if GPIO n is measured. */
+static uint32_t gPulsePins = 0;
+
+/** @brief Window of each pin as given to gpioPulseAdd(). */
+static uint32_t gPulseWindow[PULSE_CHANNELS];
+
+/** @brief Changed each time a pin is added, so old measurements are ignored. */
+static uint32_t gPulseGeneration[PULSE_CHANNELS];
+
+/** @brief Last generation handed out. */
+static uint32_t gPulseGenerationLast = 0;
+
+/** @brief Non zero when the configuration has changes the thread has not seen. */
+static volatile int gPulseDirty = 0;
+
+/** @brief Measurement of each pin as last published by the thread. */
+static tPulsePublished gPulsePublished[PULSE_CHANNELS];
+
+/** @brief The thread's state of each pin. Only used by the thread. */
+static tPulseChannel gPulseChannels[PULSE_CHANNELS];
+
+/** @brief Sampling period. */
+static uint32_t gPulsePeriod_ns = 0;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gPulseMap = NULL;
+
+/** @brief The sampling thread. */
+static pthread_t gPulseThread;
+
+/** @brief Non zero while the sampling thread should run. */
+static volatile int gPulseRunning = 0;
+
+/**
+ * @brief           Starts the pulse measurement thread.
+ * @details         gpioSetup() must have been called. The thread is given
+ *                  SCHED_FIFO priority if permitted, and run only on \p cpu
+ *                  if \p cpu is not negative. High and low times shorter
+ *                  than the period are not measured. Pins are added with
+ *                  gpioPulseAdd().
+ * @param period_ns The sampling period, #PULSE_PERIOD_MIN_NS to
+ *                  #PULSE_PERIOD_MAX_NS.
+ * @param cpu       The cpu to run on, or -1 for any.
+ * @return          An error from #errStatus. */
+errStatus gpioPulseStart(uint32_t period_ns, int cpu)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gPulseRunning)
+    {
+        dbgPrint(DBG_INFO, "Pulse measurement is already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (period_ns < PULSE_PERIOD_MIN_NS || period_ns > PULSE_PERIOD_MAX_NS)
+    {
+        dbgPrint(DBG_INFO, "period_ns %u is out of range.", period_ns);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (cpu >= CPU_SETSIZE)
+    {
+        dbgPrint(DBG_INFO, "cpu %d is out of range.", cpu);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetRegisters(&gPulseMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        memset(gPulsePublished, 0, sizeof(gPulsePublished));
+        memset(gPulseChannels, 0, sizeof(gPulseChannels));
+        gPulsePins = 0;
+        gPulsePeriod_ns = period_ns;
+        gPulseDirty = 1;
+        gPulseRunning = 1;
+
+        if ((errno = pthread_create(&gPulseThread, NULL, pulseThread, NULL)) != 0)
+        {
+            dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+            gPulseRunning = 0;
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            timeThreadRealtime(gPulseThread, cpu, "Pulse");
+
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Starts measuring a pin, or restarts it with a new
+ *                      window.
+ * @details             The pin's function is left alone, so an output can
+ *                      be measured as well as an input. Edge detection is
+ *                      enabled on the pin.
+ * @param gpioNumber    The pin, GPIO00 - GPIO31.
+ * @param window        Cycles averaged, 1 to #PULSE_WINDOW_MAX. Longer
+ *                      windows are more precise but slower to follow a
+ *                      change.
+ * @return              An error from #errStatus. */
+errStatus gpioPulseAdd(int gpioNumber, uint32_t window)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gPulseRunning)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioPulseStart() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (gpioNumber < 0 || gpioNumber >= PULSE_CHANNELS)
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %d can not be measured.", gpioNumber);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (window < 1 || window > PULSE_WINDOW_MAX)
+    {
+        dbgPrint(DBG_INFO, "window %u is not 1 - %u.", window, PULSE_WINDOW_MAX);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gPulseLock);
+        gPulseWindow[gpioNumber] = window;
+        __atomic_store_n(&gPulseGeneration[gpioNumber], ++gPulseGenerationLast,
+                         __ATOMIC_RELAXED);
+        gPulsePins |= 0x1u << gpioNumber;
+        gpioEdgeDetect(0x1u << gpioNumber, 1);
+        gPulseDirty = 1;
+        pthread_mutex_unlock(&gPulseLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Stops measuring a pin and disables its edge detection.
+ * @param gpioNumber    The pin.
+ * @return              An error from #errStatus. */
+errStatus gpioPulseRemove(int gpioNumber)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gpioNumber < 0 || gpioNumber >= PULSE_CHANNELS ||
+        !(gPulsePins & (0x1u << gpioNumber)))
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %d is not measured.", gpioNumber);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gPulseLock);
+        gPulsePins &= ~(0x1u << gpioNumber);
+        gpioEdgeDetect(0x1u << gpioNumber, 0);
+        gPulseDirty = 1;
+        pthread_mutex_unlock(&gPulseLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reads a pin's measurement.
+ * @details             Takes no lock, so may be called at any rate from any
+ *                      thread without delaying the sampling thread. Until
+ *                      the thread has sampled a newly added pin its
+ *                      measurement reads as zero.
+ * @param gpioNumber    The pin.
+ * @param[out] measure  Populated with the pin's measurement.
+ * @return              An error from #errStatus. */
+errStatus gpioPulseRead(int gpioNumber, tPulseMeasure * measure)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tPulsePublished * published = NULL;
+    uint32_t sequence = 0;
+    uint32_t generation = 0;
+
+    if (measure == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter measure was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (gpioNumber < 0 || gpioNumber >= PULSE_CHANNELS ||
+             !(gPulsePins & (0x1u << gpioNumber)))
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %d is not measured.", gpioNumber);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        published = &gPulsePublished[gpioNumber];
+
+        do
+        {
+            sequence = seqReadBegin(&published->sequence);
+            generation = published->generation;
+            *measure = published->measure;
+        } while (seqReadRetry(&published->sequence, sequence));
+
+        if (generation != __atomic_load_n(&gPulseGeneration[gpioNumber], __ATOMIC_RELAXED))
+        {
+            memset(measure, 0, sizeof(*measure));
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the sampling thread and every measurement.
+ * @return  An error from #errStatus. */
+errStatus gpioPulseStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gPulseRunning)
+    {
+        dbgPrint(DBG_INFO, "Pulse measurement is not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gPulseRunning = 0;
+        pthread_join(gPulseThread, NULL);
+
+        pthread_mutex_lock(&gPulseLock);
+        gpioEdgeDetect(gPulsePins, 0);
+        gPulsePins = 0;
+        pthread_mutex_unlock(&gPulseLock);
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function which publishes a pin's measurement.
+ * @param pin       The pin.
+ * @param channel   The thread's state of the pin.
+ */
+static void pulsePublish(int pin, const tPulseChannel * channel)
+{
+    tPulsePublished * published = &gPulsePublished[pin];
+
+    seqWriteBegin(&published->sequence);
+    published->generation = channel->generation;
+    published->measure = channel->measure;
+    seqWriteEnd(&published->sequence);
+}
+
+
+/**
+ * @brief           Internal function which records an edge.
+ * @details         A rising edge completes a cycle, which is added to the
+ *                  window sums while the oldest cycle is dropped from them.
+ * @param channel   The thread's state of the pin.
+ * @param rising    Non zero for a rising edge.
+ * @param time_ns   When the edge happened.
+ */
+static void pulseEdge(tPulseChannel * channel, int rising, uint64_t time_ns)
+{
+    tPulseMeasure * measure = &channel->measure;
+    uint32_t slots = channel->window + 1;
+    uint32_t oldest = 0;
+    uint64_t cycles = 0;
+
+    measure->edges++;
+    measure->lastEdge_ns = time_ns;
+
+    if (!rising)
+    {
+        if (channel->rises > 0)
+        {
+            channel->high[channel->newest] = time_ns - channel->rise[channel->newest];
+        }
+    }
+
+    else
+    {
+        if (channel->rises > 0)
+        {
+            channel->highSum += channel->high[channel->newest];
+        }
+
+        channel->newest = (channel->newest + 1) % slots;
+
+        /* The slot overwritten held the oldest cycle of a full window */
+        if (channel->rises > channel->window)
+        {
+            channel->highSum -= channel->high[channel->newest];
+        }
+
+        channel->rise[channel->newest] = time_ns;
+        channel->high[channel->newest] = 0;
+        channel->rises++;
+
+        cycles = channel->rises - 1 < channel->window ? channel->rises - 1 : channel->window;
+
+        if (cycles > 0)
+        {
+            oldest = (channel->newest + slots - cycles) % slots;
+            measure->cycles = cycles;
+            measure->period_ns = (time_ns - channel->rise[oldest]) / cycles;
+            measure->high_ns = channel->highSum / cycles;
+            measure->duty = measure->period_ns ?
+                (uint32_t)(channel->highSum * PWM_DUTY_MAX / (time_ns - channel->rise[oldest])) : 0;
+            measure->frequency_mHz = measure->period_ns ?
+                (uint32_t)(TIMING_NSEC_IN_SEC * 1000 / measure->period_ns) : 0;
+        }
+    }
+}
+
+
+/**
+ * @brief   Internal function run by the sampling thread.
+ * @details Each period reads and clears GPEDS0 then reads GPLEV0. A pin
+ *          which changed has had an edge at some time since the last
+ *          sample. A pin with an event which did not change had a pulse
+ *          between samples, unless it changed in the last sample, as its
+ *          edge may have come after that sample's GPEDS0 was cleared.
+ * @return  NULL */
+static void * pulseThread(void * unused)
+{
+    tPulseChannel * channel = NULL;
+    uint32_t pins = 0;
+    uint32_t events = 0;
+    uint32_t levels = REG_READ(PULSE_GPLEV0);
+    uint32_t previous = levels;
+    uint32_t changed = 0;
+    uint32_t lastChanged = 0;
+    uint32_t glitched = 0;
+    uint32_t pending = 0;
+    uint64_t last = timeNowNs();
+    uint64_t next = last;
+    uint64_t now = 0;
+    int pin = 0;
+
+    while (gPulseRunning)
+    {
+        if (gPulseDirty && pthread_mutex_trylock(&gPulseLock) == 0)
+        {
+            gPulseDirty = 0;
+            pins = gPulsePins;
+
+            for (pending = pins; pending; pending &= pending - 1)
+            {
+                pin = __builtin_ctz(pending);
+                channel = &gPulseChannels[pin];
+
+                if (channel->generation != gPulseGeneration[pin])
+                {
+                    memset(channel, 0, sizeof(*channel));
+                    channel->generation = gPulseGeneration[pin];
+                    channel->window = gPulseWindow[pin];
+                    pulsePublish(pin, channel);
+                }
+            }
+            pthread_mutex_unlock(&gPulseLock);
+        }
+
+        if ((events = REG_READ(PULSE_GPEDS0) & pins) != 0)
+        {
+            REG_WRITE(PULSE_GPEDS0, events);
+        }
+
+        levels = REG_READ(PULSE_GPLEV0);
+        now = timeNowNs();
+        changed = (levels ^ previous) & pins;
+        glitched = events & ~changed & ~lastChanged;
+
+        for (pending = changed | glitched; pending; pending &= pending - 1)
+        {
+            pin = __builtin_ctz(pending);
+            channel = &gPulseChannels[pin];
+
+            if (changed & (0x1u << pin))
+            {
+                pulseEdge(channel, levels & (0x1u << pin), last + (now - last) / 2);
+            }
+
+            else
+            {
+                channel->measure.glitches++;
+            }
+
+            pulsePublish(pin, channel);
+        }
+
+        previous = levels;
+        lastChanged = changed;
+        last = now;
+        timeNextPeriod(&next, gPulsePeriod_ns);
+        timeWaitUntil(next, PULSE_SPIN_NS);
+    }
+
+    return NULL;
+}
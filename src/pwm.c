@@ -0,0 +1,507 @@
+/**
+ * @file
+ *  @brief Contains source for the hardware PWM and general purpose clock
+ *  functionality.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Both PWM channels share one clock from the clock manager. Each channel is
+ *  run in mark-space mode, high for DAT clocks of every RNG clocks, so the
+ *  frequency is the PWM clock / RNG and the duty DAT / RNG.
+ */
+
+#include "pwm.h"
+
+/* Local / internal prototypes */
+static errStatus pwmFindPin(const tPwmPin * table, size_t count, int gpioNumber,
+                            const tPwmPin ** pin);
+
+/** @brief Header pins which can carry a PWM channel. */
+static const tPwmPin pwmPins[] = {
+    {12, 0, alt0},
+    {13, 1, alt0},
+    {18, 0, alt5},
+    {19, 1, alt5},
+};
+
+/** @brief Header pins which can carry a general purpose clock. */
+static const tPwmPin clockPins[] = {
+    {4,  0, alt0},
+    {5,  1, alt0},
+    {6,  2, alt0},
+    {20, 0, alt5},
+    {21, 1, alt5},
+};
+
+/**** Globals ****/
+/** @brief Pointer which will be mmaped to the PWM registers. */
+static volatile uint32_t * gPwmMap = NULL;
+
+/** @brief Pointer which will be mmaped to the clock manager registers. */
+static volatile uint32_t * gCmMap = NULL;
+
+/** @brief Oscillator frequency of the board in use. */
+static uint32_t gOscillatorHz = 0;
+
+/** @brief Frequency the PWM clock is running at. */
+static uint32_t gPwmClockHz = 0;
+
+/**
+ * @brief   Maps the PWM and clock manager registers and starts the PWM clock
+ *          at #PWM_DEFAULT_CLOCK_HZ.
+ * @details gpioSetup() must have been called. Neither block is available
+ *          through /dev/gpiomem so this requires root.
+ * @return  An error from #errStatus. */
+errStatus gpioPwmSetup(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tBoard * board = NULL;
+
+    if (gPwmMap != NULL)
+    {
+        dbgPrint(DBG_INFO, "gpioPwmSetup() has already been called.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if ((rtn = gpioGetBoard(&board)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetBoard() failed. Ensure gpioSetup() was called.");
+    }
+
+    else if ((rtn = periphMap(board, CM_BASE_OFFSET, &gCmMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "periphMap() failed for the clock manager. %s",
+                 gpioErrToString(rtn));
+        gCmMap = NULL;
+    }
+
+    else if ((rtn = periphMap(board, PWM_BASE_OFFSET, &gPwmMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "periphMap() failed for PWM. %s", gpioErrToString(rtn));
+        periphUnmap(gCmMap);
+        gCmMap = NULL;
+        gPwmMap = NULL;
+    }
+
+    else
+    {
+        gOscillatorHz = board->oscillatorHz;
+
+        /* Both channels off until configured */
+        REG_WRITE(PWM_REG(PWM_CTL_OFFSET), 0);
+
+        if ((rtn = gpioPwmSetClock(PWM_DEFAULT_CLOCK_HZ)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioPwmSetClock() failed. %s", gpioErrToString(rtn));
+            gpioPwmCleanup();
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops both PWM channels, the PWM clock and the general purpose
+ *          clocks, and unmaps the registers.
+ * @return  An error from #errStatus. */
+errStatus gpioPwmCleanup(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gPwmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gPwmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        REG_WRITE(PWM_REG(PWM_CTL_OFFSET), 0);
+
+        cmStop(CM_PWMCTL_OFFSET);
+        cmStop(CM_GP0CTL_OFFSET);
+        cmStop(CM_GP1CTL_OFFSET);
+        cmStop(CM_GP2CTL_OFFSET);
+
+        if ((rtn = periphUnmap(gPwmMap)) != OK ||
+            (rtn = periphUnmap(gCmMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "periphUnmap() failed. %s", gpioErrToString(rtn));
+        }
+
+        gPwmMap = NULL;
+        gCmMap = NULL;
+        gPwmClockHz = 0;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Sets the clock shared by both PWM channels.
+ * @details             The clock is the oscillator divided by an integer, the
+ *                      fractional divider is not used as it adds jitter to
+ *                      every period. Channels already running change
+ *                      frequency in proportion.
+ * @param frequencyHz   Desired clock. The nearest achievable is used, from
+ *                      the oscillator / #CM_DIVI_MAX to the oscillator / 2.
+ * @return              An error from #errStatus. */
+errStatus gpioPwmSetClock(uint32_t frequencyHz)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t divi = 0;
+
+    if (gPwmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gPwmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (frequencyHz == 0 ||
+             (divi = (gOscillatorHz + frequencyHz / 2) / frequencyHz) < 2 ||
+             divi > CM_DIVI_MAX)
+    {
+        dbgPrint(DBG_INFO, "frequencyHz %u can not be divided from %u Hz.",
+                 frequencyHz, gOscillatorHz);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = cmStart(CM_PWMCTL_OFFSET, CM_PWMDIV_OFFSET, CM_SRC_OSC,
+                            divi << CM_DIVI_SHIFT)) != OK)
+    {
+        dbgPrint(DBG_INFO, "cmStart() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        gPwmClockHz = gOscillatorHz / divi;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Outputs PWM on a pin.
+ * @details             GPIO12 and GPIO18 carry channel 1, GPIO13 and GPIO19
+ *                      channel 2. Pins sharing a channel share its output.
+ * @param gpioNumber    The pin.
+ * @param frequencyHz   Frequency, up to the PWM clock / 2. The period is a
+ *                      whole number of PWM clocks so the frequency is rounded.
+ * @param duty          Fraction of each period high, 0 to #PWM_DUTY_MAX.
+ * @return              An error from #errStatus. */
+errStatus gpioPwmSetOutput(int gpioNumber, uint32_t frequencyHz, uint32_t duty)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tPwmPin * pin = NULL;
+    uint32_t range = 0;
+    uint32_t shift = 0;
+
+    if (gPwmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gPwmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = pwmFindPin(pwmPins, sizeof(pwmPins) / sizeof(pwmPins[0]),
+                               gpioNumber, &pin)) != OK)
+    {
+        dbgPrint(DBG_INFO, "GPIO%d can not output PWM.", gpioNumber);
+    }
+
+    else if (frequencyHz == 0 || (range = gPwmClockHz / frequencyHz) < 2)
+    {
+        dbgPrint(DBG_INFO, "frequencyHz %u is above half the %u Hz PWM clock.",
+                 frequencyHz, gPwmClockHz);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (duty > PWM_DUTY_MAX)
+    {
+        dbgPrint(DBG_INFO, "duty %u is above %d.", duty, PWM_DUTY_MAX);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        shift = pin->channel * PWM_CTL_CHANNEL_SHIFT;
+
+        REG_WRITE(PWM_REG(pin->channel ? PWM_RNG2_OFFSET : PWM_RNG1_OFFSET), range);
+        REG_WRITE(PWM_REG(pin->channel ? PWM_DAT2_OFFSET : PWM_DAT1_OFFSET),
+                  (uint32_t)((uint64_t)range * duty / PWM_DUTY_MAX));
+        REG_WRITE(PWM_REG(PWM_CTL_OFFSET), REG_READ(PWM_REG(PWM_CTL_OFFSET)) |
+                  ((PWM_MSEN1 | PWM_PWEN1) << shift));
+
+        if ((rtn = gpioSetFunction(gpioNumber, pin->function)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Stops the PWM channel carried by a pin.
+ * @details             The channel idles low. The pin keeps its function.
+ * @param gpioNumber    The pin.
+ * @return              An error from #errStatus. */
+errStatus gpioPwmStop(int gpioNumber)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tPwmPin * pin = NULL;
+
+    if (gPwmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gPwmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = pwmFindPin(pwmPins, sizeof(pwmPins) / sizeof(pwmPins[0]),
+                               gpioNumber, &pin)) != OK)
+    {
+        dbgPrint(DBG_INFO, "GPIO%d can not output PWM.", gpioNumber);
+    }
+
+    else
+    {
+        REG_WRITE(PWM_REG(PWM_CTL_OFFSET), REG_READ(PWM_REG(PWM_CTL_OFFSET)) &
+                  ~(PWM_PWEN1 << (pin->channel * PWM_CTL_CHANNEL_SHIFT)));
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Outputs a general purpose clock on a pin.
+ * @details             GPIO4 / GPIO20 carry GPCLK0, GPIO5 / GPIO21 GPCLK1 and
+ *                      GPIO6 GPCLK2. The oscillator is divided with a 12 bit
+ *                      fraction, using one stage of MASH noise shaping when
+ *                      the fraction is not zero, so the average frequency is
+ *                      exact while individual periods vary by one oscillator
+ *                      cycle.
+ * @param gpioNumber    The pin.
+ * @param frequencyHz   Frequency, from the oscillator / #CM_DIVI_MAX to the
+ *                      oscillator / 2.
+ * @return              An error from #errStatus. */
+errStatus gpioClockStart(int gpioNumber, uint32_t frequencyHz)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tPwmPin * pin = NULL;
+    uint64_t divisor = 0;
+
+    if (gCmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gCmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = pwmFindPin(clockPins, sizeof(clockPins) / sizeof(clockPins[0]),
+                               gpioNumber, &pin)) != OK)
+    {
+        dbgPrint(DBG_INFO, "GPIO%d can not output a clock.", gpioNumber);
+    }
+
+    else if (frequencyHz == 0 ||
+             (divisor = (((uint64_t)gOscillatorHz << CM_DIVF_BITS) + frequencyHz / 2) /
+                        frequencyHz) < (2 << CM_DIVF_BITS) ||
+             divisor > ((uint64_t)CM_DIVI_MAX << CM_DIVF_BITS))
+    {
+        dbgPrint(DBG_INFO, "frequencyHz %u can not be divided from %u Hz.",
+                 frequencyHz, gOscillatorHz);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = cmStart(CM_GP0CTL_OFFSET + pin->channel * 8,
+                            CM_GP0DIV_OFFSET + pin->channel * 8,
+                            CM_SRC_OSC, (uint32_t)divisor)) != OK)
+    {
+        dbgPrint(DBG_INFO, "cmStart() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioSetFunction(gpioNumber, pin->function)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Stops the general purpose clock carried by a pin and
+ *                      returns the pin to an input.
+ * @param gpioNumber    The pin.
+ * @return              An error from #errStatus. */
+errStatus gpioClockStop(int gpioNumber)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tPwmPin * pin = NULL;
+
+    if (gCmMap == NULL)
+    {
+        dbgPrint(DBG_INFO, "gCmMap was NULL. Ensure gpioPwmSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = pwmFindPin(clockPins, sizeof(clockPins) / sizeof(clockPins[0]),
+                               gpioNumber, &pin)) != OK)
+    {
+        dbgPrint(DBG_INFO, "GPIO%d can not output a clock.", gpioNumber);
+    }
+
+    else if ((rtn = cmStop(CM_GP0CTL_OFFSET + pin->channel * 8)) != OK)
+    {
+        dbgPrint(DBG_INFO, "cmStop() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioSetFunction(gpioNumber, input)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which looks up a pin in \p table.
+ * @param[in] table     #pwmPins or #clockPins.
+ * @param count         Entries in \p table.
+ * @param gpioNumber    The pin.
+ * @param[out] pin      Populated with the entry.
+ * @return              #ERROR_INVALID_PIN_NUMBER if the pin is not in \p table. */
+static errStatus pwmFindPin(const tPwmPin * table, size_t count, int gpioNumber,
+                            const tPwmPin ** pin)
+{
+    errStatus rtn = ERROR_INVALID_PIN_NUMBER;
+    size_t index = 0;
+
+    for (index = 0; index < count; index++)
+    {
+        if (table[index].gpioNumber == gpioNumber)
+        {
+            *pin = &table[index];
+            rtn = OK;
+            break;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which provides the PWM and clock
+ *                      manager registers to other modules, e.g. DMA pacing.
+ * @param[out] pwm      Populated with the PWM registers.
+ * @param[out] cm       Populated with the clock manager registers.
+ * @return              #ERROR_NOT_INITIALISED if gpioPwmSetup() has not been
+ *                      called. */
+errStatus pwmGetRegisters(volatile uint32_t ** pwm, volatile uint32_t ** cm)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (pwm == NULL || cm == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter pwm or cm was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (gPwmMap == NULL)
+    {
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        *pwm = gPwmMap;
+        *cm = gCmMap;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which stops a clock generator and
+ *                      waits for it to finish its current cycle.
+ * @details             gpioPwmSetup() must have been called.
+ * @param ctlOffset     Offset of the generator's control register.
+ * @return              An error from #errStatus. */
+errStatus cmStop(uint32_t ctlOffset)
+{
+    errStatus rtn = ERROR_EXTERNAL;
+    struct timespec sleepTime = {0, 1000};
+    int polls = 0;
+
+    REG_WRITE(CM_REG(ctlOffset), CM_PASSWD | (REG_READ(CM_REG(ctlOffset)) & ~CM_ENAB & 0xFFFFFF));
+
+    for (polls = 0; polls < CM_BUSY_POLLS; polls++)
+    {
+        if (!(REG_READ(CM_REG(ctlOffset)) & CM_BUSY))
+        {
+            rtn = OK;
+            break;
+        }
+
+        nanosleep(&sleepTime, NULL);
+    }
+
+    if (rtn != OK)
+    {
+        dbgPrint(DBG_INFO, "Clock at offset 0x%x did not stop.", ctlOffset);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which (re)starts a clock generator.
+ * @details             The divisor may only be changed while the generator
+ *                      is stopped, so it is stopped first. gpioPwmSetup()
+ *                      must have been called.
+ * @param ctlOffset     Offset of the generator's control register.
+ * @param divOffset     Offset of the generator's divisor register.
+ * @param source        #CM_SRC_OSC or #CM_SRC_PLLD.
+ * @param divisor       DIVI and DIVF. MASH 1 is used if DIVF is not zero.
+ * @return              An error from #errStatus. */
+errStatus cmStart(uint32_t ctlOffset, uint32_t divOffset, uint32_t source,
+                  uint32_t divisor)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t mash = (divisor & ((0x1 << CM_DIVF_BITS) - 1)) ? 1 : 0;
+
+    if ((rtn = cmStop(ctlOffset)) == OK)
+    {
+        REG_WRITE(CM_REG(divOffset), CM_PASSWD | divisor);
+        REG_WRITE(CM_REG(ctlOffset), CM_PASSWD | (mash << CM_MASH_SHIFT) | source);
+        REG_WRITE(CM_REG(ctlOffset), CM_PASSWD | (mash << CM_MASH_SHIFT) |
+                                     source | CM_ENAB);
+    }
+
+    return rtn;
+}
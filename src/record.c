@@ -0,0 +1,340 @@
+/**
+ * @file
+ *  @brief Records BSC traffic to a file and replays it.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  While recording, each gpioI2cSetClock(), gpioI2cSet7BitSlave(),
+ *  gpioI2cWriteData() and gpioI2cReadData() call appends a #tI2cRecord,
+ *  followed by the bytes written or read, to a fully buffered stdio stream,
+ *  so most calls cost a timestamp and a copy. While not recording each call
+ *  costs one test of gI2cRecording.
+ *
+ *  gpioI2cReplay() makes the same calls again, back to back or at their
+ *  recorded times, and compares the statuses and bytes read with those
+ *  recorded, so a recording from the field can be rerun against the
+ *  hardware or a simulated device to compare library changes.
+ */
+
+#include "record.h"
+
+/**** Globals ****/
+/** @brief Non zero while recording. */
+volatile int gI2cRecording = 0;
+
+/** @brief Serialises records and protects gRecordFile. */
+static pthread_mutex_t gRecordLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The recording, NULL if not recording. */
+static FILE * gRecordFile = NULL;
+
+/** @brief timeNowNs() when recording started. */
+static uint64_t gRecordStart_ns = 0;
+
+/** @brief Non zero if a record could not be written. */
+static int gRecordFailed = 0;
+
+/**
+ * @brief           Starts recording every I2C call to a file.
+ * @details         Records are buffered, and only certain to be in the file
+ *                  once gpioI2cRecordStop() returns.
+ * @param[in] path  The file, replaced if it exists.
+ * @return          An error from #errStatus. */
+errStatus gpioI2cRecordStart(const char * path)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tRecordHeader header;
+    struct timespec now;
+
+    pthread_mutex_lock(&gRecordLock);
+
+    if (gRecordFile != NULL)
+    {
+        dbgPrint(DBG_INFO, "Already recording.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (path == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter path was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((gRecordFile = fopen(path, "wb")) == NULL)
+    {
+        dbgPrint(DBG_INFO, "fopen() failed for %s. errno: %s.", path, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        setvbuf(gRecordFile, NULL, _IOFBF, RECORD_BUFFER);
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        memset(&header, 0, sizeof(header));
+        header.magic = RECORD_MAGIC;
+        header.version = RECORD_VERSION;
+        header.start_ns = (uint64_t)now.tv_sec * TIMING_NSEC_IN_SEC + (uint64_t)now.tv_nsec;
+
+        if (fwrite(&header, sizeof(header), 1, gRecordFile) != 1)
+        {
+            dbgPrint(DBG_INFO, "Writing to %s failed. errno: %s.", path, strerror(errno));
+            fclose(gRecordFile);
+            gRecordFile = NULL;
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            gRecordStart_ns = timeNowNs();
+            gRecordFailed = 0;
+            gI2cRecording = 1;
+            rtn = OK;
+        }
+    }
+
+    pthread_mutex_unlock(&gRecordLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops recording and closes the file.
+ * @return  An error from #errStatus, #ERROR_EXTERNAL if any record could not
+ *          be written. */
+errStatus gpioI2cRecordStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gRecordLock);
+
+    if (gRecordFile == NULL)
+    {
+        dbgPrint(DBG_INFO, "Not recording.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gI2cRecording = 0;
+
+        if (fclose(gRecordFile) != 0 || gRecordFailed)
+        {
+            dbgPrint(DBG_INFO, "Records were lost. errno: %s.", strerror(errno));
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            rtn = OK;
+        }
+
+        gRecordFile = NULL;
+    }
+
+    pthread_mutex_unlock(&gRecordLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Makes the I2C calls of a recording again.
+ * @details         gpioI2cSetup() must have been called, and the devices
+ *                  should be in the state they were when recording started,
+ *                  for reads to return the same bytes. Calls which fail, or
+ *                  read different bytes, are counted and replay continues.
+ * @param[in] path  A file written by gpioI2cRecordStart().
+ * @param timed     Non zero to start each call at its recorded time from the
+ *                  start of the replay, or 0 to make the calls back to back.
+ * @param[out] stats The comparison of the replay with the recording.
+ * @return          An error from #errStatus, #ERROR_EXTERNAL if the file
+ *                  could not be read. */
+errStatus gpioI2cReplay(const char * path, int timed, tI2cReplayStats * stats)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    errStatus status = ERROR_DEFAULT;
+    tRecordHeader header;
+    tI2cRecord record;
+    tI2cTiming timing;
+    uint8_t * recorded = NULL;
+    uint8_t * replayed = NULL;
+    uint64_t start = 0;
+    uint64_t now = 0;
+    FILE * file = NULL;
+
+    if (path == NULL || stats == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter path or stats was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((file = fopen(path, "rb")) == NULL)
+    {
+        dbgPrint(DBG_INFO, "fopen() failed for %s. errno: %s.", path, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (fread(&header, sizeof(header), 1, file) != 1 ||
+             header.magic != RECORD_MAGIC || header.version == 0 ||
+             header.version > RECORD_VERSION)
+    {
+        dbgPrint(DBG_INFO, "%s is not a version %d or earlier I2C recording.", path,
+                 RECORD_VERSION);
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if ((recorded = malloc(2 * RECORD_DATA_MAX)) == NULL)
+    {
+        dbgPrint(DBG_INFO, "malloc() failed.");
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        memset(stats, 0, sizeof(*stats));
+        replayed = recorded + RECORD_DATA_MAX;
+        start = timeNowNs();
+        rtn = OK;
+
+        while (rtn == OK && fread(&record, sizeof(record), 1, file) == 1)
+        {
+            if (record.type > i2cRecordTiming ||
+                (record.length && fread(recorded, record.length, 1, file) != 1))
+            {
+                dbgPrint(DBG_INFO, "%s is corrupt after %llu calls.", path,
+                         (unsigned long long)stats->calls);
+                rtn = ERROR_EXTERNAL;
+            }
+
+            else
+            {
+                if (timed)
+                {
+                    now = timeNowNs();
+
+                    if (now > start + record.time_ns)
+                    {
+                        stats->lateMax_ns = now - start - record.time_ns > stats->lateMax_ns ?
+                                            now - start - record.time_ns : stats->lateMax_ns;
+                    }
+
+                    timeWaitUntil(start + record.time_ns, RECORD_SPIN_NS);
+                }
+
+                now = timeNowNs();
+
+                switch (record.type)
+                {
+                    case i2cRecordClock:
+                        status = gpioI2cSetClock((int)record.frequency);
+                        break;
+
+                    case i2cRecordAddress:
+                        status = gpioI2cSet7BitSlave(record.address);
+                        break;
+
+                    case i2cRecordWrite:
+                        status = gpioI2cWriteData(recorded, record.length);
+                        break;
+
+                    case i2cRecordRead:
+                        status = gpioI2cReadData(replayed, record.length);
+                        stats->dataMismatches += status == OK && record.status == OK &&
+                                                 memcmp(recorded, replayed, record.length) != 0;
+                        break;
+
+                    /* Without its tI2cTiming the call was passed NULL */
+                    default:
+                        memcpy(&timing, recorded, sizeof(timing));
+                        status = gpioI2cSetTiming(record.length == sizeof(timing) ?
+                                                  &timing : NULL, NULL);
+                        break;
+                }
+
+                stats->replayed_ns += timeNowNs() - now;
+                stats->recorded_ns += record.duration_ns;
+                stats->statusMismatches += (int32_t)status != record.status;
+                stats->calls++;
+            }
+        }
+
+        if (rtn == OK && !feof(file))
+        {
+            dbgPrint(DBG_INFO, "Reading %s failed. errno: %s.", path, strerror(errno));
+            rtn = ERROR_EXTERNAL;
+        }
+
+        free(recorded);
+    }
+
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function, appends a record of an I2C call. Called
+ *                  by RECORD_END().
+ * @param type      The call.
+ * @param address   The slave address in use, or set.
+ * @param frequency The clock set.
+ * @param[in] data  Bytes written or read, may be NULL if none.
+ * @param length    Bytes of \p data.
+ * @param rtn       The call's result.
+ * @param start_ns  timeNowNs() when the call started, 0 if recording was not
+ *                  yet started. */
+void recordAdd(eI2cRecord type, uint8_t address, uint32_t frequency, const uint8_t * data,
+               uint16_t length, errStatus rtn, uint64_t start_ns)
+{
+    tI2cRecord record;
+    uint64_t now = timeNowNs();
+
+    pthread_mutex_lock(&gRecordLock);
+
+    if (gRecordFile != NULL)
+    {
+        if (start_ns < gRecordStart_ns)
+        {
+            start_ns = now;
+        }
+
+        memset(&record, 0, sizeof(record));
+        record.time_ns = start_ns - gRecordStart_ns;
+        record.duration_ns = now - start_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)(now - start_ns);
+        record.frequency = frequency;
+        record.status = (int32_t)rtn;
+        record.length = data != NULL ? length : 0;
+        record.address = address;
+        record.type = (uint8_t)type;
+
+        if (fwrite(&record, sizeof(record), 1, gRecordFile) != 1 ||
+            (record.length && fwrite(data, record.length, 1, gRecordFile) != 1))
+        {
+            gRecordFailed = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&gRecordLock);
+}
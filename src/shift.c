@@ -0,0 +1,493 @@
+/**
+ * @file
+ *  @brief Drives chains of 74HC595 and 74HC165 shift registers.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A group is up to #SHIFT_CHAINS chains sharing a clock and latch, each
+ *  with its own data lines, so every chain is shifted by the same edges.
+ *  The GPSET0 and GPCLR0 values putting each bit of every chain on its data
+ *  line are kept for the whole pass, and only the changed chain's pins are
+ *  updated when outputs are written. A bit is then one GPSET0 and one
+ *  GPCLR0 store for the data, which also drop the clock, one GPLEV0 load
+ *  for the inputs of every chain and one GPSET0 store raising the clock.
+ *
+ *  Outputs are shadowed, so gpioShiftUpdate() only shifts a group whose
+ *  outputs changed or which has inputs to read. Inputs are read in the same
+ *  pass that shifts the outputs.
+ */
+
+#include "shift.h"
+
+/* Local / internal prototypes */
+static int shiftPin(int gpioNumber, int optional, uint32_t * pins);
+static void shiftWait(const tShiftGroup * group, uint64_t * next);
+static void shiftPass(tShiftGroup * group, uint32_t * levels);
+
+/**** Globals ****/
+/** @brief Serialises passes and protects gShiftGroups. */
+static pthread_mutex_t gShiftLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The open groups. */
+static tShiftGroup gShiftGroups[SHIFT_GROUPS];
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gShiftMap = NULL;
+
+/**
+ * @brief           Opens a group of shift register chains.
+ * @details         The clock, latch, load and data out pins are made
+ *                  outputs, the clock and data low and the latch and load
+ *                  high. Data in pins are made inputs. Every output is low
+ *                  until the first gpioShiftUpdate(). The 165s' serial
+ *                  inputs at the far end of each chain should be tied low.
+ * @param[in] config The pins, chains and clock. Copied.
+ * @param[out] group The group, for the other gpioShift functions.
+ * @return          An error from #errStatus. */
+errStatus gpioShiftOpen(const tShiftConfig * config, int * group)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tShiftGroup shift;
+    uint32_t pins = 0;
+    uint32_t used = 0;
+    uint32_t pin = 0;
+    int valid = 1;
+    int index = 0;
+    int empty = -1;
+    int chain = 0;
+
+    memset(&shift, 0, sizeof(shift));
+
+    pthread_mutex_lock(&gShiftLock);
+
+    for (index = 0; index < SHIFT_GROUPS; index++)
+    {
+        if (gShiftGroups[index].inUse)
+        {
+            used |= gShiftGroups[index].clock | gShiftGroups[index].latch |
+                    gShiftGroups[index].load | gShiftGroups[index].outAll |
+                    gShiftGroups[index].inAll;
+        }
+
+        else if (empty < 0)
+        {
+            empty = index;
+        }
+    }
+
+    if (config == NULL || group == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter config or group was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (config->chains < 1 || config->chains > SHIFT_CHAINS ||
+             config->registers < 1 || config->registers > SHIFT_REGISTERS_MAX ||
+             config->frequency < 0 || config->frequency > SHIFT_FREQ_MAX)
+    {
+        dbgPrint(DBG_INFO, "chains %d, registers %d or frequency %d is out of range.",
+                 config->chains, config->registers, config->frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (empty < 0)
+    {
+        dbgPrint(DBG_INFO, "All %d groups are open.", SHIFT_GROUPS);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        valid = shiftPin(config->gpioNumberClock, 0, &pins);
+        shift.clock = pins;
+        pin = pins;
+        valid &= shiftPin(config->gpioNumberLatch, 0, &pins);
+        shift.latch = pins & ~pin;
+        pin = pins;
+        valid &= shiftPin(config->gpioNumberLoad, 1, &pins);
+        shift.load = pins & ~pin ? pins & ~pin : shift.latch;
+
+        for (chain = 0; chain < config->chains; chain++)
+        {
+            pin = pins;
+            valid &= shiftPin(config->gpioNumberOut[chain], 1, &pins);
+            shift.out[chain] = pins & ~pin;
+            pin = pins;
+            valid &= shiftPin(config->gpioNumberIn[chain], 1, &pins);
+            shift.in[chain] = pins & ~pin;
+            shift.outAll |= shift.out[chain];
+            shift.inAll |= shift.in[chain];
+        }
+
+        if (!valid || (pins & used) || !(shift.outAll | shift.inAll))
+        {
+            dbgPrint(DBG_INFO, "Pins are invalid, repeated, on another group or no data pins.");
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if ((rtn = gpioGetRegisters(&gShiftMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            shift.chains = config->chains;
+            shift.registers = config->registers;
+            shift.half_ns = config->frequency ? 500000000u / config->frequency : 0;
+            shift.dirty = 1;
+
+            /* Every output starts low */
+            for (index = 0; index < SHIFT_BITS_MAX; index++)
+            {
+                shift.clear[index] = shift.clock | shift.outAll;
+            }
+
+            /* Levels are latched before the pins become outputs */
+            if ((rtn = gpioSetMask(shift.latch | shift.load)) == OK)
+            {
+                rtn = gpioClearMask(shift.clock | shift.outAll);
+            }
+
+            for (pin = pins; pin && rtn == OK; pin &= pin - 1)
+            {
+                index = __builtin_ctz(pin);
+                rtn = gpioSetFunction(index, shift.inAll & (0x1u << index) ? input : output);
+            }
+
+            if (rtn != OK)
+            {
+                dbgPrint(DBG_INFO, "Setting up the pins failed. %s", gpioErrToString(rtn));
+            }
+
+            else
+            {
+                shift.inUse = 1;
+                gShiftGroups[empty] = shift;
+                *group = empty;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gShiftLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Closes a group opened by gpioShiftOpen(). Its pins and the
+ *              outputs are left as they are.
+ * @param group The group.
+ * @return      An error from #errStatus. */
+errStatus gpioShiftClose(int group)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gShiftLock);
+
+    if (group < 0 || group >= SHIFT_GROUPS || !gShiftGroups[group].inUse)
+    {
+        dbgPrint(DBG_INFO, "group %d is not open.", group);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        gShiftGroups[group].inUse = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gShiftLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Sets the outputs of a chain, shown by the next
+ *                  gpioShiftUpdate() if they changed.
+ * @param group     From gpioShiftOpen().
+ * @param chain     The chain, with a data out pin.
+ * @param[in] data  One byte per register, the register nearest the Pi
+ *                  first. Bit n drives output Qn, QA being bit 0.
+ * @return          An error from #errStatus. */
+errStatus gpioShiftWrite(int group, int chain, const uint8_t * data)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tShiftGroup * shift = NULL;
+    uint32_t pin = 0;
+    int bit = 0;
+    int reg = 0;
+
+    pthread_mutex_lock(&gShiftLock);
+
+    if (group < 0 || group >= SHIFT_GROUPS || !gShiftGroups[group].inUse)
+    {
+        dbgPrint(DBG_INFO, "group %d is not open.", group);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (chain < 0 || chain >= gShiftGroups[group].chains ||
+             !gShiftGroups[group].out[chain])
+    {
+        dbgPrint(DBG_INFO, "chain %d has no outputs.", chain);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (data == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter data was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        shift = &gShiftGroups[group];
+        pin = shift->out[chain];
+
+        /* The far register's QH is shifted first */
+        for (reg = 0; reg < shift->registers; reg++)
+        {
+            if (shift->outputs[chain][reg] == data[reg])
+            {
+                continue;
+            }
+
+            for (bit = 0; bit < 8; bit++)
+            {
+                int index = (shift->registers - 1 - reg) * 8 + 7 - bit;
+
+                if ((data[reg] >> bit) & 0x1)
+                {
+                    shift->set[index] |= pin;
+                    shift->clear[index] &= ~pin;
+                }
+
+                else
+                {
+                    shift->set[index] &= ~pin;
+                    shift->clear[index] |= pin;
+                }
+            }
+
+            shift->outputs[chain][reg] = data[reg];
+            shift->dirty = 1;
+        }
+
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gShiftLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Shifts a group if its outputs changed or it has inputs,
+ *                  then latches the outputs.
+ * @details         The 165s load their inputs when the pass starts. With
+ *                  the load on the latch, loading also latches the 595s
+ *                  again with the data they already hold.
+ * @param group     From gpioShiftOpen().
+ * @return          An error from #errStatus. */
+errStatus gpioShiftUpdate(int group)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tShiftGroup * shift = NULL;
+    uint32_t levels[SHIFT_BITS_MAX];
+    int chain = 0;
+    int index = 0;
+
+    pthread_mutex_lock(&gShiftLock);
+
+    if (group < 0 || group >= SHIFT_GROUPS || !gShiftGroups[group].inUse)
+    {
+        dbgPrint(DBG_INFO, "group %d is not open.", group);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        shift = &gShiftGroups[group];
+
+        if (shift->dirty || shift->inAll)
+        {
+            shiftPass(shift, levels);
+            shift->dirty = 0;
+        }
+
+        /* The register nearest the Pi's H input is read first */
+        for (chain = 0; chain < shift->chains && shift->inAll; chain++)
+        {
+            if (!shift->in[chain])
+            {
+                continue;
+            }
+
+            memset(shift->inputs[chain], 0, shift->registers);
+
+            for (index = 0; index < shift->registers * 8; index++)
+            {
+                if (levels[index] & shift->in[chain])
+                {
+                    shift->inputs[chain][index / 8] |= 0x80 >> (index % 8);
+                }
+            }
+        }
+
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gShiftLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Gets the inputs of a chain read by the last
+ *                  gpioShiftUpdate().
+ * @param group     From gpioShiftOpen().
+ * @param chain     The chain, with a data in pin.
+ * @param[out] data One byte per register, the register nearest the Pi
+ *                  first. Bit n is input n, A being bit 0.
+ * @return          An error from #errStatus. */
+errStatus gpioShiftRead(int group, int chain, uint8_t * data)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gShiftLock);
+
+    if (group < 0 || group >= SHIFT_GROUPS || !gShiftGroups[group].inUse)
+    {
+        dbgPrint(DBG_INFO, "group %d is not open.", group);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (chain < 0 || chain >= gShiftGroups[group].chains ||
+             !gShiftGroups[group].in[chain])
+    {
+        dbgPrint(DBG_INFO, "chain %d has no inputs.", chain);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (data == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter data was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        memcpy(data, gShiftGroups[group].inputs[chain], gShiftGroups[group].registers);
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gShiftLock);
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function, adds a pin to \p pins.
+ * @param gpioNumber The pin, or -1 if \p optional.
+ * @param optional  -1 is accepted and adds nothing.
+ * @param[in,out] pins Pins so far.
+ * @return          0 if the pin is out of range or already in \p pins. */
+static int shiftPin(int gpioNumber, int optional, uint32_t * pins)
+{
+    int valid = 0;
+
+    if (gpioNumber == -1 && optional)
+    {
+        valid = 1;
+    }
+
+    else if (gpioNumber >= 0 && gpioNumber <= 31 && !(*pins & (0x1u << gpioNumber)))
+    {
+        *pins |= 0x1u << gpioNumber;
+        valid = 1;
+    }
+
+    return valid;
+}
+
+
+/**
+ * @brief           Internal function, waits half a clock if the group is
+ *                  paced.
+ * @param group     The group.
+ * @param[in,out] next Time of the last edge, advanced to this one. */
+static void shiftWait(const tShiftGroup * group, uint64_t * next)
+{
+    if (group->half_ns)
+    {
+        *next += group->half_ns;
+        timeWaitUntil(*next, SHIFT_SPIN_NS);
+    }
+}
+
+
+/**
+ * @brief           Internal function, loads the 165s, shifts every bit
+ *                  through every chain and latches the 595s.
+ * @details         Data changes with the clock low and the 595s and 165s
+ *                  both shift on the rising edge, before which QH of every
+ *                  165 chain is read.
+ * @param group     The group.
+ * @param[out] levels GPLEV0 before each rising edge. */
+static void shiftPass(tShiftGroup * group, uint32_t * levels)
+{
+    uint64_t next = timeNowNs();
+    int bits = group->registers * 8;
+    int bit = 0;
+
+    if (group->inAll)
+    {
+        REG_WRITE(SHIFT_GPCLR0, group->load);
+        shiftWait(group, &next);
+        REG_WRITE(SHIFT_GPSET0, group->load);
+    }
+
+    for (bit = 0; bit < bits; bit++)
+    {
+        REG_WRITE(SHIFT_GPSET0, group->set[bit]);
+        REG_WRITE(SHIFT_GPCLR0, group->clear[bit]);
+        shiftWait(group, &next);
+        levels[bit] = REG_READ(SHIFT_GPLEV0);
+        REG_WRITE(SHIFT_GPSET0, group->clock);
+        shiftWait(group, &next);
+    }
+
+    if (group->outAll)
+    {
+        REG_WRITE(SHIFT_GPCLR0, group->clock | group->latch);
+        shiftWait(group, &next);
+        REG_WRITE(SHIFT_GPSET0, group->latch);
+    }
+
+    else
+    {
+        REG_WRITE(SHIFT_GPCLR0, group->clock);
+    }
+}
@@ -0,0 +1,925 @@
+/**
+ * @file
+ *  @brief Publishes GPIO levels to other processes through shared memory.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  One process, the daemon, owns the GPIO registers and runs a thread which
+ *  each period applies the output changes queued by clients, then takes a
+ *  GPLEV0 snapshot and publishes it under a seqlock. Any number of client
+ *  processes map the segment read only and read the snapshot with no
+ *  system call or lock, retrying only if the daemon updated it meanwhile.
+ *
+ *  A snapshot which differs from the previous one is also written as an
+ *  event to a table of the latest #SHM_EVENTS, each slot with its own
+ *  seqlock. Clients follow the table with a cursor of their own, so a slow
+ *  client loses the oldest events rather than holding up the daemon or
+ *  other clients. Edges are only seen by comparing snapshots, so a pulse
+ *  shorter than the period may be missed.
+ *
+ *  Clients queue output changes on a lock free ring in a second segment,
+ *  the only memory they can write, which the daemon validates and applies,
+ *  so clients never touch the registers. Both sides index the ring with
+ *  the compile time geometry and the daemon keeps its read position to
+ *  itself, so whatever a client writes there can at worst refuse requests,
+ *  never make the daemon read out of bounds or stop publishing.
+ */
+
+#include "shm.h"
+
+/* Local / internal prototypes */
+static errStatus shmRequest(const tShmRequest * request);
+static uint32_t * shmCell(tRing * ring, uint32_t position);
+static int shmPush(tRing * ring, const tShmRequest * request);
+static int shmTake(tRing * ring, tShmRequest * request, uint64_t now);
+static int shmLive(const char * name);
+static void shmApply(const tShmRequest * request);
+static void shmPublish(uint32_t levels, uint32_t changed, uint64_t now);
+static void * shmThread(void * unused);
+
+/**** Globals ****/
+/** @brief The GPIO registers. Daemon only. */
+static volatile uint32_t * gShmMap = NULL;
+
+/** @brief The segment created by gpioShmStart(). */
+static tShmSegment * gShmDaemon = NULL;
+
+/** @brief The request segment created by gpioShmStart(). */
+static tShmRequests * gShmDaemonRequests = NULL;
+
+/** @brief Name of the segment created by gpioShmStart(). */
+static char gShmName[SHM_NAME_LENGTH];
+
+/** @brief Name of the request segment created by gpioShmStart(). */
+static char gShmRequestName[SHM_NAME_LENGTH];
+
+/** @brief Position of the next request the daemon takes. Kept out of the
+ ** segment so no client can move it. */
+static uint32_t gShmTail = 0;
+
+/** @brief When the daemon first found the request at gShmTail claimed but
+ ** not written, 0 if it has not. */
+static uint64_t gShmClaimed = 0;
+
+/** @brief The daemon thread. */
+static pthread_t gShmThread;
+
+/** @brief Non zero while the daemon thread should run. */
+static volatile int gShmRunning = 0;
+
+/** @brief The segment mapped by gpioShmAttach(). */
+static const tShmSegment * gShmClient = NULL;
+
+/** @brief The request segment mapped by gpioShmAttach(), NULL if the client
+ ** may not write to it. */
+static tShmRequests * gShmClientRequests = NULL;
+
+/** @brief Index of the next event gpioShmReadEvents() returns. */
+static uint64_t gShmCursor = 0;
+
+/**
+ * @brief           Creates the shared memory segments and starts the daemon
+ *                  thread publishing to them.
+ * @details         gpioSetup() must have been called. Segments left with
+ *                  the same name by a daemon which is no longer running are
+ *                  replaced, but not those of a running one. The segment
+ *                  published to is given the read permissions of \p mode
+ *                  only, the request segment \p mode. The thread is given
+ *                  SCHED_FIFO priority if permitted.
+ * @param[in] name  Name of the segment, such as #SHM_NAME_DEFAULT. Must
+ *                  start with '/'. The request segment is named with
+ *                  #SHM_REQUEST_SUFFIX appended.
+ * @param period_ns Time between snapshots, #SHM_PERIOD_MIN_NS to
+ *                  #SHM_PERIOD_MAX_NS.
+ * @param mode      Permissions of the segments, such as 0660 to allow a
+ *                  group of users to be clients, or 0640 to let them only
+ *                  read. Not reduced by the umask.
+ * @param cpu       CPU to pin the thread to, or -1 to leave it unpinned.
+ * @return          An error from #errStatus, ERROR_ALREADY_INITIALISED if
+ *                  another daemon is publishing to \p name. */
+errStatus gpioShmStart(const char * name, uint32_t period_ns, int mode, int cpu)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    void * segment = MAP_FAILED;
+    void * requests = MAP_FAILED;
+    int fd = -1;
+    int requestFd = -1;
+
+    if (gShmRunning)
+    {
+        dbgPrint(DBG_INFO, "The daemon is already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (name == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter name was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (name[0] != '/' ||
+             strlen(name) + strlen(SHM_REQUEST_SUFFIX) >= SHM_NAME_LENGTH ||
+             period_ns < SHM_PERIOD_MIN_NS || period_ns > SHM_PERIOD_MAX_NS ||
+             mode < 0 || mode > 0777 || cpu >= CPU_SETSIZE)
+    {
+        dbgPrint(DBG_INFO, "name %s, period_ns %u, mode 0%o or cpu %d is out of range.",
+                 name, period_ns, mode, cpu);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetRegisters(&gShmMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if (shmLive(name))
+    {
+        dbgPrint(DBG_INFO, "Another daemon is publishing to %s.", name);
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else
+    {
+        strcpy(gShmName, name);
+        strcpy(gShmRequestName, name);
+        strcat(gShmRequestName, SHM_REQUEST_SUFFIX);
+
+        /* Left by a daemon which did not stop cleanly */
+        shm_unlink(gShmName);
+        shm_unlink(gShmRequestName);
+
+        /* Clients are given no write permission to the published segment,
+         * the daemon writes through the mapping made before the fchmod() */
+        if ((fd = shm_open(gShmName, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0 ||
+            ftruncate(fd, sizeof(tShmSegment)) != 0 ||
+            (segment = mmap(NULL, sizeof(tShmSegment), PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0)) == MAP_FAILED ||
+            fchmod(fd, (mode_t)mode & 0444) != 0 ||
+            (requestFd = shm_open(gShmRequestName, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0 ||
+            fchmod(requestFd, (mode_t)mode) != 0 ||
+            ftruncate(requestFd, sizeof(tShmRequests)) != 0 ||
+            (requests = mmap(NULL, sizeof(tShmRequests), PROT_READ | PROT_WRITE,
+                             MAP_SHARED, requestFd, 0)) == MAP_FAILED)
+        {
+            dbgPrint(DBG_INFO, "Creating segment %s failed. errno: %s.", name, strerror(errno));
+            rtn = ERROR_EXTERNAL;
+
+            if (segment != MAP_FAILED)
+            {
+                munmap(segment, sizeof(tShmSegment));
+            }
+
+            if (fd >= 0)
+            {
+                shm_unlink(gShmName);
+            }
+
+            if (requestFd >= 0)
+            {
+                shm_unlink(gShmRequestName);
+            }
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        if (requestFd >= 0)
+        {
+            close(requestFd);
+        }
+    }
+
+    if (rtn == OK)
+    {
+        /* ftruncate() zeroed the segments */
+        gShmDaemon = (tShmSegment *)segment;
+        gShmDaemon->version = SHM_VERSION;
+        gShmDaemon->size = sizeof(tShmSegment);
+        gShmDaemon->period_ns = period_ns;
+        gShmDaemon->pid = (int32_t)getpid();
+        gShmDaemon->time_ns = timeNowNs();
+        gShmDaemon->levels = REG_READ(SHM_GPLEV0);
+        __atomic_store_n(&gShmDaemon->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+        gShmDaemonRequests = (tShmRequests *)requests;
+        gShmDaemonRequests->version = SHM_VERSION;
+        gShmDaemonRequests->size = sizeof(tShmRequests);
+        ringInit(gShmDaemonRequests->requests, SHM_REQUESTS, sizeof(tShmRequest));
+        __atomic_store_n(&gShmDaemonRequests->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+        gShmTail = 0;
+        gShmClaimed = 0;
+        gShmRunning = 1;
+
+        if ((errno = pthread_create(&gShmThread, NULL, shmThread, NULL)) != 0)
+        {
+            dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+            gShmRunning = 0;
+            munmap(gShmDaemon, sizeof(tShmSegment));
+            munmap(gShmDaemonRequests, sizeof(tShmRequests));
+            shm_unlink(gShmName);
+            shm_unlink(gShmRequestName);
+            gShmDaemon = NULL;
+            gShmDaemonRequests = NULL;
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            timeThreadRealtime(gShmThread, cpu, "Shared memory");
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the daemon thread and removes the segments. Clients still
+ *          attached keep their mappings, but the snapshot stops changing.
+ * @return  An error from #errStatus. */
+errStatus gpioShmStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gShmRunning)
+    {
+        dbgPrint(DBG_INFO, "The daemon is not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gShmRunning = 0;
+        pthread_join(gShmThread, NULL);
+        shm_unlink(gShmName);
+        shm_unlink(gShmRequestName);
+        munmap(gShmDaemon, sizeof(tShmSegment));
+        munmap(gShmDaemonRequests, sizeof(tShmRequests));
+        gShmDaemon = NULL;
+        gShmDaemonRequests = NULL;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Maps the segments created by a daemon, which may be in
+ *                  this or another process. gpioSetup() is not needed.
+ * @details         The published segment is mapped read only. A client
+ *                  without write permission to the request segment may
+ *                  still read, but its requests fail. Events are returned
+ *                  from the point of attaching. If the daemon restarts,
+ *                  attach again, the time of the snapshot stops advancing
+ *                  if it is not running.
+ * @param[in] name  Name passed to gpioShmStart().
+ * @return          An error from #errStatus. */
+errStatus gpioShmAttach(const char * name)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    char requestName[SHM_NAME_LENGTH];
+    struct stat status;
+    tShmSegment * segment = MAP_FAILED;
+    tShmRequests * requests = MAP_FAILED;
+    int fd = -1;
+
+    if (gShmClient != NULL)
+    {
+        dbgPrint(DBG_INFO, "Already attached, call gpioShmDetach() first.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (name == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter name was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (strlen(name) + strlen(SHM_REQUEST_SUFFIX) >= SHM_NAME_LENGTH)
+    {
+        dbgPrint(DBG_INFO, "name %s is too long.", name);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((fd = shm_open(name, O_RDONLY, 0)) < 0 ||
+             fstat(fd, &status) != 0)
+    {
+        dbgPrint(DBG_INFO, "Opening segment %s failed. errno: %s.", name, strerror(errno));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (status.st_size != sizeof(tShmSegment) ||
+             (segment = mmap(NULL, sizeof(tShmSegment), PROT_READ,
+                             MAP_SHARED, fd, 0)) == MAP_FAILED)
+    {
+        dbgPrint(DBG_INFO, "Segment %s is %ld bytes, %u expected, or mmap() failed.",
+                 name, (long)status.st_size, (unsigned)sizeof(tShmSegment));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (__atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+             segment->version != SHM_VERSION || segment->size != sizeof(tShmSegment))
+    {
+        dbgPrint(DBG_INFO, "Segment %s is not set up or is version %u, %u expected.",
+                 name, segment->version, SHM_VERSION);
+        munmap(segment, sizeof(tShmSegment));
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        gShmClient = segment;
+        gShmCursor = __atomic_load_n(&segment->events, __ATOMIC_ACQUIRE);
+        rtn = OK;
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    if (rtn == OK)
+    {
+        strcpy(requestName, name);
+        strcat(requestName, SHM_REQUEST_SUFFIX);
+
+        /* Geometry is not taken from the ring, only the size is checked */
+        if ((fd = shm_open(requestName, O_RDWR, 0)) < 0 ||
+            fstat(fd, &status) != 0 ||
+            status.st_size != sizeof(tShmRequests) ||
+            (requests = mmap(NULL, sizeof(tShmRequests), PROT_READ | PROT_WRITE,
+                             MAP_SHARED, fd, 0)) == MAP_FAILED)
+        {
+            dbgPrint(DBG_INFO, "Segment %s can not be written, attached read only.",
+                     requestName);
+        }
+
+        else
+        {
+            gShmClientRequests = requests;
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Unmaps the segments mapped by gpioShmAttach().
+ * @return  An error from #errStatus. */
+errStatus gpioShmDetach(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gShmClient == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioShmAttach() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        munmap((void *)gShmClient, sizeof(tShmSegment));
+        gShmClient = NULL;
+
+        if (gShmClientRequests != NULL)
+        {
+            munmap(gShmClientRequests, sizeof(tShmRequests));
+            gShmClientRequests = NULL;
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reads the latest GPLEV0 snapshot. Makes no system
+ *                      call and never waits for the daemon, other than to
+ *                      retry a copy it updated meanwhile.
+ * @param[out] levels   Bit n set if GPIO n was high.
+ * @param[out] time_ns  If not NULL, set to when the snapshot was taken, as
+ *                      timeNowNs().
+ * @return              An error from #errStatus. */
+errStatus gpioShmReadLevels(uint32_t * levels, uint64_t * time_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t sequence = 0;
+    uint32_t copyLevels = 0;
+    uint64_t copyTime = 0;
+
+    if (gShmClient == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioShmAttach() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (levels == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter levels was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        do
+        {
+            sequence = seqReadBegin(&gShmClient->sequence);
+            copyLevels = gShmClient->levels;
+            copyTime = gShmClient->time_ns;
+        } while (seqReadRetry(&gShmClient->sequence, sequence));
+
+        *levels = copyLevels;
+
+        if (time_ns != NULL)
+        {
+            *time_ns = copyTime;
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Takes the events published since the last call, or since
+ *                  attaching, oldest first. Each client has its own cursor.
+ * @param[out] events Filled with up to \p max events.
+ * @param max       Size of \p events.
+ * @param[out] count Set to the events taken, 0 if there were none.
+ * @param[out] lost If not NULL, set to the events overwritten before they
+ *                  could be taken.
+ * @return          An error from #errStatus. */
+errStatus gpioShmReadEvents(tShmEvent * events, int max, int * count, uint32_t * lost)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    const tShmSlot * slot = NULL;
+    uint64_t published = 0;
+    uint64_t index = 0;
+    uint32_t sequence = 0;
+    uint32_t missed = 0;
+    tShmEvent copy;
+
+    if (gShmClient == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioShmAttach() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (events == NULL || count == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter events or count was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        published = __atomic_load_n(&gShmClient->events, __ATOMIC_ACQUIRE);
+
+        if (published - gShmCursor > SHM_EVENTS)
+        {
+            missed = (uint32_t)(published - SHM_EVENTS - gShmCursor);
+            gShmCursor = published - SHM_EVENTS;
+        }
+
+        for (*count = 0; *count < max && gShmCursor < published; gShmCursor++)
+        {
+            slot = &gShmClient->slots[gShmCursor % SHM_EVENTS];
+
+            do
+            {
+                sequence = seqReadBegin(&slot->sequence);
+                index = slot->index;
+                copy = slot->event;
+            } while (seqReadRetry(&slot->sequence, sequence));
+
+            /* The daemon lapped the cursor while the table was being read */
+            if (index != gShmCursor)
+            {
+                missed++;
+            }
+
+            else
+            {
+                events[(*count)++] = copy;
+            }
+        }
+
+        if (lost != NULL)
+        {
+            *lost = missed;
+        }
+
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Asks the daemon to set and clear pins, as gpioSetMask() then
+ *              gpioClearMask(). Applied at the start of the daemon's next
+ *              period, pins not on the header are refused by the daemon.
+ * @param set   Bit n set to drive GPIO n high.
+ * @param clear Bit n set to drive GPIO n low.
+ * @return      An error from #errStatus, ERROR_EXTERNAL if the queue was
+ *              full or the client may not write to it. */
+errStatus gpioShmWrite(uint32_t set, uint32_t clear)
+{
+    tShmRequest request;
+
+    request.type = shmWrite;
+    request.set = set;
+    request.clear = clear;
+
+    return shmRequest(&request);
+}
+
+
+/**
+ * @brief               Asks the daemon to call gpioSetFunction().
+ * @param gpioNumber    The GPIO.
+ * @param function      The function.
+ * @return              An error from #errStatus, ERROR_EXTERNAL if the
+ *                      queue was full or the client may not write to it. */
+errStatus gpioShmSetFunction(int gpioNumber, eFunction function)
+{
+    tShmRequest request;
+
+    request.type = shmFunction;
+    request.set = (uint32_t)gpioNumber;
+    request.clear = (uint32_t)function;
+
+    return shmRequest(&request);
+}
+
+
+/**
+ * @brief               Asks the daemon to call gpioSetPullResistor().
+ * @param gpioNumber    The GPIO.
+ * @param resistor      The resistor.
+ * @return              An error from #errStatus, ERROR_EXTERNAL if the
+ *                      queue was full or the client may not write to it. */
+errStatus gpioShmSetPullResistor(int gpioNumber, eResistor resistor)
+{
+    tShmRequest request;
+
+    request.type = shmPull;
+    request.set = (uint32_t)gpioNumber;
+    request.clear = (uint32_t)resistor;
+
+    return shmRequest(&request);
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function, queues a request for the daemon.
+ * @param[in] request The request.
+ * @return          An error from #errStatus. */
+static errStatus shmRequest(const tShmRequest * request)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gShmClient == NULL)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioShmAttach() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (gShmClientRequests == NULL)
+    {
+        dbgPrint(DBG_INFO, "Attached read only, requests can not be queued.");
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else if (request->type != shmWrite && request->set > 31)
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %u is out of range.", request->set);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (!shmPush((tRing *)gShmClientRequests->requests, request))
+    {
+        dbgPrint(DBG_INFO, "The request queue is full.");
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function, finds a cell of the request ring from
+ *                  the compile time geometry.
+ * @param ring      The request ring.
+ * @param position  Push or pop position, masked here.
+ * @return          The cell's sequence number, followed by the request. */
+static uint32_t * shmCell(tRing * ring, uint32_t position)
+{
+    return (uint32_t *)((uint8_t *)(ring + 1) +
+                        (size_t)(position & (SHM_REQUESTS - 1)) * SHM_REQUEST_CELL);
+}
+
+
+/**
+ * @brief           Internal function, ringPush() on the request ring. Gives
+ *                  up rather than spin if other clients keep moving the
+ *                  head or left it inconsistent.
+ * @param ring      The request ring.
+ * @param[in] request The request.
+ * @return          1 if queued, 0 if the ring was full. */
+static int shmPush(tRing * ring, const tShmRequest * request)
+{
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t * cell = NULL;
+    int32_t diff = 0;
+    int tries = 0;
+
+    for (tries = 0; tries < SHM_REQUESTS; tries++)
+    {
+        cell = shmCell(ring, pos);
+        diff = (int32_t)(__atomic_load_n(cell, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                memcpy(cell + 1, request, sizeof(*request));
+                __atomic_store_n(cell, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        }
+
+        else if (diff < 0)
+        {
+            return 0;
+        }
+
+        else
+        {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief           Internal function, takes the next request as the only
+ *                  consumer. A request claimed by a client which has not
+ *                  written it after #SHM_CLAIM_TIMEOUT_NS is skipped and
+ *                  counted in rejected, and a cell left inconsistent while
+ *                  the ring is empty is reset, so no client can stop the
+ *                  queue for good.
+ * @param ring      The request ring.
+ * @param[out] request The request taken.
+ * @param now       The time, from timeNowNs().
+ * @return          1 if a request was taken, 0 if there was none ready. */
+static int shmTake(tRing * ring, tShmRequest * request, uint64_t now)
+{
+    uint32_t * cell = NULL;
+    uint32_t sequence = 0;
+    int taken = 0;
+    int skipped = 0;
+
+    do
+    {
+        cell = shmCell(ring, gShmTail);
+        sequence = __atomic_load_n(cell, __ATOMIC_ACQUIRE);
+        skipped = 0;
+
+        if (sequence == gShmTail + 1)
+        {
+            memcpy(request, cell + 1, sizeof(*request));
+            taken = 1;
+        }
+
+        else if (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) == gShmTail)
+        {
+            /* Empty. Any other value was written late or by a bad client,
+             * and would leave the cell unusable */
+            if (sequence != gShmTail)
+            {
+                __atomic_store_n(cell, gShmTail, __ATOMIC_RELEASE);
+            }
+
+            gShmClaimed = 0;
+        }
+
+        else if (gShmClaimed == 0)
+        {
+            gShmClaimed = now;
+        }
+
+        else if (now - gShmClaimed >= SHM_CLAIM_TIMEOUT_NS)
+        {
+            __atomic_store_n(&gShmDaemon->rejected, gShmDaemon->rejected + 1, __ATOMIC_RELAXED);
+            skipped = 1;
+        }
+
+        if (taken || skipped)
+        {
+            __atomic_store_n(cell, gShmTail + SHM_REQUESTS, __ATOMIC_RELEASE);
+            gShmTail++;
+            gShmClaimed = 0;
+            __atomic_store_n(&ring->tail, gShmTail, __ATOMIC_RELAXED);
+        }
+    } while (skipped);
+
+    return taken;
+}
+
+
+/**
+ * @brief           Internal function, checks for a daemon publishing to a
+ *                  segment. It is running if its process exists and the
+ *                  snapshot is changing or was taken in the last
+ *                  #SHM_STALE_NS.
+ * @param[in] name  The segment.
+ * @return          Non zero if a daemon is running. */
+static int shmLive(const char * name)
+{
+    const tShmSegment * segment = MAP_FAILED;
+    struct stat status;
+    uint32_t sequence = 0;
+    uint64_t time_ns = 0;
+    int live = 0;
+    int fd = -1;
+
+    if ((fd = shm_open(name, O_RDONLY, 0)) >= 0 &&
+        fstat(fd, &status) == 0 &&
+        status.st_size == sizeof(tShmSegment) &&
+        (segment = mmap(NULL, sizeof(tShmSegment), PROT_READ,
+                        MAP_SHARED, fd, 0)) != MAP_FAILED)
+    {
+        sequence = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+        time_ns = segment->time_ns;
+
+        /* Left odd only by a daemon which died while publishing */
+        live = __atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC &&
+               segment->version == SHM_VERSION &&
+               (kill((pid_t)segment->pid, 0) == 0 || errno == EPERM) &&
+               (seqReadRetry(&segment->sequence, sequence) ||
+                ((sequence & 0x1) == 0 && timeNowNs() - time_ns < SHM_STALE_NS));
+
+        munmap((void *)segment, sizeof(tShmSegment));
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return live;
+}
+
+
+/**
+ * @brief           Internal function, carries out a client's request. Ones
+ *                  the GPIO functions refuse are counted in rejected.
+ * @param[in] request The request. */
+static void shmApply(const tShmRequest * request)
+{
+    errStatus rtn = OK;
+
+    switch (request->type)
+    {
+        case shmWrite:
+            if (request->set)
+            {
+                rtn = gpioSetMask(request->set);
+            }
+
+            if (request->clear && rtn == OK)
+            {
+                rtn = gpioClearMask(request->clear);
+            }
+            break;
+
+        case shmFunction:
+            rtn = gpioSetFunction((int)request->set, (eFunction)request->clear);
+            break;
+
+        case shmPull:
+            rtn = gpioSetPullResistor((int)request->set, (eResistor)request->clear);
+            break;
+
+        default:
+            rtn = ERROR_RANGE;
+            break;
+    }
+
+    if (rtn != OK)
+    {
+        __atomic_store_n(&gShmDaemon->rejected, gShmDaemon->rejected + 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @brief           Internal function, writes an event to the next slot of
+ *                  the table, then makes it visible to clients.
+ * @param levels    The snapshot.
+ * @param changed   Pins differing from the previous snapshot.
+ * @param now       Time of the snapshot. */
+static void shmPublish(uint32_t levels, uint32_t changed, uint64_t now)
+{
+    uint64_t index = gShmDaemon->events;
+    tShmSlot * slot = &gShmDaemon->slots[index % SHM_EVENTS];
+
+    seqWriteBegin(&slot->sequence);
+    slot->index = index;
+    slot->event.time_ns = now;
+    slot->event.levels = levels;
+    slot->event.changed = changed;
+    seqWriteEnd(&slot->sequence);
+
+    __atomic_store_n(&gShmDaemon->events, index + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief           Internal function, the daemon thread.
+ * @param unused    Unused.
+ * @return          NULL. */
+static void * shmThread(void * unused)
+{
+    tRing * ring = (tRing *)gShmDaemonRequests->requests;
+    tShmRequest request;
+    uint32_t previous = gShmDaemon->levels;
+    uint32_t levels = 0;
+    uint64_t next = timeNowNs();
+    uint64_t now = 0;
+    int taken = 0;
+
+    (void)unused;
+
+    while (gShmRunning)
+    {
+        /* At most a ring's worth, so clients pushing as fast as the daemon
+         * takes can not hold up the snapshot */
+        now = timeNowNs();
+        for (taken = 0; taken < SHM_REQUESTS && shmTake(ring, &request, now); taken++)
+        {
+            shmApply(&request);
+        }
+
+        now = timeNowNs();
+        levels = REG_READ(SHM_GPLEV0);
+
+        seqWriteBegin(&gShmDaemon->sequence);
+        gShmDaemon->levels = levels;
+        gShmDaemon->time_ns = now;
+        seqWriteEnd(&gShmDaemon->sequence);
+
+        if (levels != previous)
+        {
+            shmPublish(levels, levels ^ previous, now);
+            previous = levels;
+        }
+
+        /* Snapshots need no precise timing, so sleep rather than spin */
+        timeNextPeriod(&next, gShmDaemon->period_ns);
+        timeWaitUntil(next, 0);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,2290 @@
+/**
+ * @file
+ *  @brief Contains source for the simulated register backend.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Only built into librpigpiosim.a. periph.c hands out blocks from here in
+ *  place of /dev/mem mappings and REG_READ() / REG_WRITE() land in
+ *  simRegRead() / simRegWrite(), which apply the side effects the hardware
+ *  would. The BSC model is timed from its DIV register and the board's core
+ *  clock against the monotonic clock so transfers take as long as they
+ *  would on the bus.
+ *  Slaves may also be attached to pairs of GPIO pins, where they decode the
+ *  pin levels as a bit banging master drives them and pull SDA low to
+ *  answer. 1-Wire devices time how long the master holds their pin low and
+ *  answer by holding it low for a time themselves.
+ */
+
+#include "sim.h"
+
+/* Local / internal prototypes */
+static tSimBlock * simFindBlock(volatile uint32_t * reg, uint32_t * index);
+static uint32_t simGpioLevels(tSimBlock * block, int bank);
+static void simGpioUpdate(tSimBlock * block);
+static void simGpioWrite(tSimBlock * block, uint32_t index, uint32_t value);
+static uint32_t simGpioOutputs(tSimBlock * block, int bank);
+static int simPinBusUpdate(uint32_t levels);
+static void simOneWireUpdate(uint32_t masterLow);
+static void simOneWireSlot(tSimOneWireDevice * device, int start, int bit, uint64_t now);
+static uint32_t simOneWireLow(void);
+static errStatus simShiftAttach(int input, int gpioNumberClock, int gpioNumberStrobe,
+                                int gpioNumberData, int registers);
+static tSimShiftChain * simShiftFind(int gpioNumberData, int input);
+static int simShiftUpdate(uint32_t levels);
+static uint32_t simSwitchLow(uint32_t drivenLow);
+static uint8_t simCrc8(const uint8_t * data, int length);
+static void simPinBusEdge(tSimPinBus * bus, int sda, int scl);
+static void simBscProgress(tSimBlock * block);
+static void simBscWrite(tSimBlock * block, uint32_t index, uint32_t value);
+static uint32_t simBscRead(tSimBlock * block, uint32_t index);
+static void simCmWrite(tSimBlock * block, uint32_t index, uint32_t value);
+static uint32_t simCmRead(tSimBlock * block, uint32_t index);
+static int simCmRunning(uint32_t ctlOffset);
+static void simPwmWrite(tSimBlock * block, uint32_t index, uint32_t value);
+static uint32_t simPwmRead(tSimBlock * block, uint32_t index);
+static int simRegisterFileStart(void * context, int read);
+static int simRegisterFileWrite(void * context, uint8_t byte);
+static uint8_t simRegisterFileRead(void * context);
+static errStatus simRegisterFileNew(tSimI2cDevice * device);
+
+/** @brief A simple device with 256 byte registers and an auto incrementing
+ ** register pointer, set by the first byte of each write. */
+typedef struct {
+    uint8_t mem[256];   /**< Register contents */
+    uint8_t pointer;    /**< Register pointer */
+    int     first;      /**< Next written byte sets the pointer */
+    int     inUse;      /**< Allocated */
+} tSimRegisterFile;
+
+/**** Globals ****/
+/** @brief Serialises every simulated register access. */
+static pthread_mutex_t gSimLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Simulated peripheral blocks. */
+static tSimBlock gSimBlocks[SIM_BLOCK_MAX] __attribute__((aligned(SIM_BLOCK_SIZE)));
+
+/** @brief Revision code reported to boardDetect(). */
+static uint32_t gSimRevision = SIM_DEFAULT_REVISION;
+
+/** @brief Output latches of bank 0 and 1. */
+static uint32_t gSimOutputs[2];
+
+/** @brief Pins driven from outside, bit set if driven. */
+static uint32_t gSimInputMask = 0;
+
+/** @brief Levels of pins driven from outside. */
+static uint32_t gSimInputs = 0;
+
+/** @brief Pins with a pull up, bank 0. */
+static uint32_t gSimPullUps = 0;
+
+/** @brief Pins with a pull down, bank 0. */
+static uint32_t gSimPullDowns = 0;
+
+/** @brief Last computed bank 0 levels, for edge detection. */
+static uint32_t gSimLastLevels = 0;
+
+/** @brief Level change observer. */
+static tSimLevelWatch gSimWatch = NULL;
+
+/** @brief Context passed to gSimWatch. */
+static void * gSimWatchContext = NULL;
+
+/** @brief Attached I2C slaves by address. */
+static tSimI2cDevice gSimDevices[SIM_I2C_ADDRESSES];
+
+/** @brief Non zero if an address has a slave attached. */
+static int gSimDeviceAttached[SIM_I2C_ADDRESSES];
+
+/** @brief Slaves on GPIO pins. */
+static tSimPinBus gSimPinBuses[SIM_PIN_BUSES];
+
+/** @brief Pins pulled low by slaves on GPIO pins. */
+static uint32_t gSimBusLow = 0;
+
+/** @brief 1-Wire devices. */
+static tSimOneWireDevice gSimOneWire[SIM_ONE_WIRE_DEVICES];
+
+/** @brief Pins with a 1-Wire device. */
+static uint32_t gSimOneWirePins = 0;
+
+/** @brief 1-Wire pins the master held low at the last update. */
+static uint32_t gSimOneWireMasterLow = 0;
+
+/** @brief When the master last pulled each pin low. */
+static uint64_t gSimOneWireFall_ns[32];
+
+/** @brief Storage for simI2cAttachRegisterFile(). */
+static tSimRegisterFile gSimRegisterFiles[SIM_REGISTER_FILES];
+
+/** @brief Shift register chains. */
+static tSimShiftChain gSimShift[SIM_SHIFT_CHAINS];
+
+/** @brief Pins driven by a 74HC165 chain's QH. */
+static uint32_t gSimShiftPins = 0;
+
+/** @brief Levels of the QH pins. */
+static uint32_t gSimShiftLevels = 0;
+
+/** @brief Levels at the last simShiftUpdate(), for clock and strobe edges. */
+static uint32_t gSimShiftLast = 0;
+
+/** @brief One pin of each closed switch. */
+static uint32_t gSimSwitchA[SIM_SWITCHES];
+
+/** @brief The other pin of each closed switch. */
+static uint32_t gSimSwitchB[SIM_SWITCHES];
+
+/** @brief Entries of gSimSwitchA and gSimSwitchB in use. */
+static unsigned int gSimSwitchCount = 0;
+
+/** @brief Clock manager writes hardware would ignore or glitch on. */
+static uint32_t gSimCmFaults = 0;
+
+/**
+ * @brief           Sets the revision code the simulated board reports.
+ * @details         Must be called before gpioSetup(). Defaults to
+ *                  #SIM_DEFAULT_REVISION.
+ * @param revision  A revision code as found in /proc/cpuinfo.
+ * @return          An error from #errStatus. */
+errStatus simSetRevision(uint32_t revision)
+{
+    pthread_mutex_lock(&gSimLock);
+    gSimRevision = revision;
+    pthread_mutex_unlock(&gSimLock);
+
+    return OK;
+}
+
+
+/**
+ * @brief           Drives simulated pins from outside the Pi.
+ * @details         A pin in \p mask configured as anything but an output
+ *                  reads as the matching bit of \p levels. Pins outside
+ *                  \p mask read their pull resistor, or low if none.
+ * @param mask      Bank 0 pins which are driven externally.
+ * @param levels    Levels of the driven pins.
+ * @return          An error from #errStatus. */
+errStatus simSetInputs(uint32_t mask, uint32_t levels)
+{
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimLock);
+    gSimInputMask = mask;
+    gSimInputs = levels & mask;
+
+    for (index = 0; index < SIM_BLOCK_MAX; index++)
+    {
+        if (gSimBlocks[index].mapped && gSimBlocks[index].model == simModelGpio)
+        {
+            simGpioUpdate(&gSimBlocks[index]);
+        }
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return OK;
+}
+
+
+/**
+ * @brief               Registers a function called on every level change.
+ * @param watch         The function, or NULL to remove it.
+ * @param[in] context   Passed to \p watch.
+ * @return              An error from #errStatus. */
+errStatus simSetLevelWatch(tSimLevelWatch watch, void * context)
+{
+    pthread_mutex_lock(&gSimLock);
+    gSimWatch = watch;
+    gSimWatchContext = context;
+    pthread_mutex_unlock(&gSimLock);
+
+    return OK;
+}
+
+
+/**
+ * @brief           Attaches a simulated slave to every simulated BSC.
+ * @param address   7-bit slave address.
+ * @param[in] device The callbacks, copied.
+ * @return          An error from #errStatus. */
+errStatus simI2cAttach(uint8_t address, const tSimI2cDevice * device)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (device == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if (address >= SIM_I2C_ADDRESSES)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimLock);
+        gSimDevices[address] = *device;
+        gSimDeviceAttached[address] = 1;
+        pthread_mutex_unlock(&gSimLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Attaches a 256 byte register file slave.
+ * @details         The first byte of a write sets the register pointer, later
+ *                  bytes are stored. Reads return bytes from the pointer. The
+ *                  pointer increments after every access. This matches most
+ *                  sensors and small EEPROMs.
+ * @param address   7-bit slave address.
+ * @return          An error from #errStatus. */
+errStatus simI2cAttachRegisterFile(uint8_t address)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSimI2cDevice device;
+
+    if ((rtn = simRegisterFileNew(&device)) == OK)
+    {
+        rtn = simI2cAttach(address, &device);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Removes the slave at \p address.
+ * @param address   7-bit slave address.
+ * @return          An error from #errStatus. */
+errStatus simI2cDetach(uint8_t address)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (address >= SIM_I2C_ADDRESSES)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimLock);
+        gSimDeviceAttached[address] = 0;
+        pthread_mutex_unlock(&gSimLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Attaches a simulated slave to a pair of GPIO pins.
+ * @details             The slave follows the pin levels as a bit banging
+ *                      master drives them, answering at \p address by
+ *                      pulling SDA low. Both pins need a pull up, as on a
+ *                      real bus. Each pair of pins holds one slave.
+ * @param gpioNumberSda The SDA pin, GPIO00 - GPIO31.
+ * @param gpioNumberScl The SCL pin, GPIO00 - GPIO31.
+ * @param address       7-bit slave address.
+ * @param[in] device    The callbacks, copied.
+ * @return              An error from #errStatus. */
+errStatus simI2cAttachPins(int gpioNumberSda, int gpioNumberScl, uint8_t address,
+                           const tSimI2cDevice * device)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    unsigned int index = 0;
+
+    if (device == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if (gpioNumberSda < 0 || gpioNumberSda > 31 || gpioNumberScl < 0 ||
+             gpioNumberScl > 31 || gpioNumberSda == gpioNumberScl)
+    {
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (address >= SIM_I2C_ADDRESSES)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        rtn = ERROR_RANGE;
+
+        pthread_mutex_lock(&gSimLock);
+        for (index = 0; index < SIM_PIN_BUSES; index++)
+        {
+            if (!gSimPinBuses[index].inUse)
+            {
+                memset(&gSimPinBuses[index], 0, sizeof(tSimPinBus));
+                gSimPinBuses[index].sda = 0x1u << gpioNumberSda;
+                gSimPinBuses[index].scl = 0x1u << gpioNumberScl;
+                gSimPinBuses[index].last = gSimPinBuses[index].sda | gSimPinBuses[index].scl;
+                gSimPinBuses[index].address = address;
+                gSimPinBuses[index].device = *device;
+                gSimPinBuses[index].inUse = 1;
+                rtn = OK;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&gSimLock);
+
+        if (rtn != OK)
+        {
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Attaches a 256 byte register file slave to a pair of
+ *                      GPIO pins. See simI2cAttachRegisterFile().
+ * @param gpioNumberSda The SDA pin.
+ * @param gpioNumberScl The SCL pin.
+ * @param address       7-bit slave address.
+ * @return              An error from #errStatus. */
+errStatus simI2cAttachPinsRegisterFile(int gpioNumberSda, int gpioNumberScl,
+                                       uint8_t address)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSimI2cDevice device;
+
+    if ((rtn = simRegisterFileNew(&device)) == OK)
+    {
+        rtn = simI2cAttachPins(gpioNumberSda, gpioNumberScl, address, &device);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Removes the slave on the pins with SDA \p gpioNumberSda.
+ * @param gpioNumberSda The SDA pin.
+ * @return              An error from #errStatus. */
+errStatus simI2cDetachPins(int gpioNumberSda)
+{
+    errStatus rtn = ERROR_RANGE;
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimLock);
+    for (index = 0; index < SIM_PIN_BUSES; index++)
+    {
+        if (gSimPinBuses[index].inUse && gpioNumberSda >= 0 && gpioNumberSda < 32 &&
+            gSimPinBuses[index].sda == 0x1u << gpioNumberSda)
+        {
+            gSimBusLow &= ~gSimPinBuses[index].sda;
+            gSimPinBuses[index].inUse = 0;
+            rtn = OK;
+        }
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Attaches a simulated DS18B20 temperature probe to a
+ *                      GPIO pin.
+ * @details             The probe answers reset, search ROM, match ROM, skip
+ *                      ROM, convert T, which completes at once, and read
+ *                      scratchpad. Any number of probes may share a pin, which
+ *                      needs a pull up as on a real bus.
+ * @param gpioNumber    The pin, GPIO00 - GPIO31.
+ * @param rom           64-bit ROM code, family code in the low byte and CRC
+ *                      in the high byte.
+ * @param temperature   Temperature reported, in 1/16 C.
+ * @return              An error from #errStatus. */
+errStatus simOneWireAttach(int gpioNumber, uint64_t rom, int16_t temperature)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    unsigned int index = 0;
+
+    if (gpioNumber < 0 || gpioNumber > 31)
+    {
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        rtn = ERROR_RANGE;
+
+        pthread_mutex_lock(&gSimLock);
+        for (index = 0; index < SIM_ONE_WIRE_DEVICES; index++)
+        {
+            if (!gSimOneWire[index].inUse)
+            {
+                memset(&gSimOneWire[index], 0, sizeof(tSimOneWireDevice));
+                gSimOneWire[index].pin = 0x1u << gpioNumber;
+                gSimOneWire[index].rom = rom;
+                gSimOneWire[index].temperature = temperature;
+                gSimOneWire[index].inUse = 1;
+                gSimOneWirePins |= gSimOneWire[index].pin;
+                rtn = OK;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&gSimLock);
+
+        if (rtn != OK)
+        {
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Removes every 1-Wire device on a pin.
+ * @param gpioNumber    The pin.
+ * @return              An error from #errStatus. */
+errStatus simOneWireDetach(int gpioNumber)
+{
+    errStatus rtn = ERROR_RANGE;
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimLock);
+    for (index = 0; index < SIM_ONE_WIRE_DEVICES; index++)
+    {
+        if (gSimOneWire[index].inUse && gpioNumber >= 0 && gpioNumber < 32 &&
+            gSimOneWire[index].pin == 0x1u << gpioNumber)
+        {
+            gSimOneWire[index].inUse = 0;
+            gSimOneWirePins &= ~gSimOneWire[index].pin;
+            rtn = OK;
+        }
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief                   Attaches a chain of 74HC595s, SER of the first on
+ *                          \p gpioNumberData.
+ * @details                 Each rising clock edge shifts SER into QA of the
+ *                          first register and QH' of each register into the
+ *                          next. A rising latch edge copies the stages to the
+ *                          outputs read by simShiftGetOutputs().
+ * @param gpioNumberClock   SRCLK, GPIO00 - GPIO31.
+ * @param gpioNumberLatch   RCLK, GPIO00 - GPIO31.
+ * @param gpioNumberData    SER of the first register, GPIO00 - GPIO31.
+ * @param registers         Registers in the chain, 1 - #SIM_SHIFT_REGISTERS.
+ * @return                  An error from #errStatus. */
+errStatus simShiftAttachOutputs(int gpioNumberClock, int gpioNumberLatch,
+                                int gpioNumberData, int registers)
+{
+    return simShiftAttach(0, gpioNumberClock, gpioNumberLatch, gpioNumberData, registers);
+}
+
+
+/**
+ * @brief                   Attaches a chain of 74HC165s, QH of the first on
+ *                          \p gpioNumberData.
+ * @details                 While the load is low the registers hold the
+ *                          inputs set by simShiftSetInputs(). Each rising
+ *                          clock edge with the load high shifts every
+ *                          register towards the first, the last taking in a
+ *                          0. QH of the first drives the pin unless it is an
+ *                          output.
+ * @param gpioNumberClock   CLK, GPIO00 - GPIO31.
+ * @param gpioNumberLoad    SH/LD, GPIO00 - GPIO31.
+ * @param gpioNumberData    QH of the first register, GPIO00 - GPIO31.
+ * @param registers         Registers in the chain, 1 - #SIM_SHIFT_REGISTERS.
+ * @return                  An error from #errStatus. */
+errStatus simShiftAttachInputs(int gpioNumberClock, int gpioNumberLoad,
+                               int gpioNumberData, int registers)
+{
+    return simShiftAttach(1, gpioNumberClock, gpioNumberLoad, gpioNumberData, registers);
+}
+
+
+/**
+ * @brief               Sets the parallel inputs of a 74HC165 chain.
+ * @param gpioNumberData The chain's QH pin.
+ * @param[in] data      One byte per register, the first register first. Bit
+ *                      n is input n, A being bit 0.
+ * @return              An error from #errStatus. */
+errStatus simShiftSetInputs(int gpioNumberData, const uint8_t * data)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSimShiftChain * chain = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+
+    if (data == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if ((chain = simShiftFind(gpioNumberData, 1)) == NULL)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memcpy(chain->parallel, data, chain->registers);
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Gets the latched outputs of a 74HC595 chain.
+ * @param gpioNumberData The chain's SER pin.
+ * @param[out] data     One byte per register, the first register first. Bit
+ *                      n is output Qn, QA being bit 0.
+ * @return              An error from #errStatus. */
+errStatus simShiftGetOutputs(int gpioNumberData, uint8_t * data)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSimShiftChain * chain = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+
+    if (data == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else if ((chain = simShiftFind(gpioNumberData, 0)) == NULL)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        memcpy(data, chain->parallel, chain->registers);
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Removes the shift register chain on a data pin.
+ * @param gpioNumberData The chain's SER or QH pin.
+ * @return              An error from #errStatus. */
+errStatus simShiftDetach(int gpioNumberData)
+{
+    errStatus rtn = ERROR_RANGE;
+    tSimShiftChain * chain = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+
+    if ((chain = simShiftFind(gpioNumberData, -1)) != NULL)
+    {
+        chain->inUse = 0;
+        gSimShiftPins &= ~(chain->input ? chain->data : 0);
+        gSimShiftLevels &= gSimShiftPins;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Opens or closes a switch between two pins, such as a
+ *                      key of a keypad matrix.
+ * @details             A closed switch carries a low: while either pin is an
+ *                      output latched low the other reads low, unless it is
+ *                      an output. Otherwise the pins read as they would.
+ * @param gpioNumberA   One pin, GPIO00 - GPIO31.
+ * @param gpioNumberB   The other pin, GPIO00 - GPIO31.
+ * @param closed        Non zero to close the switch, 0 to open it.
+ * @return              An error from #errStatus. */
+errStatus simSwitchSet(int gpioNumberA, int gpioNumberB, int closed)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins = 0x1u << (gpioNumberA & 0x1F) | 0x1u << (gpioNumberB & 0x1F);
+    unsigned int index = 0;
+
+    if (gpioNumberA < 0 || gpioNumberA > 31 || gpioNumberB < 0 || gpioNumberB > 31 ||
+        gpioNumberA == gpioNumberB)
+    {
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        rtn = OK;
+
+        pthread_mutex_lock(&gSimLock);
+        for (index = 0; index < gSimSwitchCount; index++)
+        {
+            if ((gSimSwitchA[index] | gSimSwitchB[index]) == pins)
+            {
+                break;
+            }
+        }
+
+        if (!closed && index < gSimSwitchCount)
+        {
+            gSimSwitchCount--;
+            gSimSwitchA[index] = gSimSwitchA[gSimSwitchCount];
+            gSimSwitchB[index] = gSimSwitchB[gSimSwitchCount];
+        }
+
+        else if (closed && index == SIM_SWITCHES)
+        {
+            rtn = ERROR_RANGE;
+        }
+
+        else if (closed && index == gSimSwitchCount)
+        {
+            gSimSwitchA[index] = 0x1u << gpioNumberA;
+            gSimSwitchB[index] = 0x1u << gpioNumberB;
+            gSimSwitchCount++;
+        }
+
+        for (index = 0; index < SIM_BLOCK_MAX; index++)
+        {
+            if (gSimBlocks[index].mapped && gSimBlocks[index].model == simModelGpio)
+            {
+                simGpioUpdate(&gSimBlocks[index]);
+            }
+        }
+        pthread_mutex_unlock(&gSimLock);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Reads what a mapped block holds in a register, without
+ *                  the side effects a read by the library has.
+ * @param offset    Offset of the register from the peripheral base, e.g.
+ *                  #PWM_BASE_OFFSET + #PWM_RNG1_OFFSET.
+ * @param[out] value Populated with the register contents. The password byte
+ *                  of clock manager registers reads as zero.
+ * @return          #ERROR_RANGE if no mapped block holds \p offset. */
+errStatus simPeekRegister(uint32_t offset, uint32_t * value)
+{
+    errStatus rtn = ERROR_RANGE;
+    unsigned int index = 0;
+
+    if (value == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimLock);
+        for (index = 0; index < SIM_BLOCK_MAX && rtn != OK; index++)
+        {
+            if (gSimBlocks[index].mapped && offset >= gSimBlocks[index].offset &&
+                offset < gSimBlocks[index].offset + SIM_BLOCK_SIZE)
+            {
+                *value = gSimBlocks[index].regs[(offset - gSimBlocks[index].offset) /
+                                                sizeof(uint32_t)];
+                rtn = OK;
+            }
+        }
+        pthread_mutex_unlock(&gSimLock);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Counts the clock manager writes hardware would have
+ *                  ignored or glitched on.
+ * @details         A write without #CM_PASSWD, or one changing the divisor,
+ *                  source or MASH of a generator which is still BUSY. The
+ *                  count runs for the life of the process.
+ * @param[out] faults Populated with the count.
+ * @return          An error from #errStatus. */
+errStatus simCmGetFaults(uint32_t * faults)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (faults == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimLock);
+        *faults = gSimCmFaults;
+        pthread_mutex_unlock(&gSimLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Accepted for compatibility, simulated blocks are never
+ *                  mapped from a device.
+ * @param mode      The mapping mode to use.
+ * @return          An error from #errStatus. */
+errStatus gpioSetMapMode(eMapMode mode)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (mode < mapAuto || mode > mapCombined)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Accepted for compatibility, simulated blocks are never
+ *                  mapped from a device.
+ * @param blocks    #eMapBlock flags combined with bitwise OR.
+ * @return          An error from #errStatus. */
+errStatus gpioSetMapBlocks(uint32_t blocks)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (blocks == 0 || (blocks & ~(uint32_t)mapBlockAll) != 0)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function which hands out a simulated block in
+ *                  place of the periph.c mapping.
+ * @param[in] board Board table entry, unused.
+ * @param offset    Offset of the block from the peripheral base.
+ * @param[out] map  Populated with the block's registers.
+ * @return          An error from #errStatus. */
+errStatus periphMap(const tBoard * board, uint32_t offset, volatile uint32_t ** map)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    unsigned int index = 0;
+    tSimBlock * block = NULL;
+
+    if (board == NULL || map == NULL)
+    {
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimLock);
+        while (index < SIM_BLOCK_MAX && gSimBlocks[index].mapped)
+        {
+            index++;
+        }
+
+        if (index < SIM_BLOCK_MAX)
+        {
+            block = &gSimBlocks[index];
+            memset(block, 0, sizeof(*block));
+            block->mapped = 1;
+            block->offset = offset;
+
+            if (offset == GPIO_BASE_OFFSET)
+            {
+                block->model = simModelGpio;
+                gSimOutputs[0] = gSimOutputs[1] = 0;
+                gSimLastLevels = simGpioLevels(block, 0);
+            }
+
+            else if (offset == BSC0_BASE_OFFSET || offset == BSC1_BASE_OFFSET ||
+                     offset == BSC2_BASE_OFFSET)
+            {
+                block->model = simModelBsc;
+            }
+
+            else if (offset == DMA_BASE_OFFSET)
+            {
+                block->model = simModelDma;
+            }
+
+            else if (offset == CM_BASE_OFFSET)
+            {
+                block->model = simModelCm;
+            }
+
+            else if (offset == PWM_BASE_OFFSET)
+            {
+                block->model = simModelPwm;
+            }
+
+            *map = block->regs;
+            rtn = OK;
+        }
+        pthread_mutex_unlock(&gSimLock);
+
+        if (block == NULL)
+        {
+            rtn = ERROR_RANGE;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function which releases a simulated block.
+ * @param map       Pointer returned by periphMap().
+ * @return          An error from #errStatus. */
+errStatus periphUnmap(volatile uint32_t * map)
+{
+    errStatus rtn = ERROR_RANGE;
+    uint32_t index = 0;
+    tSimBlock * block = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+    if ((block = simFindBlock(map, &index)) != NULL)
+    {
+        block->mapped = 0;
+        rtn = OK;
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Internal function which returns the simulated revision code.
+ * @return  The revision code set by simSetRevision(). */
+uint32_t simRevision(void)
+{
+    return gSimRevision;
+}
+
+
+/**
+ * @brief       Internal function behind REG_READ() in the simulated build.
+ * @param reg   Address of the register.
+ * @return      The register value. */
+uint32_t simRegRead(volatile uint32_t * reg)
+{
+    uint32_t value = 0;
+    uint32_t index = 0;
+    tSimBlock * block = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+    if ((block = simFindBlock(reg, &index)) == NULL)
+    {
+        value = *reg;
+    }
+
+    else if (block->model == simModelGpio)
+    {
+        switch (index * sizeof(uint32_t))
+        {
+            case GPLEV0_OFFSET:
+                value = simGpioLevels(block, 0);
+                break;
+            case GPLEV1_OFFSET:
+                value = simGpioLevels(block, 1);
+                break;
+            /* Write only */
+            case GPSET0_OFFSET: case GPSET1_OFFSET:
+            case GPCLR0_OFFSET: case GPCLR1_OFFSET:
+                value = 0;
+                break;
+            default:
+                value = block->regs[index];
+                break;
+        }
+    }
+
+    else if (block->model == simModelBsc)
+    {
+        value = simBscRead(block, index);
+    }
+
+    else if (block->model == simModelCm)
+    {
+        value = simCmRead(block, index);
+    }
+
+    else if (block->model == simModelPwm)
+    {
+        value = simPwmRead(block, index);
+    }
+
+    else
+    {
+        value = block->regs[index];
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return value;
+}
+
+
+/**
+ * @brief       Internal function behind REG_WRITE() in the simulated build.
+ * @param reg   Address of the register.
+ * @param value The value written. */
+void simRegWrite(volatile uint32_t * reg, uint32_t value)
+{
+    uint32_t index = 0;
+    tSimBlock * block = NULL;
+    tSimBlock * dma = NULL;
+
+    pthread_mutex_lock(&gSimLock);
+    if ((block = simFindBlock(reg, &index)) == NULL)
+    {
+        *reg = value;
+    }
+
+    else if (block->model == simModelGpio)
+    {
+        simGpioWrite(block, index, value);
+    }
+
+    else if (block->model == simModelBsc)
+    {
+        simBscWrite(block, index, value);
+    }
+
+    else if (block->model == simModelCm)
+    {
+        simCmWrite(block, index, value);
+    }
+
+    else if (block->model == simModelPwm)
+    {
+        simPwmWrite(block, index, value);
+    }
+
+    /* Starting or stopping a channel joins its thread, so not under the lock */
+    else if (block->model == simModelDma)
+    {
+        dma = block;
+    }
+
+    else
+    {
+        block->regs[index] = value;
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    if (dma != NULL)
+    {
+        simDmaWrite(dma->regs, index, value);
+    }
+}
+
+
+/**
+ * @brief           Internal function which finds a register of a mapped
+ *                  block by its peripheral offset, as the DMA engine does.
+ * @param offset    Offset of the register from the peripheral base.
+ * @return          The register or NULL if its block is not mapped. */
+volatile uint32_t * simPeriphReg(uint32_t offset)
+{
+    volatile uint32_t * reg = NULL;
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimLock);
+    for (index = 0; index < SIM_BLOCK_MAX && reg == NULL; index++)
+    {
+        if (gSimBlocks[index].mapped && offset >= gSimBlocks[index].offset &&
+            offset < gSimBlocks[index].offset + SIM_BLOCK_SIZE)
+        {
+            reg = gSimBlocks[index].regs + (offset - gSimBlocks[index].offset) /
+                                           sizeof(uint32_t);
+        }
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    return reg;
+}
+
+
+/**
+ * @brief           Internal function which finds the block holding \p reg.
+ * @param reg       Register address.
+ * @param[out] index Populated with the word index of \p reg in the block.
+ * @return          The block or NULL. */
+static tSimBlock * simFindBlock(volatile uint32_t * reg, uint32_t * index)
+{
+    unsigned int block = 0;
+
+    for (block = 0; block < SIM_BLOCK_MAX; block++)
+    {
+        if (gSimBlocks[block].mapped &&
+            reg >= gSimBlocks[block].regs &&
+            reg < gSimBlocks[block].regs + SIM_BLOCK_SIZE / sizeof(uint32_t))
+        {
+            *index = reg - gSimBlocks[block].regs;
+            return &gSimBlocks[block];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief       Internal function which computes the pin levels of a bank.
+ * @details     Outputs read their latch. Other pins read low if a pin bus
+ *              slave pulls them low, else the external level if driven,
+ *              otherwise their pull resistor.
+ * @param block The GPIO block.
+ * @param bank  0 for GPIO00 - 31, 1 for GPIO32 - 53.
+ * @return      The GPLEVn value. */
+static uint32_t simGpioLevels(tSimBlock * block, int bank)
+{
+    uint32_t outputs = simGpioOutputs(block, bank);
+    uint32_t slaveLow = gSimBusLow;
+
+    if (bank)
+    {
+        return gSimOutputs[1] & outputs;
+    }
+
+    if (gSimOneWirePins)
+    {
+        slaveLow |= simOneWireLow();
+    }
+
+    if (gSimSwitchCount)
+    {
+        slaveLow |= simSwitchLow(outputs & ~gSimOutputs[0]);
+    }
+
+    return (gSimOutputs[0] & outputs) |
+           (~outputs & ~slaveLow & ~gSimShiftPins &
+            ((gSimInputs & gSimInputMask) | (gSimPullUps & ~gSimInputMask))) |
+           (~outputs & gSimShiftLevels);
+}
+
+
+/**
+ * @brief       Internal function, the pins of a bank set to output.
+ * @param block The GPIO block.
+ * @param bank  0 for GPIO00 - GPIO31, 1 for GPIO32 - GPIO53.
+ * @return      Bit n set if pin n of the bank is an output. */
+static uint32_t simGpioOutputs(tSimBlock * block, int bank)
+{
+    uint32_t outputs = 0;
+    uint32_t pin = 0;
+    uint32_t fsel = 0;
+    uint32_t first = bank * 32;
+    uint32_t last = bank ? 54 : 32;
+
+    for (pin = first; pin < last; pin++)
+    {
+        fsel = (block->regs[pin / 10] >> ((pin % 10) * 3)) & GPFSEL_BITS;
+
+        if (fsel == GPFSEL_OUTPUT)
+        {
+            outputs |= 0x1u << (pin - first);
+        }
+    }
+
+    return outputs;
+}
+
+
+/**
+ * @brief       Internal function which applies edge detection after bank 0
+ *              levels may have changed.
+ * @param block The GPIO block.
+ */
+static void simGpioUpdate(tSimBlock * block)
+{
+    uint32_t levels = simGpioLevels(block, 0);
+    uint32_t changed = 0;
+    uint32_t rising = 0;
+    uint32_t falling = 0;
+    uint32_t * regs = block->regs;
+
+    /* A slave answering changes SDA, which it only does while SCL is low */
+    if (simPinBusUpdate(levels))
+    {
+        levels = simGpioLevels(block, 0);
+    }
+
+    /* 1-Wire devices follow what the master drives, not the line */
+    if (gSimOneWirePins)
+    {
+        simOneWireUpdate(simGpioOutputs(block, 0) & ~gSimOutputs[0] & gSimOneWirePins);
+        levels = simGpioLevels(block, 0);
+    }
+
+    /* Shift registers clock on what the master drives, QH then follows */
+    if (simShiftUpdate(levels))
+    {
+        levels = simGpioLevels(block, 0);
+    }
+
+    changed = levels ^ gSimLastLevels;
+    rising = changed & levels;
+    falling = changed & ~levels;
+
+    if (changed)
+    {
+        regs[GPEDS0_OFFSET / sizeof(uint32_t)] |=
+            (rising & (regs[GPREN0_OFFSET / sizeof(uint32_t)] |
+                       regs[GPAREN0_OFFSET / sizeof(uint32_t)])) |
+            (falling & (regs[GPFEN0_OFFSET / sizeof(uint32_t)] |
+                        regs[GPAFEN0_OFFSET / sizeof(uint32_t)]));
+
+        gSimLastLevels = levels;
+
+        if (gSimWatch != NULL)
+        {
+            gSimWatch(gSimWatchContext, timeNowNs(), levels, changed);
+        }
+    }
+
+    /* Level detection holds while the level is present */
+    regs[GPEDS0_OFFSET / sizeof(uint32_t)] |=
+        (levels & regs[GPHEN0_OFFSET / sizeof(uint32_t)]) |
+        (~levels & regs[GPLEN0_OFFSET / sizeof(uint32_t)]);
+}
+
+
+/**
+ * @brief       Internal function which applies a write to the GPIO block.
+ * @param block The GPIO block.
+ * @param index Word index of the register.
+ * @param value Value written.
+ */
+static void simGpioWrite(tSimBlock * block, uint32_t index, uint32_t value)
+{
+    uint32_t pin = 0;
+    uint32_t pull = 0;
+
+    switch (index * sizeof(uint32_t))
+    {
+        case GPSET0_OFFSET:
+            gSimOutputs[0] |= value;
+            break;
+        case GPSET1_OFFSET:
+            gSimOutputs[1] |= value;
+            break;
+        case GPCLR0_OFFSET:
+            gSimOutputs[0] &= ~value;
+            break;
+        case GPCLR1_OFFSET:
+            gSimOutputs[1] &= ~value;
+            break;
+        case GPLEV0_OFFSET:
+        case GPLEV1_OFFSET:
+            break;
+        /* Write 1 to clear */
+        case GPEDS0_OFFSET:
+        case GPEDS1_OFFSET:
+            block->regs[index] &= ~value;
+            break;
+        /* The pull in GPPUD is applied to the pins clocked */
+        case GPPUDCLK0_OFFSET:
+            pull = block->regs[GPPUD_OFFSET / sizeof(uint32_t)];
+            gSimPullUps = pull == GPPUD_PULLUP ? gSimPullUps | value :
+                                                 gSimPullUps & ~value;
+            gSimPullDowns = pull == GPPUD_PULLDOWN ? gSimPullDowns | value :
+                                                     gSimPullDowns & ~value;
+            block->regs[index] = value;
+            break;
+        case GPPUPPDN0_OFFSET:
+        case GPPUPPDN1_OFFSET:
+            block->regs[index] = value;
+            for (pin = 0; pin < 16; pin++)
+            {
+                uint32_t bit = 0x1u << (pin + (index - GPPUPPDN0_OFFSET /
+                                               sizeof(uint32_t)) * 16);
+                pull = (value >> (pin * 2)) & GPPUPPDN_BITS;
+                gSimPullUps = pull == GPPUPPDN_PULLUP ? gSimPullUps | bit :
+                                                        gSimPullUps & ~bit;
+                gSimPullDowns = pull == GPPUPPDN_PULLDOWN ? gSimPullDowns | bit :
+                                                            gSimPullDowns & ~bit;
+            }
+            break;
+        default:
+            block->regs[index] = value;
+            break;
+    }
+
+    simGpioUpdate(block);
+}
+
+
+/**
+ * @brief       Internal function which advances a BSC transfer to now.
+ * @details     One byte (or the address) completes every byteTime_ns. A
+ *              write stalls with an empty FIFO, a read with a full one, as
+ *              the hardware does by holding SCL low.
+ * @param block The BSC block.
+ */
+static void simBscProgress(tSimBlock * block)
+{
+    tSimBsc * bsc = &block->bsc;
+    uint64_t now = timeNowNs();
+    tSimI2cDevice * device = NULL;
+
+    while (bsc->active && !bsc->stalled && now >= bsc->nextEvent_ns)
+    {
+        device = bsc->device;
+
+        if (bsc->addressPhase)
+        {
+            bsc->addressPhase = 0;
+
+            if (device == NULL ||
+                (device->start != NULL && !device->start(device->context, bsc->read)))
+            {
+                bsc->status |= BSC_ERR;
+                bsc->remaining = 0;
+            }
+        }
+
+        else if (!bsc->read)
+        {
+            if (bsc->fifoCount == 0)
+            {
+                bsc->stalled = 1;
+                break;
+            }
+
+            if (device->write != NULL &&
+                !device->write(device->context, bsc->fifo[bsc->fifoHead]))
+            {
+                bsc->status |= BSC_ERR;
+                bsc->remaining = 0;
+            }
+
+            else
+            {
+                bsc->remaining--;
+            }
+
+            bsc->fifoHead = (bsc->fifoHead + 1) % BSC_FIFO_SIZE;
+            bsc->fifoCount--;
+        }
+
+        else
+        {
+            if (bsc->fifoCount == BSC_FIFO_SIZE)
+            {
+                bsc->stalled = 1;
+                break;
+            }
+
+            bsc->fifo[(bsc->fifoHead + bsc->fifoCount) % BSC_FIFO_SIZE] =
+                device->read != NULL ? device->read(device->context) : 0xFF;
+            bsc->fifoCount++;
+            bsc->remaining--;
+        }
+
+        if (bsc->remaining == 0)
+        {
+            bsc->active = 0;
+            bsc->status |= BSC_DONE;
+
+            if (device != NULL && device->stop != NULL)
+            {
+                device->stop(device->context);
+            }
+        }
+
+        bsc->nextEvent_ns += bsc->byteTime_ns;
+    }
+}
+
+
+/**
+ * @brief       Internal function which applies a write to a BSC block.
+ * @param block The BSC block.
+ * @param index Word index of the register.
+ * @param value Value written.
+ */
+static void simBscWrite(tSimBlock * block, uint32_t index, uint32_t value)
+{
+    tSimBsc * bsc = &block->bsc;
+    uint32_t divider = 0;
+    uint32_t address = 0;
+    const tBoard * board = NULL;
+
+    simBscProgress(block);
+
+    switch (index * sizeof(uint32_t))
+    {
+        case BSC_C_OFFSET:
+            if (value & BSC_CLEAR)
+            {
+                bsc->fifoCount = 0;
+                bsc->fifoHead = 0;
+            }
+
+            if ((value & BSC_ST) && (value & BSC_I2CEN) && !bsc->active)
+            {
+                divider = block->regs[BSC_DIV_OFFSET / sizeof(uint32_t)] & 0xFFFE;
+                divider = divider ? divider : 32768;
+                address = block->regs[BSC_A_OFFSET / sizeof(uint32_t)] & 0x7F;
+
+                bsc->active = 1;
+                bsc->addressPhase = 1;
+                bsc->stalled = 0;
+                bsc->read = value & BSC_READ;
+                bsc->remaining = block->regs[BSC_DLEN_OFFSET / sizeof(uint32_t)] & 0xFFFF;
+                bsc->byteTime_ns = (uint64_t)CLOCKS_PER_BYTE_SIM * divider *
+                                   TIMING_NSEC_IN_SEC /
+                                   (gpioGetBoard(&board) == OK ? board->coreClockHz :
+                                                                 CORE_CLK_HZ);
+                bsc->nextEvent_ns = timeNowNs() + bsc->byteTime_ns;
+                bsc->device = gSimDeviceAttached[address] ? &gSimDevices[address] : NULL;
+            }
+
+            /* CLEAR and ST read back as zero */
+            block->regs[index] = value & ~(BSC_CLEAR | BSC_ST);
+            break;
+
+        /* Write 1 to clear */
+        case BSC_S_OFFSET:
+            bsc->status &= ~(value & (BSC_DONE | BSC_ERR | BSC_CLKT));
+            break;
+
+        case BSC_FIFO_OFFSET:
+            if (bsc->fifoCount < BSC_FIFO_SIZE)
+            {
+                bsc->fifo[(bsc->fifoHead + bsc->fifoCount) % BSC_FIFO_SIZE] = value;
+                bsc->fifoCount++;
+            }
+
+            if (bsc->stalled && !bsc->read)
+            {
+                bsc->stalled = 0;
+                bsc->nextEvent_ns = timeNowNs() + bsc->byteTime_ns;
+            }
+            break;
+
+        default:
+            block->regs[index] = value;
+            break;
+    }
+}
+
+
+/**
+ * @brief       Internal function which reads a register of a BSC block.
+ * @param block The BSC block.
+ * @param index Word index of the register.
+ * @return      The register value. */
+static uint32_t simBscRead(tSimBlock * block, uint32_t index)
+{
+    tSimBsc * bsc = &block->bsc;
+    uint32_t value = 0;
+
+    simBscProgress(block);
+
+    switch (index * sizeof(uint32_t))
+    {
+        case BSC_S_OFFSET:
+            value = bsc->status;
+            value |= bsc->active ? BSC_TA : 0;
+            value |= bsc->fifoCount < BSC_FIFO_SIZE ? BSC_TXD : 0;
+            value |= bsc->fifoCount > 0 ? BSC_RXD : 0;
+            value |= bsc->fifoCount == 0 ? BSC_TXE : 0;
+            value |= bsc->fifoCount == BSC_FIFO_SIZE ? BSC_RXF : 0;
+            value |= bsc->active && !bsc->read &&
+                     bsc->fifoCount < BSC_FIFO_SIZE / 4 ? BSC_TXW : 0;
+            value |= bsc->active && bsc->read &&
+                     bsc->fifoCount >= BSC_FIFO_SIZE * 3 / 4 ? BSC_RXR : 0;
+            break;
+
+        /* Reads back the bytes remaining while a transfer is active */
+        case BSC_DLEN_OFFSET:
+            value = bsc->active ? bsc->remaining : block->regs[index];
+            break;
+
+        case BSC_FIFO_OFFSET:
+            if (bsc->fifoCount > 0)
+            {
+                value = bsc->fifo[bsc->fifoHead];
+                bsc->fifoHead = (bsc->fifoHead + 1) % BSC_FIFO_SIZE;
+                bsc->fifoCount--;
+
+                if (bsc->stalled && bsc->read)
+                {
+                    bsc->stalled = 0;
+                    bsc->nextEvent_ns = timeNowNs() + bsc->byteTime_ns;
+                }
+            }
+            break;
+
+        default:
+            value = block->regs[index];
+            break;
+    }
+
+    return value;
+}
+
+
+/**
+ * @brief       Internal function which applies a write to the clock manager.
+ * @details     Writes without #CM_PASSWD are ignored, as are changes to the
+ *              divisor, source or MASH of a running generator, which
+ *              hardware glitches on. Both count in gSimCmFaults. Setting
+ *              ENAB sets BUSY at once, clearing it leaves BUSY set for
+ *              #SIM_CM_BUSY_READS reads and KILL clears it at once.
+ * @param block The clock manager block.
+ * @param index Word index of the register.
+ * @param value Value written.
+ */
+static void simCmWrite(tSimBlock * block, uint32_t index, uint32_t value)
+{
+    uint32_t ctl = index & ~0x1u;
+    uint32_t busy = 0;
+
+    if ((value & 0xFF000000) != CM_PASSWD)
+    {
+        gSimCmFaults++;
+    }
+
+    else if (index >= SIM_CM_REGS)
+    {
+        block->regs[index] = value & 0xFFFFFF;
+    }
+
+    else if ((busy = block->regs[ctl] & CM_BUSY) &&
+             (index != ctl ||
+              ((value ^ block->regs[ctl]) & (CM_SRC_MASK | CM_MASH_MASK | CM_FLIP))))
+    {
+        gSimCmFaults++;
+    }
+
+    else if (index != ctl)
+    {
+        block->regs[index] = value & 0xFFFFFF;
+    }
+
+    else if (value & CM_KILL)
+    {
+        block->regs[index] = value & 0xFFFFFF & ~(CM_KILL | CM_BUSY);
+        block->cmBusyReads[index] = 0;
+    }
+
+    else if (value & CM_ENAB)
+    {
+        block->regs[index] = (value & 0xFFFFFF) | CM_BUSY;
+        block->cmBusyReads[index] = 0;
+    }
+
+    else
+    {
+        block->regs[index] = (value & 0xFFFFFF & ~CM_BUSY) | busy;
+        block->cmBusyReads[index] = busy ? SIM_CM_BUSY_READS : 0;
+    }
+}
+
+
+/**
+ * @brief       Internal function which reads the clock manager.
+ * @details     A disabled generator's BUSY clears after #SIM_CM_BUSY_READS
+ *              reads of its control register.
+ * @param block The clock manager block.
+ * @param index Word index of the register.
+ * @return      The register value. */
+static uint32_t simCmRead(tSimBlock * block, uint32_t index)
+{
+    if (index < SIM_CM_REGS && block->cmBusyReads[index] > 0 &&
+        --block->cmBusyReads[index] == 0)
+    {
+        block->regs[index] &= ~CM_BUSY;
+    }
+
+    return block->regs[index];
+}
+
+
+/**
+ * @brief           Internal function which checks whether a clock generator
+ *                  of a mapped clock manager is running.
+ * @param ctlOffset Offset of the generator's control register.
+ * @return          Non zero if BUSY is set. */
+static int simCmRunning(uint32_t ctlOffset)
+{
+    unsigned int index = 0;
+    int running = 0;
+
+    for (index = 0; index < SIM_BLOCK_MAX; index++)
+    {
+        if (gSimBlocks[index].mapped && gSimBlocks[index].model == simModelCm)
+        {
+            running = (gSimBlocks[index].regs[ctlOffset / sizeof(uint32_t)] & CM_BUSY) != 0;
+        }
+    }
+
+    return running;
+}
+
+
+/**
+ * @brief       Internal function which applies a write to the PWM block.
+ * @param block The PWM block.
+ * @param index Word index of the register.
+ * @param value Value written.
+ */
+static void simPwmWrite(tSimBlock * block, uint32_t index, uint32_t value)
+{
+    switch (index * sizeof(uint32_t))
+    {
+        /* Write 1 to clear, the channel state bits are read only */
+        case PWM_STA_OFFSET:
+            block->regs[index] &= ~(value & PWM_STA_ERRORS);
+            break;
+
+        /* CLRF reads back as zero */
+        case PWM_CTL_OFFSET:
+            block->regs[index] = value & ~PWM_CLRF1;
+            break;
+
+        default:
+            block->regs[index] = value;
+            break;
+    }
+}
+
+
+/**
+ * @brief       Internal function which reads the PWM block.
+ * @details     A channel reports it is transmitting while it is enabled and
+ *              the PWM clock is running.
+ * @param block The PWM block.
+ * @param index Word index of the register.
+ * @return      The register value. */
+static uint32_t simPwmRead(tSimBlock * block, uint32_t index)
+{
+    uint32_t value = block->regs[index];
+    uint32_t ctl = block->regs[PWM_CTL_OFFSET / sizeof(uint32_t)];
+    int channel = 0;
+
+    if (index * sizeof(uint32_t) == PWM_STA_OFFSET && simCmRunning(CM_PWMCTL_OFFSET))
+    {
+        for (channel = 0; channel < 2; channel++)
+        {
+            value |= (ctl & (PWM_PWEN1 << (channel * PWM_CTL_CHANNEL_SHIFT))) ?
+                     PWM_STA_STA1 << channel : 0;
+        }
+    }
+
+    return value;
+}
+
+
+/**
+ * @brief   Internal function, register file address phase.
+ * @return  1, always acknowledged. */
+static int simRegisterFileStart(void * context, int read)
+{
+    ((tSimRegisterFile *)context)->first = !read;
+    return 1;
+}
+
+
+/**
+ * @brief   Internal function, register file write.
+ * @return  1, always acknowledged. */
+static int simRegisterFileWrite(void * context, uint8_t byte)
+{
+    tSimRegisterFile * file = (tSimRegisterFile *)context;
+
+    if (file->first)
+    {
+        file->pointer = byte;
+        file->first = 0;
+    }
+
+    else
+    {
+        file->mem[file->pointer++] = byte;
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Internal function, register file read.
+ * @return  The byte at the register pointer. */
+static uint8_t simRegisterFileRead(void * context)
+{
+    tSimRegisterFile * file = (tSimRegisterFile *)context;
+
+    return file->mem[file->pointer++];
+}
+
+
+/**
+ * @brief           Internal function, allocates a register file.
+ * @param[out] device The callbacks for the register file.
+ * @return          An error from #errStatus. */
+static errStatus simRegisterFileNew(tSimI2cDevice * device)
+{
+    errStatus rtn = ERROR_RANGE;
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimLock);
+    for (index = 0; index < SIM_REGISTER_FILES; index++)
+    {
+        if (!gSimRegisterFiles[index].inUse)
+        {
+            memset(&gSimRegisterFiles[index], 0, sizeof(tSimRegisterFile));
+            gSimRegisterFiles[index].inUse = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gSimLock);
+
+    if (index == SIM_REGISTER_FILES)
+    {
+    }
+
+    else
+    {
+        device->start = simRegisterFileStart;
+        device->write = simRegisterFileWrite;
+        device->read = simRegisterFileRead;
+        device->stop = NULL;
+        device->context = &gSimRegisterFiles[index];
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function, runs the slaves on GPIO pins against
+ *                  the new pin levels. Called with the lock held.
+ * @param levels    The GPIO levels.
+ * @return          Non zero if a slave changed what it drives. */
+static int simPinBusUpdate(uint32_t levels)
+{
+    uint32_t low = 0;
+    uint32_t before = gSimBusLow;
+    unsigned int index = 0;
+
+    for (index = 0; index < SIM_PIN_BUSES; index++)
+    {
+        tSimPinBus * bus = &gSimPinBuses[index];
+
+        if (!bus->inUse)
+        {
+            continue;
+        }
+
+        if ((levels ^ bus->last) & (bus->sda | bus->scl))
+        {
+            simPinBusEdge(bus, (levels & bus->sda) != 0, (levels & bus->scl) != 0);
+            bus->last = levels;
+        }
+
+        low |= bus->driveLow ? bus->sda : 0;
+    }
+
+    gSimBusLow = low;
+
+    return low != before;
+}
+
+
+/**
+ * @brief           Internal function, moves a pin bus slave on by one change
+ *                  of SDA and / or SCL.
+ * @details         A change of SDA while SCL is high is a START or STOP. Data
+ *                  is sampled as SCL rises and the slave changes SDA as SCL
+ *                  falls.
+ * @param bus       The slave.
+ * @param sda       The new SDA level.
+ * @param scl       The new SCL level. */
+static void simPinBusEdge(tSimPinBus * bus, int sda, int scl)
+{
+    int lastSda = (bus->last & bus->sda) != 0;
+    int lastScl = (bus->last & bus->scl) != 0;
+    tSimI2cDevice * device = &bus->device;
+
+    if (scl && lastScl && sda != lastSda)
+    {
+        if (!sda)
+        {
+            bus->state = simPinBusAddress;
+            bus->bits = 0;
+            bus->byte = 0;
+        }
+
+        else
+        {
+            if (bus->state != simPinBusIdle && device->stop != NULL)
+            {
+                device->stop(device->context);
+            }
+            bus->state = simPinBusIdle;
+        }
+        bus->driveLow = 0;
+    }
+
+    else if (scl && !lastScl)
+    {
+        if (bus->state == simPinBusAddress || bus->state == simPinBusReceive)
+        {
+            bus->byte = (uint8_t)((bus->byte << 1) | sda);
+            bus->bits++;
+        }
+
+        else if (bus->state == simPinBusMasterAck)
+        {
+            bus->masterAck = !sda;
+        }
+    }
+
+    else if (!scl && lastScl)
+    {
+        switch (bus->state)
+        {
+            case simPinBusAddress:
+                if (bus->bits == 8)
+                {
+                    bus->read = bus->byte & 0x1;
+                    bus->driveLow = (bus->byte >> 1) == bus->address &&
+                                    (device->start == NULL ||
+                                     device->start(device->context, bus->read));
+                    bus->state = bus->driveLow ? simPinBusAck : simPinBusIdle;
+                }
+                break;
+
+            case simPinBusReceive:
+                if (bus->bits == 8)
+                {
+                    bus->driveLow = device->write == NULL ||
+                                    device->write(device->context, bus->byte);
+                    bus->state = simPinBusAck;
+                }
+                break;
+
+            /* A NACKed byte ends the slave's part until the next START */
+            case simPinBusAck:
+                if (!bus->driveLow)
+                {
+                    bus->state = simPinBusIdle;
+                }
+
+                else if (bus->read)
+                {
+                    bus->byte = device->read != NULL ? device->read(device->context) : 0xFF;
+                    bus->driveLow = !(bus->byte & 0x80);
+                    bus->bits = 1;
+                    bus->state = simPinBusTransmit;
+                }
+
+                else
+                {
+                    bus->driveLow = 0;
+                    bus->bits = 0;
+                    bus->byte = 0;
+                    bus->state = simPinBusReceive;
+                }
+                break;
+
+            case simPinBusTransmit:
+                if (bus->bits < 8)
+                {
+                    bus->driveLow = !((bus->byte >> (7 - bus->bits)) & 0x1);
+                    bus->bits++;
+                }
+
+                else
+                {
+                    bus->driveLow = 0;
+                    bus->state = simPinBusMasterAck;
+                }
+                break;
+
+            case simPinBusMasterAck:
+                if (bus->masterAck)
+                {
+                    bus->byte = device->read != NULL ? device->read(device->context) : 0xFF;
+                    bus->driveLow = !(bus->byte & 0x80);
+                    bus->bits = 1;
+                    bus->state = simPinBusTransmit;
+                }
+
+                else
+                {
+                    bus->driveLow = 0;
+                    bus->state = simPinBusIdle;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+
+/**
+ * @brief           Internal function, starts and ends 1-Wire slots as the
+ *                  master pulls pins low and releases them. Called with the
+ *                  lock held.
+ * @param masterLow 1-Wire pins the master is holding low. */
+static void simOneWireUpdate(uint32_t masterLow)
+{
+    uint32_t changed = masterLow ^ gSimOneWireMasterLow;
+    uint64_t now = 0;
+    uint64_t low_ns = 0;
+    unsigned int index = 0;
+    int pin = 0;
+
+    if (!changed)
+    {
+        return;
+    }
+
+    now = timeNowNs();
+
+    for (index = 0; index < SIM_ONE_WIRE_DEVICES; index++)
+    {
+        tSimOneWireDevice * device = &gSimOneWire[index];
+
+        if (!device->inUse || !(changed & device->pin))
+        {
+            continue;
+        }
+
+        pin = __builtin_ctz(device->pin);
+        low_ns = now - gSimOneWireFall_ns[pin];
+
+        if (masterLow & device->pin)
+        {
+            simOneWireSlot(device, 1, 0, now);
+        }
+
+        else if (low_ns > SIM_ONE_WIRE_RESET_NS)
+        {
+            device->state = simOneWireRom;
+            device->bits = 0;
+            device->shift = 0;
+            device->holdUntil_ns = now + SIM_ONE_WIRE_PRESENCE_NS;
+        }
+
+        else
+        {
+            simOneWireSlot(device, 0, low_ns < SIM_ONE_WIRE_BIT_NS, now);
+        }
+    }
+
+    for (pin = 0; pin < 32; pin++)
+    {
+        if (changed & masterLow & (0x1u << pin))
+        {
+            gSimOneWireFall_ns[pin] = now;
+        }
+    }
+
+    gSimOneWireMasterLow = masterLow;
+}
+
+
+/**
+ * @brief           Internal function, moves a 1-Wire device on at the start
+ *                  or end of a slot.
+ * @details         At the start a device with a 0 to send holds the line
+ *                  low. At the end the bit the master wrote is taken, which
+ *                  is a 1 for a read slot.
+ * @param device    The device.
+ * @param start     Non zero at the start of the slot.
+ * @param bit       The bit written, at the end of the slot.
+ * @param now       The time. */
+static void simOneWireSlot(tSimOneWireDevice * device, int start, int bit, uint64_t now)
+{
+    int send = 1;
+
+    if (start)
+    {
+        if (device->state == simOneWireSearch && device->phase < 2)
+        {
+            send = (int)((device->rom >> device->bits) & 0x1) ^ device->phase;
+        }
+
+        else if (device->state == simOneWireSend && device->bits < SIM_ONE_WIRE_SCRATCHPAD * 8)
+        {
+            send = (device->send[device->bits / 8] >> (device->bits % 8)) & 0x1;
+        }
+
+        if (!send)
+        {
+            device->holdUntil_ns = now + SIM_ONE_WIRE_BIT_NS;
+        }
+
+        return;
+    }
+
+    switch (device->state)
+    {
+        case simOneWireRom:
+        case simOneWireFunction:
+            device->shift |= (uint64_t)bit << device->bits++;
+
+            if (device->bits < 8)
+            {
+                break;
+            }
+
+            device->bits = 0;
+            device->phase = 0;
+
+            if (device->state == simOneWireRom)
+            {
+                device->state = device->shift == 0xF0 ? simOneWireSearch :
+                                device->shift == 0x55 ? simOneWireMatch :
+                                device->shift == 0xCC ? simOneWireFunction : simOneWireIdle;
+            }
+
+            /* Read scratchpad. Convert T completes at once so reads as done */
+            else if (device->shift == 0xBE)
+            {
+                device->send[0] = (uint8_t)(device->temperature & 0xFF);
+                device->send[1] = (uint8_t)((uint16_t)device->temperature >> 8);
+                device->send[2] = 0x4B;
+                device->send[3] = 0x46;
+                device->send[4] = 0x7F;
+                device->send[5] = 0xFF;
+                device->send[6] = 0x0C;
+                device->send[7] = 0x10;
+                device->send[8] = simCrc8(device->send, 8);
+                device->state = simOneWireSend;
+            }
+
+            else
+            {
+                device->state = simOneWireIdle;
+            }
+
+            device->shift = 0;
+            break;
+
+        case simOneWireSearch:
+            if (device->phase < 2)
+            {
+                device->phase++;
+            }
+
+            else if (bit != (int)((device->rom >> device->bits) & 0x1))
+            {
+                device->state = simOneWireIdle;
+            }
+
+            else if (++device->bits == 64)
+            {
+                device->state = simOneWireFunction;
+                device->bits = 0;
+            }
+
+            else
+            {
+                device->phase = 0;
+            }
+            break;
+
+        case simOneWireMatch:
+            device->shift |= (uint64_t)bit << device->bits++;
+
+            if (device->bits == 64)
+            {
+                device->state = device->shift == device->rom ? simOneWireFunction :
+                                                               simOneWireIdle;
+                device->bits = 0;
+                device->shift = 0;
+            }
+            break;
+
+        case simOneWireSend:
+            device->bits++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief   Internal function, the pins 1-Wire devices are holding low.
+ * @return  The pins. */
+static uint32_t simOneWireLow(void)
+{
+    uint32_t low = 0;
+    uint64_t now = timeNowNs();
+    unsigned int index = 0;
+
+    for (index = 0; index < SIM_ONE_WIRE_DEVICES; index++)
+    {
+        if (gSimOneWire[index].inUse && gSimOneWire[index].holdUntil_ns > now)
+        {
+            low |= gSimOneWire[index].pin;
+        }
+    }
+
+    return low;
+}
+
+
+/**
+ * @brief           Internal function, the Dallas / Maxim CRC-8 of \p data.
+ * @param data      The bytes.
+ * @param length    Number of bytes.
+ * @return          The CRC. */
+static uint8_t simCrc8(const uint8_t * data, int length)
+{
+    uint8_t crc = 0;
+    int index = 0;
+    int bit = 0;
+
+    for (index = 0; index < length; index++)
+    {
+        crc ^= data[index];
+
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = crc & 0x1 ? (crc >> 1) ^ 0x8C : crc >> 1;
+        }
+    }
+
+    return crc;
+}
+
+
+/**
+ * @brief           Internal function, attaches a chain of either type.
+ * @param input     74HC165s, otherwise 74HC595s.
+ * @param gpioNumberClock  The clock pin.
+ * @param gpioNumberStrobe The latch or load pin.
+ * @param gpioNumberData   The data pin.
+ * @param registers Registers in the chain.
+ * @return          An error from #errStatus. */
+static errStatus simShiftAttach(int input, int gpioNumberClock, int gpioNumberStrobe,
+                                int gpioNumberData, int registers)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    unsigned int index = 0;
+
+    if (gpioNumberClock < 0 || gpioNumberClock > 31 ||
+        gpioNumberStrobe < 0 || gpioNumberStrobe > 31 ||
+        gpioNumberData < 0 || gpioNumberData > 31)
+    {
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (registers < 1 || registers > SIM_SHIFT_REGISTERS)
+    {
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        rtn = ERROR_RANGE;
+
+        pthread_mutex_lock(&gSimLock);
+        if (simShiftFind(gpioNumberData, -1) == NULL)
+        {
+            for (index = 0; index < SIM_SHIFT_CHAINS; index++)
+            {
+                if (!gSimShift[index].inUse)
+                {
+                    memset(&gSimShift[index], 0, sizeof(tSimShiftChain));
+                    gSimShift[index].input = input;
+                    gSimShift[index].clock = 0x1u << gpioNumberClock;
+                    gSimShift[index].strobe = 0x1u << gpioNumberStrobe;
+                    gSimShift[index].data = 0x1u << gpioNumberData;
+                    gSimShift[index].registers = registers;
+                    gSimShift[index].inUse = 1;
+                    gSimShiftPins |= input ? gSimShift[index].data : 0;
+                    rtn = OK;
+                    break;
+                }
+            }
+        }
+        pthread_mutex_unlock(&gSimLock);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function, finds the chain on a data pin. Called
+ *                  with gSimLock held.
+ * @param gpioNumberData The data pin.
+ * @param input     1 for a 74HC165 chain, 0 for a 74HC595 chain, -1 for
+ *                  either.
+ * @return          The chain or NULL. */
+static tSimShiftChain * simShiftFind(int gpioNumberData, int input)
+{
+    tSimShiftChain * chain = NULL;
+    unsigned int index = 0;
+
+    for (index = 0; index < SIM_SHIFT_CHAINS && gpioNumberData >= 0 &&
+                    gpioNumberData < 32; index++)
+    {
+        if (gSimShift[index].inUse && gSimShift[index].data == 0x1u << gpioNumberData &&
+            (input < 0 || gSimShift[index].input == input))
+        {
+            chain = &gSimShift[index];
+            break;
+        }
+    }
+
+    return chain;
+}
+
+
+/**
+ * @brief           Internal function, clocks, latches and loads the shift
+ *                  register chains.
+ * @details         Stage n of a 74HC595 chain is bit n % 8 of register
+ *                  n / 8. Stage n of a 74HC165 chain is the n-th bit to
+ *                  appear on QH, bit 7 - n % 8 of register n / 8.
+ * @param levels    Bank 0 levels.
+ * @return          Non zero if a QH level changed. */
+static int simShiftUpdate(uint32_t levels)
+{
+    uint32_t rising = levels & ~gSimShiftLast;
+    uint32_t qh = 0;
+    tSimShiftChain * chain = NULL;
+    unsigned int index = 0;
+    int stages = 0;
+    int stage = 0;
+
+    for (index = 0; index < SIM_SHIFT_CHAINS; index++)
+    {
+        chain = &gSimShift[index];
+
+        if (!chain->inUse)
+        {
+            continue;
+        }
+
+        stages = chain->registers * 8;
+
+        if (chain->input && !(levels & chain->strobe))
+        {
+            for (stage = 0; stage < stages; stage++)
+            {
+                chain->stage[stage] = (chain->parallel[stage / 8] >> (7 - stage % 8)) & 0x1;
+            }
+        }
+
+        else if (chain->input && (rising & chain->clock))
+        {
+            memmove(chain->stage, chain->stage + 1, stages - 1);
+            chain->stage[stages - 1] = 0;
+        }
+
+        else if (rising & chain->clock)
+        {
+            memmove(chain->stage + 1, chain->stage, stages - 1);
+            chain->stage[0] = levels & chain->data ? 1 : 0;
+        }
+
+        if (!chain->input && (rising & chain->strobe))
+        {
+            memset(chain->parallel, 0, chain->registers);
+
+            for (stage = 0; stage < stages; stage++)
+            {
+                chain->parallel[stage / 8] |= chain->stage[stage] << (stage % 8);
+            }
+        }
+
+        if (chain->input && chain->stage[0])
+        {
+            qh |= chain->data;
+        }
+    }
+
+    gSimShiftLast = levels;
+
+    if (qh != gSimShiftLevels)
+    {
+        gSimShiftLevels = qh;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief           Internal function, the pins closed switches pull low.
+ * @param drivenLow Outputs latched low.
+ * @return          The pins. */
+static uint32_t simSwitchLow(uint32_t drivenLow)
+{
+    uint32_t low = 0;
+    unsigned int index = 0;
+
+    for (index = 0; index < gSimSwitchCount; index++)
+    {
+        low |= gSimSwitchA[index] & drivenLow ? gSimSwitchB[index] : 0;
+        low |= gSimSwitchB[index] & drivenLow ? gSimSwitchA[index] : 0;
+    }
+
+    return low;
+}
@@ -0,0 +1,407 @@
+/**
+ * @file
+ *  @brief Contains source for the simulated DMA engine.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Only built into librpigpiosim.a, in place of mbox.c. DMA memory is heap
+ *  memory given bus addresses from #SIM_DMA_BUS_BASE. Setting ACTIVE in a
+ *  channel's CS starts a thread which walks the control blocks as the DMA
+ *  engine would, reading and writing peripherals through simRegRead() and
+ *  simRegWrite(). Blocks waiting on the PWM or PCM DREQ are paced at the
+ *  tick the simulated PWM / PCM and clock manager registers are set to, and
+ *  the system timer counter reads as the monotonic clock.
+ */
+
+#include "sim.h"
+#include "dma.h"
+
+/* Local / internal prototypes */
+static void * simDmaRun(void * context);
+static uint32_t simDmaTickNs(uint32_t ti);
+static uint32_t * simBusMemory(uint32_t bus);
+static uint32_t simBusRead(uint32_t bus);
+static void simBusWrite(uint32_t bus, uint32_t value);
+
+/** @brief A simulated DMA channel. */
+typedef struct {
+    pthread_t  thread;  /**< Walks the control blocks */
+    int        started; /**< thread needs joining */
+    int        abort;   /**< Set to stop thread */
+    uint32_t * regs;    /**< The channel's registers */
+} tSimDmaChannel;
+
+/**** Globals ****/
+/** @brief Guards the allocation table. */
+static pthread_mutex_t gSimDmaLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Memory handed out by dmaMemAlloc(). */
+static tDmaMemory gSimDmaAllocs[SIM_DMA_ALLOCS];
+
+/** @brief Bus address given to the next allocation. */
+static uint32_t gSimDmaNextBus = SIM_DMA_BUS_BASE;
+
+/** @brief The channels. */
+static tSimDmaChannel gSimDmaChannels[DMA_CHANNEL_MAX + 1];
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which hands out heap memory in place
+ *                      of the mailbox allocation.
+ * @param size          Bytes required. Rounded up to whole pages.
+ * @param[out] memory   Populated with the allocation.
+ * @return              An error from #errStatus. */
+errStatus dmaMemAlloc(size_t size, tDmaMemory * memory)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    unsigned int index = 0;
+    void * virt = NULL;
+
+    if (memory == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter memory was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (size == 0)
+    {
+        dbgPrint(DBG_INFO, "Parameter size was 0.");
+        rtn = ERROR_RANGE;
+    }
+
+    else if (posix_memalign(&virt, pageSize, (size + pageSize - 1) & ~(pageSize - 1)) != 0)
+    {
+        dbgPrint(DBG_INFO, "posix_memalign() failed for %u bytes.", (uint32_t)size);
+        rtn = ERROR_EXTERNAL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimDmaLock);
+        while (index < SIM_DMA_ALLOCS && gSimDmaAllocs[index].virt != NULL)
+        {
+            index++;
+        }
+
+        if (index < SIM_DMA_ALLOCS)
+        {
+            memory->handle = index + 1;
+            memory->bus = gSimDmaNextBus;
+            memory->virt = virt;
+            memory->size = (size + pageSize - 1) & ~(pageSize - 1);
+            memset(memory->virt, 0, memory->size);
+
+            gSimDmaNextBus += memory->size;
+            gSimDmaAllocs[index] = *memory;
+            rtn = OK;
+        }
+        pthread_mutex_unlock(&gSimDmaLock);
+
+        if (rtn != OK)
+        {
+            dbgPrint(DBG_INFO, "All %d simulated DMA allocations are in use.",
+                     SIM_DMA_ALLOCS);
+            free(virt);
+            rtn = ERROR_RANGE;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which releases memory from
+ *                      dmaMemAlloc().
+ * @param[in] memory    The allocation.
+ * @return              An error from #errStatus. */
+errStatus dmaMemFree(tDmaMemory * memory)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (memory == NULL || memory->handle == 0 || memory->handle > SIM_DMA_ALLOCS)
+    {
+        dbgPrint(DBG_INFO, "Parameter memory was NULL or not allocated.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSimDmaLock);
+        memset(&gSimDmaAllocs[memory->handle - 1], 0, sizeof(tDmaMemory));
+        pthread_mutex_unlock(&gSimDmaLock);
+
+        free(memory->virt);
+        memset(memory, 0, sizeof(*memory));
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function applying a write to the simulated DMA
+ *                  block. Called by simRegWrite() without its lock held.
+ * @param regs      The block's registers.
+ * @param index     Word index of the register written.
+ * @param value     The value written. */
+void simDmaWrite(uint32_t * regs, uint32_t index, uint32_t value)
+{
+    uint32_t channel = index * sizeof(uint32_t) / DMA_CHANNEL_SIZE;
+    uint32_t offset = index * sizeof(uint32_t) % DMA_CHANNEL_SIZE;
+    tSimDmaChannel * state = NULL;
+
+    if (channel > DMA_CHANNEL_MAX || offset != DMA_CS_OFFSET)
+    {
+        __atomic_store_n(&regs[index], value, __ATOMIC_SEQ_CST);
+    }
+
+    else
+    {
+        state = &gSimDmaChannels[channel];
+        state->regs = regs + channel * DMA_CHANNEL_SIZE / sizeof(uint32_t);
+
+        if (value & (DMA_CS_ABORT | DMA_CS_RESET | DMA_CS_ACTIVE))
+        {
+            if (state->started)
+            {
+                __atomic_store_n(&state->abort, 1, __ATOMIC_SEQ_CST);
+                pthread_join(state->thread, NULL);
+                state->started = 0;
+            }
+
+            __atomic_store_n(&regs[index], 0, __ATOMIC_SEQ_CST);
+        }
+
+        else
+        {
+            /* END and INT are write 1 to clear */
+            __atomic_and_fetch(&regs[index], ~(value & (DMA_CS_END | DMA_CS_INT)),
+                               __ATOMIC_SEQ_CST);
+        }
+
+        if (value & DMA_CS_ACTIVE)
+        {
+            state->abort = 0;
+            __atomic_store_n(&regs[index], DMA_CS_ACTIVE, __ATOMIC_SEQ_CST);
+
+            if (pthread_create(&state->thread, NULL, simDmaRun, state) == 0)
+            {
+                state->started = 1;
+            }
+
+            else
+            {
+                dbgPrint(DBG_INFO, "pthread_create() failed for DMA channel %u.", channel);
+                __atomic_store_n(&regs[index], DMA_CS_ERROR, __ATOMIC_SEQ_CST);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief           Internal function which runs a channel until its chain
+ *                  ends or it is aborted.
+ * @param context   The channel's #tSimDmaChannel.
+ * @return          NULL. */
+static void * simDmaRun(void * context)
+{
+    tSimDmaChannel * state = context;
+    uint32_t * regs = state->regs;
+    uint32_t block = __atomic_load_n(&regs[DMA_CONBLK_AD_OFFSET / sizeof(uint32_t)],
+                                     __ATOMIC_SEQ_CST);
+    uint32_t ti = 0;
+    uint32_t source = 0;
+    uint32_t dest = 0;
+    uint32_t words = 0;
+    uint32_t tick_ns = 0;
+    uint64_t deadline = timeNowNs();
+    uint64_t now = 0;
+    struct timespec wake;
+
+    while (block != 0 && !__atomic_load_n(&state->abort, __ATOMIC_SEQ_CST))
+    {
+        ti = simBusRead(block);
+        source = simBusRead(block + 4);
+        dest = simBusRead(block + 8);
+        words = simBusRead(block + 12) / sizeof(uint32_t);
+        tick_ns = (ti & (DMA_TI_DEST_DREQ | DMA_TI_SRC_DREQ)) ? simDmaTickNs(ti) : 0;
+
+        while (words-- && !__atomic_load_n(&state->abort, __ATOMIC_SEQ_CST))
+        {
+            if (tick_ns)
+            {
+                deadline += tick_ns;
+
+                if (deadline > (now = timeNowNs()) + SIM_DMA_AHEAD_NS)
+                {
+                    wake.tv_sec = deadline / TIMING_NSEC_IN_SEC;
+                    wake.tv_nsec = deadline % TIMING_NSEC_IN_SEC;
+                    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+                }
+            }
+
+            simBusWrite(dest, simBusRead(source));
+            source += (ti & DMA_TI_SRC_INC) ? sizeof(uint32_t) : 0;
+            dest += (ti & DMA_TI_DEST_INC) ? sizeof(uint32_t) : 0;
+        }
+
+        block = simBusRead(block + 20);
+        __atomic_store_n(&regs[DMA_CONBLK_AD_OFFSET / sizeof(uint32_t)], block,
+                         __ATOMIC_SEQ_CST);
+    }
+
+    if (!__atomic_load_n(&state->abort, __ATOMIC_SEQ_CST))
+    {
+        __atomic_store_n(&regs[DMA_CS_OFFSET / sizeof(uint32_t)], DMA_CS_END,
+                         __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief       Internal function which computes the tick of the FIFO a
+ *              block waits on, from the simulated PWM / PCM and clock manager
+ *              registers.
+ * @param ti    The block's transfer information.
+ * @return      The tick, 0 if the FIFO is not clocked. */
+static uint32_t simDmaTickNs(uint32_t ti)
+{
+    const tBoard * board = NULL;
+    volatile uint32_t * range = NULL;
+    volatile uint32_t * ctl = NULL;
+    volatile uint32_t * div = NULL;
+    uint32_t clocks = 0;
+    uint32_t sourceHz = 0;
+    uint32_t tick_ns = 0;
+
+    if (((ti >> 16) & 0x1F) == DMA_DREQ_PWM)
+    {
+        range = simPeriphReg(PWM_BASE_OFFSET + PWM_RNG1_OFFSET);
+        ctl = simPeriphReg(CM_BASE_OFFSET + CM_PWMCTL_OFFSET);
+        div = simPeriphReg(CM_BASE_OFFSET + CM_PWMDIV_OFFSET);
+        clocks = range != NULL ? simRegRead(range) : 0;
+    }
+
+    else if (((ti >> 16) & 0x1F) == DMA_DREQ_PCM_TX)
+    {
+        range = simPeriphReg(PCM_BASE_OFFSET + PCM_MODE_OFFSET);
+        ctl = simPeriphReg(CM_BASE_OFFSET + CM_PCMCTL_OFFSET);
+        div = simPeriphReg(CM_BASE_OFFSET + CM_PCMDIV_OFFSET);
+        clocks = range != NULL ? ((simRegRead(range) >> 10) & 0x3FF) + 1 : 0;
+    }
+
+    if (ctl != NULL && div != NULL && gpioGetBoard(&board) == OK &&
+        (simRegRead(ctl) & CM_ENAB))
+    {
+        sourceHz = (simRegRead(ctl) & 0xF) == CM_SRC_PLLD ? board->plldHz :
+                                                            board->oscillatorHz;
+        tick_ns = (uint32_t)((uint64_t)clocks * ((simRegRead(div) >> CM_DIVI_SHIFT) &
+                                                 CM_DIVI_MAX) *
+                             TIMING_NSEC_IN_SEC / sourceHz);
+    }
+
+    return tick_ns;
+}
+
+
+/**
+ * @brief       Internal function which finds the heap memory at a bus address.
+ * @param bus   The bus address.
+ * @return      The word or NULL if \p bus is not allocated. */
+static uint32_t * simBusMemory(uint32_t bus)
+{
+    uint32_t * word = NULL;
+    unsigned int index = 0;
+
+    pthread_mutex_lock(&gSimDmaLock);
+    for (index = 0; index < SIM_DMA_ALLOCS && word == NULL; index++)
+    {
+        if (gSimDmaAllocs[index].virt != NULL && bus >= gSimDmaAllocs[index].bus &&
+            bus < gSimDmaAllocs[index].bus + gSimDmaAllocs[index].size)
+        {
+            word = (uint32_t *)gSimDmaAllocs[index].virt +
+                   (bus - gSimDmaAllocs[index].bus) / sizeof(uint32_t);
+        }
+    }
+    pthread_mutex_unlock(&gSimDmaLock);
+
+    return word;
+}
+
+
+/**
+ * @brief       Internal function which reads a word as the DMA engine does.
+ * @param bus   The bus address.
+ * @return      The word, 0 if nothing is at \p bus. */
+static uint32_t simBusRead(uint32_t bus)
+{
+    volatile uint32_t * reg = NULL;
+    uint32_t * word = NULL;
+    uint32_t value = 0;
+
+    if (bus == DMA_PERI_BUS(ST_BASE_OFFSET + ST_CLO_OFFSET))
+    {
+        value = (uint32_t)(timeNowNs() / 1000);
+    }
+
+    else if ((bus & 0xFF000000) == PERI_BUS_BASE)
+    {
+        if ((reg = simPeriphReg(bus - PERI_BUS_BASE)) != NULL)
+        {
+            value = simRegRead(reg);
+        }
+    }
+
+    else if ((word = simBusMemory(bus)) != NULL)
+    {
+        value = __atomic_load_n(word, __ATOMIC_SEQ_CST);
+    }
+
+    return value;
+}
+
+
+/**
+ * @brief       Internal function which writes a word as the DMA engine does.
+ * @param bus   The bus address.
+ * @param value The word. */
+static void simBusWrite(uint32_t bus, uint32_t value)
+{
+    volatile uint32_t * reg = NULL;
+    uint32_t * word = NULL;
+
+    if ((bus & 0xFF000000) == PERI_BUS_BASE)
+    {
+        if ((reg = simPeriphReg(bus - PERI_BUS_BASE)) != NULL)
+        {
+            simRegWrite(reg, value);
+        }
+    }
+
+    else if ((word = simBusMemory(bus)) != NULL)
+    {
+        __atomic_store_n(word, value, __ATOMIC_SEQ_CST);
+    }
+}
@@ -0,0 +1,585 @@
+/**
+ * @file
+ *  @brief Contains source for the bit banged multi bus I2C master.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  Each bus is an open drain SDA and SCL on any two GPIOs. A line is
+ *  released by making its pin an input, so the pull up takes it high, and
+ *  pulled low by making it an output with its latch cleared. A slave holding
+ *  SCL low after it is released stretches the clock.
+ *
+ *  One call to gpioSoftI2cTransfer() clocks a transaction on each of several
+ *  buses in lockstep. Every bit period is four quarters. In each quarter the
+ *  lines every bus wants low are collected into one mask and applied with a
+ *  single read-modify-write per GPFSEL register that changes. SCL is checked
+ *  for stretching and SDA is sampled with one GPLEV0 load for all the buses.
+ *  So N buses cost about as much as one, as long as their pins share GPFSEL
+ *  registers.
+ */
+
+#include "softi2c.h"
+
+/* Local / internal prototypes */
+static void softI2cApply(uint32_t low);
+static int softI2cStretch(tSoftI2cLane * lanes, int count, uint32_t low);
+static void softI2cLaneOp(tSoftI2cLane * lane);
+static void softI2cLaneAdvance(tSoftI2cLane * lane);
+static void softI2cLaneFinish(tSoftI2cLane * lane, errStatus status);
+
+/**** Globals ****/
+/** @brief SDA level of each operation in each quarter, 1 released. */
+static const uint8_t gSoftI2cSdaQuarters[softI2cOpMax][SOFT_I2C_QUARTERS] = {
+    {1, 1, 0, 0},   /* Start: SDA falls while SCL is high */
+    {0, 0, 1, 1},   /* Stop: SDA rises while SCL is high */
+    {0, 0, 0, 0},   /* Bit0 */
+    {1, 1, 1, 1},   /* Bit1 */
+    {1, 1, 1, 1}    /* Idle */
+};
+
+/** @brief SCL level of each operation in each quarter, 1 released. */
+static const uint8_t gSoftI2cSclQuarters[softI2cOpMax][SOFT_I2C_QUARTERS] = {
+    {0, 1, 1, 0},   /* Start */
+    {0, 1, 1, 1},   /* Stop */
+    {0, 1, 1, 0},   /* Bit0 */
+    {0, 1, 1, 0},   /* Bit1 */
+    {1, 1, 1, 1}    /* Idle */
+};
+
+/** @brief Serialises transfers and protects gSoftI2cBuses. */
+static pthread_mutex_t gSoftI2cLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The open buses. */
+static tSoftI2cBus gSoftI2cBuses[SOFT_I2C_BUSES];
+
+/** @brief Lines currently pulled low. */
+static uint32_t gSoftI2cLow = 0;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gSoftI2cMap = NULL;
+
+/**
+ * @brief               Opens a software I2C bus on two GPIOs.
+ * @details             Both pins are made inputs with their pull ups enabled
+ *                      and their output latches cleared, so the bus idles
+ *                      high. External pull ups are still recommended, the
+ *                      internal ones are weak and limit the clock rate.
+ * @param gpioNumberSda The SDA pin.
+ * @param gpioNumberScl The SCL pin.
+ * @param frequency     The clock in Hz, #SOFT_I2C_FREQ_MIN to
+ *                      #SOFT_I2C_FREQ_MAX.
+ * @param[out] bus      The bus, for gpioSoftI2cTransfer().
+ * @return              An error from #errStatus. */
+errStatus gpioSoftI2cOpen(int gpioNumberSda, int gpioNumberScl, int frequency, int * bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t pins = 0;
+    uint32_t used = 0;
+    int index = 0;
+    int empty = -1;
+
+    pthread_mutex_lock(&gSoftI2cLock);
+
+    for (index = 0; index < SOFT_I2C_BUSES; index++)
+    {
+        if (gSoftI2cBuses[index].inUse)
+        {
+            used |= gSoftI2cBuses[index].sda | gSoftI2cBuses[index].scl;
+        }
+
+        else if (empty < 0)
+        {
+            empty = index;
+        }
+    }
+
+    if (bus == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter bus was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (frequency < SOFT_I2C_FREQ_MIN || frequency > SOFT_I2C_FREQ_MAX)
+    {
+        dbgPrint(DBG_INFO, "frequency %d is out of range.", frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (gpioNumberSda == gpioNumberScl || gpioNumberSda < 0 || gpioNumberSda > 31 ||
+             gpioNumberScl < 0 || gpioNumberScl > 31)
+    {
+        dbgPrint(DBG_INFO, "Pins %d and %d can not be a bus.", gpioNumberSda, gpioNumberScl);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (used & ((0x1u << gpioNumberSda) | (0x1u << gpioNumberScl)))
+    {
+        dbgPrint(DBG_INFO, "Pin %d or %d is already on a bus.", gpioNumberSda, gpioNumberScl);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (empty < 0)
+    {
+        dbgPrint(DBG_INFO, "All %d buses are open.", SOFT_I2C_BUSES);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioSetFunction(gpioNumberSda, input)) != OK ||
+             (rtn = gpioSetFunction(gpioNumberScl, input)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioGetRegisters(&gSoftI2cMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioSetPullResistor(gpioNumberSda, pullup)) != OK ||
+             (rtn = gpioSetPullResistor(gpioNumberScl, pullup)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioSetPullResistor() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        pins = (0x1u << gpioNumberSda) | (0x1u << gpioNumberScl);
+
+        /* Outputs latched low, so pulling a line low is only a GPFSEL write */
+        if ((rtn = gpioClearMask(pins)) == OK)
+        {
+            gSoftI2cBuses[empty].sda = 0x1u << gpioNumberSda;
+            gSoftI2cBuses[empty].scl = 0x1u << gpioNumberScl;
+            gSoftI2cBuses[empty].frequency = frequency;
+            gSoftI2cBuses[empty].inUse = 1;
+            gSoftI2cLow &= ~pins;
+            *bus = empty;
+        }
+    }
+
+    pthread_mutex_unlock(&gSoftI2cLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Closes a bus opened by gpioSoftI2cOpen(). Its pins are left as
+ *              inputs.
+ * @param bus   The bus.
+ * @return      An error from #errStatus. */
+errStatus gpioSoftI2cClose(int bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gSoftI2cLock);
+
+    if (bus < 0 || bus >= SOFT_I2C_BUSES || !gSoftI2cBuses[bus].inUse)
+    {
+        dbgPrint(DBG_INFO, "bus %d is not open.", bus);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        gSoftI2cBuses[bus].inUse = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSoftI2cLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Runs one transaction on each of several buses at once.
+ * @details         Each transaction writes \p writeLength bytes, then, if
+ *                  \p readLength is non zero, sends a repeated START and
+ *                  reads \p readLength bytes. A transaction with nothing to
+ *                  write is a plain read. The buses are clocked together at
+ *                  the frequency of the slowest. The call returns when every
+ *                  transaction has finished, each with its own \p status and
+ *                  count of stretched clocks.
+ * @param[in,out] transfers The transactions, each on a different bus.
+ * @param count     Number of transactions, 1 to #SOFT_I2C_BUSES.
+ * @return          OK if every transaction succeeded, otherwise the status of
+ *                  the first that failed. */
+errStatus gpioSoftI2cTransfer(tSoftI2cTransfer * transfers, int count)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSoftI2cLane lanes[SOFT_I2C_BUSES];
+    uint32_t buses = 0;
+    uint32_t low = 0;
+    uint32_t levels = 0;
+    uint64_t quarter_ns = 0;
+    uint64_t next = 0;
+    int frequency = SOFT_I2C_FREQ_MAX;
+    int active = 0;
+    int index = 0;
+    int quarter = 0;
+
+    pthread_mutex_lock(&gSoftI2cLock);
+
+    if (transfers == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter transfers was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (count < 1 || count > SOFT_I2C_BUSES)
+    {
+        dbgPrint(DBG_INFO, "count %d is out of range.", count);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        for (index = 0; index < count; index++)
+        {
+            tSoftI2cTransfer * transfer = &transfers[index];
+
+            if (transfer->bus < 0 || transfer->bus >= SOFT_I2C_BUSES ||
+                !gSoftI2cBuses[transfer->bus].inUse || buses & (0x1u << transfer->bus))
+            {
+                dbgPrint(DBG_INFO, "bus %d is not open or is used twice.", transfer->bus);
+                rtn = ERROR_RANGE;
+                break;
+            }
+
+            else if (transfer->address > 0x7F)
+            {
+                dbgPrint(DBG_INFO, "address 0x%x is not a 7-bit address.", transfer->address);
+                rtn = ERROR_RANGE;
+                break;
+            }
+
+            else if ((transfer->writeLength && transfer->writeData == NULL) ||
+                     (transfer->readLength && transfer->readBuffer == NULL))
+            {
+                dbgPrint(DBG_INFO, "Transfer on bus %d has a NULL buffer.", transfer->bus);
+                rtn = ERROR_NULL;
+                break;
+            }
+
+            buses |= 0x1u << transfer->bus;
+            frequency = gSoftI2cBuses[transfer->bus].frequency < frequency ?
+                        gSoftI2cBuses[transfer->bus].frequency : frequency;
+
+            memset(&lanes[index], 0, sizeof(tSoftI2cLane));
+            lanes[index].transfer = transfer;
+            lanes[index].sda = gSoftI2cBuses[transfer->bus].sda;
+            lanes[index].scl = gSoftI2cBuses[transfer->bus].scl;
+            lanes[index].stage = softI2cStageStart;
+            lanes[index].reading = transfer->writeLength == 0 && transfer->readLength > 0;
+            transfer->status = ERROR_DEFAULT;
+            transfer->stretches = 0;
+        }
+    }
+
+    if (rtn == ERROR_DEFAULT)
+    {
+        quarter_ns = 1000000000ull / ((uint64_t)frequency * SOFT_I2C_QUARTERS);
+        next = timeNowNs();
+        active = count;
+
+        while (active)
+        {
+            for (index = 0; index < count; index++)
+            {
+                softI2cLaneOp(&lanes[index]);
+            }
+
+            for (quarter = 0; quarter < SOFT_I2C_QUARTERS; quarter++)
+            {
+                low = 0;
+
+                for (index = 0; index < count; index++)
+                {
+                    eSoftI2cOp op = lanes[index].op;
+
+                    low |= gSoftI2cSdaQuarters[op][quarter] ? 0 : lanes[index].sda;
+                    low |= gSoftI2cSclQuarters[op][quarter] ? 0 : lanes[index].scl;
+                }
+
+                softI2cApply(low);
+
+                /* The slave may hold SCL low once it is released */
+                if (quarter == 1 && softI2cStretch(lanes, count, low))
+                {
+                    next = timeNowNs();
+                }
+
+                else if (quarter == SOFT_I2C_SAMPLE_QUARTER)
+                {
+                    levels = REG_READ(SOFT_I2C_GPLEV0);
+
+                    for (index = 0; index < count; index++)
+                    {
+                        lanes[index].sample = (levels & lanes[index].sda) != 0;
+                    }
+                }
+
+                next += quarter_ns;
+                timeWaitUntil(next, SOFT_I2C_SPIN_NS);
+            }
+
+            active = 0;
+
+            for (index = 0; index < count; index++)
+            {
+                softI2cLaneAdvance(&lanes[index]);
+                active += lanes[index].stage != softI2cStageDone;
+            }
+        }
+
+        rtn = OK;
+
+        for (index = 0; index < count; index++)
+        {
+            if (transfers[index].status != OK)
+            {
+                rtn = transfers[index].status;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gSoftI2cLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Internal function, pulls low the lines in \p low and releases
+ *              the rest.
+ * @param low   Lines to pull low. */
+static void softI2cApply(uint32_t low)
+{
+    if (low != gSoftI2cLow)
+    {
+        fselWrite(gSoftI2cMap, gSoftI2cLow & ~low, low & ~gSoftI2cLow);
+        gSoftI2cLow = low;
+    }
+}
+
+
+/**
+ * @brief       Internal function, waits for every released SCL to read high.
+ * @details     A lane whose slave holds SCL low past
+ *              #SOFT_I2C_STRETCH_MAX_NS fails with #ERROR_I2C_CLK_TIMEOUT and
+ *              releases its lines. The other lanes carry on.
+ * @param lanes The lanes.
+ * @param count Number of lanes.
+ * @param low   Lines being pulled low.
+ * @return      Non zero if any clock was stretched. */
+static int softI2cStretch(tSoftI2cLane * lanes, int count, uint32_t low)
+{
+    uint32_t held = 0;
+    uint64_t start = 0;
+    int stretched = 0;
+    int index = 0;
+
+    held = ~REG_READ(SOFT_I2C_GPLEV0) & ~low;
+
+    for (index = 0; index < count; index++)
+    {
+        if (lanes[index].op != softI2cOpIdle && held & lanes[index].scl)
+        {
+            lanes[index].transfer->stretches++;
+            stretched = 1;
+        }
+    }
+
+    if (stretched)
+    {
+        start = timeNowNs();
+
+        for (;;)
+        {
+            held = 0;
+
+            for (index = 0; index < count; index++)
+            {
+                held |= lanes[index].op != softI2cOpIdle ? lanes[index].scl : 0;
+            }
+
+            held &= ~REG_READ(SOFT_I2C_GPLEV0) & ~low;
+
+            if (!held)
+            {
+                break;
+            }
+
+            else if (timeNowNs() - start > SOFT_I2C_STRETCH_MAX_NS)
+            {
+                for (index = 0; index < count; index++)
+                {
+                    if (held & lanes[index].scl)
+                    {
+                        softI2cLaneFinish(&lanes[index], ERROR_I2C_CLK_TIMEOUT);
+                        low &= ~(lanes[index].sda | lanes[index].scl);
+                    }
+                }
+
+                softI2cApply(low);
+                break;
+            }
+        }
+    }
+
+    return stretched;
+}
+
+
+/**
+ * @brief       Internal function, chooses the clock a lane drives next.
+ * @param lane  The lane. */
+static void softI2cLaneOp(tSoftI2cLane * lane)
+{
+    const tSoftI2cTransfer * transfer = lane->transfer;
+
+    switch (lane->stage)
+    {
+        case softI2cStageStart:
+            lane->op = softI2cOpStart;
+            break;
+
+        case softI2cStageAddress:
+        case softI2cStageWrite:
+            lane->op = lane->bit == 8 || (lane->byte >> (7 - lane->bit)) & 0x1 ?
+                       softI2cOpBit1 : softI2cOpBit0;
+            break;
+
+        /* The last byte read is NACKed */
+        case softI2cStageRead:
+            lane->op = lane->bit < 8 || lane->index + 1 == transfer->readLength ?
+                       softI2cOpBit1 : softI2cOpBit0;
+            break;
+
+        case softI2cStageStop:
+            lane->op = softI2cOpStop;
+            break;
+
+        default:
+            lane->op = softI2cOpIdle;
+            break;
+    }
+}
+
+
+/**
+ * @brief       Internal function, moves a lane on after a clock.
+ * @param lane  The lane, with the SDA level sampled during the clock. */
+static void softI2cLaneAdvance(tSoftI2cLane * lane)
+{
+    tSoftI2cTransfer * transfer = lane->transfer;
+
+    switch (lane->stage)
+    {
+        case softI2cStageStart:
+            lane->stage = softI2cStageAddress;
+            lane->byte = (uint8_t)((transfer->address << 1) | lane->reading);
+            lane->bit = 0;
+            break;
+
+        case softI2cStageAddress:
+        case softI2cStageWrite:
+            if (lane->bit < 8)
+            {
+                lane->bit++;
+            }
+
+            else if (lane->sample)
+            {
+                transfer->status = ERROR_I2C_NACK;
+                lane->stage = softI2cStageStop;
+            }
+
+            else if (lane->stage == softI2cStageAddress && lane->reading)
+            {
+                lane->stage = softI2cStageRead;
+                lane->index = 0;
+                lane->bit = 0;
+            }
+
+            else
+            {
+                lane->index += lane->stage == softI2cStageWrite;
+                lane->stage = softI2cStageWrite;
+                lane->bit = 0;
+
+                if (lane->index < transfer->writeLength)
+                {
+                    lane->byte = transfer->writeData[lane->index];
+                }
+
+                else if (transfer->readLength)
+                {
+                    lane->stage = softI2cStageStart;
+                    lane->reading = 1;
+                }
+
+                else
+                {
+                    lane->stage = softI2cStageStop;
+                }
+            }
+            break;
+
+        case softI2cStageRead:
+            if (lane->bit < 8)
+            {
+                lane->byte = (uint8_t)((lane->byte << 1) | lane->sample);
+                lane->bit++;
+            }
+
+            else
+            {
+                transfer->readBuffer[lane->index++] = lane->byte;
+                lane->bit = 0;
+
+                if (lane->index == transfer->readLength)
+                {
+                    lane->stage = softI2cStageStop;
+                }
+            }
+            break;
+
+        case softI2cStageStop:
+            softI2cLaneFinish(lane, transfer->status == ERROR_DEFAULT ? OK : transfer->status);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief           Internal function, ends a lane's transaction.
+ * @param lane      The lane.
+ * @param status    The result of the transaction. */
+static void softI2cLaneFinish(tSoftI2cLane * lane, errStatus status)
+{
+    lane->transfer->status = status;
+    lane->stage = softI2cStageDone;
+    lane->op = softI2cOpIdle;
+}
@@ -0,0 +1,501 @@
+/**
+ * @file
+ *  @brief Contains source for the software PWM engine.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Every channel sets at the start of the period and clears high_ns later.
+ *  Channels are merged into one schedule of edges sorted by offset, each a
+ *  GPSET0 mask and a GPCLR0 mask, so a period costs two stores per distinct
+ *  duty rather than per channel. A duty change moves one channel's bit
+ *  between edges, inserting or removing an edge in place, and the PWM thread
+ *  picks up the edited schedule at the start of its next period.
+ */
+
+#include "softpwm.h"
+
+/* Local / internal prototypes */
+static int softPwmEdgeFind(const tSoftPwmSchedule * schedule, uint32_t offset_ns);
+static void softPwmEdgeAdd(tSoftPwmSchedule * schedule, uint32_t offset_ns,
+                           uint32_t setMask, uint32_t clearMask);
+static void softPwmEdgeRemove(tSoftPwmSchedule * schedule, uint32_t offset_ns,
+                              uint32_t setMask, uint32_t clearMask);
+static void softPwmChannelAdd(tSoftPwmSchedule * schedule, uint32_t mask, uint32_t high_ns);
+static void softPwmChannelRemove(tSoftPwmSchedule * schedule, uint32_t mask, uint32_t high_ns);
+static void * softPwmThread(void * unused);
+
+/**** Globals ****/
+/** @brief Protects gSoftPwmPending, gSoftPwmHigh and gSoftPwmPublished. */
+static pthread_mutex_t gSoftPwmLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Schedule edited by gpioSoftPwmSetDuty(). */
+static tSoftPwmSchedule gSoftPwmPending;
+
+/** @brief Non zero when gSoftPwmPending has changes the thread has not seen. */
+static int gSoftPwmDirty = 0;
+
+/** @brief High time of each channel. */
+static uint32_t gSoftPwmHigh[SOFT_PWM_CHANNELS];
+
+/** @brief Bit n set if GPIO n is a channel. */
+static uint32_t gSoftPwmChannels = 0;
+
+/** @brief Period of every channel. */
+static uint32_t gSoftPwmPeriod_ns = 0;
+
+/** @brief Statistics as last published by the thread. */
+static tSoftPwmStats gSoftPwmPublished;
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gSoftPwmMap = NULL;
+
+/** @brief The PWM thread. */
+static pthread_t gSoftPwmThread;
+
+/** @brief Non zero while the PWM thread should run. */
+static volatile int gSoftPwmRunning = 0;
+
+/**
+ * @brief           Starts the PWM thread.
+ * @details         gpioSetup() must have been called. The thread is given
+ *                  SCHED_FIFO priority if permitted, and run only on \p cpu
+ *                  if \p cpu is not negative. Isolating that cpu from the
+ *                  scheduler (isolcpus=) gives the lowest jitter. Channels
+ *                  are added with gpioSoftPwmSetDuty().
+ * @param period_ns The period of every channel, #SOFT_PWM_PERIOD_MIN_NS to
+ *                  #SOFT_PWM_PERIOD_MAX_NS.
+ * @param cpu       The cpu to run on, or -1 for any.
+ * @return          An error from #errStatus. */
+errStatus gpioSoftPwmStart(uint32_t period_ns, int cpu)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gSoftPwmRunning)
+    {
+        dbgPrint(DBG_INFO, "Software PWM is already running.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if (period_ns < SOFT_PWM_PERIOD_MIN_NS || period_ns > SOFT_PWM_PERIOD_MAX_NS)
+    {
+        dbgPrint(DBG_INFO, "period_ns %u is out of range.", period_ns);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (cpu >= CPU_SETSIZE)
+    {
+        dbgPrint(DBG_INFO, "cpu %d is out of range.", cpu);
+        rtn = ERROR_RANGE;
+    }
+
+    else if ((rtn = gpioGetRegisters(&gSoftPwmMap)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        memset(&gSoftPwmPending, 0, sizeof(gSoftPwmPending));
+        memset(gSoftPwmHigh, 0, sizeof(gSoftPwmHigh));
+        memset(&gSoftPwmPublished, 0, sizeof(gSoftPwmPublished));
+        gSoftPwmChannels = 0;
+        gSoftPwmDirty = 1;
+        gSoftPwmPeriod_ns = period_ns;
+        gSoftPwmRunning = 1;
+
+        if ((errno = pthread_create(&gSoftPwmThread, NULL, softPwmThread, NULL)) != 0)
+        {
+            dbgPrint(DBG_INFO, "pthread_create() failed. errno: %s.", strerror(errno));
+            gSoftPwmRunning = 0;
+            rtn = ERROR_EXTERNAL;
+        }
+
+        else
+        {
+            timeThreadRealtime(gSoftPwmThread, cpu, "PWM");
+
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Sets the high time of a channel.
+ * @details             The first call for a pin makes it an output and adds
+ *                      it as a channel. The change applies from the start of
+ *                      the next period.
+ * @param gpioNumber    The pin, which must be on the header.
+ * @param high_ns       Time high each period, 0 to the period. 0 holds the
+ *                      pin low, the period holds it high.
+ * @return              An error from #errStatus. */
+errStatus gpioSoftPwmSetDuty(int gpioNumber, uint32_t high_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t mask = 0;
+
+    if (!gSoftPwmRunning)
+    {
+        dbgPrint(DBG_INFO, "Ensure gpioSoftPwmStart() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (gpioNumber < 0 || gpioNumber >= SOFT_PWM_CHANNELS)
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %d can not be a PWM channel.", gpioNumber);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else if (high_ns > gSoftPwmPeriod_ns)
+    {
+        dbgPrint(DBG_INFO, "high_ns %u is longer than the period.", high_ns);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        mask = 0x1u << gpioNumber;
+
+        if (!(gSoftPwmChannels & mask) &&
+            (rtn = gpioSetFunction(gpioNumber, output)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioSetFunction() failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            pthread_mutex_lock(&gSoftPwmLock);
+            if (gSoftPwmChannels & mask)
+            {
+                softPwmChannelRemove(&gSoftPwmPending, mask, gSoftPwmHigh[gpioNumber]);
+            }
+            softPwmChannelAdd(&gSoftPwmPending, mask, high_ns);
+            gSoftPwmHigh[gpioNumber] = high_ns;
+            gSoftPwmChannels |= mask;
+            gSoftPwmDirty = 1;
+            pthread_mutex_unlock(&gSoftPwmLock);
+
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Removes a channel, leaving the pin low.
+ * @param gpioNumber    The pin.
+ * @return              An error from #errStatus. */
+errStatus gpioSoftPwmRelease(int gpioNumber)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    uint32_t mask = 0;
+
+    if (gpioNumber < 0 || gpioNumber >= SOFT_PWM_CHANNELS ||
+        !(gSoftPwmChannels & (0x1u << gpioNumber)))
+    {
+        dbgPrint(DBG_INFO, "gpioNumber %d is not a PWM channel.", gpioNumber);
+        rtn = ERROR_INVALID_PIN_NUMBER;
+    }
+
+    else
+    {
+        mask = 0x1u << gpioNumber;
+
+        pthread_mutex_lock(&gSoftPwmLock);
+        softPwmChannelRemove(&gSoftPwmPending, mask, gSoftPwmHigh[gpioNumber]);
+        gSoftPwmChannels &= ~mask;
+        gSoftPwmDirty = 1;
+        pthread_mutex_unlock(&gSoftPwmLock);
+
+        REG_WRITE(SOFT_PWM_GPCLR0, mask);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the PWM thread and drives every channel low.
+ * @return  An error from #errStatus. */
+errStatus gpioSoftPwmStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (!gSoftPwmRunning)
+    {
+        dbgPrint(DBG_INFO, "Software PWM is not running.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gSoftPwmRunning = 0;
+        pthread_join(gSoftPwmThread, NULL);
+
+        REG_WRITE(SOFT_PWM_GPCLR0, gSoftPwmChannels);
+        gSoftPwmChannels = 0;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Gets the timing statistics of the PWM thread.
+ * @details             Lateness is the time from when an edge was due to
+ *                      when its stores completed. The thread publishes its
+ *                      counts once per period.
+ * @param[out] stats    Populated with the statistics since gpioSoftPwmStart().
+ * @return              An error from #errStatus. */
+errStatus gpioSoftPwmGetStats(tSoftPwmStats * stats)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (stats == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stats was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        pthread_mutex_lock(&gSoftPwmLock);
+        *stats = gSoftPwmPublished;
+        pthread_mutex_unlock(&gSoftPwmLock);
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which finds an edge.
+ * @param[in] schedule  The schedule.
+ * @param offset_ns     The edge offset.
+ * @return              Index of the edge at \p offset_ns, or if there is none
+ *                      the index it would be inserted at, negated minus one. */
+static int softPwmEdgeFind(const tSoftPwmSchedule * schedule, uint32_t offset_ns)
+{
+    int first = 0;
+    int last = schedule->count - 1;
+    int middle = 0;
+
+    while (first <= last)
+    {
+        middle = (first + last) / 2;
+
+        if (schedule->edges[middle].offset_ns == offset_ns)
+        {
+            return middle;
+        }
+
+        else if (schedule->edges[middle].offset_ns < offset_ns)
+        {
+            first = middle + 1;
+        }
+
+        else
+        {
+            last = middle - 1;
+        }
+    }
+
+    return -first - 1;
+}
+
+
+/**
+ * @brief               Internal function which adds masks to the edge at
+ *                      \p offset_ns, inserting the edge if needed.
+ * @param schedule      The schedule.
+ * @param offset_ns     The edge offset.
+ * @param setMask       Pins to set.
+ * @param clearMask     Pins to clear.
+ */
+static void softPwmEdgeAdd(tSoftPwmSchedule * schedule, uint32_t offset_ns,
+                           uint32_t setMask, uint32_t clearMask)
+{
+    int index = softPwmEdgeFind(schedule, offset_ns);
+
+    if (index < 0)
+    {
+        index = -index - 1;
+        memmove(&schedule->edges[index + 1], &schedule->edges[index],
+                (schedule->count - index) * sizeof(tSoftPwmEdge));
+        schedule->edges[index].offset_ns = offset_ns;
+        schedule->edges[index].setMask = 0;
+        schedule->edges[index].clearMask = 0;
+        schedule->count++;
+    }
+
+    schedule->edges[index].setMask |= setMask;
+    schedule->edges[index].clearMask |= clearMask;
+}
+
+
+/**
+ * @brief               Internal function which removes masks from the edge
+ *                      at \p offset_ns, removing the edge once it is empty.
+ * @param schedule      The schedule.
+ * @param offset_ns     The edge offset.
+ * @param setMask       Pins no longer set.
+ * @param clearMask     Pins no longer cleared.
+ */
+static void softPwmEdgeRemove(tSoftPwmSchedule * schedule, uint32_t offset_ns,
+                              uint32_t setMask, uint32_t clearMask)
+{
+    int index = softPwmEdgeFind(schedule, offset_ns);
+
+    if (index >= 0)
+    {
+        schedule->edges[index].setMask &= ~setMask;
+        schedule->edges[index].clearMask &= ~clearMask;
+
+        if (schedule->edges[index].setMask == 0 && schedule->edges[index].clearMask == 0)
+        {
+            schedule->count--;
+            memmove(&schedule->edges[index], &schedule->edges[index + 1],
+                    (schedule->count - index) * sizeof(tSoftPwmEdge));
+        }
+    }
+}
+
+
+/**
+ * @brief               Internal function which adds a channel's edges.
+ * @details             The set is at the start of the period unless the
+ *                      channel is always low, the clear at \p high_ns unless
+ *                      it is always high.
+ * @param schedule      The schedule.
+ * @param mask          The channel's pin.
+ * @param high_ns       The channel's high time.
+ */
+static void softPwmChannelAdd(tSoftPwmSchedule * schedule, uint32_t mask, uint32_t high_ns)
+{
+    if (high_ns > 0)
+    {
+        softPwmEdgeAdd(schedule, 0, mask, 0);
+    }
+
+    if (high_ns < gSoftPwmPeriod_ns)
+    {
+        softPwmEdgeAdd(schedule, high_ns, 0, mask);
+    }
+}
+
+
+/**
+ * @brief               Internal function which removes a channel's edges.
+ * @param schedule      The schedule.
+ * @param mask          The channel's pin.
+ * @param high_ns       The high time the channel was added with.
+ */
+static void softPwmChannelRemove(tSoftPwmSchedule * schedule, uint32_t mask, uint32_t high_ns)
+{
+    if (high_ns > 0)
+    {
+        softPwmEdgeRemove(schedule, 0, mask, 0);
+    }
+
+    if (high_ns < gSoftPwmPeriod_ns)
+    {
+        softPwmEdgeRemove(schedule, high_ns, 0, mask);
+    }
+}
+
+
+/**
+ * @brief   Internal function run by the PWM thread.
+ * @details Each period starts by taking any edited schedule and publishing
+ *          the statistics, only if the lock is free so a caller holding it
+ *          does not delay the period.
+ * @return  NULL */
+static void * softPwmThread(void * unused)
+{
+    tSoftPwmSchedule active;
+    tSoftPwmStats stats;
+    const tSoftPwmEdge * edge = NULL;
+    uint64_t periodStart = timeNowNs();
+    uint64_t target = 0;
+    uint64_t late = 0;
+    int index = 0;
+    int bucket = 0;
+
+    memset(&active, 0, sizeof(active));
+    memset(&stats, 0, sizeof(stats));
+
+    while (gSoftPwmRunning)
+    {
+        if (pthread_mutex_trylock(&gSoftPwmLock) == 0)
+        {
+            if (gSoftPwmDirty)
+            {
+                active = gSoftPwmPending;
+                gSoftPwmDirty = 0;
+            }
+            gSoftPwmPublished = stats;
+            pthread_mutex_unlock(&gSoftPwmLock);
+        }
+
+        for (index = 0; index < active.count; index++)
+        {
+            edge = &active.edges[index];
+            target = periodStart + edge->offset_ns;
+
+            timeWaitUntil(target, SOFT_PWM_SPIN_NS);
+
+            if (edge->setMask)
+            {
+                REG_WRITE(SOFT_PWM_GPSET0, edge->setMask);
+            }
+
+            if (edge->clearMask)
+            {
+                REG_WRITE(SOFT_PWM_GPCLR0, edge->clearMask);
+            }
+
+            late = timeNowNs() - target;
+            bucket = late ? 64 - __builtin_clzll(late) : 0;
+            bucket = bucket >= STATS_HIST_BUCKETS ? STATS_HIST_BUCKETS - 1 : bucket;
+            stats.lateness.calls++;
+            stats.lateness.histogram[bucket]++;
+            stats.lateness.totalNs += late;
+            stats.maxLateNs = late > stats.maxLateNs ? late : stats.maxLateNs;
+        }
+
+        stats.periods++;
+
+        /* A period was missed entirely, restart rather than chase it */
+        if (timeNextPeriod(&periodStart, gSoftPwmPeriod_ns))
+        {
+            stats.overruns++;
+        }
+
+        timeWaitUntil(periodStart, SOFT_PWM_SPIN_NS);
+    }
+
+    return NULL;
+}
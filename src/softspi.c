@@ -0,0 +1,480 @@
+/**
+ * @file
+ *  @brief Contains source for the bit banged multi lane SPI master.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *  A bus is one SCLK shared by up to #SOFT_SPI_LANES lanes, each with its
+ *  own MOSI, MISO and chip select. Lanes may be the data lines of one wide
+ *  device or separate devices clocked together.
+ *
+ *  Before a chunk of bytes is clocked, the GPSET0 and GPCLR0 values of
+ *  every edge are computed from the data of all the lanes and the SPI mode.
+ *  Data changes ride on the edge which shifts, so each edge, clock and
+ *  every lane's data together, is one GPSET0 and one GPCLR0 store. MISO of
+ *  every lane is read with one GPLEV0 load per bit and unpacked once the
+ *  chunk is done. Without pacing, SCLK runs as fast as the stores allow.
+ */
+
+#include "softspi.h"
+
+/* Local / internal prototypes */
+static int softSpiPin(int gpioNumber, int optional, uint32_t * pins);
+static int softSpiPrepare(const tSoftSpiBus * bus, const uint8_t * const * txData,
+                          size_t offset, size_t bytes, tSoftSpiEdge * start,
+                          tSoftSpiEdge * lead, tSoftSpiEdge * trail);
+static void softSpiClock(const tSoftSpiBus * bus, const tSoftSpiEdge * start,
+                         const tSoftSpiEdge * lead, const tSoftSpiEdge * trail,
+                         uint32_t * levels, int bits, uint64_t * next);
+static void softSpiUnpack(const tSoftSpiBus * bus, const uint32_t * levels,
+                          uint8_t * const * rxBuffer, size_t offset, size_t bytes);
+
+/**** Globals ****/
+/** @brief Serialises transfers and protects gSoftSpiBuses. */
+static pthread_mutex_t gSoftSpiLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief The open buses. */
+static tSoftSpiBus gSoftSpiBuses[SOFT_SPI_BUSES];
+
+/** @brief The GPIO registers. */
+static volatile uint32_t * gSoftSpiMap = NULL;
+
+/**
+ * @brief           Opens a software SPI bus.
+ * @details         SCLK, MOSI and chip select pins are made outputs, SCLK
+ *                  at its idle level, MOSI low and chip selects high. MISO
+ *                  pins are made inputs.
+ * @param[in] config The pins, mode, bit order and clock. Copied.
+ * @param[out] bus  The bus, for gpioSoftSpiTransfer().
+ * @return          An error from #errStatus. */
+errStatus gpioSoftSpiOpen(const tSoftSpiConfig * config, int * bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSoftSpiBus spi;
+    uint32_t pins = 0;
+    uint32_t used = 0;
+    uint32_t pin = 0;
+    int valid = 1;
+    int index = 0;
+    int empty = -1;
+    int lane = 0;
+
+    memset(&spi, 0, sizeof(spi));
+
+    pthread_mutex_lock(&gSoftSpiLock);
+
+    for (index = 0; index < SOFT_SPI_BUSES; index++)
+    {
+        if (gSoftSpiBuses[index].inUse)
+        {
+            used |= gSoftSpiBuses[index].sclk | gSoftSpiBuses[index].mosiAll |
+                    gSoftSpiBuses[index].misoAll | gSoftSpiBuses[index].cs;
+        }
+
+        else if (empty < 0)
+        {
+            empty = index;
+        }
+    }
+
+    if (config == NULL || bus == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter config or bus was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (config->lanes < 1 || config->lanes > SOFT_SPI_LANES ||
+             config->mode < 0 || config->mode > 3 ||
+             (config->order != softSpiMsbFirst && config->order != softSpiLsbFirst) ||
+             config->frequency < 0 || config->frequency > SOFT_SPI_FREQ_MAX)
+    {
+        dbgPrint(DBG_INFO, "lanes %d, mode %d, order %d or frequency %d is out of range.",
+                 config->lanes, config->mode, config->order, config->frequency);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (empty < 0)
+    {
+        dbgPrint(DBG_INFO, "All %d buses are open.", SOFT_SPI_BUSES);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        valid = softSpiPin(config->gpioNumberSclk, 0, &pins);
+        spi.sclk = pins;
+
+        for (lane = 0; lane < config->lanes; lane++)
+        {
+            pin = pins;
+            valid &= softSpiPin(config->gpioNumberMosi[lane], 1, &pins);
+            spi.mosi[lane] = pins & ~pin;
+            pin = pins;
+            valid &= softSpiPin(config->gpioNumberMiso[lane], 1, &pins);
+            spi.miso[lane] = pins & ~pin;
+            pin = pins;
+            valid &= softSpiPin(config->gpioNumberCs[lane], 1, &pins);
+            spi.cs |= pins & ~pin;
+            spi.mosiAll |= spi.mosi[lane];
+            spi.misoAll |= spi.miso[lane];
+        }
+
+        if (!valid || (pins & used))
+        {
+            dbgPrint(DBG_INFO, "Pins are invalid, repeated or on another bus.");
+            rtn = ERROR_INVALID_PIN_NUMBER;
+        }
+
+        else if ((rtn = gpioGetRegisters(&gSoftSpiMap)) != OK)
+        {
+            dbgPrint(DBG_INFO, "gpioGetRegisters() failed. %s", gpioErrToString(rtn));
+        }
+
+        else
+        {
+            spi.lanes = config->lanes;
+            spi.cpol = (config->mode >> 1) & 0x1;
+            spi.cpha = config->mode & 0x1;
+            spi.order = config->order;
+            spi.half_ns = config->frequency ? 500000000u / config->frequency : 0;
+
+            /* Levels are latched before the pins become outputs */
+            if ((rtn = gpioSetMask(spi.cs | (spi.cpol ? spi.sclk : 0))) == OK)
+            {
+                rtn = gpioClearMask(spi.mosiAll | (spi.cpol ? 0 : spi.sclk));
+            }
+
+            for (pin = pins; pin && rtn == OK; pin &= pin - 1)
+            {
+                index = __builtin_ctz(pin);
+                rtn = gpioSetFunction(index, spi.misoAll & (0x1u << index) ? input : output);
+            }
+
+            if (rtn != OK)
+            {
+                dbgPrint(DBG_INFO, "Setting up the pins failed. %s", gpioErrToString(rtn));
+            }
+
+            else
+            {
+                spi.inUse = 1;
+                gSoftSpiBuses[empty] = spi;
+                *bus = empty;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&gSoftSpiLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief       Closes a bus opened by gpioSoftSpiOpen(). Its pins are left as
+ *              they are.
+ * @param bus   The bus.
+ * @return      An error from #errStatus. */
+errStatus gpioSoftSpiClose(int bus)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    pthread_mutex_lock(&gSoftSpiLock);
+
+    if (bus < 0 || bus >= SOFT_SPI_BUSES || !gSoftSpiBuses[bus].inUse)
+    {
+        dbgPrint(DBG_INFO, "bus %d is not open.", bus);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        gSoftSpiBuses[bus].inUse = 0;
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSoftSpiLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Clocks \p length bytes on every lane of a bus.
+ * @details         Every lane's chip select is held low for the transfer.
+ * @param bus       From gpioSoftSpiOpen().
+ * @param[in] txData One pointer per lane to \p length bytes to send. The
+ *                  array or a lane's pointer may be NULL to send zeros.
+ * @param[out] rxBuffer One pointer per lane to \p length bytes received.
+ *                  The array or a lane's pointer may be NULL to discard.
+ * @param length    Bytes per lane.
+ * @return          An error from #errStatus. */
+errStatus gpioSoftSpiTransfer(int bus, const uint8_t * const * txData,
+                              uint8_t * const * rxBuffer, size_t length)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tSoftSpiEdge start;
+    tSoftSpiEdge lead[SOFT_SPI_CHUNK_BITS];
+    tSoftSpiEdge trail[SOFT_SPI_CHUNK_BITS];
+    uint32_t levels[SOFT_SPI_CHUNK_BITS];
+    const tSoftSpiBus * spi = NULL;
+    uint64_t next = 0;
+    size_t offset = 0;
+    size_t bytes = 0;
+    int bits = 0;
+
+    pthread_mutex_lock(&gSoftSpiLock);
+
+    if (bus < 0 || bus >= SOFT_SPI_BUSES || !gSoftSpiBuses[bus].inUse)
+    {
+        dbgPrint(DBG_INFO, "bus %d is not open.", bus);
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        spi = &gSoftSpiBuses[bus];
+        REG_WRITE(SOFT_SPI_GPCLR0, spi->cs);
+        next = timeNowNs();
+
+        for (offset = 0; offset < length; offset += bytes)
+        {
+            bytes = length - offset < SOFT_SPI_CHUNK ? length - offset : SOFT_SPI_CHUNK;
+            bits = softSpiPrepare(spi, txData, offset, bytes, &start, lead, trail);
+            softSpiClock(spi, &start, lead, trail, levels, bits, &next);
+
+            if (rxBuffer != NULL && spi->misoAll)
+            {
+                softSpiUnpack(spi, levels, rxBuffer, offset, bytes);
+            }
+        }
+
+        REG_WRITE(SOFT_SPI_GPSET0, spi->cs);
+        rtn = OK;
+    }
+
+    pthread_mutex_unlock(&gSoftSpiLock);
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Internal function, adds a pin to \p pins.
+ * @param gpioNumber The pin, or -1 if \p optional.
+ * @param optional  -1 is accepted and adds nothing.
+ * @param[in,out] pins Pins so far.
+ * @return          0 if the pin is out of range or already in \p pins. */
+static int softSpiPin(int gpioNumber, int optional, uint32_t * pins)
+{
+    int valid = 0;
+
+    if (gpioNumber == -1 && optional)
+    {
+        valid = 1;
+    }
+
+    else if (gpioNumber >= 0 && gpioNumber <= 31 && !(*pins & (0x1u << gpioNumber)))
+    {
+        *pins |= 0x1u << gpioNumber;
+        valid = 1;
+    }
+
+    return valid;
+}
+
+
+/**
+ * @brief           Internal function, computes every edge of a chunk.
+ * @details         With CPHA 0 data is set up before the first leading edge
+ *                  and changes with each trailing edge. With CPHA 1 it
+ *                  changes with each leading edge. The other edge only moves
+ *                  SCLK and is the one data is sampled before.
+ * @param bus       The bus.
+ * @param txData    As gpioSoftSpiTransfer().
+ * @param offset    Byte of the transfer the chunk starts at.
+ * @param bytes     Bytes in the chunk.
+ * @param[out] start Written before the first leading edge.
+ * @param[out] lead The leading edge of each bit.
+ * @param[out] trail The trailing edge of each bit.
+ * @return          Bits in the chunk. */
+static int softSpiPrepare(const tSoftSpiBus * bus, const uint8_t * const * txData,
+                          size_t offset, size_t bytes, tSoftSpiEdge * start,
+                          tSoftSpiEdge * lead, tSoftSpiEdge * trail)
+{
+    uint32_t activeSet = bus->cpol ? 0 : bus->sclk;
+    uint32_t activeClear = bus->cpol ? bus->sclk : 0;
+    uint32_t high = 0;
+    uint8_t value = 0;
+    int bits = (int)bytes * 8;
+    int byte = 0;
+    int lane = 0;
+    int bit = 0;
+    int shift = 0;
+
+    /* The MOSI pins each bit drives high, gathered in lead[] */
+    for (bit = 0; bit < bits; bit++)
+    {
+        lead[bit].set = 0;
+    }
+
+    for (lane = 0; lane < bus->lanes; lane++)
+    {
+        if (!bus->mosi[lane] || txData == NULL || txData[lane] == NULL)
+        {
+            continue;
+        }
+
+        for (byte = 0; byte < (int)bytes; byte++)
+        {
+            value = txData[lane][offset + byte];
+
+            for (bit = 0; bit < 8; bit++)
+            {
+                shift = bus->order == softSpiMsbFirst ? 7 - bit : bit;
+                lead[byte * 8 + bit].set |= (value >> shift) & 0x1 ? bus->mosi[lane] : 0;
+            }
+        }
+    }
+
+    start->set = 0;
+    start->clear = 0;
+
+    for (bit = 0; bit < bits; bit++)
+    {
+        high = lead[bit].set;
+
+        if (bus->cpha)
+        {
+            lead[bit].set = activeSet | high;
+            lead[bit].clear = activeClear | (bus->mosiAll & ~high);
+            trail[bit].set = activeClear;
+            trail[bit].clear = activeSet;
+        }
+
+        else
+        {
+            if (bit == 0)
+            {
+                start->set = high;
+                start->clear = bus->mosiAll & ~high;
+            }
+
+            else
+            {
+                trail[bit - 1].set |= high;
+                trail[bit - 1].clear |= bus->mosiAll & ~high;
+            }
+
+            lead[bit].set = activeSet;
+            lead[bit].clear = activeClear;
+            trail[bit].set = activeClear;
+            trail[bit].clear = activeSet;
+        }
+    }
+
+    return bits;
+}
+
+
+/**
+ * @brief           Internal function, clocks a chunk.
+ * @param bus       The bus.
+ * @param start     Written before the first leading edge.
+ * @param lead      The leading edge of each bit.
+ * @param trail     The trailing edge of each bit.
+ * @param[out] levels GPLEV0 read before each trailing edge.
+ * @param bits      Bits in the chunk.
+ * @param[in,out] next Time of the next edge when paced. */
+static void softSpiClock(const tSoftSpiBus * bus, const tSoftSpiEdge * start,
+                         const tSoftSpiEdge * lead, const tSoftSpiEdge * trail,
+                         uint32_t * levels, int bits, uint64_t * next)
+{
+    int bit = 0;
+
+    REG_WRITE(SOFT_SPI_GPSET0, start->set);
+    REG_WRITE(SOFT_SPI_GPCLR0, start->clear);
+
+    for (bit = 0; bit < bits; bit++)
+    {
+        if (bus->half_ns)
+        {
+            *next += bus->half_ns;
+            timeWaitUntil(*next, SOFT_SPI_SPIN_NS);
+        }
+
+        REG_WRITE(SOFT_SPI_GPSET0, lead[bit].set);
+        REG_WRITE(SOFT_SPI_GPCLR0, lead[bit].clear);
+
+        if (bus->half_ns)
+        {
+            *next += bus->half_ns;
+            timeWaitUntil(*next, SOFT_SPI_SPIN_NS);
+        }
+
+        if (bus->misoAll)
+        {
+            levels[bit] = REG_READ(SOFT_SPI_GPLEV0);
+        }
+
+        REG_WRITE(SOFT_SPI_GPSET0, trail[bit].set);
+        REG_WRITE(SOFT_SPI_GPCLR0, trail[bit].clear);
+    }
+}
+
+
+/**
+ * @brief           Internal function, unpacks MISO of each lane from the
+ *                  GPLEV0 reads of a chunk.
+ * @param bus       The bus.
+ * @param levels    GPLEV0 read at each bit.
+ * @param rxBuffer  As gpioSoftSpiTransfer().
+ * @param offset    Byte of the transfer the chunk starts at.
+ * @param bytes     Bytes in the chunk. */
+static void softSpiUnpack(const tSoftSpiBus * bus, const uint32_t * levels,
+                          uint8_t * const * rxBuffer, size_t offset, size_t bytes)
+{
+    uint8_t value = 0;
+    int byte = 0;
+    int lane = 0;
+    int bit = 0;
+
+    for (lane = 0; lane < bus->lanes; lane++)
+    {
+        if (!bus->miso[lane] || rxBuffer[lane] == NULL)
+        {
+            continue;
+        }
+
+        for (byte = 0; byte < (int)bytes; byte++)
+        {
+            value = 0;
+
+            for (bit = 0; bit < 8; bit++)
+            {
+                if (levels[byte * 8 + bit] & bus->miso[lane])
+                {
+                    value |= bus->order == softSpiMsbFirst ? 0x80 >> bit : 0x1 << bit;
+                }
+            }
+
+            rxBuffer[lane][offset + byte] = value;
+        }
+    }
+}
@@ -0,0 +1,366 @@
+/**
+ * @file
+ *  @brief Contains source for the per call statistics.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Each thread records into its own block so the recording path is plain
+ *  increments. Blocks are only ever added to the global list, a block whose
+ *  thread has exited is reused by the next new thread so its counts are kept.
+ *  Readers sum every block. On 32 bit targets a 64 bit counter may be read
+ *  mid update, so a snapshot taken while calls are in flight is approximate.
+ */
+
+#include "stats.h"
+
+#ifdef GPIO_STATS
+#include <pthread.h>
+
+/** @brief Statistics belonging to a single thread. */
+typedef struct tStatsThread {
+    tStats                stats;  /**< Counters, only written by the owner */
+    int                   inUse;  /**< Non zero while a thread owns this */
+    struct tStatsThread * next;   /**< Next block in gStatsThreads */
+} tStatsThread;
+
+/* Local / internal prototypes */
+static tStatsThread * statsThreadRegister(void);
+static void statsThreadRelease(void * block);
+static void statsKeyCreate(void);
+static void statsSum(tStats * stats);
+
+/**** Globals ****/
+/** @brief This thread's block. NULL until the first recorded call. */
+static __thread tStatsThread * tStatsBlock = NULL;
+
+/** @brief Every block ever registered. */
+static tStatsThread * gStatsThreads = NULL;
+
+/** @brief Protects gStatsThreads and gStatsBaseline. Not taken when recording. */
+static pthread_mutex_t gStatsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Sum of all blocks at the last gpioStatsReset(). */
+static tStats gStatsBaseline;
+
+/** @brief Key used to release a block when its thread exits. */
+static pthread_key_t gStatsKey;
+
+/** @brief Ensures gStatsKey is created once. */
+static pthread_once_t gStatsKeyOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/** @brief Names of each #eStatsApi for gpioStatsDump(). */
+static const char * statsApiNames[statsApiMax] = {
+    "gpioSetFunction",
+    "gpioSetPin",
+    "gpioReadPin",
+    "gpioSetPullResistor",
+    "gpioI2cSetClock",
+    "gpioI2cSet7BitSlave",
+    "gpioI2cWriteData",
+    "gpioI2cReadData",
+    "gpioSetMask",
+    "gpioClearMask",
+    "gpioReadLevels",
+};
+
+/**
+ * @brief               Takes a snapshot of the statistics since the last
+ *                      gpioStatsReset().
+ * @details             Only available if the library was built with
+ *                      STATS=1, otherwise #ERROR_UNSUPPORTED is returned.
+ * @param[out] stats    Populated with the counts of every thread.
+ * @return              An error from #errStatus. */
+errStatus gpioStatsSnapshot(tStats * stats)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (stats == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stats was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+#ifdef GPIO_STATS
+        uint64_t * total = (uint64_t *)stats;
+        const uint64_t * baseline = (const uint64_t *)&gStatsBaseline;
+        size_t index = 0;
+
+        pthread_mutex_lock(&gStatsLock);
+        statsSum(stats);
+
+        /* tStats is only uint64_t counters so can be walked as an array */
+        for (index = 0; index < sizeof(tStats) / sizeof(uint64_t); index++)
+        {
+            total[index] -= baseline[index];
+        }
+        pthread_mutex_unlock(&gStatsLock);
+
+        rtn = OK;
+#else
+        memset(stats, 0, sizeof(*stats));
+        rtn = ERROR_UNSUPPORTED;
+#endif
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Zeroes the statistics returned by gpioStatsSnapshot().
+ * @details The recording threads are not touched, the current totals are
+ *          instead remembered and subtracted from later snapshots.
+ * @return  An error from #errStatus. */
+errStatus gpioStatsReset(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+#ifdef GPIO_STATS
+    pthread_mutex_lock(&gStatsLock);
+    statsSum(&gStatsBaseline);
+    pthread_mutex_unlock(&gStatsLock);
+    rtn = OK;
+#else
+    rtn = ERROR_UNSUPPORTED;
+#endif
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Writes a human readable summary of the statistics.
+ * @details         For each API called the call count, a count of each
+ *                  #errStatus returned, the mean latency and the 50th, 90th
+ *                  and 99th percentile latencies are printed. Percentiles
+ *                  are the upper bound of the histogram bucket they fall in.
+ * @param stream    Output stream, e.g. stdout.
+ * @return          An error from #errStatus. */
+errStatus gpioStatsDump(FILE * stream)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    tStats stats;
+    int api = 0;
+    int status = 0;
+
+    if (stream == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stream was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if ((rtn = gpioStatsSnapshot(&stats)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioStatsSnapshot() failed. %s", gpioErrToString(rtn));
+    }
+
+    else
+    {
+        for (api = 0; api < statsApiMax; api++)
+        {
+            const tStatsApi * entry = &stats.api[api];
+
+            if (entry->calls == 0)
+            {
+                continue;
+            }
+
+            fprintf(stream, "%-20s calls %llu mean %lluns p50 <%lluns "
+                    "p90 <%lluns p99 <%lluns\n", statsApiNames[api],
+                    (unsigned long long)entry->calls,
+                    (unsigned long long)(entry->totalNs / entry->calls),
+                    (unsigned long long)gpioStatsPercentile(entry, 50),
+                    (unsigned long long)gpioStatsPercentile(entry, 90),
+                    (unsigned long long)gpioStatsPercentile(entry, 99));
+
+            for (status = 0; status < ERROR_MAX; status++)
+            {
+                if (entry->status[status] != 0)
+                {
+                    fprintf(stream, "%-20s   %s %llu\n", "",
+                            gpioErrToString(status),
+                            (unsigned long long)entry->status[status]);
+                }
+            }
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Finds a latency percentile from a histogram.
+ * @param[in] entry Statistics of a single API.
+ * @param percent   Percentile to find, 0 - 100.
+ * @return          Upper bound in nano seconds of the bucket holding the
+ *                  percentile, or 0 if no calls have been recorded. */
+uint64_t gpioStatsPercentile(const tStatsApi * entry, int percent)
+{
+    uint64_t target = 0;
+    uint64_t seen = 0;
+    int bucket = 0;
+
+    if (entry == NULL || entry->calls == 0)
+    {
+        return 0;
+    }
+
+    target = (entry->calls * (uint64_t)percent + 99) / 100;
+
+    for (bucket = 0; bucket < STATS_HIST_BUCKETS; bucket++)
+    {
+        seen += entry->histogram[bucket];
+
+        if (seen >= target)
+        {
+            break;
+        }
+    }
+
+    return bucket >= STATS_HIST_BUCKETS - 1 ? UINT64_MAX : (0x1ULL << bucket);
+}
+
+/****************************** Internal Functions ******************************/
+
+#ifdef GPIO_STATS
+/**
+ * @brief           Internal function which records a single call.
+ * @details         Called through STATS_END(). This thread's block is only
+ *                  written by this thread so no atomics are needed.
+ * @param api       The API being recorded.
+ * @param rtn       The status the API is returning.
+ * @param start_ns  timeNowNs() when the API was entered.
+ */
+void statsRecord(eStatsApi api, errStatus rtn, uint64_t start_ns)
+{
+    tStatsThread * block = tStatsBlock;
+    tStatsApi * entry = NULL;
+    uint64_t elapsed = timeNowNs() - start_ns;
+    int bucket = 0;
+
+    if (block == NULL && (block = statsThreadRegister()) == NULL)
+    {
+        return;
+    }
+
+    /* Bucket b holds latencies in [2^(b-1), 2^b) nano seconds */
+    bucket = elapsed ? 64 - __builtin_clzll(elapsed) : 0;
+    bucket = bucket >= STATS_HIST_BUCKETS ? STATS_HIST_BUCKETS - 1 : bucket;
+
+    entry = &block->stats.api[api];
+    entry->calls++;
+    entry->status[rtn < ERROR_MAX ? rtn : ERROR_DEFAULT]++;
+    entry->histogram[bucket]++;
+    entry->totalNs += elapsed;
+}
+
+
+/**
+ * @brief   Internal function which gives the calling thread a block.
+ * @return  The block, or NULL if one could not be allocated. */
+static tStatsThread * statsThreadRegister(void)
+{
+    tStatsThread * block = NULL;
+
+    pthread_once(&gStatsKeyOnce, statsKeyCreate);
+    pthread_mutex_lock(&gStatsLock);
+
+    for (block = gStatsThreads; block != NULL; block = block->next)
+    {
+        if (!block->inUse)
+        {
+            break;
+        }
+    }
+
+    if (block == NULL && (block = calloc(1, sizeof(*block))) != NULL)
+    {
+        block->next = gStatsThreads;
+        gStatsThreads = block;
+    }
+
+    if (block != NULL)
+    {
+        block->inUse = 1;
+        pthread_setspecific(gStatsKey, block);
+    }
+
+    pthread_mutex_unlock(&gStatsLock);
+
+    tStatsBlock = block;
+
+    return block;
+}
+
+
+/**
+ * @brief           Internal function called as a thread exits.
+ * @param block     The exiting thread's block.
+ */
+static void statsThreadRelease(void * block)
+{
+    pthread_mutex_lock(&gStatsLock);
+    ((tStatsThread *)block)->inUse = 0;
+    pthread_mutex_unlock(&gStatsLock);
+}
+
+
+/**
+ * @brief   Internal function which creates gStatsKey.
+ */
+static void statsKeyCreate(void)
+{
+    pthread_key_create(&gStatsKey, statsThreadRelease);
+}
+
+
+/**
+ * @brief           Internal function which sums every block. gStatsLock
+ *                  must be held.
+ * @param[out] stats Populated with the sum.
+ */
+static void statsSum(tStats * stats)
+{
+    tStatsThread * block = NULL;
+    uint64_t * total = (uint64_t *)stats;
+    size_t index = 0;
+
+    memset(stats, 0, sizeof(*stats));
+
+    for (block = gStatsThreads; block != NULL; block = block->next)
+    {
+        const volatile uint64_t * counts = (const volatile uint64_t *)&block->stats;
+
+        for (index = 0; index < sizeof(tStats) / sizeof(uint64_t); index++)
+        {
+            total[index] += counts[index];
+        }
+    }
+}
+#else
+/**
+ * @brief   Compiled out. Build with STATS=1 to enable.
+ */
+void statsRecord(eStatsApi api, errStatus rtn, uint64_t start_ns)
+{
+}
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file
+ *  @brief Contains source for the timing helpers shared by the library's
+ *  threads.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* For CPU_SET() and pthread_setaffinity_np() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "timing.h"
+#include "log.h"
+#include <sched.h>
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief           Internal function which gives a thread the highest
+ *                  SCHED_FIFO priority and optionally pins it to a cpu.
+ * @details         Either failing is logged as a warning and the thread
+ *                  carries on as it was.
+ * @param thread    The thread.
+ * @param cpu       The cpu to run on, or -1 for any.
+ * @param name      What the thread does, for the warnings, e.g. "Encoder".
+ */
+void timeThreadRealtime(pthread_t thread, int cpu, const char * name)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+
+    /* Without CAP_SYS_NICE this fails and the thread stays SCHED_OTHER */
+    if (pthread_setschedparam(thread, SCHED_FIFO, &param) != 0)
+    {
+        GPIO_LOG(logWarning, "%s thread could not be made SCHED_FIFO.", name);
+    }
+
+    if (cpu >= 0)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+
+        if (pthread_setaffinity_np(thread, sizeof(cpus), &cpus) != 0)
+        {
+            GPIO_LOG(logWarning, "%s thread could not be pinned to cpu %d.", name, cpu);
+        }
+    }
+}
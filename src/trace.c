@@ -0,0 +1,384 @@
+/**
+ * @file
+ *  @brief Records a trace of library calls for Chrome or Perfetto.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Built with TRACE=1, instrumented calls record a span from entry to
+ *  return, and some record counter tracks such as the BSC FIFO fill level
+ *  or the level of each pin driven. As with the statistics each thread
+ *  records into its own buffer, so recording takes no lock and no atomic
+ *  read-modify-write, only a store of the event and a release store of the
+ *  count. A buffer which fills drops later events, and gpioTraceStart()
+ *  empties the buffers by starting a new generation, which each thread
+ *  notices on its next event.
+ *
+ *  gpioTraceWrite() writes Chrome trace event JSON, which both
+ *  chrome://tracing and the Perfetto UI open.
+ */
+
+#include "trace.h"
+
+#ifdef GPIO_TRACE
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/** @brief Events belonging to a single thread. */
+typedef struct tTraceThread {
+    tTraceEvent           events[TRACE_EVENTS]; /**< Only written by the owner */
+    uint32_t              count;                /**< Events recorded */
+    uint32_t              dropped;              /**< Events dropped as full */
+    uint32_t              generation;           /**< Generation of the events */
+    int                   tid;                  /**< Thread id of the owner */
+    char                  name[16];             /**< Thread name of the owner */
+    int                   inUse;                /**< Non zero while a thread owns this */
+    struct tTraceThread * next;                 /**< Next block in gTraceThreads */
+} tTraceThread;
+
+/* Local / internal prototypes */
+static tTraceThread * traceThreadGet(void);
+static tTraceThread * traceThreadRegister(void);
+static void traceThreadRelease(void * block);
+static void traceKeyCreate(void);
+static void traceAdd(eTraceEvent type, const char * name, uint64_t time_ns, int64_t value);
+
+/**** Globals ****/
+/** @brief Non zero while tracing. */
+volatile int gTraceRunning = 0;
+
+/** @brief This thread's block. NULL until the first recorded event. */
+static __thread tTraceThread * tTraceBlock = NULL;
+
+/** @brief Every block ever registered. */
+static tTraceThread * gTraceThreads = NULL;
+
+/** @brief Protects gTraceThreads and gTraceGeneration changes. Not taken
+ *  when recording. */
+static pthread_mutex_t gTraceLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @brief Incremented by each gpioTraceStart(), older events are discarded. */
+static uint32_t gTraceGeneration = 0;
+
+/** @brief timeNowNs() at the last gpioTraceStart(), time zero of the trace. */
+static uint64_t gTraceStart_ns = 0;
+
+/** @brief Key used to release a block when its thread exits. */
+static pthread_key_t gTraceKey;
+
+/** @brief Ensures gTraceKey is created once. */
+static pthread_once_t gTraceKeyOnce = PTHREAD_ONCE_INIT;
+
+/** @brief Counter track of each pin. */
+static const char * gTracePinNames[32] = {
+    "GPIO0",  "GPIO1",  "GPIO2",  "GPIO3",  "GPIO4",  "GPIO5",  "GPIO6",  "GPIO7",
+    "GPIO8",  "GPIO9",  "GPIO10", "GPIO11", "GPIO12", "GPIO13", "GPIO14", "GPIO15",
+    "GPIO16", "GPIO17", "GPIO18", "GPIO19", "GPIO20", "GPIO21", "GPIO22", "GPIO23",
+    "GPIO24", "GPIO25", "GPIO26", "GPIO27", "GPIO28", "GPIO29", "GPIO30", "GPIO31",
+};
+#endif
+
+/**
+ * @brief   Discards any trace recorded so far and starts tracing.
+ * @details Only available if the library was built with TRACE=1, otherwise
+ *          #ERROR_UNSUPPORTED is returned.
+ * @return  An error from #errStatus. */
+errStatus gpioTraceStart(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+#ifdef GPIO_TRACE
+    pthread_mutex_lock(&gTraceLock);
+    gTraceStart_ns = timeNowNs();
+    __atomic_store_n(&gTraceGeneration, gTraceGeneration + 1, __ATOMIC_RELEASE);
+    gTraceRunning = 1;
+    pthread_mutex_unlock(&gTraceLock);
+    rtn = OK;
+#else
+    rtn = ERROR_UNSUPPORTED;
+#endif
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops tracing. The trace is kept for gpioTraceWrite().
+ * @return  An error from #errStatus. */
+errStatus gpioTraceStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+#ifdef GPIO_TRACE
+    gTraceRunning = 0;
+    rtn = OK;
+#else
+    rtn = ERROR_UNSUPPORTED;
+#endif
+
+    return rtn;
+}
+
+
+/**
+ * @brief           Writes the trace since the last gpioTraceStart() as Chrome
+ *                  trace event JSON.
+ * @details         May be called while tracing, events recorded meanwhile
+ *                  may be left out. Times are in micro seconds from
+ *                  gpioTraceStart(). Threads which dropped events have an
+ *                  instant event "trace dropped" at their last event.
+ * @param stream    Output stream, such as a file opened for writing.
+ * @return          An error from #errStatus. */
+errStatus gpioTraceWrite(FILE * stream)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (stream == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter stream was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+#ifdef GPIO_TRACE
+        const tTraceThread * block = NULL;
+        const tTraceEvent * event = NULL;
+        const char * separator = "";
+        uint32_t count = 0;
+        uint32_t index = 0;
+        int pid = (int)getpid();
+
+        pthread_mutex_lock(&gTraceLock);
+        fprintf(stream, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+        for (block = gTraceThreads; block != NULL; block = block->next)
+        {
+            if (__atomic_load_n(&block->generation, __ATOMIC_ACQUIRE) != gTraceGeneration)
+            {
+                continue;
+            }
+
+            /* Events before count are complete and no longer written */
+            count = __atomic_load_n(&block->count, __ATOMIC_ACQUIRE);
+
+            fprintf(stream, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                    "\"args\":{\"name\":\"%s\"}}", separator, pid, block->tid, block->name);
+            separator = ",";
+
+            for (index = 0; index < count; index++)
+            {
+                event = &block->events[index];
+
+                if (event->type == traceSpanEvent)
+                {
+                    fprintf(stream, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                            "\"ts\":%.3f,\"dur\":%.3f}", event->name, pid, block->tid,
+                            (event->time_ns - gTraceStart_ns) / 1000.0, event->value / 1000.0);
+                }
+
+                else
+                {
+                    fprintf(stream, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%d,\"tid\":%d,"
+                            "\"ts\":%.3f,\"args\":{\"value\":%lld}}", event->name, pid,
+                            block->tid, (event->time_ns - gTraceStart_ns) / 1000.0,
+                            (long long)event->value);
+                }
+            }
+
+            if (block->dropped && count)
+            {
+                fprintf(stream, ",\n{\"name\":\"trace dropped\",\"ph\":\"i\",\"s\":\"t\","
+                        "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{\"events\":%u}}", pid,
+                        block->tid, (block->events[count - 1].time_ns - gTraceStart_ns) / 1000.0,
+                        block->dropped);
+            }
+        }
+
+        fprintf(stream, "\n]}\n");
+        pthread_mutex_unlock(&gTraceLock);
+
+        rtn = ferror(stream) ? ERROR_EXTERNAL : OK;
+#else
+        rtn = ERROR_UNSUPPORTED;
+#endif
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+#ifdef GPIO_TRACE
+/**
+ * @brief           Internal function which records a span. Called through
+ *                  TRACE_END().
+ * @param name      The span, a string literal.
+ * @param start_ns  timeNowNs() when the span started. */
+void traceSpan(const char * name, uint64_t start_ns)
+{
+    traceAdd(traceSpanEvent, name, start_ns, (int64_t)(timeNowNs() - start_ns));
+}
+
+
+/**
+ * @brief           Internal function which records a counter. Called through
+ *                  TRACE_COUNTER().
+ * @param name      The counter track, a string literal.
+ * @param value     The counter's new value. */
+void traceCounter(const char * name, int64_t value)
+{
+    traceAdd(traceCounterEvent, name, timeNowNs(), value);
+}
+
+
+/**
+ * @brief           Internal function which records the level of each pin in
+ *                  \p mask on its own counter track. Called through
+ *                  TRACE_LEVELS().
+ * @param mask      Bit n set for GPIO n.
+ * @param levels    Bit n set if GPIO n is high. */
+void traceLevels(uint32_t mask, uint32_t levels)
+{
+    uint64_t now = timeNowNs();
+    int bit = 0;
+
+    for (; mask; mask &= mask - 1)
+    {
+        bit = __builtin_ctz(mask);
+        traceAdd(traceCounterEvent, gTracePinNames[bit], now, (levels >> bit) & 0x1);
+    }
+}
+
+
+/**
+ * @brief   Internal function which returns the calling thread's block,
+ *          emptied if a new generation has started.
+ * @return  The block, or NULL if one could not be allocated. */
+static tTraceThread * traceThreadGet(void)
+{
+    tTraceThread * block = tTraceBlock;
+    uint32_t generation = __atomic_load_n(&gTraceGeneration, __ATOMIC_ACQUIRE);
+
+    if (block == NULL)
+    {
+        block = traceThreadRegister();
+    }
+
+    if (block != NULL && block->generation != generation)
+    {
+        block->count = 0;
+        block->dropped = 0;
+        __atomic_store_n(&block->generation, generation, __ATOMIC_RELEASE);
+    }
+
+    return block;
+}
+
+
+/**
+ * @brief   Internal function which gives the calling thread a block.
+ * @return  The block, or NULL if one could not be allocated. */
+static tTraceThread * traceThreadRegister(void)
+{
+    tTraceThread * block = NULL;
+
+    pthread_once(&gTraceKeyOnce, traceKeyCreate);
+    pthread_mutex_lock(&gTraceLock);
+
+    for (block = gTraceThreads; block != NULL; block = block->next)
+    {
+        if (!block->inUse)
+        {
+            break;
+        }
+    }
+
+    if (block == NULL && (block = calloc(1, sizeof(*block))) != NULL)
+    {
+        block->next = gTraceThreads;
+        gTraceThreads = block;
+    }
+
+    if (block != NULL)
+    {
+        /* A reused block's events belong to its previous thread */
+        __atomic_store_n(&block->generation, 0, __ATOMIC_RELEASE);
+        block->inUse = 1;
+        block->tid = (int)syscall(SYS_gettid);
+        pthread_getname_np(pthread_self(), block->name, sizeof(block->name));
+        pthread_setspecific(gTraceKey, block);
+    }
+
+    pthread_mutex_unlock(&gTraceLock);
+
+    tTraceBlock = block;
+
+    return block;
+}
+
+
+/**
+ * @brief           Internal function called as a thread exits.
+ * @param block     The exiting thread's block.
+ */
+static void traceThreadRelease(void * block)
+{
+    pthread_mutex_lock(&gTraceLock);
+    ((tTraceThread *)block)->inUse = 0;
+    pthread_mutex_unlock(&gTraceLock);
+}
+
+
+/**
+ * @brief   Internal function which creates gTraceKey.
+ */
+static void traceKeyCreate(void)
+{
+    pthread_key_create(&gTraceKey, traceThreadRelease);
+}
+
+
+/**
+ * @brief           Internal function which appends an event to the calling
+ *                  thread's block.
+ * @param type      The event.
+ * @param name      Span or counter track.
+ * @param time_ns   Start of the span or time of the counter.
+ * @param value     Duration or counter value. */
+static void traceAdd(eTraceEvent type, const char * name, uint64_t time_ns, int64_t value)
+{
+    tTraceThread * block = traceThreadGet();
+    tTraceEvent * event = NULL;
+
+    if (block != NULL && block->count == TRACE_EVENTS)
+    {
+        block->dropped++;
+    }
+
+    else if (block != NULL)
+    {
+        event = &block->events[block->count];
+        event->time_ns = time_ns;
+        event->value = value;
+        event->name = name;
+        event->type = type;
+        __atomic_store_n(&block->count, block->count + 1, __ATOMIC_RELEASE);
+    }
+}
+#endif
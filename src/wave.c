@@ -0,0 +1,426 @@
+/**
+ * @file
+ *  @brief Contains source for DMA driven GPIO waveforms.
+ *
+ *  This is is part of https://github.com/alanbarr/RaspberryPi-GPIO
+ *  a C library for basic control of the Raspberry Pi's GPIO pins.
+ *  Copyright (C) Alan Barr 2012
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  A waveform is a chain of DMA control blocks. Blocks copy a mask to GPSET0
+ *  or GPCLR0, or copy words into the PWM or PCM FIFO. The FIFO is drained at
+ *  one word per tick and the DMA engine waits on its DREQ, so the FIFO blocks
+ *  are the delays between edges. Once started no CPU time is used. The FIFO
+ *  runs ahead by its depth, which delays every edge by the same amount and so
+ *  does not affect the time between them.
+ */
+
+#include "wave.h"
+
+/* Local / internal prototypes */
+static void waveAddBlock(tDmaControlBlock * blocks, size_t capacity, size_t * used,
+                         uint32_t blocksBus, uint32_t ti, uint32_t dest,
+                         uint32_t data, uint32_t length);
+
+/**** Globals ****/
+/** @brief Registers of the DMA channel playing waveforms. */
+static volatile uint32_t * gWaveDma = NULL;
+
+/** @brief The DMA channel playing waveforms. */
+static int gWaveChannel = -1;
+
+/** @brief Peripheral pacing the DMA channel. */
+static eWavePacing gWavePacing = wavePacePwm;
+
+/** @brief Length of a tick. */
+static uint32_t gWaveTickNs = 0;
+
+/** @brief Memory holding the chain being played. */
+static tDmaMemory gWaveMemory;
+
+/**
+ * @brief               Claims a DMA channel and starts the pacing peripheral.
+ * @details             gpioSetup() must have been called. Requires root.
+ *                      The pacing clock is PLLD / #DMA_PACE_CLOCK_DIVI,
+ *                      replacing the PWM or PCM clock. Hardware PWM output
+ *                      can not be used alongside #wavePacePwm.
+ * @param pacing        The peripheral pacing the waveform.
+ * @param tick_ns       Resolution of delays, #WAVE_TICK_NS_MIN to
+ *                      #WAVE_TICK_NS_MAX. It is rounded to whole pacing clocks.
+ *                      Ticks under 1 us only keep time while the DMA engine
+ *                      gets through each tick's blocks within the tick.
+ * @param dmaChannel    DMA channel 0 - 14, or -1 for
+ *                      #WAVE_DEFAULT_DMA_CHANNEL. It must not be used by the
+ *                      firmware or kernel.
+ * @param[out] achieved_ns  Populated with the tick used, may be NULL.
+ * @return              An error from #errStatus. */
+errStatus gpioWaveSetup(eWavePacing pacing, uint32_t tick_ns, int dmaChannel,
+                        uint32_t * achieved_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    int channel = dmaChannel < 0 ? WAVE_DEFAULT_DMA_CHANNEL : dmaChannel;
+
+    if (gWaveDma != NULL)
+    {
+        dbgPrint(DBG_INFO, "gpioWaveSetup() has already been called.");
+        rtn = ERROR_ALREADY_INITIALISED;
+    }
+
+    else if ((rtn = dmaPaceStart(pacing, tick_ns, &gWaveTickNs)) != OK)
+    {
+        dbgPrint(DBG_INFO, "dmaPaceStart() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = dmaChannelOpen(channel, &gWaveDma)) != OK)
+    {
+        dbgPrint(DBG_INFO, "dmaChannelOpen() failed. %s", gpioErrToString(rtn));
+        dmaPaceStop(pacing);
+        gWaveDma = NULL;
+    }
+
+    else
+    {
+        gWaveChannel = channel;
+        gWavePacing = pacing;
+
+        if (achieved_ns != NULL)
+        {
+            *achieved_ns = gWaveTickNs;
+        }
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops any waveform, frees its memory, stops the pacing peripheral
+ *          and releases the DMA channel.
+ * @return  An error from #errStatus. */
+errStatus gpioWaveCleanup(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gWaveDma == NULL)
+    {
+        dbgPrint(DBG_INFO, "gWaveDma was NULL. Ensure gpioWaveSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else
+    {
+        gpioWaveStop();
+        dmaChannelClose(gWaveChannel);
+        rtn = dmaPaceStop(gWavePacing);
+
+        gWaveDma = NULL;
+        gWaveChannel = -1;
+        gWaveTickNs = 0;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Plays a waveform, replacing any already playing.
+ * @details             Returns once the DMA engine has started. Use
+ *                      gpioWaveBusy() to find when a waveform not looping
+ *                      has finished.
+ * @param[in] steps     The steps. Copied, so may be reused on return.
+ * @param stepCount     Number of steps.
+ * @param loop          Non zero to repeat the steps until gpioWaveStop().
+ *                      A looping waveform must contain a delay.
+ * @return              An error from #errStatus. */
+errStatus gpioWavePlay(const tWaveStep * steps, size_t stepCount, int loop)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    size_t blockCount = 0;
+
+    if (gWaveDma == NULL)
+    {
+        dbgPrint(DBG_INFO, "gWaveDma was NULL. Ensure gpioWaveSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = gpioWaveBuild(steps, stepCount, gWaveTickNs, gWavePacing, loop,
+                                  NULL, 0, &blockCount)) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioWaveBuild() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioWaveStop()) != OK)
+    {
+        dbgPrint(DBG_INFO, "gpioWaveStop() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = dmaMemAlloc(blockCount * sizeof(tDmaControlBlock),
+                                &gWaveMemory)) != OK)
+    {
+        dbgPrint(DBG_INFO, "dmaMemAlloc() failed. %s", gpioErrToString(rtn));
+    }
+
+    else if ((rtn = gpioWaveBuild(steps, stepCount, gWaveTickNs, gWavePacing, loop,
+                                  gWaveMemory.virt, gWaveMemory.bus, &blockCount)) != OK ||
+             (rtn = dmaChannelStart(gWaveDma, gWaveMemory.bus)) != OK)
+    {
+        dbgPrint(DBG_INFO, "Starting the waveform failed. %s", gpioErrToString(rtn));
+        dmaMemFree(&gWaveMemory);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Reports whether a waveform is playing.
+ * @param[out] busy     Set non zero while the DMA channel is active.
+ * @return              An error from #errStatus. */
+errStatus gpioWaveBusy(int * busy)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gWaveDma == NULL)
+    {
+        dbgPrint(DBG_INFO, "gWaveDma was NULL. Ensure gpioWaveSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (busy == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter busy was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        *busy = (REG_READ(DMA_REG(gWaveDma, DMA_CS_OFFSET)) & DMA_CS_ACTIVE) ? 1 : 0;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief   Stops the waveform playing, if any, and frees its memory. Pins are
+ *          left as the last step executed drove them.
+ * @return  An error from #errStatus. */
+errStatus gpioWaveStop(void)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gWaveDma == NULL)
+    {
+        dbgPrint(DBG_INFO, "gWaveDma was NULL. Ensure gpioWaveSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if ((rtn = dmaChannelStop(gWaveDma)) == OK && gWaveMemory.virt != NULL)
+    {
+        rtn = dmaMemFree(&gWaveMemory);
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Internal function which reports the tick set up by
+ *                      gpioWaveSetup().
+ * @param[out] tick_ns  Populated with the tick.
+ * @return              An error from #errStatus. */
+errStatus waveGetTick(uint32_t * tick_ns)
+{
+    errStatus rtn = ERROR_DEFAULT;
+
+    if (gWaveDma == NULL)
+    {
+        dbgPrint(DBG_INFO, "gWaveDma was NULL. Ensure gpioWaveSetup() was called successfully.");
+        rtn = ERROR_NOT_INITIALISED;
+    }
+
+    else if (tick_ns == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter tick_ns was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else
+    {
+        *tick_ns = gWaveTickNs;
+        rtn = OK;
+    }
+
+    return rtn;
+}
+
+
+/**
+ * @brief               Builds the control block chain for a waveform.
+ * @details             This only writes to \p blocks, so chains may be built
+ *                      and checked on any machine. Each step becomes a block
+ *                      copying its set mask to GPSET0, one copying its clear
+ *                      mask to GPCLR0 (either omitted if the mask is 0) and
+ *                      enough FIFO blocks to wait its delay, each at most
+ *                      #DMA_LENGTH_MAX bytes so lite channels may be used.
+ *                      Every block copies its own first reserved word.
+ * @param[in] steps     The steps.
+ * @param stepCount     Number of steps.
+ * @param tick_ns       Tick the pacing peripheral runs at.
+ * @param pacing        The pacing peripheral.
+ * @param loop          Non zero to link the last block back to the first.
+ * @param[out] blocks   Populated with the chain, 32 byte aligned. May be NULL
+ *                      to only count the blocks required.
+ * @param blocksBus     Bus address of \p blocks.
+ * @param[in,out] blockCount    Capacity of \p blocks. Populated with the blocks
+ *                      required, also when #ERROR_RANGE is returned because
+ *                      \p blocks is too small.
+ * @return              An error from #errStatus. */
+errStatus gpioWaveBuild(const tWaveStep * steps, size_t stepCount, uint32_t tick_ns,
+                        eWavePacing pacing, int loop, tDmaControlBlock * blocks,
+                        uint32_t blocksBus, size_t * blockCount)
+{
+    errStatus rtn = ERROR_DEFAULT;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t index = 0;
+    uint64_t ticks = 0;
+    uint64_t totalTicks = 0;
+    uint32_t chunk = 0;
+    uint32_t fifo = 0;
+
+    if (steps == NULL || blockCount == NULL)
+    {
+        dbgPrint(DBG_INFO, "Parameter steps or blockCount was NULL.");
+        rtn = ERROR_NULL;
+    }
+
+    else if (stepCount == 0 || tick_ns == 0)
+    {
+        dbgPrint(DBG_INFO, "Parameter stepCount or tick_ns was 0.");
+        rtn = ERROR_RANGE;
+    }
+
+    else if (pacing < wavePacePwm || pacing > wavePacePcm)
+    {
+        dbgPrint(DBG_INFO, "pacing value: %d was out of range.", pacing);
+        rtn = ERROR_RANGE;
+    }
+
+    else if (blocks != NULL &&
+             (((uintptr_t)blocks | blocksBus) & (sizeof(tDmaControlBlock) - 1)))
+    {
+        dbgPrint(DBG_INFO, "blocks is not 32 byte aligned.");
+        rtn = ERROR_RANGE;
+    }
+
+    else
+    {
+        capacity = blocks != NULL ? *blockCount : 0;
+        fifo = DMA_PACE_FIFO(pacing);
+
+        for (index = 0; index < stepCount; index++)
+        {
+            if (steps[index].setMask)
+            {
+                waveAddBlock(blocks, capacity, &used, blocksBus, WAVE_TI_GPIO,
+                             DMA_PERI_BUS(GPIO_BASE_OFFSET + GPSET0_OFFSET),
+                             steps[index].setMask, sizeof(uint32_t));
+            }
+
+            if (steps[index].clearMask)
+            {
+                waveAddBlock(blocks, capacity, &used, blocksBus, WAVE_TI_GPIO,
+                             DMA_PERI_BUS(GPIO_BASE_OFFSET + GPCLR0_OFFSET),
+                             steps[index].clearMask, sizeof(uint32_t));
+            }
+
+            ticks = ((uint64_t)steps[index].delay_ns + tick_ns / 2) / tick_ns;
+            totalTicks += ticks;
+
+            while (ticks)
+            {
+                chunk = ticks > WAVE_TICKS_PER_BLOCK ? WAVE_TICKS_PER_BLOCK : (uint32_t)ticks;
+                waveAddBlock(blocks, capacity, &used, blocksBus, DMA_PACE_TI(pacing),
+                             fifo, 0, chunk * sizeof(uint32_t));
+                ticks -= chunk;
+            }
+        }
+
+        *blockCount = used;
+
+        if (used == 0 || (loop && totalTicks == 0))
+        {
+            dbgPrint(DBG_INFO, "The waveform has no blocks or loops without a delay.");
+            rtn = ERROR_RANGE;
+        }
+
+        else if (blocks != NULL && used > capacity)
+        {
+            dbgPrint(DBG_INFO, "%u blocks are required, blocks holds %u.",
+                     (uint32_t)used, (uint32_t)capacity);
+            rtn = ERROR_RANGE;
+        }
+
+        else
+        {
+            if (blocks != NULL)
+            {
+                blocks[used - 1].next = loop ? blocksBus : 0;
+            }
+
+            rtn = OK;
+        }
+    }
+
+    return rtn;
+}
+
+/****************************** Internal Functions ******************************/
+
+/**
+ * @brief               Internal function which appends a block to a chain,
+ *                      linked to the block after it.
+ * @details             The block is only written if it is within \p capacity,
+ *                      \p used is always incremented.
+ * @param blocks        The chain, may be NULL.
+ * @param capacity      Blocks in \p blocks.
+ * @param[in,out] used  Blocks appended so far.
+ * @param blocksBus     Bus address of \p blocks.
+ * @param ti            Transfer information.
+ * @param dest          Destination bus address.
+ * @param data          Word the block copies, kept in the block.
+ * @param length        Bytes to copy. The source does not increment. */
+static void waveAddBlock(tDmaControlBlock * blocks, size_t capacity, size_t * used,
+                         uint32_t blocksBus, uint32_t ti, uint32_t dest,
+                         uint32_t data, uint32_t length)
+{
+    uint32_t bus = blocksBus + (uint32_t)(*used * sizeof(tDmaControlBlock));
+
+    if (blocks != NULL && *used < capacity)
+    {
+        blocks[*used].ti = ti;
+        blocks[*used].source = bus + offsetof(tDmaControlBlock, reserved);
+        blocks[*used].dest = dest;
+        blocks[*used].length = length;
+        blocks[*used].stride = 0;
+        blocks[*used].next = bus + sizeof(tDmaControlBlock);
+        blocks[*used].reserved[0] = data;
+        blocks[*used].reserved[1] = 0;
+    }
+
+    (*used)++;
+}